@@ -4,8 +4,11 @@
  *
  * @details
  * - Reads an input image and overlays a banner image at specified coordinates.
- * - Supports RGBA images for input, output, and banner data.
+ * - Supports GRAYSCALE8, RGB24 and RGBA32 images for input and output,
+ *   a banner drawn over a GRAYSCALE8 image is written as luma.
  * - Utilizes side packets for providing the banner image and overlay positions.
+ * - The overlay lives in BannerKernel so it can also run as a
+ *   StaticPipeline stage.
  **********************************/
 
 #ifndef BANNER_H
@@ -17,6 +20,104 @@
 #include <sstream>
 #include <cassert>
 
+/**********************************
+ * @class BannerKernel
+ * @brief Overlays a banner image onto an image in place.
+ **********************************/
+class BannerKernel {
+private:
+    const Image* banner;    // Banner image, owned by the caller
+    int overlayStartX;      // X position of the banner
+    int overlayStartY;      // Y position of the banner
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param bannerImage The banner image, must outlive the kernel.
+     * @param startX X position of the banner.
+     * @param startY Y position of the banner.
+     **********************************/
+    BannerKernel(const Image& bannerImage, int startX, int startY)
+        : banner(&bannerImage), overlayStartX(startX), overlayStartY(startY) {}
+
+    /**********************************
+     * @brief Overlays the banner onto the image.
+     * The image may be GRAYSCALE8, RGB24 or RGBA32 and the banner RGB24
+     * or RGBA32, a banner without alpha is treated as opaque.
+     * @param image The image to modify in place.
+     **********************************/
+    void process(Image& image) const {
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto imageTag) {
+                dispatchPixelFormat<PixelFormat::RGB24, PixelFormat::RGBA32>(
+                    banner->getFormat(), [&](auto bannerTag) {
+                        processFormat<decltype(imageTag)::format,
+                                      decltype(bannerTag)::format>(image);
+                    });
+            });
+    }
+
+    /**********************************
+     * @brief Overlays the banner for known image and banner formats.
+     * @tparam F The pixel format of the image.
+     * @tparam B The pixel format of the banner.
+     * @param image The image to modify in place.
+     **********************************/
+    template <PixelFormat F, PixelFormat B>
+    void processFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        using BannerTraits = PixelFormatTraits<B>;
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t outputStride = image.getStride();
+        uint8_t* outputData = image.getData().data();
+
+        size_t bannerStride = banner->getStride();
+        const uint8_t* bannerData = banner->getData().data();
+
+        // Overlay the banner onto the image
+        for (size_t by = 0; by < (size_t)banner->getHeight(); ++by) {
+            size_t oy = overlayStartY + by;
+            if (oy >= height) continue;
+
+            for (size_t bx = 0; bx < (size_t)banner->getWidth(); ++bx) {
+                size_t ox = overlayStartX + bx;
+                if (ox >= width) continue;
+
+                // Calculate banner pixel and output pixel addresses
+                const uint8_t* bannerPixel =
+                    bannerData + (by * bannerStride) + (bx * BannerTraits::bytesPerPixel);
+                uint8_t bannerAlpha = 255;
+                if constexpr (BannerTraits::hasAlpha) {
+                    bannerAlpha = bannerPixel[BannerTraits::alphaOffset];
+                }
+
+                uint8_t* outputPixel =
+                    outputData + (oy * outputStride) + (ox * Traits::bytesPerPixel);
+
+                // Skip transparent banner pixels, copy the rest
+                if (bannerAlpha == 0) continue;
+
+                if constexpr (Traits::channels == 1) {
+                    outputPixel[0] = static_cast<uint8_t>(
+                        0.2126 * bannerPixel[BannerTraits::redOffset] +
+                        0.7152 * bannerPixel[BannerTraits::greenOffset] +
+                        0.0722 * bannerPixel[BannerTraits::blueOffset] + 0.5
+                    );
+                } else {
+                    outputPixel[Traits::redOffset] = bannerPixel[BannerTraits::redOffset];
+                    outputPixel[Traits::greenOffset] = bannerPixel[BannerTraits::greenOffset];
+                    outputPixel[Traits::blueOffset] = bannerPixel[BannerTraits::blueOffset];
+                    if constexpr (Traits::hasAlpha) {
+                        outputPixel[Traits::alphaOffset] = bannerAlpha;
+                    }
+                }
+            }
+        }
+    }
+};
+
 /**********************************
  * @class BannerCalculator
  * @brief A calculator class for overlaying a banner onto an image.
@@ -68,55 +169,15 @@ public:
         // Check if there is data in the input port
         if (inputPort.size() == 0) return;
 
-        // Read the input packet and extract the image
+        // Read the input packet and take the image out of it
         Packet inputPacket = inputPort.read();
-        Image outputImage = inputPacket.get<Image>();
+        Image outputImage = std::move(inputPacket.get<Image>());
 
-        // Retrieve the banner image and overlay positions from side packets
-        Image banner = cc->getSidePacket(kTagBanner).get<Image>();
+        // Overlay the banner image from the side packets
+        const Image& banner = cc->getSidePacket(kTagBanner).get<Image>();
         const int overlayStartX = cc->getSidePacket(kTagOverlayStartX).get<int>();
         const int overlayStartY = cc->getSidePacket(kTagOverlayStartY).get<int>();
-
-        // Retrieve image and banner properties
-        size_t outputPixelSize = Image::bitsPerPixel(outputImage.getFormat()) / 8;
-        if (outputPixelSize < 1) return;
-
-        size_t width = outputImage.getWidth();
-        size_t height = outputImage.getHeight();
-        size_t outputStride = outputPixelSize * width;
-        vector<uint8_t>& outputData = outputImage.getData();
-
-        size_t offsetSize = Image::bitsPerPixel(banner.getFormat()) / 8;
-        size_t bannerStride = offsetSize * banner.getWidth();
-        vector<uint8_t>& bannerData = banner.getData();
-
-        // Overlay the banner onto the image
-        for (size_t by = 0; by < (size_t)banner.getHeight(); ++by) {
-            size_t oy = overlayStartY + by;
-            if (oy >= height) continue;
-
-            for (size_t bx = 0; bx < banner.getWidth(); ++bx) {
-                size_t ox = overlayStartX + bx;
-                if (ox >= width) continue;
-
-                // Calculate banner pixel and output pixel indices
-                size_t bannerIndex = (by * bannerStride) + (bx * offsetSize);
-                uint8_t bannerRed = bannerData[bannerIndex];
-                uint8_t bannerGreen = bannerData[bannerIndex + 1];
-                uint8_t bannerBlue = bannerData[bannerIndex + 2];
-                uint8_t bannerAlpha = bannerData[bannerIndex + 3];
-
-                size_t outputIndex = (oy * outputStride) + (ox * outputPixelSize);
-
-                // Copy banner pixel data if alpha is non-zero
-                if (bannerAlpha != 0) {
-                    outputData[outputIndex] = bannerRed;
-                    outputData[outputIndex + 1] = bannerGreen;
-                    outputData[outputIndex + 2] = bannerBlue;
-                    outputData[outputIndex + 3] = bannerAlpha;
-                }
-            }
-        }
+        BannerKernel(banner, overlayStartX, overlayStartY).process(outputImage);
 
         // Write the modified image to the output port
         cc->getOutputPort(cc->kTagOutput).write(Packet(std::move(outputImage)));
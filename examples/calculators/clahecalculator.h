@@ -0,0 +1,341 @@
+/**********************************
+ * @file clahecalculator.h
+ * @brief Defines the ClaheCalculator class, which enhances local contrast
+ * with contrast limited adaptive histogram equalization.
+ *
+ * @details
+ * - The image is split in a grid of tiles, each tile gets a clipped
+ *   luma histogram and its own equalization LUT.
+ * - Tile histograms are computed in parallel, one band of tile rows
+ *   per thread.
+ * - Each pixel interpolates bilinearly between the LUTs of the four
+ *   nearest tile centers, in 8-bit fixed point.
+ * - Color images are equalized on their luma, the luma change is added
+ *   to every color channel. Alpha is left untouched.
+ * - Configured with the `claheTilesX`, `claheTilesY` and `claheClipLimit`
+ *   (float, multiple of the average bin count) side packets.
+ *   https://en.wikipedia.org/wiki/Adaptive_histogram_equalization
+ **********************************/
+
+#ifndef CLAHE_CALCULATOR_H
+#define CLAHE_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+#include "../../src/parallel.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+/**********************************
+ * @class ClaheKernel
+ * @brief Applies CLAHE to an image in place.
+ **********************************/
+class ClaheKernel {
+private:
+    int tilesX;         // Number of tile columns
+    int tilesY;         // Number of tile rows
+    float clipLimit;    // Histogram clip limit, relative to the average bin count
+
+    /**********************************
+     * @struct AxisWeights
+     * @brief Interpolation between tile centers along one axis.
+     **********************************/
+    struct AxisWeights {
+        vector<int32_t> first;      // Tile before the coordinate
+        vector<int32_t> second;     // Tile after the coordinate
+        vector<int32_t> weight;     // Weight of the second tile in [0, 256]
+    };
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param newTilesX Number of tile columns.
+     * @param newTilesY Number of tile rows.
+     * @param newClipLimit Clip limit, 1 disables the equalization and
+     * large values approach plain adaptive equalization.
+     **********************************/
+    ClaheKernel(int newTilesX = 8, int newTilesY = 8, float newClipLimit = 2.0f)
+        : tilesX(std::max(newTilesX, 1)), tilesY(std::max(newTilesY, 1)),
+          clipLimit(std::max(newClipLimit, 1.0f)) {}
+
+    /**********************************
+     * @brief Equalizes the image.
+     * Supports GRAYSCALE8, RGB24 and RGBA32, other formats are left untouched.
+     * A clip limit of 1 flattens every histogram, the image is returned as is.
+     * @param image The image to process in place.
+     **********************************/
+    void process(Image& image) const {
+        if (clipLimit <= 1.0f) return;
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                processFormat<decltype(tag)::format>(image);
+            });
+    }
+
+    /**********************************
+     * @brief Equalizes an image of a known format.
+     * @tparam F The pixel format of the image.
+     * @param image The image to process in place.
+     **********************************/
+    template <PixelFormat F>
+    void processFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        const int32_t width = image.getWidth();
+        const int32_t height = image.getHeight();
+        const size_t stride = image.getStride();
+        uint8_t* pixelData = image.getData().data();
+        if (width == 0 || height == 0) return;
+
+        const int32_t gridX = std::min(tilesX, width);
+        const int32_t gridY = std::min(tilesY, height);
+
+        // Luma plane, gray images are used as is
+        vector<uint8_t> lumaPlane;
+        const uint8_t* luma = pixelData;
+        size_t lumaStride = stride;
+        if constexpr (Traits::channels > 1) {
+            lumaPlane.resize(static_cast<size_t>(width) * height);
+            Parallel::forRows(height, [&](int32_t begin, int32_t end) {
+                for (int32_t row = begin; row < end; ++row) {
+                    const uint8_t* pixel = pixelData + row * stride;
+                    uint8_t* target = lumaPlane.data() + static_cast<size_t>(row) * width;
+                    for (int32_t col = 0; col < width; ++col, pixel += Traits::bytesPerPixel) {
+                        target[col] = lumaOf<Traits>(pixel);
+                    }
+                }
+            });
+            luma = lumaPlane.data();
+            lumaStride = width;
+        }
+
+        // One LUT per tile, tile rows are processed in parallel
+        vector<array<uint8_t, 256>> luts(static_cast<size_t>(gridX) * gridY);
+        Parallel::forRows(gridY, [&](int32_t begin, int32_t end) {
+            for (int32_t ty = begin; ty < end; ++ty) {
+                for (int32_t tx = 0; tx < gridX; ++tx) {
+                    buildTileLut(luma, lumaStride,
+                                 tx * width / gridX, (tx + 1) * width / gridX,
+                                 ty * height / gridY, (ty + 1) * height / gridY,
+                                 luts[ty * gridX + tx]);
+                }
+            }
+        }, 1);
+
+        const AxisWeights columns = axisWeights(width, gridX);
+        const AxisWeights rows = axisWeights(height, gridY);
+
+        Parallel::forRows(height, [&](int32_t begin, int32_t end) {
+            for (int32_t row = begin; row < end; ++row) {
+                const array<uint8_t, 256>* topLuts = luts.data() + rows.first[row] * gridX;
+                const array<uint8_t, 256>* bottomLuts = luts.data() + rows.second[row] * gridX;
+                const int32_t wy = rows.weight[row];
+                const uint8_t* lumaRow = luma + row * lumaStride;
+                uint8_t* pixel = pixelData + row * stride;
+
+                for (int32_t col = 0; col < width; ++col, pixel += Traits::bytesPerPixel) {
+                    const uint8_t value = lumaRow[col];
+                    const int32_t left = columns.first[col];
+                    const int32_t right = columns.second[col];
+                    const int32_t wx = columns.weight[col];
+                    const int32_t top = topLuts[left][value] * (256 - wx) + topLuts[right][value] * wx;
+                    const int32_t bottom = bottomLuts[left][value] * (256 - wx) + bottomLuts[right][value] * wx;
+                    const int32_t equalized = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+
+                    if constexpr (Traits::channels == 1) {
+                        pixel[0] = static_cast<uint8_t>(equalized);
+                    } else {
+                        const int32_t change = equalized - value;
+                        pixel[Traits::redOffset] = clampByte(pixel[Traits::redOffset] + change);
+                        pixel[Traits::greenOffset] = clampByte(pixel[Traits::greenOffset] + change);
+                        pixel[Traits::blueOffset] = clampByte(pixel[Traits::blueOffset] + change);
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    /**********************************
+     * @brief Computes the luma of a color pixel.
+     * @tparam Traits The traits of the pixel format.
+     * @param pixel Pointer to the pixel.
+     * @return BT.709 luma in 8-bit fixed point.
+     **********************************/
+    template <typename Traits>
+    static uint8_t lumaOf(const uint8_t* pixel) {
+        return static_cast<uint8_t>((54 * pixel[Traits::redOffset] +
+                                     183 * pixel[Traits::greenOffset] +
+                                     19 * pixel[Traits::blueOffset]) >> 8);
+    }
+
+    /**********************************
+     * @brief Builds the clipped equalization LUT of a tile.
+     * Counts above the clip limit are redistributed evenly over all bins.
+     * @param luma The luma plane.
+     * @param lumaStride Bytes per luma row.
+     * @param x0 First column of the tile.
+     * @param x1 One past the last column.
+     * @param y0 First row of the tile.
+     * @param y1 One past the last row.
+     * @param lut Receives the LUT.
+     **********************************/
+    void buildTileLut(const uint8_t* luma, size_t lumaStride, int32_t x0, int32_t x1,
+                      int32_t y0, int32_t y1, array<uint8_t, 256>& lut) const {
+        uint32_t histogram[256] = {};
+        for (int32_t y = y0; y < y1; ++y) {
+            const uint8_t* row = luma + y * lumaStride;
+            for (int32_t x = x0; x < x1; ++x) {
+                histogram[row[x]]++;
+            }
+        }
+
+        const uint32_t pixels = static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+        const uint32_t limit = std::max<uint32_t>(1, static_cast<uint32_t>(clipLimit * pixels / 256.0f));
+        uint32_t excess = 0;
+        for (uint32_t& count : histogram) {
+            if (count > limit) {
+                excess += count - limit;
+                count = limit;
+            }
+        }
+        const uint32_t share = excess / 256;
+        const uint32_t remainder = excess % 256;
+        for (uint32_t value = 0; value < 256; ++value) {
+            histogram[value] += share + (value < remainder ? 1 : 0);
+        }
+
+        // Bins map to their midpoint in the distribution, a flat histogram is the identity
+        uint32_t cumulative = 0;
+        for (size_t value = 0; value < 256; ++value) {
+            const uint64_t midpoint = 2 * static_cast<uint64_t>(cumulative) + histogram[value];
+            lut[value] = static_cast<uint8_t>((midpoint * 255 + pixels) / (2 * static_cast<uint64_t>(pixels)));
+            cumulative += histogram[value];
+        }
+    }
+
+    /**********************************
+     * @brief Computes the tiles and weights to interpolate along an axis.
+     * Coordinates before the first or after the last tile center use
+     * that tile alone.
+     * @param length Number of pixels along the axis.
+     * @param tiles Number of tiles along the axis.
+     * @return The per-coordinate tiles and weights.
+     **********************************/
+    static AxisWeights axisWeights(int32_t length, int32_t tiles) {
+        AxisWeights axis;
+        axis.first.resize(length);
+        axis.second.resize(length);
+        axis.weight.resize(length);
+
+        // Tile centers in half pixels, to stay in integers
+        vector<int32_t> centers(tiles);
+        for (int32_t t = 0; t < tiles; ++t) {
+            centers[t] = t * length / tiles + (t + 1) * length / tiles;
+        }
+
+        int32_t tile = 0;
+        for (int32_t i = 0; i < length; ++i) {
+            const int32_t position = 2 * i + 1;
+            while (tile + 1 < tiles && centers[tile + 1] <= position) tile++;
+            if (position <= centers[0]) {
+                axis.first[i] = axis.second[i] = 0;
+                axis.weight[i] = 0;
+            } else if (tile + 1 >= tiles) {
+                axis.first[i] = axis.second[i] = tiles - 1;
+                axis.weight[i] = 0;
+            } else {
+                axis.first[i] = tile;
+                axis.second[i] = tile + 1;
+                axis.weight[i] = (position - centers[tile]) * 256 / (centers[tile + 1] - centers[tile]);
+            }
+        }
+        return axis;
+    }
+
+    /**********************************
+     * @brief Clamps a value to a byte.
+     * @param value The value to clamp.
+     * @return The value in [0, 255].
+     **********************************/
+    static uint8_t clampByte(int32_t value) {
+        return static_cast<uint8_t>(std::clamp(value, 0, 255));
+    }
+};
+
+/**********************************
+ * @class ClaheCalculator
+ * @brief A calculator class for local contrast enhancement.
+ **********************************/
+class ClaheCalculator : public CalculatorBase {
+private:
+    const string kOutputEqualized = "ImageEqualized";   // Output port tag for the equalized image
+    const string kTilesX = "claheTilesX";               // Side packet tag for the tile columns
+    const string kTilesY = "claheTilesY";               // Side packet tag for the tile rows
+    const string kClipLimit = "claheClipLimit";         // Side packet tag for the clip limit (float)
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    ClaheCalculator(const string& calcName = "ClaheCalculator",
+                    const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputEqualized, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Equalizes the input image.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it
+        Packet inputPacket = inputPort.read();
+        Image outputImage = std::move(inputPacket.get<Image>());
+
+        const int tilesX = cc->hasSidePacket(kTilesX) ? cc->getSidePacket(kTilesX).get<int>() : 8;
+        const int tilesY = cc->hasSidePacket(kTilesY) ? cc->getSidePacket(kTilesY).get<int>() : 8;
+        const float clipLimit = cc->hasSidePacket(kClipLimit) ?
+            cc->getSidePacket(kClipLimit).get<float>() : 2.0f;
+        ClaheKernel(tilesX, tilesY, clipLimit).process(outputImage);
+
+        cc->getOutputPort(kOutputEqualized).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+#endif // CLAHE_CALCULATOR_H
@@ -3,9 +3,22 @@
  * @brief Defines the DitherCalculator class, which applies dithering to images.
  *
  * @details
- * - Supports dithering with configurable Bayer matrices.
+ * - Supports dithering with Bayer matrices of any power-of-two size
+ *   and with tileable blue-noise threshold maps.
+ * - The `thresholdTexture` side packet (an Image) dithers with a loaded
+ *   noise texture, `blueNoiseSize` generates a blue-noise map once.
+ *   Without them the Bayer matrix of `bayerLevel` is used.
  * - Adjustable color levels and spread for red, green, and blue channels.
+ * - GRAYSCALE8 input is dithered on its single channel using the
+ *   `grayCount` side packet, or the green levels when it is absent.
+ * - With the `ditherOutputBits` side packet set to 1, 2 or 4 the luma is
+ *   dithered to 2, 4 or 16 levels and emitted bit-packed as GRAYSCALE1,
+ *   GRAYSCALE2 or GRAYSCALE4.
+ * - With a spread of 0 dithering is plain per-channel quantization, the
+ *   calculator then exposes it as a PointLut for fusion.
  * - Processes image data to create a dithered output image.
+ * - The dithering lives in DitherKernel so it can also run as a
+ *   StaticPipeline stage.
  *   https://en.wikipedia.org/wiki/Dither
  **********************************/
 
@@ -15,66 +28,245 @@
 #include "../../src/calculatorbase.h"
 #include "../../src/image.h"
 #include "../../src/imageutils.h"
+#include "../../src/bitpacking.h"
+#include "../../src/thresholdmap.h"
+#include "../../src/pointlut.h"
 #include <sstream>
 #include <cassert>
 #include <cmath>
 
+/**********************************
+ * @class DitherKernel
+ * @brief Applies ordered dithering to an image in place.
+ **********************************/
+class DitherKernel {
+private:
+    /**********************************
+     * @struct QuantizeTable
+     * @brief Fixed-point quantizer for one channel.
+     * A value v and an expanded threshold t map to
+     * output[(scaled[v] + t) >> kFixedShift].
+     **********************************/
+    struct QuantizeTable {
+        uint32_t scaled[256];       // (levels - 1) * v / 255 in 16.16 fixed point
+        vector<uint8_t> output;     // Output value for every reachable level
+    };
+
+    int redLevels;      // Number of red levels
+    int greenLevels;    // Number of green levels
+    int blueLevels;     // Number of blue levels
+    int spread;         // Dithering spread
+    int grayLevels;     // Number of levels for single channel images
+    int outputBits;     // 1, 2 or 4 to emit packed gray, 0 to keep the format
+    const ThresholdMap* thresholds;     // Threshold map tiled over the image
+    QuantizeTable redTable;             // Quantizer for the red channel
+    QuantizeTable greenTable;           // Quantizer for the green channel
+    QuantizeTable blueTable;            // Quantizer for the blue channel
+    QuantizeTable grayTable;            // Quantizer for single channel images
+    QuantizeTable packedTable;          // Quantizer to level indexes for packed output
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param red Number of red levels.
+     * @param green Number of green levels.
+     * @param blue Number of blue levels.
+     * @param ditherSpread Dithering spread.
+     * @param level Bayer matrix level, the matrix side is 2 << level.
+     * @param gray Number of levels for GRAYSCALE8 images, 0 to use the green levels.
+     * @param packedBits 1, 2 or 4 to emit bit-packed gray, 0 to keep the format.
+     * @param thresholdMap Threshold map to use instead of the Bayer matrix, must outlive the kernel.
+     **********************************/
+    DitherKernel(int red, int green, int blue, int ditherSpread, int level, int gray = 0,
+                 int packedBits = 0, const ThresholdMap* thresholdMap = nullptr)
+        : redLevels(red), greenLevels(green), blueLevels(blue),
+          spread(std::max(ditherSpread, 0)),
+          grayLevels(gray > 0 ? gray : green),
+          outputBits(packedBits == 1 || packedBits == 2 || packedBits == 4 ? packedBits : 0),
+          thresholds(thresholdMap ? thresholdMap : &ThresholdMap::bayerForLevel(level)) {
+        buildTable(redTable, redLevels, false);
+        buildTable(greenTable, greenLevels, false);
+        buildTable(blueTable, blueLevels, false);
+        buildTable(grayTable, grayLevels, false);
+        buildTable(packedTable, 1 << std::max(outputBits, 1), true);
+    }
+
+    /**********************************
+     * @brief Applies dithering to the image.
+     * @param image The image to dither in place.
+     **********************************/
+    void process(Image& image) const {
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                if (outputBits != 0) {
+                    image = toPacked<decltype(tag)::format>(image);
+                } else {
+                    processFormat<decltype(tag)::format>(image);
+                }
+            });
+    }
+
+    /**********************************
+     * @brief Dithers the luma of an image into a bit-packed gray image.
+     * Each row is quantized into a level buffer and then packed.
+     * @tparam F The pixel format of the source image.
+     * @param image The source image.
+     * @return A GRAYSCALE1, GRAYSCALE2 or GRAYSCALE4 image.
+     **********************************/
+    template <PixelFormat F>
+    Image toPacked(const Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        const uint8_t* pixelData = image.getData().data();
+        PixelFormat packedFormat = outputBits == 1 ? PixelFormat::GRAYSCALE1 :
+                                   outputBits == 2 ? PixelFormat::GRAYSCALE2 :
+                                                     PixelFormat::GRAYSCALE4;
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t stride = image.getStride();
+        size_t packedStride = (width * outputBits + 7) / 8;
+        vector<uint8_t> packedData(packedStride * height);
+        vector<uint8_t> levelRow(width);
+        vector<uint32_t> thresholdRow(width);
+
+        for (size_t row = 0; row < height; ++row) {
+            const uint8_t* source = pixelData + row * stride;
+            thresholds->expandRow(row, width, spread, thresholdRow.data());
+            for (size_t col = 0; col < width; ++col) {
+                const uint8_t* pixel = source + col * Traits::bytesPerPixel;
+                uint8_t luma = pixel[0];
+                if constexpr (Traits::channels > 1) {
+                    luma = static_cast<uint8_t>(
+                        0.2126 * pixel[Traits::redOffset] +
+                        0.7152 * pixel[Traits::greenOffset] +
+                        0.0722 * pixel[Traits::blueOffset] + 0.5
+                    );
+                }
+                levelRow[col] = quantize(packedTable, luma, thresholdRow[col]);
+            }
+            BitPacking::packRow(levelRow.data(), width, outputBits,
+                                packedData.data() + row * packedStride);
+        }
+
+        return Image(image.getWidth(), image.getHeight(), packedFormat, std::move(packedData));
+    }
+
+    /**********************************
+     * @brief Applies dithering to an image of a known format.
+     * Alpha, when present, is left untouched.
+     * @tparam F The pixel format of the image.
+     * @param image The image to dither in place.
+     **********************************/
+    template <PixelFormat F>
+    void processFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* pixelData = image.getData().data();
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t stride = image.getStride();
+        vector<uint32_t> thresholdRow(width);
+
+        // Apply dithering
+        for (size_t row = 0; row < height; ++row) {
+            uint8_t* target = pixelData + row * stride;
+            thresholds->expandRow(row, width, spread, thresholdRow.data());
+            for (size_t col = 0; col < width; ++col) {
+                uint8_t* pixel = target + col * Traits::bytesPerPixel;
+                const uint32_t threshold = thresholdRow[col];
+
+                if constexpr (Traits::channels == 1) {
+                    pixel[0] = quantize(grayTable, pixel[0], threshold);
+                } else {
+                    pixel[Traits::redOffset] =
+                        quantize(redTable, pixel[Traits::redOffset], threshold);
+                    pixel[Traits::greenOffset] =
+                        quantize(greenTable, pixel[Traits::greenOffset], threshold);
+                    pixel[Traits::blueOffset] =
+                        quantize(blueTable, pixel[Traits::blueOffset], threshold);
+                }
+            }
+        }
+    }
+
+    /**********************************
+     * @brief Retrieves the kernel as a PointLut.
+     * Only possible without spread and packed output, the result then
+     * does not depend on the pixel position.
+     * @param lut Receives the LUT.
+     * @return True if the kernel is a point operation.
+     **********************************/
+    bool toPointLut(PointLut& lut) const {
+        if (spread != 0 || outputBits != 0) return false;
+        auto fill = [](array<uint8_t, 256>& table, const QuantizeTable& quantizer) {
+            for (size_t value = 0; value < 256; ++value) {
+                table[value] = quantize(quantizer, static_cast<uint8_t>(value), 0);
+            }
+        };
+        fill(lut.getTable(LutChannel::RED), redTable);
+        fill(lut.getTable(LutChannel::GREEN), greenTable);
+        fill(lut.getTable(LutChannel::BLUE), blueTable);
+        fill(lut.getTable(LutChannel::GRAY), grayTable);
+        return true;
+    }
+
+private:
+    /**********************************
+     * @brief Builds the quantizer of a channel.
+     * The level of a pixel is floor((levels - 1) * v / 255 + spread * t),
+     * with t the normalized threshold in [0, 1).
+     * @param table The table to fill.
+     * @param levels Number of output levels.
+     * @param toLevel True to output level indexes, false to output values in [0, 255].
+     **********************************/
+    void buildTable(QuantizeTable& table, int levels, bool toLevel) const {
+        levels = std::clamp(levels, 2, 256);
+        for (uint32_t value = 0; value < 256; ++value) {
+            table.scaled[value] = static_cast<uint32_t>(
+                (static_cast<uint64_t>(levels - 1) * value << ThresholdMap::kFixedShift) / 255);
+        }
+        // Levels past the top one are reached when spread is above 1
+        table.output.resize(levels + spread);
+        for (size_t level = 0; level < table.output.size(); ++level) {
+            int clamped = std::min(static_cast<int>(level), levels - 1);
+            table.output[level] = toLevel ? static_cast<uint8_t>(clamped) :
+                static_cast<uint8_t>((clamped / (levels - 1.0)) * 255.0);
+        }
+    }
+
+    /**********************************
+     * @brief Quantizes a channel value.
+     * @param table The quantizer of the channel.
+     * @param value The channel value.
+     * @param threshold Expanded threshold for the pixel.
+     * @return The dithered channel value or level index.
+     **********************************/
+    static uint8_t quantize(const QuantizeTable& table, uint8_t value, uint32_t threshold) {
+        return table.output[(table.scaled[value] + threshold) >> ThresholdMap::kFixedShift];
+    }
+};
+
 /**********************************
  * @class DitherCalculator
  * @brief A calculator class for applying dithering effects to images.
  **********************************/
-class DitherCalculator : public CalculatorBase {
+class DitherCalculator : public CalculatorBase, public PointOperation {
 private:
     const string kInputGrayscale = "ImageGrayscale";  // Input port tag for grayscale image
     const string kOutputDither = "ImageDither";       // Output port tag for dithered image
     const string kOutputPixel = "ImagePixel";         // Output port tag for pixelated image
 
-    // Bayer matrices for dithering
-    const int bayer2[2 * 2] = {
-        0, 2,
-        3, 1
-    };
-
-    const int bayer4[4 * 4] = {
-        0, 8, 2, 10,
-        12, 4, 14, 6,
-        3, 11, 1, 9,
-        15, 7, 13, 5
-    };
-
-    const int bayer8[8 * 8] = {
-        0, 32, 8, 40, 2, 34, 10, 42,
-        48, 16, 56, 24, 50, 18, 58, 26,
-        12, 44, 4, 36, 14, 46, 6, 38,
-        60, 28, 52, 20, 62, 30, 54, 22,
-        3, 35, 11, 43, 1, 33, 9, 41,
-        51, 19, 59, 27, 49, 17, 57, 25,
-        15, 47, 7, 39, 13, 45, 5, 37,
-        63, 31, 55, 23, 61, 29, 53, 21
-    };
-
     const string kRedLevels = "redCount";    // Side packet tag for red channel levels
     const string kGreenLevels = "greenCount"; // Side packet tag for green channel levels
     const string kBlueLevels = "blueCount";   // Side packet tag for blue channel levels
     const string kSpread = "spread";          // Side packet tag for dithering spread
     const string kBayerLevel = "bayerLevel";  // Side packet tag for Bayer matrix level
+    const string kGrayLevels = "grayCount";   // Side packet tag for single channel levels
+    const string kOutputBits = "ditherOutputBits"; // Side packet tag for packed output depth
+    const string kThresholdTexture = "thresholdTexture"; // Side packet tag for a threshold texture
+    const string kBlueNoiseSize = "blueNoiseSize";  // Side packet tag for a generated blue-noise size
 
-    /**********************************
-     * @brief Retrieves a Bayer matrix value based on level.
-     * @param x X-coordinate in the image.
-     * @param y Y-coordinate in the image.
-     * @param level Bayer matrix level (0 for 2x2, 1 for 4x4, 2 for 8x8).
-     * @return Normalized Bayer value.
-     **********************************/
-    float getBayerValue(int x, int y, int level) {
-        if (level == 0) {
-            return float(bayer2[(x % 2) + (y % 2) * 2]) / 4.0f - 0.5f;
-        } else if (level == 1) {
-            return float(bayer4[(x % 4) + (y % 4) * 4]) / 16.0f - 0.5f;
-        } else {
-            return float(bayer8[(x % 8) + (y % 8) * 8]) / 64.0f - 0.5f;
-        }
-    }
+    unique_ptr<ThresholdMap> thresholdMap;  // Texture or blue-noise map, built on first use
 
 public:
     /**********************************
@@ -111,59 +303,14 @@ public:
     void process(CalculatorContext* cc, float delta) override {
         Port& inputPort = cc->getInputPort(kOutputPixel);
 
-        // Retrieve side packet values
-        const int redLevels = cc->getSidePacket(kRedLevels).get<int>();
-        const int greenLevels = cc->getSidePacket(kGreenLevels).get<int>();
-        const int blueLevels = cc->getSidePacket(kBlueLevels).get<int>();
-        const int spread = cc->getSidePacket(kSpread).get<int>();
-        const int bayerLevel = cc->getSidePacket(kBayerLevel).get<int>();
-
         // Check if there is data in the input port
         if (inputPort.size() == 0) return;
 
-        // Read the input packet and extract the image
+        // Read the input packet and take the image out of it
         Packet inputPacket = inputPort.read();
-        Image outputImage = inputPacket.get<Image>();
-        std::vector<uint8_t>& pixelData = outputImage.getData();
-
-        size_t pixelSize = Image::bitsPerPixel(outputImage.getFormat()) / 8;
-        if (pixelSize < 1) return;
+        Image outputImage = std::move(inputPacket.get<Image>());
 
-        size_t width = outputImage.getWidth();
-        size_t height = outputImage.getHeight();
-        size_t realStride = pixelSize * width;
-        size_t dataSize = pixelData.size();
-
-        // Apply dithering
-        for (size_t i = 0; i < dataSize; i += pixelSize) {
-            size_t row = i / realStride;
-            size_t col = (i % realStride) / pixelSize;
-
-            if (row >= height) break;
-
-            uint8_t red = pixelData[i];
-            uint8_t green = pixelData[i + 1];
-            uint8_t blue = pixelData[i + 2];
-            uint8_t alpha = pixelData[i + 3];
-            float bayerValue = getBayerValue(row, col, bayerLevel);
-
-            uint8_t dr = static_cast<uint8_t>(
-                (floor((redLevels - 1.0) * (red / 255.0) + spread * (bayerValue + 0.5)) / (redLevels - 1.0)) * 255.0);
-            dr = clamp(dr, 0, 255);
-
-            uint8_t dg = static_cast<uint8_t>(
-                (floor((greenLevels - 1.0) * (green / 255.0) + spread * (bayerValue + 0.5)) / (greenLevels - 1.0)) * 255.0);
-            dg = clamp(dg, 0, 255);
-
-            uint8_t db = static_cast<uint8_t>(
-                (floor((blueLevels - 1.0) * (blue / 255.0) + spread * (bayerValue + 0.5)) / (blueLevels - 1.0)) * 255.0);
-            db = clamp(db, 0, 255);
-
-            pixelData[i] = dr;
-            pixelData[i + 1] = dg;
-            pixelData[i + 2] = db;
-            pixelData[i + 3] = alpha;
-        }
+        makeKernel(cc).process(outputImage);
 
         // Write the dithered image to the output port
         cc->getOutputPort(kOutputDither).write(Packet(std::move(outputImage)));
@@ -177,18 +324,57 @@ public:
      **********************************/
     void close(CalculatorContext* cc, float delta) override {}
 
+    /**********************************
+     * @brief Retrieves the quantization as a PointLut.
+     * @param cc Pointer to the calculator context.
+     * @param lut Receives the LUT.
+     * @return True if the spread is 0 and the output is not packed.
+     **********************************/
+    bool getPointLut(CalculatorContext* cc, PointLut& lut) override {
+        return makeKernel(cc).toPointLut(lut);
+    }
+
+    string getPointInputTag() const override { return kOutputPixel; }
+    string getPointOutputTag() const override { return kOutputDither; }
+
 private:
     /**********************************
-     * @brief Clamps a value between a minimum and maximum.
-     * @param value The value to clamp.
-     * @param min The minimum allowed value.
-     * @param max The maximum allowed value.
-     * @return The clamped value.
+     * @brief Builds the kernel from the side packets.
+     * @param cc Pointer to the calculator context.
+     * @return The configured kernel.
+     **********************************/
+    DitherKernel makeKernel(CalculatorContext* cc) {
+        // Retrieve side packet values
+        const int redLevels = cc->getSidePacket(kRedLevels).get<int>();
+        const int greenLevels = cc->getSidePacket(kGreenLevels).get<int>();
+        const int blueLevels = cc->getSidePacket(kBlueLevels).get<int>();
+        const int spread = cc->getSidePacket(kSpread).get<int>();
+        const int bayerLevel = cc->getSidePacket(kBayerLevel).get<int>();
+        const int grayLevels = cc->hasSidePacket(kGrayLevels) ?
+            cc->getSidePacket(kGrayLevels).get<int>() : 0;
+        const int outputBits = cc->hasSidePacket(kOutputBits) ?
+            cc->getSidePacket(kOutputBits).get<int>() : 0;
+        return DitherKernel(redLevels, greenLevels, blueLevels, spread, bayerLevel, grayLevels,
+                            outputBits, getThresholdMap(cc));
+    }
+
+    /**********************************
+     * @brief Retrieves the configured threshold map.
+     * Textures and blue noise are built once and reused for every frame.
+     * @param cc Pointer to the calculator context.
+     * @return The threshold map, or nullptr to use the Bayer matrix.
      **********************************/
-    uint8_t clamp(uint8_t value, uint8_t min, uint8_t max) {
-        if (value < min) return min;
-        if (value > max) return max;
-        return value;
+    const ThresholdMap* getThresholdMap(CalculatorContext* cc) {
+        if (!thresholdMap) {
+            if (cc->hasSidePacket(kThresholdTexture)) {
+                thresholdMap = make_unique<ThresholdMap>(
+                    ThresholdMap::fromImage(cc->getSidePacket(kThresholdTexture).get<Image>()));
+            } else if (cc->hasSidePacket(kBlueNoiseSize)) {
+                thresholdMap = make_unique<ThresholdMap>(
+                    ThresholdMap::blueNoise(cc->getSidePacket(kBlueNoiseSize).get<int>()));
+            }
+        }
+        return thresholdMap.get();
     }
 };
 
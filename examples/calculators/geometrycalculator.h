@@ -0,0 +1,196 @@
+/**********************************
+ * @file geometrycalculator.h
+ * @brief Defines the GeometryCalculator class, which rotates and mirrors
+ * images.
+ *
+ * @details
+ * - Supports 90, 180 and 270 degree clockwise rotations, horizontal and
+ *   vertical flips and the transpose.
+ * - 90 degree rotations are a blocked transpose of a vertically flipped
+ *   source view, 270 degree rotations a transpose into a vertically
+ *   flipped target view. The flip only changes the sign of the row stride.
+ * - Transposes run in parallel, each band of source rows fills a band of
+ *   target columns.
+ * - Flips and the 180 degree rotation work in place.
+ * - Configured with the `geometryTransform` side packet (GeometryTransform).
+ **********************************/
+
+#ifndef GEOMETRY_CALCULATOR_H
+#define GEOMETRY_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/imageview.h"
+#include "../../src/packet.h"
+#include "../../src/parallel.h"
+
+/**********************************
+ * @enum GeometryTransform
+ * @brief Geometric transforms, rotations are clockwise.
+ **********************************/
+enum class GeometryTransform {
+    NONE,
+    ROTATE_90,
+    ROTATE_180,
+    ROTATE_270,
+    FLIP_HORIZONTAL,
+    FLIP_VERTICAL,
+    TRANSPOSE
+};
+
+/**********************************
+ * @class GeometryKernel
+ * @brief Applies a geometric transform to an image.
+ **********************************/
+class GeometryKernel {
+private:
+    GeometryTransform transform;    // Transform to apply
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param newTransform The transform to apply.
+     **********************************/
+    explicit GeometryKernel(GeometryTransform newTransform) : transform(newTransform) {}
+
+    /**********************************
+     * @brief Transforms the image.
+     * Supports GRAYSCALE8, RGB24 and RGBA32, other formats are left untouched.
+     * Rotations by 90 and 270 degrees swap the width and the height.
+     * @param image The image to transform, replaced by the result.
+     **********************************/
+    void process(Image& image) const {
+        const PixelFormat format = image.getFormat();
+        if (format != PixelFormat::GRAYSCALE8 && format != PixelFormat::RGB24 &&
+            format != PixelFormat::RGBA32) {
+            return;
+        }
+
+        switch (transform) {
+            case GeometryTransform::NONE:
+                break;
+            case GeometryTransform::ROTATE_90: {
+                // target(x, y) = source(y, height - 1 - x)
+                Image rotated(image.getHeight(), image.getWidth(), format);
+                transpose(ConstImageView(image).flippedVertical(), ImageView(rotated));
+                image = std::move(rotated);
+                break;
+            }
+            case GeometryTransform::ROTATE_270: {
+                // target(x, y) = source(width - 1 - y, x)
+                Image rotated(image.getHeight(), image.getWidth(), format);
+                transpose(ConstImageView(image), ImageView(rotated).flippedVertical());
+                image = std::move(rotated);
+                break;
+            }
+            case GeometryTransform::ROTATE_180:
+                ImageTransform::flipVertical(ImageView(image));
+                ImageTransform::flipHorizontal(ImageView(image));
+                break;
+            case GeometryTransform::FLIP_HORIZONTAL:
+                ImageTransform::flipHorizontal(ImageView(image));
+                break;
+            case GeometryTransform::FLIP_VERTICAL:
+                ImageTransform::flipVertical(ImageView(image));
+                break;
+            case GeometryTransform::TRANSPOSE: {
+                Image transposed(image.getHeight(), image.getWidth(), format);
+                transpose(ConstImageView(image), ImageView(transposed));
+                image = std::move(transposed);
+                break;
+            }
+        }
+    }
+
+private:
+    /**********************************
+     * @brief Transposes a view into another, one band of rows per thread.
+     * @param source The view to transpose.
+     * @param targetView The target, source height by source width, may be flipped.
+     **********************************/
+    static void transpose(const ConstImageView& source, const ImageView& targetView) {
+        const size_t bytesPerPixel = Image::bitsPerPixel(source.getFormat()) / 8;
+
+        // Source rows [begin, end) become target columns [begin, end)
+        Parallel::forRows(source.getHeight(), [&](int32_t begin, int32_t end) {
+            ConstImageView sourceBand(source.row(begin), source.getWidth(), end - begin,
+                                      source.getFormat(), source.getStride());
+            ImageView targetBand(targetView.row(0) + begin * bytesPerPixel, end - begin,
+                                 targetView.getHeight(), targetView.getFormat(),
+                                 targetView.getStride());
+            ImageTransform::transpose(sourceBand, targetBand);
+        }, ImageTransform::kTileSize);
+    }
+};
+
+/**********************************
+ * @class GeometryCalculator
+ * @brief A calculator class for image rotations and flips.
+ **********************************/
+class GeometryCalculator : public CalculatorBase {
+private:
+    const string kOutputTransformed = "ImageTransformed";   // Output port tag for the transformed image
+    const string kTransform = "geometryTransform";          // Side packet tag for the GeometryTransform
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    GeometryCalculator(const string& calcName = "GeometryCalculator",
+                       const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputTransformed, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Rotates or mirrors the input image.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it
+        Packet inputPacket = inputPort.read();
+        Image outputImage = std::move(inputPacket.get<Image>());
+
+        const GeometryTransform transform = cc->hasSidePacket(kTransform) ?
+            cc->getSidePacket(kTransform).get<GeometryTransform>() : GeometryTransform::NONE;
+        GeometryKernel(transform).process(outputImage);
+
+        cc->getOutputPort(kOutputTransformed).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+#endif // GEOMETRY_CALCULATOR_H
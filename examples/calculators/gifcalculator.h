@@ -0,0 +1,168 @@
+/**********************************
+ * @file gifcalculator.h
+ * @brief Defines the GifCalculator class, which records the frames it
+ * receives as an animated GIF.
+ *
+ * @details
+ * - Maps every frame to palette indexes and hands them to a GifWriter,
+ *   which encodes and writes on its own thread. The frame packet is
+ *   forwarded untouched (no copy) to `ImageGif`.
+ * - The palette is chosen on the first frame. Packed gray frames (see
+ *   `ditherOutputBits`) use their own levels, GRAYSCALE8 frames use
+ *   `grayCount` gray levels and color frames the `redCount`, `greenCount`
+ *   and `blueCount` lattice, the same side packets DitherCalculator
+ *   reads, so its output is stored without further loss. Without them,
+ *   or past 255 colors, a 6x7x6 lattice is used.
+ * - Frame delays come from the packet timestamps.
+ * - close() finishes the file once `gifFrames` frames are recorded, open
+ *   ended recordings are finished with finish(). Both throw the encoding
+ *   and write errors of the writer thread. A calculator destroyed before
+ *   that still finishes the file, but errors are dropped.
+ * - String side packet `gifPath` (required), int side packets `gifLoop`
+ *   (default 0, loop forever) and `gifFrames` (default 0, no limit).
+ **********************************/
+
+#ifndef GIF_CALCULATOR_H
+#define GIF_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/gif.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+
+/**********************************
+ * @class GifCalculator
+ * @brief A calculator class writing an animated GIF.
+ **********************************/
+class GifCalculator : public CalculatorBase {
+private:
+    const string kOutputFrame = "ImageGif";     // Output port tag for the forwarded frame
+    const string kPath = "gifPath";             // Side packet tag for the file path
+    const string kLoop = "gifLoop";             // Side packet tag for the loop count
+    const string kFrames = "gifFrames";         // Side packet tag for the number of frames to record
+    const string kRedLevels = "redCount";       // Side packet tag for red levels
+    const string kGreenLevels = "greenCount";   // Side packet tag for green levels
+    const string kBlueLevels = "blueCount";     // Side packet tag for blue levels
+    const string kGrayLevels = "grayCount";     // Side packet tag for gray levels
+
+    string inputTag;                    // Tag of the input port read by the calculator
+    unique_ptr<GifPalette> palette;     // Chosen on the first frame
+    unique_ptr<GifWriter> writer;       // Created on the first frame
+    size_t recordedFrames = 0;          // Frames handed to the writer
+    bool finished = false;              // The file is complete, later frames are only forwarded
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    GifCalculator(const string& calcName = "GifCalculator", const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputFrame, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Queues the frame for the GIF writer and forwards it.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     * @throws runtime_error if the file cannot be opened or the writer failed.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        Packet inputPacket = inputPort.read();
+        if (!finished) {
+            const Image& image = inputPacket.get<Image>();
+            if (!writer) {
+                palette = make_unique<GifPalette>(choosePalette(cc, image));
+                writer = make_unique<GifWriter>(cc->getSidePacket(kPath).get<string>(), image.getWidth(),
+                                                image.getHeight(), *palette, getInt(cc, kLoop, 0));
+            }
+
+            vector<uint8_t> indexes;
+            palette->map(image, indexes);
+            writer->addFrame(std::move(indexes), inputPacket.getTimestamp());
+            recordedFrames++;
+        }
+
+        cc->getOutputPort(kOutputFrame).write(std::move(inputPacket));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * Finishes the file once `gifFrames` frames are recorded.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     * @throws runtime_error if encoding or writing the file failed.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {
+        const int frames = getInt(cc, kFrames, 0);
+        if (frames > 0 && recordedFrames >= static_cast<size_t>(frames)) finish();
+    }
+
+    /**********************************
+     * @brief Encodes the queued frames and writes the end of the file.
+     * Frames received afterwards are forwarded without being recorded.
+     * @throws runtime_error if encoding or writing the file failed.
+     **********************************/
+    void finish() {
+        if (finished) return;
+        finished = true;
+        if (writer) writer->close();
+    }
+
+private:
+    /**********************************
+     * @brief Chooses the palette matching the first frame.
+     * @param cc Pointer to the calculator context.
+     * @param image The first frame.
+     * @return The palette.
+     **********************************/
+    GifPalette choosePalette(CalculatorContext* cc, const Image& image) const {
+        const int bits = Image::bitsPerPixel(image.getFormat());
+        if (bits > 0 && bits < 8) {
+            return GifPalette::gray(1 << bits);
+        }
+        if (image.getFormat() == PixelFormat::GRAYSCALE8) {
+            const int gray = getInt(cc, kGrayLevels, getInt(cc, kGreenLevels, 255));
+            return GifPalette::gray(std::clamp(gray, 2, 255));
+        }
+        const int red = getInt(cc, kRedLevels, 0);
+        const int green = getInt(cc, kGreenLevels, 0);
+        const int blue = getInt(cc, kBlueLevels, 0);
+        if (red >= 2 && green >= 2 && blue >= 2 && red * green * blue <= 255) {
+            return GifPalette(red, green, blue);
+        }
+        return GifPalette(6, 7, 6);
+    }
+
+    /**********************************
+     * @brief Reads an optional int side packet.
+     **********************************/
+    static int getInt(CalculatorContext* cc, const string& tag, int fallback) {
+        return cc->hasSidePacket(tag) ? cc->getSidePacket(tag).get<int>() : fallback;
+    }
+};
+
+#endif // GIF_CALCULATOR_H
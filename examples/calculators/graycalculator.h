@@ -7,6 +7,10 @@
  * - Processes input image data and computes grayscale values.
  * - Uses a weighted formula to calculate grayscale based on RGB values.
  * - Outputs the grayscale image through a specified port.
+ * - Optionally emits a single channel GRAYSCALE8 image (1 byte per pixel)
+ *   when the `grayscaleSingleChannel` side packet is set to 1.
+ * - The conversion lives in GrayscaleKernel so it can also run as a
+ *   StaticPipeline stage.
  *   https://en.wikipedia.org/wiki/Grayscale
  **********************************/
 
@@ -20,6 +24,107 @@
 #include <sstream>
 #include <cassert>
 
+/**********************************
+ * @class GrayscaleKernel
+ * @brief Converts an image to grayscale in place.
+ **********************************/
+class GrayscaleKernel {
+private:
+    bool singleChannel;     // Emit GRAYSCALE8 instead of converting in place
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param emitSingleChannel True to replace the image with a GRAYSCALE8 image.
+     **********************************/
+    explicit GrayscaleKernel(bool emitSingleChannel = false)
+        : singleChannel(emitSingleChannel) {}
+
+    /**********************************
+     * @brief Converts the image to grayscale.
+     * Supports RGB24 and RGBA32, other formats are left untouched.
+     * In single channel mode the image is replaced by a GRAYSCALE8 image.
+     * @param image The image to convert.
+     **********************************/
+    void process(Image& image) const {
+        dispatchPixelFormat<PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                if (singleChannel) {
+                    image = toGrayscale8<decltype(tag)::format>(image);
+                } else {
+                    processFormat<decltype(tag)::format>(image);
+                }
+            });
+    }
+
+    /**********************************
+     * @brief Converts an image of a known format to a GRAYSCALE8 image.
+     * Alpha is dropped.
+     * @tparam F The pixel format of the source image.
+     * @param image The source image.
+     * @return A single channel image with the luma of every pixel.
+     **********************************/
+    template <PixelFormat F>
+    Image toGrayscale8(const Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        const uint8_t* pixelData = image.getData().data();
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t stride = image.getStride();
+        vector<uint8_t> grayData(width * height);
+
+        for (size_t y = 0; y < height; ++y) {
+            const uint8_t* row = pixelData + y * stride;
+            uint8_t* grayRow = grayData.data() + y * width;
+            for (size_t x = 0; x < width; ++x) {
+                const uint8_t* pixel = row + x * Traits::bytesPerPixel;
+                grayRow[x] = static_cast<uint8_t>(
+                    0.2126 * pixel[Traits::redOffset] +
+                    0.7152 * pixel[Traits::greenOffset] +
+                    0.0722 * pixel[Traits::blueOffset] + 0.5
+                );
+            }
+        }
+        return Image(image.getWidth(), image.getHeight(), PixelFormat::GRAYSCALE8,
+                     std::move(grayData));
+    }
+
+    /**********************************
+     * @brief Converts an image of a known format to grayscale.
+     * Alpha, when present, is left untouched.
+     * @tparam F The pixel format of the image.
+     * @param image The image to convert in place.
+     **********************************/
+    template <PixelFormat F>
+    void processFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* pixelData = image.getData().data();
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t stride = image.getStride();
+
+        // Convert to grayscale
+        for (size_t y = 0; y < height; ++y) {
+            uint8_t* row = pixelData + y * stride;
+            for (size_t x = 0; x < width; ++x) {
+                uint8_t* pixel = row + x * Traits::bytesPerPixel;
+
+                uint8_t gray = static_cast<uint8_t>(
+                    0.2126 * pixel[Traits::redOffset] +
+                    0.7152 * pixel[Traits::greenOffset] +
+                    0.0722 * pixel[Traits::blueOffset] + 0.5
+                );
+
+                pixel[Traits::redOffset] = gray;
+                pixel[Traits::greenOffset] = gray;
+                pixel[Traits::blueOffset] = gray;
+            }
+        }
+    }
+};
+
 /**********************************
  * @class GrayscaleCalculator
  * @brief A calculator class for converting images to grayscale.
@@ -29,6 +134,7 @@ private:
     const string kOutputGrayscale = "ImageGrayscale"; // Output port tag for grayscale image
     const string kOutputDither = "ImageDither";       // Output port tag for dithered image
     const string kOutputPixel = "ImagePixel";         // Output port tag for pixelated image
+    const string kSingleChannel = "grayscaleSingleChannel"; // Side packet tag for GRAYSCALE8 output
 
 public:
     /**********************************
@@ -68,41 +174,13 @@ public:
         // Check if there is data in the input port
         if (inputPort.size() == 0) return;
 
-        // Read the input packet and extract the image
+        // Read the input packet and take the image out of it
         Packet inputPacket = inputPort.read();
-        Image outputImage = inputPacket.get<Image>();
-        std::vector<uint8_t>& pixelData = outputImage.getData();
+        Image outputImage = std::move(inputPacket.get<Image>());
 
-        size_t pixelSize = Image::bitsPerPixel(outputImage.getFormat()) / 8;
-        if (pixelSize < 1) return;
-
-        size_t width = outputImage.getWidth();
-        size_t height = outputImage.getHeight();
-        size_t realStride = pixelSize * width;
-
-
-        // Convert to grayscale
-        for (size_t x = 0; x < width; ++x) {
-            for (size_t y = 0; y < height; ++y) {
-                size_t i = (y * realStride) + (x * pixelSize);
-
-                uint8_t red = pixelData[i];
-                uint8_t green = pixelData[i + 1];
-                uint8_t blue = pixelData[i + 2];
-                uint8_t alpha = pixelData[i + 3];
-
-                uint8_t gray = static_cast<uint8_t>(
-                    0.2126 * red +
-                    0.7152 * green +
-                    0.0722 * blue
-                );
-
-                pixelData[i] = gray;
-                pixelData[i + 1] = gray;
-                pixelData[i + 2] = gray;
-                pixelData[i + 3] = alpha;
-            }
-        }
+        bool singleChannel = cc->hasSidePacket(kSingleChannel) &&
+                             cc->getSidePacket(kSingleChannel).get<int>() != 0;
+        GrayscaleKernel(singleChannel).process(outputImage);
 
         // Write the grayscale image to the output port
         cc->getOutputPort(kOutputGrayscale).write(Packet(std::move(outputImage)));
@@ -0,0 +1,95 @@
+/**********************************
+ * @file integralimagecalculator.h
+ * @brief Defines the IntegralImageCalculator class, which attaches the
+ * summed-area table of each frame to its packet.
+ *
+ * @details
+ * - Builds the IntegralImage once per frame and attaches it to the frame
+ *   packet under `integralImage`, the packet itself is forwarded without
+ *   copying the image.
+ * - Downstream calculators that read the frame without modifying it
+ *   first (e.g. PixelShapeCalculator square blocks) reuse the table.
+ * - Calculators that emit a new packet drop the attachment, so a stale
+ *   table never travels with modified pixels.
+ **********************************/
+
+#ifndef INTEGRAL_IMAGE_CALCULATOR_H
+#define INTEGRAL_IMAGE_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/integralimage.h"
+#include "../../src/packet.h"
+
+/**********************************
+ * @class IntegralImageCalculator
+ * @brief A calculator class attaching integral images to frames.
+ **********************************/
+class IntegralImageCalculator : public CalculatorBase {
+private:
+    const string kOutputFrame = "ImageIntegral";        // Output port tag for the forwarded frame
+    const string kIntegralImage = "integralImage";      // Packet attachment tag for the IntegralImage
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    IntegralImageCalculator(const string& calcName = "IntegralImageCalculator",
+                            const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputFrame, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Attaches the integral image of the input frame and forwards it.
+     * Unsupported formats are forwarded without an attachment.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        Packet inputPacket = inputPort.read();
+        const Image& image = inputPacket.get<Image>();
+        const PixelFormat format = image.getFormat();
+        if (format == PixelFormat::GRAYSCALE8 || format == PixelFormat::RGB24 ||
+            format == PixelFormat::RGBA32) {
+            inputPacket.attach(kIntegralImage, IntegralImage(image));
+        }
+
+        cc->getOutputPort(kOutputFrame).write(std::move(inputPacket));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+#endif // INTEGRAL_IMAGE_CALCULATOR_H
@@ -0,0 +1,174 @@
+/**********************************
+ * @file levelscalculator.h
+ * @brief Defines the LevelsCalculator class, which remaps the tonal
+ * range of images.
+ *
+ * @details
+ * - Maps the [black, white] input range onto [0, 255], values outside
+ *   the range are clipped.
+ * - Applies a gamma correction and an optional posterization.
+ * - Configured with the `levelsBlack`, `levelsWhite`, `levelsGamma`
+ *   (float) and `levelsPosterize` side packets, all optional.
+ * - The mapping is a PointLut, so consecutive LevelsCalculators (and
+ *   other point operations) are fused by Scheduler::compilePointOperations().
+ *   https://en.wikipedia.org/wiki/Image_editing#Contrast_change_and_brightening
+ **********************************/
+
+#ifndef LEVELS_CALCULATOR_H
+#define LEVELS_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+#include "../../src/pointlut.h"
+#include <algorithm>
+#include <cmath>
+
+/**********************************
+ * @class LevelsKernel
+ * @brief Remaps the tonal range of an image in place through a PointLut.
+ **********************************/
+class LevelsKernel {
+private:
+    PointLut lut;   // Precomputed mapping for every channel value
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param black Input value mapped to 0.
+     * @param white Input value mapped to 255.
+     * @param gamma Gamma correction, 1 keeps the midtones.
+     * @param posterize Number of output levels, 0 to disable posterization.
+     **********************************/
+    LevelsKernel(int black = 0, int white = 255, float gamma = 1.0f, int posterize = 0) {
+        black = std::clamp(black, 0, 254);
+        white = std::clamp(white, black + 1, 255);
+        const double inverseGamma = gamma > 0.0f ? 1.0 / gamma : 1.0;
+        lut.setColor([&](uint8_t value) {
+            double x = std::clamp((value - black) / double(white - black), 0.0, 1.0);
+            x = pow(x, inverseGamma);
+            if (posterize >= 2) {
+                x = round(x * (posterize - 1)) / (posterize - 1);
+            }
+            return static_cast<uint8_t>(lround(x * 255.0));
+        });
+    }
+
+    /**********************************
+     * @brief Retrieves the mapping as a PointLut.
+     * @return The LUT applied by the kernel.
+     **********************************/
+    const PointLut& getLut() const {
+        return lut;
+    }
+
+    /**********************************
+     * @brief Remaps the image. Alpha is left untouched.
+     * @param image The image to process in place.
+     **********************************/
+    void process(Image& image) const {
+        lut.apply(image);
+    }
+};
+
+/**********************************
+ * @class LevelsCalculator
+ * @brief A calculator class for levels, gamma and posterize adjustments.
+ **********************************/
+class LevelsCalculator : public CalculatorBase, public PointOperation {
+private:
+    const string kOutputLevels = "ImageLevels";   // Output port tag for the adjusted image
+    const string kBlack = "levelsBlack";          // Side packet tag for the black point
+    const string kWhite = "levelsWhite";          // Side packet tag for the white point
+    const string kGamma = "levelsGamma";          // Side packet tag for the gamma (float)
+    const string kPosterize = "levelsPosterize";  // Side packet tag for the posterize levels
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    LevelsCalculator(const string& calcName = "LevelsCalculator",
+                     const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputLevels, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Applies the levels adjustment to the input image.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it
+        Packet inputPacket = inputPort.read();
+        Image outputImage = std::move(inputPacket.get<Image>());
+
+        makeKernel(cc).process(outputImage);
+
+        cc->getOutputPort(kOutputLevels).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Retrieves the levels adjustment as a PointLut.
+     * @param cc Pointer to the calculator context.
+     * @param lut Receives the LUT.
+     * @return Always true, levels are a point operation.
+     **********************************/
+    bool getPointLut(CalculatorContext* cc, PointLut& lut) override {
+        lut = makeKernel(cc).getLut();
+        return true;
+    }
+
+    string getPointInputTag() const override { return inputTag; }
+    string getPointOutputTag() const override { return kOutputLevels; }
+
+private:
+    /**********************************
+     * @brief Builds the kernel from the side packets.
+     * @param cc Pointer to the calculator context.
+     * @return The configured kernel.
+     **********************************/
+    LevelsKernel makeKernel(CalculatorContext* cc) const {
+        const int black = cc->hasSidePacket(kBlack) ? cc->getSidePacket(kBlack).get<int>() : 0;
+        const int white = cc->hasSidePacket(kWhite) ? cc->getSidePacket(kWhite).get<int>() : 255;
+        const float gamma = cc->hasSidePacket(kGamma) ? cc->getSidePacket(kGamma).get<float>() : 1.0f;
+        const int posterize = cc->hasSidePacket(kPosterize) ?
+            cc->getSidePacket(kPosterize).get<int>() : 0;
+        return LevelsKernel(black, white, gamma, posterize);
+    }
+};
+
+#endif // LEVELS_CALCULATOR_H
@@ -0,0 +1,120 @@
+/**********************************
+ * @file lut3dcalculator.h
+ * @brief Defines the Lut3DCalculator class, which color grades images
+ * with a 3D lookup table.
+ *
+ * @details
+ * - The LUT is loaded once, typically from a `.cube` file with
+ *   Lut3D::fromCubeFile(), and passed as the `lut3d` side packet.
+ * - Colors are mapped with tetrahedral interpolation in fixed point,
+ *   row bands are processed in parallel.
+ * - Alpha is left untouched, GRAYSCALE8 images are passed through.
+ * - The grading lives in Lut3DKernel so it can also run as a
+ *   StaticPipeline stage.
+ *   https://en.wikipedia.org/wiki/Color_grading
+ **********************************/
+
+#ifndef LUT3D_CALCULATOR_H
+#define LUT3D_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+#include "../../src/lut3d.h"
+
+/**********************************
+ * @class Lut3DKernel
+ * @brief Applies a 3D LUT to an image in place.
+ **********************************/
+class Lut3DKernel {
+private:
+    const Lut3D* lut;   // The LUT, owned by the caller
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param newLut The LUT to apply, must outlive the kernel.
+     **********************************/
+    explicit Lut3DKernel(const Lut3D& newLut) : lut(&newLut) {}
+
+    /**********************************
+     * @brief Grades the image.
+     * Supports RGB24 and RGBA32, other formats are left untouched.
+     * @param image The image to process in place.
+     **********************************/
+    void process(Image& image) const {
+        if (image.getFormat() == PixelFormat::RGB24 || image.getFormat() == PixelFormat::RGBA32) {
+            lut->apply(image);
+        }
+    }
+};
+
+/**********************************
+ * @class Lut3DCalculator
+ * @brief A calculator class for 3D LUT color grading.
+ **********************************/
+class Lut3DCalculator : public CalculatorBase {
+private:
+    const string kOutputGraded = "ImageGraded";   // Output port tag for the graded image
+    const string kLut = "lut3d";                  // Side packet tag for the Lut3D
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    Lut3DCalculator(const string& calcName = "Lut3DCalculator",
+                    const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputGraded, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Grades the input image with the LUT side packet.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it
+        Packet inputPacket = inputPort.read();
+        Image outputImage = std::move(inputPacket.get<Image>());
+
+        Lut3DKernel(cc->getSidePacket(kLut).get<Lut3D>()).process(outputImage);
+
+        cc->getOutputPort(kOutputGraded).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+#endif // LUT3D_CALCULATOR_H
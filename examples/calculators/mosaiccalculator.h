@@ -0,0 +1,481 @@
+/**********************************
+ * @file mosaiccalculator.h
+ * @brief Defines the MosaicCalculator class, which composites several
+ * feeds into one grid image.
+ *
+ * @details
+ * - Reads N input ports, `ImageMosaicInput0` to `ImageMosaicInput<N-1>`,
+ *   connected to the producers with Scheduler::connect() or written with
+ *   Scheduler::writeToInputPort(calcName, tag, packet).
+ * - Each source is scaled straight into its cell of the output frame
+ *   through an ImageView over the cell, there is no intermediate image.
+ *   Sources already at the cell size are copied row by row.
+ * - Output frames come from a FramePool. Consumers that return frames
+ *   with FramePool::release() make steady state compositing allocation
+ *   free, the pool can be shared through the `mosaicFramePool` side packet.
+ * - Rows of the output are rendered in parallel bands.
+ * - Sync policies (`mosaicSync` side packet, MosaicSync):
+ *   - LATEST: emits whenever any input delivered a frame, every cell shows
+ *     the latest frame of its input.
+ *   - ALIGNED: emits only sets with one frame per input whose timestamps
+ *     are within `mosaicSyncWindow` (int, microseconds, default one frame
+ *     at 60 fps). Frames too old to ever be aligned are dropped.
+ * - Optional int side packets `mosaicColumns` (default ceil(sqrt(N))),
+ *   `mosaicCellWidth` and `mosaicCellHeight` (default 480x270, a 4x4 grid
+ *   fills a 1080p frame), and `mosaicScaling` (MosaicScaling).
+ *
+ * Constraints:
+ * - Sources may be GRAYSCALE8, RGB24 or RGBA32, the output is RGBA32.
+ *   Cells without a frame yet, or with another format, are opaque black.
+ * - Register the producers before the MosaicCalculator, the Scheduler
+ *   runs calculators in registration order.
+ **********************************/
+
+#ifndef MOSAIC_CALCULATOR_H
+#define MOSAIC_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/framepool.h"
+#include "../../src/image.h"
+#include "../../src/imageview.h"
+#include "../../src/packet.h"
+#include "../../src/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**********************************
+ * @enum MosaicSync
+ * @brief When the MosaicCalculator emits a frame.
+ **********************************/
+enum class MosaicSync {
+    LATEST,
+    ALIGNED
+};
+
+/**********************************
+ * @enum MosaicScaling
+ * @brief How sources are resized to the cell size.
+ * - NEAREST: one source pixel per cell pixel.
+ * - AREA: each cell pixel averages the source pixels it covers.
+ **********************************/
+enum class MosaicScaling {
+    NEAREST,
+    AREA
+};
+
+/**********************************
+ * @class MosaicKernel
+ * @brief Renders sources into the cells of a grid.
+ **********************************/
+class MosaicKernel {
+private:
+    static const uint32_t kExactReciprocalArea = 4096;  // Multiplying by the reciprocal is exact below this footprint
+
+    int32_t columns;        // Cells per grid row
+    int32_t cellWidth;      // Cell width in pixels
+    int32_t cellHeight;     // Cell height in pixels
+    MosaicScaling scaling;  // Resize filter
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param newColumns Cells per grid row.
+     * @param newCellWidth Cell width in pixels.
+     * @param newCellHeight Cell height in pixels.
+     * @param newScaling Resize filter.
+     * @throws ImageException if a size is below 1.
+     **********************************/
+    MosaicKernel(int32_t newColumns, int32_t newCellWidth, int32_t newCellHeight,
+                 MosaicScaling newScaling = MosaicScaling::AREA)
+        : columns(newColumns), cellWidth(newCellWidth), cellHeight(newCellHeight),
+          scaling(newScaling) {
+        if (columns < 1 || cellWidth < 1 || cellHeight < 1) {
+            throw ImageException("Error MosaicKernel: Grid and cell sizes must be at least 1.");
+        }
+    }
+
+    /**********************************
+     * @brief Retrieves the width of the composite.
+     * @return Columns times the cell width.
+     **********************************/
+    int32_t getOutputWidth() const {
+        return columns * cellWidth;
+    }
+
+    /**********************************
+     * @brief Retrieves the height of the composite.
+     * @param sourceCount Number of cells.
+     * @return Grid rows times the cell height.
+     **********************************/
+    int32_t getOutputHeight(int32_t sourceCount) const {
+        return max(1, (sourceCount + columns - 1) / columns) * cellHeight;
+    }
+
+    /**********************************
+     * @brief Renders every source into its cell, in row major order.
+     * Every pixel of the output is written.
+     * @param sources One image per cell, nullptr for an empty cell.
+     * @param output RGBA32 image of getOutputWidth() x getOutputHeight().
+     * @throws ImageException if the output does not match the grid.
+     **********************************/
+    void compose(const vector<const Image*>& sources, Image& output) const {
+        const int32_t sourceCount = static_cast<int32_t>(sources.size());
+        if (output.getFormat() != PixelFormat::RGBA32 || output.getWidth() != getOutputWidth() ||
+            output.getHeight() != getOutputHeight(sourceCount)) {
+            throw ImageException("Error MosaicKernel: Output does not match the grid.");
+        }
+
+        const ImageView outputView(output);
+        Parallel::forRows(output.getHeight(), [&](int32_t begin, int32_t end) {
+            vector<uint32_t> columnSums;
+            for (int32_t y = begin; y < end;) {
+                const int32_t gridRow = y / cellHeight;
+                const int32_t cellBegin = y - gridRow * cellHeight;
+                const int32_t cellEnd = min(cellHeight, end - gridRow * cellHeight);
+                for (int32_t gridColumn = 0; gridColumn < columns; ++gridColumn) {
+                    const int32_t cellIndex = gridRow * columns + gridColumn;
+                    const ImageView cell = outputView.subView(gridColumn * cellWidth,
+                                                              gridRow * cellHeight, cellWidth, cellHeight);
+                    renderRows(cellIndex < sourceCount ? sources[cellIndex] : nullptr,
+                               cell, cellBegin, cellEnd, columnSums);
+                }
+                y = gridRow * cellHeight + cellEnd;
+            }
+        });
+    }
+
+private:
+    /**********************************
+     * @brief Renders rows [y0, y1) of one cell.
+     * @param source The source image, nullptr for an empty cell.
+     * @param cell RGBA32 view over the cell.
+     * @param y0 First cell row.
+     * @param y1 One past the last cell row.
+     * @param columnSums Scratch buffer of the calling band.
+     **********************************/
+    void renderRows(const Image* source, const ImageView& cell, int32_t y0, int32_t y1,
+                    vector<uint32_t>& columnSums) const {
+        bool matched = source && dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            source->getFormat(), [&](auto tag) {
+                renderRows<decltype(tag)::format>(ConstImageView(*source), cell, y0, y1, columnSums);
+            });
+        if (matched) return;
+
+        static const uint8_t kBlack[4] = {0, 0, 0, 255};
+        for (int32_t y = y0; y < y1; ++y) {
+            uint8_t* target = cell.row(y);
+            for (int32_t x = 0; x < cellWidth; ++x, target += 4) {
+                memcpy(target, kBlack, 4);
+            }
+        }
+    }
+
+    /**********************************
+     * @brief Renders rows [y0, y1) of one cell from a source of a known format.
+     * @tparam F The pixel format of the source.
+     **********************************/
+    template <PixelFormat F>
+    void renderRows(const ConstImageView& source, const ImageView& cell, int32_t y0, int32_t y1,
+                    vector<uint32_t>& columnSums) const {
+        using Traits = PixelFormatTraits<F>;
+        const int32_t sourceWidth = source.getWidth();
+        const int32_t sourceHeight = source.getHeight();
+
+        // Same size: one row copy, or a conversion, per cell row
+        if (sourceWidth == cellWidth && sourceHeight == cellHeight) {
+            for (int32_t y = y0; y < y1; ++y) {
+                if constexpr (F == PixelFormat::RGBA32) {
+                    memcpy(cell.row(y), source.row(y), static_cast<size_t>(cellWidth) * 4);
+                } else {
+                    const uint8_t* pixel = source.row(y);
+                    uint8_t* target = cell.row(y);
+                    for (int32_t x = 0; x < cellWidth; ++x, pixel += Traits::bytesPerPixel, target += 4) {
+                        storeRGBA<F>(pixel, target);
+                    }
+                }
+            }
+            return;
+        }
+
+        if (scaling == MosaicScaling::NEAREST) {
+            // Source byte offset of the pixel under the center of each cell column
+            vector<int32_t> offsets(cellWidth);
+            for (int32_t x = 0; x < cellWidth; ++x) {
+                const int64_t sourceX = (2LL * x + 1) * sourceWidth / (2LL * cellWidth);
+                offsets[x] = static_cast<int32_t>(sourceX) * Traits::bytesPerPixel;
+            }
+            for (int32_t y = y0; y < y1; ++y) {
+                const int64_t sourceY = (2LL * y + 1) * sourceHeight / (2LL * cellHeight);
+                const uint8_t* sourceRow = source.row(static_cast<int32_t>(sourceY));
+                uint8_t* target = cell.row(y);
+                for (int32_t x = 0; x < cellWidth; ++x, target += 4) {
+                    storeRGBA<F>(sourceRow + offsets[x], target);
+                }
+            }
+            return;
+        }
+
+        // Area: sum the covered source rows per column, then the covered columns
+        constexpr int32_t channels = Traits::channels;
+        vector<int32_t> bounds(cellWidth + 1);
+        for (int32_t x = 0; x <= cellWidth; ++x) {
+            bounds[x] = static_cast<int32_t>(static_cast<int64_t>(x) * sourceWidth / cellWidth);
+        }
+        columnSums.resize(static_cast<size_t>(sourceWidth) * channels);
+        for (int32_t y = y0; y < y1; ++y) {
+            const int32_t sourceY0 = static_cast<int32_t>(static_cast<int64_t>(y) * sourceHeight / cellHeight);
+            const int32_t sourceY1 = max(sourceY0 + 1,
+                static_cast<int32_t>(static_cast<int64_t>(y + 1) * sourceHeight / cellHeight));
+
+            fill(columnSums.begin(), columnSums.end(), 0);
+            for (int32_t sourceY = sourceY0; sourceY < sourceY1; ++sourceY) {
+                accumulateRow(source.row(sourceY), columnSums.data(), columnSums.size());
+            }
+
+            uint8_t* target = cell.row(y);
+            uint32_t area = 0;
+            uint64_t reciprocal = 0;
+            for (int32_t x = 0; x < cellWidth; ++x, target += 4) {
+                const int32_t sourceX0 = bounds[x];
+                const int32_t sourceX1 = max(sourceX0 + 1, bounds[x + 1]);
+                const uint32_t cellArea = static_cast<uint32_t>(sourceX1 - sourceX0) *
+                                          static_cast<uint32_t>(sourceY1 - sourceY0);
+                if (cellArea != area) {
+                    // A row has at most two footprint widths, divisions are rare
+                    area = cellArea;
+                    reciprocal = ((1ULL << 32) + area - 1) / area;
+                }
+                uint8_t mean[4];
+                for (int32_t channel = 0; channel < channels; ++channel) {
+                    uint32_t total = area / 2;
+                    for (int32_t sourceX = sourceX0; sourceX < sourceX1; ++sourceX) {
+                        total += columnSums[sourceX * channels + channel];
+                    }
+                    mean[channel] = static_cast<uint8_t>(area < kExactReciprocalArea ?
+                        (total * reciprocal) >> 32 : total / area);
+                }
+                storeRGBA<F>(mean, target);
+            }
+        }
+    }
+
+    /**********************************
+     * @brief Adds a row of bytes to running 32-bit sums.
+     * @param row The bytes.
+     * @param sums The sums, one per byte.
+     * @param count Number of bytes.
+     **********************************/
+    static void accumulateRow(const uint8_t* row, uint32_t* sums, size_t count) {
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+            __m128i* sum = reinterpret_cast<__m128i*>(sums + i);
+            _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum), _mm_unpacklo_epi16(low, zero)));
+            _mm_storeu_si128(sum + 1, _mm_add_epi32(_mm_loadu_si128(sum + 1), _mm_unpackhi_epi16(low, zero)));
+            _mm_storeu_si128(sum + 2, _mm_add_epi32(_mm_loadu_si128(sum + 2), _mm_unpacklo_epi16(high, zero)));
+            _mm_storeu_si128(sum + 3, _mm_add_epi32(_mm_loadu_si128(sum + 3), _mm_unpackhi_epi16(high, zero)));
+        }
+#endif
+        for (; i < count; ++i) {
+            sums[i] += row[i];
+        }
+    }
+
+    /**********************************
+     * @brief Converts one pixel to RGBA32, opaque unless the source has alpha.
+     * @tparam F The pixel format of the source.
+     **********************************/
+    template <PixelFormat F>
+    static void storeRGBA(const uint8_t* pixel, uint8_t* target) {
+        using Traits = PixelFormatTraits<F>;
+        target[0] = pixel[Traits::redOffset];
+        target[1] = pixel[Traits::greenOffset];
+        target[2] = pixel[Traits::blueOffset];
+        if constexpr (Traits::hasAlpha) {
+            target[3] = pixel[Traits::alphaOffset];
+        } else {
+            target[3] = 255;
+        }
+    }
+};
+
+/**********************************
+ * @class MosaicCalculator
+ * @brief A calculator class compositing several feeds into a grid.
+ **********************************/
+class MosaicCalculator : public CalculatorBase {
+private:
+    const string kOutputMosaic = "ImageMosaic";         // Output port tag for the composite
+    const string kColumns = "mosaicColumns";            // Side packet tag for the cells per grid row
+    const string kCellWidth = "mosaicCellWidth";        // Side packet tag for the cell width
+    const string kCellHeight = "mosaicCellHeight";      // Side packet tag for the cell height
+    const string kScaling = "mosaicScaling";            // Side packet tag for the MosaicScaling
+    const string kSync = "mosaicSync";                  // Side packet tag for the MosaicSync
+    const string kSyncWindow = "mosaicSyncWindow";      // Side packet tag for the aligned timestamp spread in microseconds
+    const string kFramePool = "mosaicFramePool";        // Side packet tag for a shared_ptr<FramePool>
+    static const size_t kMaxPending = 8;                // Frames buffered per input while aligning
+
+    int32_t inputCount;                 // Number of input ports
+    vector<Packet> latest;              // Latest frame of every input
+    vector<deque<Packet>> pending;      // Frames waiting to be aligned, ALIGNED only
+    unique_ptr<MosaicKernel> kernel;    // Created on the first frame
+    shared_ptr<FramePool> pool;         // Output frames
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputCount Number of feeds, at least 1.
+     **********************************/
+    MosaicCalculator(const string& calcName = "MosaicCalculator", int32_t newInputCount = 4)
+        : CalculatorBase(calcName), inputCount(max(1, newInputCount)),
+          latest(inputCount), pending(inputCount) {}
+
+    /**********************************
+     * @brief Retrieves the tag of an input port.
+     * @param input Index of the feed.
+     * @return The tag, `ImageMosaicInput<input>`.
+     **********************************/
+    static string getInputTag(int32_t input) {
+        return "ImageMosaicInput" + to_string(input);
+    }
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        for (int32_t input = 0; input < inputCount; ++input) {
+            context->addInputPort(getInputTag(input), Port());
+        }
+        context->addOutputPort(kOutputMosaic, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Drains every input and emits the composites the sync policy allows.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        if (!kernel) {
+            const int32_t defaultColumns = static_cast<int32_t>(ceil(sqrt(static_cast<double>(inputCount))));
+            const MosaicScaling scaling = cc->hasSidePacket(kScaling) ?
+                cc->getSidePacket(kScaling).get<MosaicScaling>() : MosaicScaling::AREA;
+            kernel = make_unique<MosaicKernel>(getInt(cc, kColumns, defaultColumns),
+                getInt(cc, kCellWidth, 480), getInt(cc, kCellHeight, 270), scaling);
+            pool = cc->hasSidePacket(kFramePool) ?
+                cc->getSidePacket(kFramePool).get<shared_ptr<FramePool>>() : make_shared<FramePool>();
+        }
+        const MosaicSync sync = cc->hasSidePacket(kSync) ?
+            cc->getSidePacket(kSync).get<MosaicSync>() : MosaicSync::LATEST;
+
+        bool updated = false;
+        for (int32_t input = 0; input < inputCount; ++input) {
+            Port& inputPort = cc->getInputPort(getInputTag(input));
+            while (inputPort.size() > 0) {
+                Packet inputPacket = inputPort.read();
+                if (sync == MosaicSync::LATEST) {
+                    latest[input] = std::move(inputPacket);
+                    updated = true;
+                } else {
+                    pending[input].push_back(std::move(inputPacket));
+                    if (pending[input].size() > kMaxPending) pending[input].pop_front();
+                }
+            }
+        }
+
+        if (sync == MosaicSync::LATEST) {
+            if (updated) emit(cc);
+            return;
+        }
+        const long long window = getInt(cc, kSyncWindow, 16667);
+        while (alignPending(window)) {
+            emit(cc);
+        }
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+
+private:
+    /**********************************
+     * @brief Reads an optional int side packet.
+     **********************************/
+    static int getInt(CalculatorContext* cc, const string& tag, int fallback) {
+        return cc->hasSidePacket(tag) ? cc->getSidePacket(tag).get<int>() : fallback;
+    }
+
+    /**********************************
+     * @brief Moves the next aligned set of pending frames into latest.
+     * Oldest frames that cannot be aligned with every other input are dropped.
+     * @param window Maximum timestamp spread of a set.
+     * @return True if a set was found.
+     **********************************/
+    bool alignPending(long long window) {
+        while (true) {
+            int32_t oldest = 0;
+            long long newestTimestamp = 0;
+            for (int32_t input = 0; input < inputCount; ++input) {
+                if (pending[input].empty()) return false;
+                const long long timestamp = pending[input].front().getTimestamp();
+                if (timestamp < pending[oldest].front().getTimestamp()) oldest = input;
+                newestTimestamp = max(newestTimestamp, timestamp);
+            }
+
+            // Later frames of the other inputs are even newer, the oldest can never align
+            if (newestTimestamp - pending[oldest].front().getTimestamp() > window) {
+                pending[oldest].pop_front();
+                continue;
+            }
+            for (int32_t input = 0; input < inputCount; ++input) {
+                latest[input] = std::move(pending[input].front());
+                pending[input].pop_front();
+            }
+            return true;
+        }
+    }
+
+    /**********************************
+     * @brief Composes the latest frames into a pooled frame and writes it.
+     **********************************/
+    void emit(CalculatorContext* cc) {
+        vector<const Image*> sources(inputCount, nullptr);
+        for (int32_t input = 0; input < inputCount; ++input) {
+            if (latest[input].isValid()) sources[input] = &latest[input].get<Image>();
+        }
+
+        Image outputImage = pool->acquire(kernel->getOutputWidth(),
+                                          kernel->getOutputHeight(inputCount), PixelFormat::RGBA32);
+        kernel->compose(sources, outputImage);
+        cc->getOutputPort(kOutputMosaic).write(Packet(std::move(outputImage)));
+    }
+};
+
+#endif // MOSAIC_CALCULATOR_H
@@ -6,7 +6,13 @@
  * @details
  * - Supports two pixel shapes (e.g., square, triangle).
  * - Processes image data by grouping pixels into blocks and reassigning their values.
+ * - Square blocks take the average color of the block, read in constant
+ *   time per block from an integral image. The integral image attached
+ *   to the input packet by IntegralImageCalculator is reused when present.
+ * - Triangle blocks copy the color of their anchor pixel.
  * - Utilizes side packets for pixel size and shape settings.
+ * - The pixelation lives in PixelShapeKernel so it can also run as a
+ *   StaticPipeline stage.
  **********************************/
 
 #ifndef PIXEL_SHAPE_CALCULATOR_H
@@ -15,91 +21,119 @@
 #include "../../src/calculatorbase.h"
 #include "../../src/image.h"
 #include "../../src/imageutils.h"
+#include "../../src/integralimage.h"
+#include "../../src/parallel.h"
 #include <sstream>
 #include <cmath>
 #include <cassert>
 
 /**********************************
- * @class PixelShapeCalculator
- * @brief A calculator class for applying pixelation effects to images.
+ * @class PixelShapeKernel
+ * @brief Applies a pixelation effect to an image in place.
  **********************************/
-class PixelShapeCalculator : public CalculatorBase {
+class PixelShapeKernel {
 private:
-    const string kOutputPixel = "ImagePixel";         // Output port tag for pixelated image
-    const string kOutputGrayscale = "ImageGrayscale"; // Output port tag for grayscale image
-    const string kPixelSize = "pixelSize";            // Side packet tag for pixel size
-    const string kPixelShape = "pixeShape";           // Side packet tag for pixel shape
+    int pixSizeFilter;  // Size of the pixel block
+    int pixelShape;     // Pixel shape (0 square, 1 triangle)
 
 public:
     /**********************************
      * @brief Constructor.
-     * Initializes the calculator with its name.
+     * @param blockSize Size of the pixel block.
+     * @param shape Pixel shape (0 square, 1 triangle).
      **********************************/
-    PixelShapeCalculator() : CalculatorBase("PixelShapeCalculator") {}
+    PixelShapeKernel(int blockSize, int shape)
+        : pixSizeFilter(blockSize), pixelShape(shape) {}
 
     /**********************************
-     * @brief Registers input and output ports.
-     * @param newSidePacket Optional map of side packets.
-     * @return A unique pointer to the calculator context.
+     * @brief Applies pixelation to the image.
+     * Square blocks are filled with their average color, triangle
+     * blocks copy their anchor pixel.
+     * @param image The image to modify in place.
+     * @param integral Integral image of the input, built on demand when
+     *        missing or when it does not match the image.
      **********************************/
-    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
-        auto context = make_unique<CalculatorContext>(newSidePacket);
-        context->addOutputPort(kOutputPixel, Port()); 
-        return context;
+    void process(Image& image, const IntegralImage* integral = nullptr) const {
+        if (pixSizeFilter < 1) return;
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                if (pixelShape == 1) {
+                    processTriangles<decltype(tag)::format>(image);
+                    return;
+                }
+                constexpr int32_t channels = PixelFormatTraits<decltype(tag)::format>::channels;
+                if (integral && integral->getWidth() == image.getWidth() &&
+                    integral->getHeight() == image.getHeight() && integral->getChannels() == channels) {
+                    averageBlocks<decltype(tag)::format>(image, *integral);
+                } else {
+                    averageBlocks<decltype(tag)::format>(image, IntegralImage(image));
+                }
+            });
     }
 
     /**********************************
-     * @brief Enter method.
-     * Called at the start of the calculator lifecycle for initialization.
-     * @param cc Pointer to the calculator context.
-     * @param delta Time elapsed since the last frame.
+     * @brief Fills every square block with its average color.
+     * @tparam F The pixel format of the image.
+     * @param image The image to modify in place.
+     * @param integral Integral image of the unmodified image.
      **********************************/
-    void enter(CalculatorContext* cc, float delta) override {}
+    template <PixelFormat F>
+    void averageBlocks(Image& image, const IntegralImage& integral) const {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* pixelData = image.getData().data();
+        const int32_t width = image.getWidth();
+        const int32_t height = image.getHeight();
+        const size_t stride = image.getStride();
+        const int32_t block = pixSizeFilter;
+        const int32_t blockRows = (height + block - 1) / block;
 
-    /**********************************
-     * @brief Process method.
-     * Applies pixelation effects to the input image.
-     * @param cc Pointer to the calculator context.
-     * @param delta Time elapsed since the last frame.
-     **********************************/
-    void process(CalculatorContext* cc, float delta) override {
-        // Retrieve the input port
-        Port& inputPort = cc->getInputPort(cc->kTagInput);
+        Parallel::forRows(blockRows, [&](int32_t begin, int32_t end) {
+            for (int32_t blockRow = begin; blockRow < end; ++blockRow) {
+                const int32_t y0 = blockRow * block;
+                const int32_t y1 = std::min(y0 + block, height);
+                for (int32_t x0 = 0; x0 < width; x0 += block) {
+                    const int32_t x1 = std::min(x0 + block, width);
 
-        // Check if there is data in the input port
-        if (inputPort.size() == 0) return;
+                    // One constant time query per block
+                    uint8_t mean[Traits::channels];
+                    integral.means(x0, y0, x1, y1, mean);
 
-        // Read the input packet and extract the image
-        Packet inputPacket = inputPort.read();
-        Image outputImage = inputPacket.get<Image>();
-        int pixSizeFilter = cc->getSidePacket(kPixelSize).get<int>();
-        int pixelShape = cc->getSidePacket(kPixelShape).get<int>();
+                    for (int32_t y = y0; y < y1; ++y) {
+                        uint8_t* pixel = pixelData + y * stride + x0 * Traits::bytesPerPixel;
+                        for (int32_t x = x0; x < x1; ++x, pixel += Traits::bytesPerPixel) {
+                            memcpy(pixel, mean, Traits::channels);
+                        }
+                    }
+                }
+            }
+        }, 1);
+    }
 
-        // Access image data
-        std::vector<uint8_t>& pixelData = outputImage.getData();
-        size_t pixelSize = Image::bitsPerPixel(outputImage.getFormat()) / 8;
-        if (pixelSize < 1) return;
+    /**********************************
+     * @brief Applies triangle pixelation to an image of a known format.
+     * Every pixel copies its triangle anchor, anchors map onto
+     * themselves so rows can be walked in memory order.
+     * @tparam F The pixel format of the image.
+     * @param image The image to modify in place.
+     **********************************/
+    template <PixelFormat F>
+    void processTriangles(Image& image) const {
+        constexpr size_t pixelSize = PixelFormatTraits<F>::bytesPerPixel;
+        uint8_t* pixelData = image.getData().data();
 
-        size_t width = outputImage.getWidth();
-        size_t height = outputImage.getHeight();
-        size_t realStride = pixelSize * width;
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t realStride = image.getStride();
 
         // Apply pixelation
-        for (size_t x = 0; x < width; ++x) {
-            for (size_t y = 0; y < height; ++y) {
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
                 size_t i = (y * realStride) + (x * pixelSize); // Calculate 1D index
 
                 size_t pixelatedUV[2] {x, y};
                 size_t imageSize[2] {width, height};
 
-                // Apply the appropriate pixelation function
-                if (pixelShape == 0) {
-                    getSquareUV(pixelatedUV, pixSizeFilter, imageSize);
-                } else if (pixelShape == 1) {
-                    getTriangleUV(pixelatedUV, pixSizeFilter, imageSize);
-                } else {
-                    getSquareUV(pixelatedUV, pixSizeFilter, imageSize);
-                }
+                getTriangleUV(pixelatedUV, pixSizeFilter, imageSize);
 
                 size_t newRow = pixelatedUV[1];
                 size_t newCol = pixelatedUV[0];
@@ -108,51 +142,21 @@ public:
                 size_t newIndex = (newRow * realStride) + (newCol * pixelSize);
 
                 // Copy pixel data
-                uint8_t red = pixelData[newIndex];
-                uint8_t green = pixelData[newIndex + 1];
-                uint8_t blue = pixelData[newIndex + 2];
-                uint8_t alpha = pixelData[newIndex + 3];
-
-                pixelData[i] = red;
-                pixelData[i + 1] = green;
-                pixelData[i + 2] = blue;
-                pixelData[i + 3] = alpha;
+                for (size_t c = 0; c < pixelSize; ++c) {
+                    pixelData[i + c] = pixelData[newIndex + c];
+                }
             }
         }
-
-        // Write the processed image to the output port
-        cc->getOutputPort(kOutputPixel).write(Packet(std::move(outputImage)));
     }
 
-    /**********************************
-     * @brief Close method.
-     * Called at the end of the calculator lifecycle for cleanup.
-     * @param cc Pointer to the calculator context.
-     * @param delta Time elapsed since the last frame.
-     **********************************/
-    void close(CalculatorContext* cc, float delta) override {}
-
 private:
-    /**********************************
-     * @brief Applies square pixelation to UV coordinates.
-     * @param uv The UV coordinates to modify.
-     * @param pixelSize The size of the square pixel block.
-     * @param imageSize The size of the image.
-     **********************************/
-    void getSquareUV(size_t uv[2], float pixelSize, size_t imageSize[2]) {
-        uv[0] = floor(uv[0] / pixelSize) * pixelSize;
-        uv[1] = floor(uv[1] / pixelSize) * pixelSize;
-        if (uv[0] >= imageSize[0]) uv[0] = imageSize[0] - 1;
-        if (uv[1] >= imageSize[1]) uv[1] = imageSize[1] - 1;
-    }
-
     /**********************************
      * @brief Applies triangle pixelation to UV coordinates.
      * @param uv The UV coordinates to modify.
      * @param pixelSize The size of the triangle pixel block.
      * @param imageSize The size of the image.
      **********************************/
-    void getTriangleUV(size_t uv[2], size_t pixelSize, size_t imageSize[2]) {
+    void getTriangleUV(size_t uv[2], size_t pixelSize, size_t imageSize[2]) const {
         float blockCoords[2] = {
             static_cast<float>(uv[0]) / pixelSize,
             static_cast<float>(uv[1]) / pixelSize
@@ -177,5 +181,79 @@ private:
     }
 };
 
+/**********************************
+ * @class PixelShapeCalculator
+ * @brief A calculator class for applying pixelation effects to images.
+ **********************************/
+class PixelShapeCalculator : public CalculatorBase {
+private:
+    const string kOutputPixel = "ImagePixel";         // Output port tag for pixelated image
+    const string kOutputGrayscale = "ImageGrayscale"; // Output port tag for grayscale image
+    const string kPixelSize = "pixelSize";            // Side packet tag for pixel size
+    const string kPixelShape = "pixeShape";           // Side packet tag for pixel shape
+    const string kIntegralImage = "integralImage";    // Packet attachment tag for the IntegralImage
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * Initializes the calculator with its name.
+     **********************************/
+    PixelShapeCalculator() : CalculatorBase("PixelShapeCalculator") {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputPixel, Port()); 
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * Called at the start of the calculator lifecycle for initialization.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Applies pixelation effects to the input image.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        // Retrieve the input port
+        Port& inputPort = cc->getInputPort(cc->kTagInput);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it, the attachments stay in the packet
+        Packet inputPacket = inputPort.read();
+        const IntegralImage* integral = inputPacket.hasAttachment(kIntegralImage) ?
+            &inputPacket.getAttachment<IntegralImage>(kIntegralImage) : nullptr;
+        Image outputImage = std::move(inputPacket.get<Image>());
+        int pixSizeFilter = cc->getSidePacket(kPixelSize).get<int>();
+        int pixelShape = cc->getSidePacket(kPixelShape).get<int>();
+
+        PixelShapeKernel(pixSizeFilter, pixelShape).process(outputImage, integral);
+
+        // Write the processed image to the output port
+        cc->getOutputPort(kOutputPixel).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * Called at the end of the calculator lifecycle for cleanup.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
 #endif // PIXEL_SHAPE_CALCULATOR_H
 
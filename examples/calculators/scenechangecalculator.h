@@ -0,0 +1,132 @@
+/**********************************
+ * @file scenechangecalculator.h
+ * @brief Defines the SceneChangeCalculator class, which flags frames whose
+ * content changed since the last scene change.
+ *
+ * @details
+ * - Runs a SceneChangeDetector on every frame and attaches the result to
+ *   the frame packet: `sceneChanged` (bool) and `sceneScore` (int, mean
+ *   absolute luma difference of the coarse grid, 0 to 255). The packet is
+ *   forwarded without copying the image.
+ * - Uses the `integralImage` attachment when present (see
+ *   IntegralImageCalculator) for exact cell means.
+ * - Changed frames also write their luma grid to the `SceneThumbnail`
+ *   side output port, a cheap keyframe thumbnail.
+ * - Downstream calculators can be skipped on unchanged frames with
+ *   Scheduler::gateCalculator(), e.g. a StatisticsCalculator.
+ * - Optional int side packets `sceneThreshold` (default 10),
+ *   `sceneGridWidth` and `sceneGridHeight` (default 32x18).
+ **********************************/
+
+#ifndef SCENE_CHANGE_CALCULATOR_H
+#define SCENE_CHANGE_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/integralimage.h"
+#include "../../src/packet.h"
+#include "../../src/scenechange.h"
+
+/**********************************
+ * @class SceneChangeCalculator
+ * @brief A calculator class flagging scene changes.
+ **********************************/
+class SceneChangeCalculator : public CalculatorBase {
+private:
+    const string kOutputFrame = "ImageScene";           // Output port tag for the flagged frame
+    const string kOutputThumbnail = "SceneThumbnail";   // Side output port tag for keyframe thumbnails
+    const string kChanged = "sceneChanged";             // Packet attachment tag for the changed flag
+    const string kScore = "sceneScore";                 // Packet attachment tag for the score
+    const string kIntegralImage = "integralImage";      // Packet attachment tag for the IntegralImage
+    const string kThreshold = "sceneThreshold";         // Side packet tag for the change threshold
+    const string kGridWidth = "sceneGridWidth";         // Side packet tag for the grid width
+    const string kGridHeight = "sceneGridHeight";       // Side packet tag for the grid height
+
+    string inputTag;                            // Tag of the input port read by the calculator
+    unique_ptr<SceneChangeDetector> detector;   // Created on the first frame, keeps the previous grid
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    SceneChangeCalculator(const string& calcName = "SceneChangeCalculator",
+                          const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputFrame, Port());
+        context->addSideOutputPort(kOutputThumbnail, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Compares the input frame with the last changed one and forwards it flagged.
+     * Unsupported formats are forwarded flagged as changed.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        if (!detector) {
+            detector = make_unique<SceneChangeDetector>(getInt(cc, kGridWidth, 32),
+                getInt(cc, kGridHeight, 18), getInt(cc, kThreshold, 10));
+        }
+
+        Packet inputPacket = inputPort.read();
+        const Image& image = inputPacket.get<Image>();
+        const PixelFormat format = image.getFormat();
+        bool changed = true;
+        int score = 255;
+        if (format == PixelFormat::GRAYSCALE8 || format == PixelFormat::RGB24 ||
+            format == PixelFormat::RGBA32) {
+            const IntegralImage* integral = inputPacket.hasAttachment(kIntegralImage) ?
+                &inputPacket.getAttachment<IntegralImage>(kIntegralImage) : nullptr;
+            changed = detector->update(image, integral);
+            score = detector->getScore();
+            if (changed) {
+                cc->getSideOutputPort(kOutputThumbnail).write(Packet(detector->getThumbnail()));
+            }
+        }
+        inputPacket.attach(kChanged, changed);
+        inputPacket.attach(kScore, score);
+
+        cc->getOutputPort(kOutputFrame).write(std::move(inputPacket));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+
+private:
+    /**********************************
+     * @brief Reads an optional int side packet.
+     **********************************/
+    static int getInt(CalculatorContext* cc, const string& tag, int fallback) {
+        return cc->hasSidePacket(tag) ? cc->getSidePacket(tag).get<int>() : fallback;
+    }
+};
+
+#endif // SCENE_CHANGE_CALCULATOR_H
@@ -0,0 +1,222 @@
+/**********************************
+ * @file statisticscalculator.h
+ * @brief Defines the StatisticsCalculator class, which measures the
+ * luma histogram and exposure statistics of images.
+ *
+ * @details
+ * - Computes a 256-bin luma histogram, min, max and mean luma, and the
+ *   number of pixels with a channel clipped to 0 or 255.
+ * - Each row band counts into its own sub-histograms, merged once per
+ *   band, so threads never contend on shared counters.
+ * - Inside a band four interleaved sub-histograms break the dependency
+ *   between consecutive increments of the same bin.
+ * - The frame packet is forwarded untouched (no copy), the statistics
+ *   are written to the `ImageStatistics` side output port.
+ **********************************/
+
+#ifndef STATISTICS_CALCULATOR_H
+#define STATISTICS_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+#include "../../src/parallel.h"
+#include <array>
+#include <mutex>
+
+/**********************************
+ * @struct ImageStatistics
+ * @brief Per-frame luma and clipping statistics.
+ **********************************/
+struct ImageStatistics {
+    array<uint32_t, 256> lumaHistogram{};   // Number of pixels per luma value
+    uint64_t pixelCount = 0;                // Number of pixels measured
+    uint64_t clippedLow = 0;                // Pixels with a color channel at 0
+    uint64_t clippedHigh = 0;               // Pixels with a color channel at 255
+    uint8_t minLuma = 0;                    // Darkest luma value
+    uint8_t maxLuma = 0;                    // Brightest luma value
+    double meanLuma = 0.0;                  // Average luma
+};
+
+/**********************************
+ * @class StatisticsKernel
+ * @brief Measures an image without modifying it.
+ **********************************/
+class StatisticsKernel {
+private:
+    static const int kLanes = 4;    // Interleaved sub-histograms per band
+
+    /**********************************
+     * @struct BandCounts
+     * @brief Counters owned by a single row band.
+     **********************************/
+    struct BandCounts {
+        uint32_t histogram[kLanes][256] = {};
+        uint64_t clippedLow = 0;
+        uint64_t clippedHigh = 0;
+    };
+
+public:
+    /**********************************
+     * @brief Measures the image.
+     * Supports GRAYSCALE8, RGB24 and RGBA32, other formats yield empty statistics.
+     * @param image The image to measure.
+     * @return The statistics of the image.
+     **********************************/
+    ImageStatistics measure(const Image& image) const {
+        ImageStatistics statistics;
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                statistics = measureFormat<decltype(tag)::format>(image);
+            });
+        return statistics;
+    }
+
+    /**********************************
+     * @brief Measures an image of a known format.
+     * @tparam F The pixel format of the image.
+     * @param image The image to measure.
+     * @return The statistics of the image.
+     **********************************/
+    template <PixelFormat F>
+    ImageStatistics measureFormat(const Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        const uint8_t* pixelData = image.getData().data();
+        const size_t width = image.getWidth();
+        const size_t stride = image.getStride();
+
+        ImageStatistics statistics;
+        mutex mergeLock;
+        Parallel::forRows(image.getHeight(), [&](int32_t begin, int32_t end) {
+            BandCounts counts;
+            for (int32_t row = begin; row < end; ++row) {
+                const uint8_t* pixel = pixelData + row * stride;
+                for (size_t col = 0; col < width; ++col, pixel += Traits::bytesPerPixel) {
+                    uint32_t luma;
+                    uint8_t low, high;
+                    if constexpr (Traits::channels == 1) {
+                        luma = low = high = pixel[0];
+                    } else {
+                        const uint8_t r = pixel[Traits::redOffset];
+                        const uint8_t g = pixel[Traits::greenOffset];
+                        const uint8_t b = pixel[Traits::blueOffset];
+                        // BT.709 weights in 8-bit fixed point, they sum to 256
+                        luma = (54 * r + 183 * g + 19 * b) >> 8;
+                        low = std::min(r, std::min(g, b));
+                        high = std::max(r, std::max(g, b));
+                    }
+                    counts.histogram[col % kLanes][luma]++;
+                    counts.clippedLow += low == 0;
+                    counts.clippedHigh += high == 255;
+                }
+            }
+
+            // One merge per band
+            lock_guard<mutex> guard(mergeLock);
+            for (size_t value = 0; value < 256; ++value) {
+                for (int lane = 0; lane < kLanes; ++lane) {
+                    statistics.lumaHistogram[value] += counts.histogram[lane][value];
+                }
+            }
+            statistics.clippedLow += counts.clippedLow;
+            statistics.clippedHigh += counts.clippedHigh;
+        });
+
+        summarize(statistics);
+        return statistics;
+    }
+
+private:
+    /**********************************
+     * @brief Derives min, max, mean and pixel count from the histogram.
+     * @param statistics The statistics to complete.
+     **********************************/
+    static void summarize(ImageStatistics& statistics) {
+        uint64_t sum = 0;
+        bool first = true;
+        for (size_t value = 0; value < 256; ++value) {
+            uint32_t count = statistics.lumaHistogram[value];
+            if (count == 0) continue;
+            if (first) {
+                statistics.minLuma = static_cast<uint8_t>(value);
+                first = false;
+            }
+            statistics.maxLuma = static_cast<uint8_t>(value);
+            statistics.pixelCount += count;
+            sum += static_cast<uint64_t>(count) * value;
+        }
+        if (statistics.pixelCount > 0) {
+            statistics.meanLuma = static_cast<double>(sum) / statistics.pixelCount;
+        }
+    }
+};
+
+/**********************************
+ * @class StatisticsCalculator
+ * @brief A calculator class publishing per-frame image statistics.
+ **********************************/
+class StatisticsCalculator : public CalculatorBase {
+private:
+    const string kOutputFrame = "ImageMeasured";        // Output port tag for the forwarded frame
+    const string kOutputStatistics = "ImageStatistics"; // Side output port tag for the statistics
+
+    string inputTag;    // Tag of the input port read by the calculator
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    StatisticsCalculator(const string& calcName = "StatisticsCalculator",
+                         const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input, output and side output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputFrame, Port());
+        context->addSideOutputPort(kOutputStatistics, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Measures the input image and forwards it unchanged.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        Packet inputPacket = inputPort.read();
+        ImageStatistics statistics = StatisticsKernel().measure(inputPacket.get<Image>());
+
+        // The frame packet itself moves on, the image is never copied
+        cc->getOutputPort(kOutputFrame).write(std::move(inputPacket));
+        cc->getSideOutputPort(kOutputStatistics).write(Packet(statistics));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+#endif // STATISTICS_CALCULATOR_H
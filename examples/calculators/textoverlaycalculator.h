@@ -0,0 +1,371 @@
+/**********************************
+ * @file textoverlaycalculator.h
+ * @brief Defines the TextOverlayCalculator class, which burns text such
+ * as timestamps and stream IDs into images.
+ *
+ * @details
+ * - The font is rasterized once into a GlyphAtlas when the kernel is
+ *   created.
+ * - The laid-out string is cached as a coverage layer. When the text
+ *   changes, only the cells whose character changed are copied from the
+ *   atlas, e.g. the milliseconds digits of a timestamp.
+ * - The layer is alpha blended over every frame in integer arithmetic.
+ *   With SSE2, 16 coverage bytes are tested at once and empty runs are
+ *   skipped, RGBA32 and GRAYSCALE8 pixels are blended 4 and 16 at a time.
+ * - Configured with the `textTemplate` side packet (string), where
+ *   `{frame}` expands to the frame number and `{time}` to the local wall
+ *   clock time HH:MM:SS.mmm. Optional `textX`, `textY`, `textScale`,
+ *   `textColor` (0xRRGGBB) and `textOpacity` (0 to 255) int side packets.
+ **********************************/
+
+#ifndef TEXT_OVERLAY_CALCULATOR_H
+#define TEXT_OVERLAY_CALCULATOR_H
+
+#include "../../src/calculatorbase.h"
+#include "../../src/glyphatlas.h"
+#include "../../src/image.h"
+#include "../../src/packet.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**********************************
+ * @class TextOverlayKernel
+ * @brief Draws a single line of text onto images.
+ **********************************/
+class TextOverlayKernel {
+private:
+    GlyphAtlas atlas;           // Rasterized font, coverage scaled by the opacity
+    int32_t startX;             // Left edge of the text
+    int32_t startY;             // Top edge of the text
+    array<uint8_t, 3> color;    // Text color, red green blue
+    string text;                // Text currently laid out in the layer
+    vector<uint8_t> layer;      // Coverage of the laid-out text, one cell per character
+    int32_t layerWidth;         // Layer width in pixels
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param scale Pixels per font pixel, the line is 9 * scale pixels high.
+     * @param x Left edge of the text.
+     * @param y Top edge of the text.
+     * @param rgb Text color as 0xRRGGBB.
+     * @param opacity Text opacity, 255 is opaque.
+     **********************************/
+    explicit TextOverlayKernel(int32_t scale = 2, int32_t x = 8, int32_t y = 8,
+                               uint32_t rgb = 0xFFFFFF, uint8_t opacity = 255)
+        : atlas(scale, opacity), startX(x), startY(y),
+          color{static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb)},
+          layerWidth(0) {}
+
+    /**********************************
+     * @brief Lays out new text, re-rasterizing only the changed characters.
+     * A change of length lays out the whole string again.
+     * @param newText The text to draw.
+     * @return The number of glyphs copied from the atlas.
+     **********************************/
+    int32_t setText(const string& newText) {
+        const int32_t cellWidth = atlas.getCellWidth();
+        const int32_t cellHeight = atlas.getCellHeight();
+        if (newText.size() != text.size()) {
+            layerWidth = static_cast<int32_t>(newText.size()) * cellWidth;
+            layer.assign(static_cast<size_t>(layerWidth) * cellHeight, 0);
+            text.assign(newText.size(), '\0');
+        }
+
+        int32_t changed = 0;
+        for (size_t i = 0; i < newText.size(); ++i) {
+            if (text[i] == newText[i] && newText[i] != '\0') continue;
+            const int32_t cell = atlas.cellOf(newText[i]);
+            for (int32_t y = 0; y < cellHeight; ++y) {
+                memcpy(layer.data() + y * layerWidth + i * cellWidth, atlas.cellRow(cell, y), cellWidth);
+            }
+            changed++;
+        }
+        text = newText;
+        return changed;
+    }
+
+    /**********************************
+     * @brief Blends the text layer onto the image.
+     * Supports GRAYSCALE8, RGB24 and RGBA32, other formats are left untouched.
+     * @param image The image to modify in place.
+     **********************************/
+    void process(Image& image) const {
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                processFormat<decltype(tag)::format>(image);
+            });
+    }
+
+    /**********************************
+     * @brief Blends the text layer onto an image of a known format.
+     * @tparam F The pixel format of the image.
+     * @param image The image to modify in place.
+     **********************************/
+    template <PixelFormat F>
+    void processFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+
+        // Clip the layer to the image
+        const int32_t x0 = std::max(startX, 0);
+        const int32_t x1 = std::min(startX + layerWidth, image.getWidth());
+        const int32_t y0 = std::max(startY, 0);
+        const int32_t y1 = std::min(startY + atlas.getCellHeight(), image.getHeight());
+        if (x0 >= x1 || y0 >= y1) return;
+
+        const array<uint8_t, 4> pixelColor = colorOf<F>();
+        const int32_t count = x1 - x0;
+        for (int32_t y = y0; y < y1; ++y) {
+            const uint8_t* coverage = layer.data() + (y - startY) * layerWidth + (x0 - startX);
+            uint8_t* pixel = image.getData().data() + y * image.getStride() + x0 * Traits::bytesPerPixel;
+
+            int32_t x = 0;
+#ifdef __SSE2__
+            for (; x + 16 <= count; x += 16) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage + x));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128())) == 0xFFFF) continue;
+                blend16<F>(pixel + x * Traits::bytesPerPixel, coverage + x, pixelColor);
+            }
+#endif
+            for (; x < count; ++x) {
+                if (coverage[x] == 0) continue;
+                blendPixel<F>(pixel + x * Traits::bytesPerPixel, coverage[x], pixelColor);
+            }
+        }
+    }
+
+private:
+    /**********************************
+     * @brief Lays out the text color in pixel byte order.
+     * Alpha is opaque, so blending composites the text over the pixel.
+     * @tparam F The pixel format of the image.
+     * @return The color bytes, luma for GRAYSCALE8.
+     **********************************/
+    template <PixelFormat F>
+    array<uint8_t, 4> colorOf() const {
+        using Traits = PixelFormatTraits<F>;
+        array<uint8_t, 4> bytes = {255, 255, 255, 255};
+        if constexpr (Traits::channels == 1) {
+            // BT.709 weights in 8-bit fixed point, they sum to 256
+            bytes[0] = static_cast<uint8_t>((54 * color[0] + 183 * color[1] + 19 * color[2]) >> 8);
+        } else {
+            bytes[Traits::redOffset] = color[0];
+            bytes[Traits::greenOffset] = color[1];
+            bytes[Traits::blueOffset] = color[2];
+        }
+        return bytes;
+    }
+
+    /**********************************
+     * @brief Blends one pixel, p = (p * (256 - a) + c * a + 128) >> 8.
+     * @tparam F The pixel format of the image.
+     * @param pixel The pixel to modify.
+     * @param coverage Text coverage of the pixel.
+     * @param pixelColor Color bytes in pixel order.
+     **********************************/
+    template <PixelFormat F>
+    static void blendPixel(uint8_t* pixel, uint8_t coverage, const array<uint8_t, 4>& pixelColor) {
+        const int32_t alpha = coverage + (coverage >> 7);   // 0..256
+        for (size_t channel = 0; channel < PixelFormatTraits<F>::bytesPerPixel; ++channel) {
+            pixel[channel] = static_cast<uint8_t>(
+                (pixel[channel] * (256 - alpha) + pixelColor[channel] * alpha + 128) >> 8);
+        }
+    }
+
+    /**********************************
+     * @brief Blends 16 consecutive pixels.
+     * @tparam F The pixel format of the image.
+     * @param pixel The first pixel to modify.
+     * @param coverage Text coverage of the 16 pixels.
+     * @param pixelColor Color bytes in pixel order.
+     **********************************/
+    template <PixelFormat F>
+    static void blend16(uint8_t* pixel, const uint8_t* coverage, const array<uint8_t, 4>& pixelColor) {
+#ifdef __SSE2__
+        if constexpr (F == PixelFormat::RGBA32) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i colorWide = _mm_setr_epi16(pixelColor[0], pixelColor[1], pixelColor[2], pixelColor[3],
+                                                     pixelColor[0], pixelColor[1], pixelColor[2], pixelColor[3]);
+            for (int32_t quad = 0; quad < 4; ++quad, pixel += 16, coverage += 4) {
+                int32_t packed;
+                memcpy(&packed, coverage, 4);
+                if (packed == 0) continue;
+
+                // Every coverage byte repeated over the 4 channels of its pixel
+                __m128i alpha = _mm_cvtsi32_si128(packed);
+                alpha = _mm_unpacklo_epi8(alpha, alpha);
+                alpha = _mm_unpacklo_epi16(alpha, alpha);
+
+                __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel));
+                __m128i low = blend8(_mm_unpacklo_epi8(source, zero), _mm_unpacklo_epi8(alpha, zero), colorWide);
+                __m128i high = blend8(_mm_unpackhi_epi8(source, zero), _mm_unpackhi_epi8(alpha, zero), colorWide);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pixel), _mm_packus_epi16(low, high));
+            }
+            return;
+        } else if constexpr (F == PixelFormat::GRAYSCALE8) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i colorWide = _mm_set1_epi16(pixelColor[0]);
+            __m128i alpha = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage));
+            __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel));
+            __m128i low = blend8(_mm_unpacklo_epi8(source, zero), _mm_unpacklo_epi8(alpha, zero), colorWide);
+            __m128i high = blend8(_mm_unpackhi_epi8(source, zero), _mm_unpackhi_epi8(alpha, zero), colorWide);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pixel), _mm_packus_epi16(low, high));
+            return;
+        }
+#endif
+        for (int32_t x = 0; x < 16; ++x) {
+            if (coverage[x] == 0) continue;
+            blendPixel<F>(pixel + x * PixelFormatTraits<F>::bytesPerPixel, coverage[x], pixelColor);
+        }
+    }
+
+#ifdef __SSE2__
+    /**********************************
+     * @brief Blends eight 16-bit lanes, same formula as blendPixel.
+     * @param source Pixel bytes widened to 16 bits.
+     * @param coverage Coverage widened to 16 bits.
+     * @param colorWide Color bytes widened to 16 bits.
+     * @return The blended lanes.
+     **********************************/
+    static __m128i blend8(__m128i source, __m128i coverage, __m128i colorWide) {
+        const __m128i alpha = _mm_add_epi16(coverage, _mm_srli_epi16(coverage, 7));
+        const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(source, inverse), _mm_mullo_epi16(colorWide, alpha));
+        return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+    }
+#endif
+};
+
+/**********************************
+ * @class TextOverlayCalculator
+ * @brief A calculator class burning text into images.
+ **********************************/
+class TextOverlayCalculator : public CalculatorBase {
+private:
+    const string kOutputText = "ImageText";         // Output port tag for the image with text
+    const string kTemplate = "textTemplate";        // Side packet tag for the text template
+    const string kX = "textX";                      // Side packet tag for the left edge
+    const string kY = "textY";                      // Side packet tag for the top edge
+    const string kScale = "textScale";              // Side packet tag for the font scale
+    const string kColor = "textColor";              // Side packet tag for the 0xRRGGBB color
+    const string kOpacity = "textOpacity";          // Side packet tag for the opacity
+
+    string inputTag;                        // Tag of the input port read by the calculator
+    unique_ptr<TextOverlayKernel> kernel;   // Created on the first frame, keeps the atlas and layer
+    long long frameCount = 0;               // Frames processed so far
+
+public:
+    /**********************************
+     * @brief Constructor.
+     * @param calcName Name of the calculator, unique within a Scheduler.
+     * @param newInputTag Tag of the output port of the previous calculator.
+     **********************************/
+    TextOverlayCalculator(const string& calcName = "TextOverlayCalculator",
+                          const string& newInputTag = "kTagInput")
+        : CalculatorBase(calcName), inputTag(newInputTag) {}
+
+    /**********************************
+     * @brief Registers input and output ports.
+     * @param newSidePacket Optional map of side packets.
+     * @return A unique pointer to the calculator context.
+     **********************************/
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort(kOutputText, Port());
+        return context;
+    }
+
+    /**********************************
+     * @brief Enter method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    /**********************************
+     * @brief Process method.
+     * Expands the text template and draws it onto the input image.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void process(CalculatorContext* cc, float delta) override {
+        Port& inputPort = cc->getInputPort(inputTag);
+
+        // Check if there is data in the input port
+        if (inputPort.size() == 0) return;
+
+        // Read the input packet and take the image out of it
+        Packet inputPacket = inputPort.read();
+        Image outputImage = std::move(inputPacket.get<Image>());
+
+        if (!kernel) {
+            kernel = make_unique<TextOverlayKernel>(
+                getInt(cc, kScale, 2), getInt(cc, kX, 8), getInt(cc, kY, 8),
+                static_cast<uint32_t>(getInt(cc, kColor, 0xFFFFFF)),
+                static_cast<uint8_t>(std::clamp(getInt(cc, kOpacity, 255), 0, 255)));
+        }
+        const string textTemplate = cc->hasSidePacket(kTemplate) ?
+            cc->getSidePacket(kTemplate).get<string>() : string("{time}");
+        kernel->setText(expand(textTemplate));
+        kernel->process(outputImage);
+        frameCount++;
+
+        cc->getOutputPort(kOutputText).write(Packet(std::move(outputImage)));
+    }
+
+    /**********************************
+     * @brief Close method.
+     * @param cc Pointer to the calculator context.
+     * @param delta Time elapsed since the last frame.
+     **********************************/
+    void close(CalculatorContext* cc, float delta) override {}
+
+private:
+    /**********************************
+     * @brief Reads an optional int side packet.
+     **********************************/
+    static int getInt(CalculatorContext* cc, const string& tag, int fallback) {
+        return cc->hasSidePacket(tag) ? cc->getSidePacket(tag).get<int>() : fallback;
+    }
+
+    /**********************************
+     * @brief Replaces the `{frame}` and `{time}` placeholders.
+     * @param textTemplate The template.
+     * @return The text for the current frame.
+     **********************************/
+    string expand(const string& textTemplate) const {
+        string result = textTemplate;
+        replaceAll(result, "{frame}", to_string(frameCount));
+        if (result.find("{time}") != string::npos) {
+            auto now = chrono::system_clock::now();
+            time_t seconds = chrono::system_clock::to_time_t(now);
+            long long millis = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+            tm local{};
+            localtime_r(&seconds, &local);
+            char clock[16];
+            snprintf(clock, sizeof(clock), "%02d:%02d:%02d.%03lld", local.tm_hour, local.tm_min, local.tm_sec, millis);
+            replaceAll(result, "{time}", clock);
+        }
+        return result;
+    }
+
+    /**********************************
+     * @brief Replaces every occurrence of a placeholder.
+     **********************************/
+    static void replaceAll(string& text, const string& placeholder, const string& value) {
+        for (size_t at = text.find(placeholder); at != string::npos; at = text.find(placeholder, at + value.size())) {
+            text.replace(at, placeholder.size(), value);
+        }
+    }
+};
+
+#endif // TEXT_OVERLAY_CALCULATOR_H
@@ -106,6 +106,9 @@ int main() {
     const string kSpread = "spread";
     const string kBayerLevel = "bayerLevel";
 
+    // Grayscale tags configuration
+    const string kSingleChannel = "grayscaleSingleChannel";
+
     // Banner tags configuration
     const string bannerName = "../assets/banner.bmp";
     const string kTagBanner = "ImageBanner";
@@ -123,6 +126,9 @@ int main() {
     (*sidePackets)[kPixelSize] = Packet(4);
     (*sidePackets)[kPixelShape] = Packet(1);
 
+    // Emit 1 byte per pixel after the grayscale stage
+    (*sidePackets)[kSingleChannel] = Packet(1);
+
     // Load banner image and set its position
     Image banner = ImageUtils::readBMP(bannerName);
     (*sidePackets)[kTagBanner] = Packet(banner);
@@ -144,12 +150,18 @@ int main() {
 
     scheduler.connectCalculators();
 
-    // Register output callback for processed frames
+    // Register output callback for processed frames, expanded to RGBA for the consumer
     scheduler.registerOutputCallback([](const Packet& packet) {
         if (packet.isValid()) {
-            Image out = packet.get<Image>();
-            const vector<uint8_t>& rgbaData = out.getData();
-            cout.write(reinterpret_cast<const char*>(rgbaData.data()), rgbaData.size());
+            const Image& out = packet.get<Image>();
+            if (out.getFormat() == PixelFormat::RGBA32) {
+                const vector<uint8_t>& rgbaData = out.getData();
+                cout.write(reinterpret_cast<const char*>(rgbaData.data()), rgbaData.size());
+            } else {
+                Image rgba = ImageUtils::toRGBA32(out);
+                const vector<uint8_t>& rgbaData = rgba.getData();
+                cout.write(reinterpret_cast<const char*>(rgbaData.data()), rgbaData.size());
+            }
         }
     });
 
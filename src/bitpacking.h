@@ -0,0 +1,134 @@
+/**********************************
+ * @file bitpacking.h
+ * @author Erich Gutierrez Chavez
+ * @brief Packs and unpacks 1, 2 and 4 bit pixel rows.
+ *
+ * @details
+ * - Rows use the BMP bit order: the leftmost pixel is stored in the
+ *   most significant bits of each byte.
+ * - 1-bit rows are packed 16 pixels at a time with an SSE2 compare and
+ *   movemask when available, with a portable fallback.
+ * - 2 and 4 bit rows are packed with plain loops the compiler vectorizes.
+ *
+ * Constraints:
+ * - Input levels must already be in range for the bit depth
+ *   (0..1, 0..3 or 0..15).
+ **********************************/
+
+#ifndef BIT_PACKING_H
+#define BIT_PACKING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**********************************
+ * Builds a table reversing the bit order of a byte.
+ * @return The 256 entry table.
+ **********************************/
+constexpr array<uint8_t, 256> makeReverseBitsTable() {
+    array<uint8_t, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < 8; ++b) {
+            if (i & (1 << b)) reversed |= 1 << (7 - b);
+        }
+        table[i] = static_cast<uint8_t>(reversed);
+    }
+    return table;
+}
+
+inline constexpr array<uint8_t, 256> kReverseBits = makeReverseBitsTable();
+
+class BitPacking {
+public:
+    /**********************************
+     * Packs a row of levels into bytes.
+     * @param levels One level per pixel.
+     * @param count Number of pixels in the row.
+     * @param bits Bits per pixel (1, 2 or 4).
+     * @param out Destination, at least (count * bits + 7) / 8 bytes.
+     **********************************/
+    static void packRow(const uint8_t* levels, size_t count, int bits, uint8_t* out) {
+        if (bits == 1) {
+            packRow1(levels, count, out);
+        } else if (bits == 2) {
+            packRowN<2>(levels, count, out);
+        } else if (bits == 4) {
+            packRowN<4>(levels, count, out);
+        }
+    }
+
+    /**********************************
+     * Unpacks a row of bytes into one level per pixel.
+     * @param packed Packed row.
+     * @param count Number of pixels in the row.
+     * @param bits Bits per pixel (1, 2 or 4).
+     * @param levels Destination, at least count bytes.
+     **********************************/
+    static void unpackRow(const uint8_t* packed, size_t count, int bits, uint8_t* levels) {
+        const int perByte = 8 / bits;
+        const uint8_t mask = static_cast<uint8_t>((1 << bits) - 1);
+        for (size_t x = 0; x < count; ++x) {
+            int shift = 8 - bits * (static_cast<int>(x % perByte) + 1);
+            levels[x] = (packed[x / perByte] >> shift) & mask;
+        }
+    }
+
+private:
+    /**********************************
+     * Packs a row of 0/1 levels, 8 pixels per byte.
+     **********************************/
+    static void packRow1(const uint8_t* levels, size_t count, uint8_t* out) {
+        size_t x = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= count; x += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + x));
+            // movemask collects one bit per byte, pixel 0 in the lowest bit
+            int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xFFFF;
+            out[x / 8] = kReverseBits[mask & 0xFF];
+            out[x / 8 + 1] = kReverseBits[mask >> 8];
+        }
+#endif
+        for (; x < count; x += 8) {
+            uint8_t byte = 0;
+            for (size_t b = 0; b < 8 && x + b < count; ++b) {
+                byte |= static_cast<uint8_t>((levels[x + b] != 0) << (7 - b));
+            }
+            out[x / 8] = byte;
+        }
+    }
+
+    /**********************************
+     * Packs a row of 2 or 4 bit levels.
+     * @tparam Bits Bits per pixel.
+     **********************************/
+    template <int Bits>
+    static void packRowN(const uint8_t* levels, size_t count, uint8_t* out) {
+        constexpr size_t perByte = 8 / Bits;
+        size_t fullBytes = count / perByte;
+        for (size_t i = 0; i < fullBytes; ++i) {
+            uint8_t byte = 0;
+            for (size_t b = 0; b < perByte; ++b) {
+                byte |= static_cast<uint8_t>(levels[i * perByte + b] << (8 - Bits * (b + 1)));
+            }
+            out[i] = byte;
+        }
+        if (count % perByte != 0) {
+            uint8_t byte = 0;
+            for (size_t b = 0; fullBytes * perByte + b < count; ++b) {
+                byte |= static_cast<uint8_t>(levels[fullBytes * perByte + b] << (8 - Bits * (b + 1)));
+            }
+            out[fullBytes] = byte;
+        }
+    }
+};
+
+#endif // BIT_PACKING_H
@@ -9,6 +9,8 @@
  * - Prevents overwriting of existing ports.
  * - Allows access to side packets using standard map operations.
  * - Ensures ports and packets are accessible but immutable once added.
+ * - Side output ports carry results (statistics, metadata) next to the
+ *   main outputs, they are not forwarded to the next calculator.
  **********************************/
 
 #ifndef CALCULATOR_CONTEXT_H
@@ -26,6 +28,7 @@ class CalculatorContext {
 private:
     map<string, shared_ptr<Port>> inputs;             // Input ports
     map<string, shared_ptr<Port>> outputs;            // Output ports
+    map<string, shared_ptr<Port>> sideOutputs;        // Side output ports, never forwarded
     const shared_ptr<map<string, Packet>> sidePackets; // Side packets
 
 public:
@@ -76,6 +79,19 @@ public:
         }
     }
 
+    /**********************************
+     * Add a new side output port.
+     * Side outputs are read by the application, the Scheduler does not
+     * connect them to the next calculator.
+     * @param tag Unique tag for the port.
+     * @param port The Port object to add.
+     **********************************/
+    void addSideOutputPort(const string& tag, Port&& port) {
+        if (sideOutputs.find(tag) == sideOutputs.end()) {
+            sideOutputs[tag] = make_shared<Port>(std::move(port));
+        }
+    }
+
     /**********************************
      * Bind an input port by tag.
      * @param tag Unique tag for the port.
@@ -122,6 +138,20 @@ public:
         return *(it->second);
     }
 
+    /**********************************
+     * Get side output port by tag.
+     * @param tag Unique tag for the port.
+     * @return Reference to the requested side output port.
+     * @throws CalculatorException if port not found.
+     **********************************/
+    Port& getSideOutputPort(const string& tag) const {
+        auto it = sideOutputs.find(tag);
+        if (it == sideOutputs.end()) {
+            throw CalculatorException("No such side output port: " + tag);
+        }
+        return *(it->second);
+    }
+
     /**********************************
      * Get side packet by tag.
      * @param tag Unique tag for the side packet.
@@ -186,6 +216,15 @@ public:
     bool hasSidePacket(const string& tag) const {
         return sidePackets->find(tag) != sidePackets->end();
     }
+
+    /**********************************
+     * Check if a side output port exists.
+     * @param tag Unique tag for the port.
+     * @return True if the side output port exists, false otherwise.
+     **********************************/
+    bool hasSideOutput(const string& tag) const {
+        return sideOutputs.find(tag) != sideOutputs.end();
+    }
 };
 
 #endif // CALCULATOR_CONTEXT_H
@@ -0,0 +1,546 @@
+/**********************************
+ * @file deflate.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the Deflate class, a fast single-pass deflate compressor
+ * for data that is compressed in independent chunks.
+ *
+ * @details
+ * - Two modes in the spirit of zlib's Z_HUFFMAN_ONLY and Z_RLE: literals
+ *   only, or literals and runs of the previous byte (distance 1). Both
+ *   suit filtered image rows, which are mostly small values and runs of
+ *   zeros, at a fraction of the cost of a match finder.
+ * - Every chunk is one dynamic Huffman block with length-limited codes,
+ *   or stored blocks when that is smaller. Chunks never refer to earlier
+ *   data and end on a byte boundary, so chunks compressed on different
+ *   threads concatenate into one valid stream (as pigz does).
+ * - Adler-32 checksums of chunks can be computed in parallel and
+ *   combined with combineAdler32().
+ *   https://www.rfc-editor.org/rfc/rfc1951 and rfc1950
+ **********************************/
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**********************************
+ * @enum DeflateMode
+ * @brief Symbols a chunk is coded with.
+ **********************************/
+enum class DeflateMode {
+    HUFFMAN_ONLY,   // Literals only
+    RLE             // Literals and runs of the previous byte
+};
+
+class Deflate {
+public:
+    static const int32_t kMaxCodeLength = 15;       // Longest literal/length or distance code
+    static const int32_t kMaxCodeLengthCode = 7;    // Longest code length code
+    static const uint32_t kAdlerBase = 65521;       // Largest prime below 65536
+
+    /**********************************
+     * Compresses a chunk as complete deflate blocks ending on a byte boundary.
+     * @param data Bytes to compress.
+     * @param size Number of bytes.
+     * @param mode Symbols to code the chunk with.
+     * @param last True for the final chunk of the stream.
+     * @param out Receives the blocks, appended.
+     **********************************/
+    static void compressChunk(const uint8_t* data, size_t size, DeflateMode mode, bool last,
+                              vector<uint8_t>& out) {
+        // Symbol frequencies, runs are kept as 256 + length tokens
+        array<uint32_t, 286> literalFreq{};
+        array<uint32_t, 30> distanceFreq{};
+        vector<uint16_t> tokens;
+        if (mode == DeflateMode::HUFFMAN_ONLY) {
+            // Four histograms, filtered rows repeat values and would stall on one counter
+            array<array<uint32_t, 256>, 4> counts{};
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4) {
+                ++counts[0][data[i]];
+                ++counts[1][data[i + 1]];
+                ++counts[2][data[i + 2]];
+                ++counts[3][data[i + 3]];
+            }
+            for (; i < size; ++i) ++counts[0][data[i]];
+            for (int32_t value = 0; value < 256; ++value) {
+                literalFreq[value] = counts[0][value] + counts[1][value] + counts[2][value] + counts[3][value];
+            }
+        } else {
+            tokens.resize(size);
+            uint16_t* token = tokens.data();
+            const LengthTable& table = lengthTable();
+            size_t i = 0;
+            int32_t previous = -1;
+            while (i < size) {
+                const uint8_t value = data[i];
+                if (value != previous) {
+                    *token++ = value;
+                    ++literalFreq[value];
+                    previous = value;
+                    ++i;
+                    continue;
+                }
+                // Runs of at least 3 repeat the previous byte, shorter ones stay literals
+                const size_t limit = min<size_t>(258, size - i);
+                size_t run = 1;
+                while (run < limit && data[i + run] == value) ++run;
+                if (run >= 3) {
+                    *token++ = static_cast<uint16_t>(256 + run);
+                    ++literalFreq[table.code[run]];
+                    ++distanceFreq[0];
+                } else {
+                    for (size_t k = 0; k < run; ++k) *token++ = value;
+                    literalFreq[value] += static_cast<uint32_t>(run);
+                }
+                i += run;
+            }
+            tokens.resize(token - tokens.data());
+        }
+        literalFreq[256] = 1;
+
+        // Every tree gets at least two codes, some inflaters reject less
+        if (count_if(distanceFreq.begin(), distanceFreq.end(), [](uint32_t f) { return f > 0; }) < 2) {
+            distanceFreq[0] = max<uint32_t>(distanceFreq[0], 1);
+            distanceFreq[1] = max<uint32_t>(distanceFreq[1], 1);
+        }
+        if (count_if(literalFreq.begin(), literalFreq.end(), [](uint32_t f) { return f > 0; }) < 2) {
+            literalFreq[0] = 1;
+        }
+
+        DynamicHeader header = buildHeader(literalFreq.data(), distanceFreq.data());
+        uint64_t dataBits = 0;
+        const LengthTable& table = lengthTable();
+        for (int32_t symbol = 0; symbol < 286; ++symbol) {
+            dataBits += static_cast<uint64_t>(literalFreq[symbol]) *
+                        (header.literalLengths[symbol] + (symbol > 256 ? table.symbolExtraBits[symbol - 257] : 0));
+        }
+        dataBits += static_cast<uint64_t>(distanceFreq[0]) * header.distanceLengths[0];
+
+        // Stored blocks hold at most 65535 bytes, 5 header bytes each
+        const size_t storedBlocks = max<size_t>(1, (size + 65534) / 65535);
+        const uint64_t storedBits = (static_cast<uint64_t>(size) + storedBlocks * 5) * 8;
+        const uint64_t dynamicBits = 3 + header.bits + dataBits;
+
+        const size_t start = out.size();
+        if (dynamicBits >= storedBits) {
+            out.resize(start + size + storedBlocks * 5 + 8);
+            BitWriter writer(out.data() + start);
+            size_t offset = 0;
+            for (size_t block = 0; block < storedBlocks; ++block) {
+                const size_t length = min<size_t>(65535, size - offset);
+                writer.put(last && block + 1 == storedBlocks ? 1 : 0, 1);
+                writer.put(0, 2);
+                writer.align();
+                writer.put(static_cast<uint32_t>(length), 16);
+                writer.put(static_cast<uint32_t>(~length & 0xFFFF), 16);
+                memcpy(writer.p, data + offset, length);
+                writer.p += length;
+                offset += length;
+            }
+            out.resize(writer.p - out.data());
+            return;
+        }
+
+        // Dynamic block, plus an empty stored block to align non-final chunks
+        out.resize(start + dynamicBits / 8 + 16);
+        BitWriter writer(out.data() + start);
+        writer.put(last ? 1 : 0, 1);
+        writer.put(2, 2);
+        writeHeader(writer, header);
+
+        // Codes of every token, a run is its length symbol, extra bits and distance 1
+        array<uint32_t, 515> tokenCodes;
+        array<uint8_t, 515> tokenLengths;
+        for (int32_t value = 0; value < 256; ++value) {
+            tokenCodes[value] = header.literalCodes[value];
+            tokenLengths[value] = header.literalLengths[value];
+        }
+        if (mode == DeflateMode::RLE) {
+            for (int32_t length = 3; length <= 258; ++length) {
+                const int32_t symbol = table.code[length];
+                const int32_t extraBits = table.symbolExtraBits[symbol - 257];
+                const int32_t symbolLength = header.literalLengths[symbol];
+                tokenCodes[256 + length] = header.literalCodes[symbol] |
+                                           static_cast<uint32_t>(table.extraValue[length]) << symbolLength |
+                                           static_cast<uint32_t>(header.distanceCodes[0]) << (symbolLength + extraBits);
+                tokenLengths[256 + length] = static_cast<uint8_t>(symbolLength + extraBits + header.distanceLengths[0]);
+            }
+        }
+
+        // Two tokens of at most 21 bits per put halve the dependency chain
+        auto emit = [&](const auto* symbols, size_t count) {
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2) {
+                const uint32_t first = symbols[i];
+                const uint32_t second = symbols[i + 1];
+                writer.put(tokenCodes[first] | static_cast<uint64_t>(tokenCodes[second]) << tokenLengths[first],
+                           tokenLengths[first] + tokenLengths[second]);
+            }
+            if (i < count) writer.put(tokenCodes[symbols[i]], tokenLengths[symbols[i]]);
+        };
+        if (mode == DeflateMode::HUFFMAN_ONLY) {
+            emit(data, size);
+        } else {
+            emit(tokens.data(), tokens.size());
+        }
+        const uint16_t* literalCodes = header.literalCodes.data();
+        const uint8_t* literalLengths = header.literalLengths.data();
+        writer.put(literalCodes[256], literalLengths[256]);
+        if (!last) {
+            writer.put(0, 3);
+            writer.align();
+            writer.put(0xFFFF0000u, 32);
+        }
+        writer.align();
+        out.resize(writer.p - out.data());
+    }
+
+    /**********************************
+     * Computes or continues an Adler-32 checksum.
+     * @param data Bytes to checksum.
+     * @param size Number of bytes.
+     * @param adler Checksum of the preceding bytes, 1 for none.
+     * @return The checksum.
+     **********************************/
+    static uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1) {
+        uint64_t a = adler & 0xFFFF;
+        uint64_t b = adler >> 16;
+        while (size > 0) {
+            // 5552 bytes is the most the scalar sums take without overflowing 32 bits
+            const size_t block = min<size_t>(size, 5552);
+            size_t i = 0;
+#ifdef __SSE2__
+            // Per 16 bytes: b += 16 * a + 16 * x0 + 15 * x1 + ... + x15, a += x0 + ... + x15
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i weightsLow = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+            const __m128i weightsHigh = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+            __m128i byteSums = zero;
+            __m128i previousSums = zero;
+            __m128i weighted = zero;
+            const size_t vectors = block / 16;
+            for (; i + 16 <= block; i += 16) {
+                const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                previousSums = _mm_add_epi64(previousSums, byteSums);
+                byteSums = _mm_add_epi64(byteSums, _mm_sad_epu8(x, zero));
+                weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), weightsLow));
+                weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), weightsHigh));
+            }
+            weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 8));
+            weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+            const uint64_t bytes = static_cast<uint64_t>(_mm_cvtsi128_si64(byteSums)) +
+                                   static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_srli_si128(byteSums, 8)));
+            const uint64_t previous = static_cast<uint64_t>(_mm_cvtsi128_si64(previousSums)) +
+                                      static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_srli_si128(previousSums, 8)));
+            b += vectors * 16 * a + 16 * previous + static_cast<uint32_t>(_mm_cvtsi128_si32(weighted));
+            a += bytes;
+#endif
+            for (; i < block; ++i) {
+                a += data[i];
+                b += a;
+            }
+            a %= kAdlerBase;
+            b %= kAdlerBase;
+            data += block;
+            size -= block;
+        }
+        return static_cast<uint32_t>(b << 16 | a);
+    }
+
+    /**********************************
+     * Combines the Adler-32 checksums of two consecutive byte ranges.
+     * @param first Checksum of the first range.
+     * @param second Checksum of the second range.
+     * @param secondSize Length of the second range.
+     * @return The checksum of both ranges.
+     **********************************/
+    static uint32_t combineAdler32(uint32_t first, uint32_t second, size_t secondSize) {
+        const uint32_t remainder = static_cast<uint32_t>(secondSize % kAdlerBase);
+        uint32_t a = first & 0xFFFF;
+        uint32_t b = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * a) % kAdlerBase);
+        a += (second & 0xFFFF) + kAdlerBase - 1;
+        b += (first >> 16) + (second >> 16) + kAdlerBase - remainder;
+        if (a >= kAdlerBase) a -= kAdlerBase;
+        if (a >= kAdlerBase) a -= kAdlerBase;
+        if (b >= kAdlerBase * 2) b -= kAdlerBase * 2;
+        if (b >= kAdlerBase) b -= kAdlerBase;
+        return b << 16 | a;
+    }
+
+    /**********************************
+     * Computes length-limited Huffman code lengths.
+     * A single used symbol still gets a one bit code, as does symbol 0 or 1.
+     * @param freq Frequency of each symbol.
+     * @param count Number of symbols.
+     * @param maxLength Longest allowed code.
+     * @param lengths Receives the code length of each symbol, 0 if unused.
+     **********************************/
+    static void buildLengths(const uint32_t* freq, int32_t count, int32_t maxLength, uint8_t* lengths) {
+        fill(lengths, lengths + count, 0);
+        vector<pair<uint32_t, int32_t>> leaves;
+        for (int32_t symbol = 0; symbol < count; ++symbol) {
+            if (freq[symbol] > 0) leaves.emplace_back(freq[symbol], symbol);
+        }
+        if (leaves.empty()) return;
+        if (leaves.size() == 1) {
+            lengths[leaves[0].second] = 1;
+            lengths[leaves[0].second == 0 ? 1 : 0] = 1;
+            return;
+        }
+        stable_sort(leaves.begin(), leaves.end(),
+                    [](const pair<uint32_t, int32_t>& a, const pair<uint32_t, int32_t>& b) { return a.first < b.first; });
+
+        // Huffman tree with two queues: sorted leaves and internal nodes in creation order
+        const int32_t leafCount = static_cast<int32_t>(leaves.size());
+        vector<uint64_t> weight(2 * leafCount - 1);
+        vector<int32_t> parent(2 * leafCount - 1, 0);
+        for (int32_t i = 0; i < leafCount; ++i) weight[i] = leaves[i].first;
+        int32_t nextLeaf = 0;
+        int32_t nextNode = leafCount;
+        for (int32_t node = leafCount; node < 2 * leafCount - 1; ++node) {
+            for (int32_t pick = 0; pick < 2; ++pick) {
+                int32_t child;
+                if (nextLeaf < leafCount && (nextNode >= node || weight[nextLeaf] <= weight[nextNode])) {
+                    child = nextLeaf++;
+                } else {
+                    child = nextNode++;
+                }
+                weight[node] += weight[child];
+                parent[child] = node;
+            }
+        }
+
+        // Leaf depths, clamped, then the Kraft sum is repaired as miniz does
+        vector<int32_t> depth(2 * leafCount - 1, 0);
+        array<uint32_t, 33> lengthCount{};
+        for (int32_t node = 2 * leafCount - 3; node >= 0; --node) {
+            depth[node] = depth[parent[node]] + 1;
+            if (node < leafCount) ++lengthCount[min(depth[node], maxLength)];
+        }
+        uint64_t kraft = 0;
+        for (int32_t length = 1; length <= maxLength; ++length) {
+            kraft += static_cast<uint64_t>(lengthCount[length]) << (maxLength - length);
+        }
+        while (kraft > (1ULL << maxLength)) {
+            --lengthCount[maxLength];
+            for (int32_t length = maxLength - 1; length > 0; --length) {
+                if (lengthCount[length] > 0) {
+                    --lengthCount[length];
+                    lengthCount[length + 1] += 2;
+                    break;
+                }
+            }
+            --kraft;
+        }
+
+        // Rarest symbols get the longest codes
+        int32_t leaf = 0;
+        for (int32_t length = maxLength; length > 0; --length) {
+            for (uint32_t i = 0; i < lengthCount[length]; ++i) {
+                lengths[leaves[leaf++].second] = static_cast<uint8_t>(length);
+            }
+        }
+    }
+
+private:
+    /**********************************
+     * @struct BitWriter
+     * @brief Writes codes least significant bit first into a sized buffer.
+     * Every put stores 8 bytes and advances by the whole bytes written,
+     * without a branch, so the buffer needs 8 bytes of slack.
+     **********************************/
+    struct BitWriter {
+        uint8_t* p;
+        uint64_t bits = 0;
+        int32_t count = 0;
+
+        explicit BitWriter(uint8_t* target) : p(target) {}
+
+        void put(uint64_t value, int32_t length) {
+            bits |= static_cast<uint64_t>(value) << count;
+            count += length;
+            memcpy(p, &bits, 8);
+            p += count >> 3;
+            bits >>= count & ~7;
+            count &= 7;
+        }
+
+        void align() {
+            // The partial byte is already stored
+            if (count > 0) ++p;
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    /**********************************
+     * @struct LengthTable
+     * @brief Length symbols and extra bits for match lengths 3 to 258.
+     **********************************/
+    struct LengthTable {
+        array<uint16_t, 259> code{};
+        array<uint16_t, 259> extraValue{};
+        array<uint8_t, 29> symbolExtraBits{};
+    };
+
+    /**********************************
+     * @struct DynamicHeader
+     * @brief Codes of a dynamic block and its encoded code lengths.
+     **********************************/
+    struct DynamicHeader {
+        array<uint8_t, 286> literalLengths{};
+        array<uint16_t, 286> literalCodes{};
+        array<uint8_t, 30> distanceLengths{};
+        array<uint16_t, 30> distanceCodes{};
+        array<uint8_t, 19> codeLengthLengths{};
+        array<uint16_t, 19> codeLengthCodes{};
+        vector<pair<uint8_t, uint8_t>> codeLengthTokens;    // Symbol and extra bits value
+        int32_t literalCount = 257;
+        int32_t distanceCount = 1;
+        int32_t codeLengthCount = 4;
+        uint64_t bits = 0;          // Header size in bits, without the 3 bit block header
+    };
+
+    static const LengthTable& lengthTable() {
+        static const LengthTable table = [] {
+            static const uint16_t base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const uint8_t extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            LengthTable result;
+            for (int32_t symbol = 0; symbol < 29; ++symbol) {
+                result.symbolExtraBits[symbol] = extra[symbol];
+                // 258 has its own symbol, the next to last one stops at 257
+                const int32_t end = symbol == 28 ? 259 : min(258, base[symbol] + (1 << extra[symbol]));
+                for (int32_t length = base[symbol]; length < end; ++length) {
+                    result.code[length] = static_cast<uint16_t>(257 + symbol);
+                    result.extraValue[length] = static_cast<uint16_t>(length - base[symbol]);
+                }
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    /**********************************
+     * Assigns canonical codes, bit reversed for least significant bit first output.
+     **********************************/
+    static void assignCodes(const uint8_t* lengths, int32_t count, uint16_t* codes) {
+        array<uint32_t, 16> lengthCount{};
+        for (int32_t symbol = 0; symbol < count; ++symbol) ++lengthCount[lengths[symbol]];
+        lengthCount[0] = 0;
+        array<uint32_t, 16> nextCode{};
+        uint32_t code = 0;
+        for (int32_t length = 1; length < 16; ++length) {
+            code = (code + lengthCount[length - 1]) << 1;
+            nextCode[length] = code;
+        }
+        for (int32_t symbol = 0; symbol < count; ++symbol) {
+            const int32_t length = lengths[symbol];
+            if (length == 0) continue;
+            uint32_t value = nextCode[length]++;
+            uint32_t reversed = 0;
+            for (int32_t bit = 0; bit < length; ++bit, value >>= 1) reversed = reversed << 1 | (value & 1);
+            codes[symbol] = static_cast<uint16_t>(reversed);
+        }
+    }
+
+    /**********************************
+     * Builds the codes of a dynamic block and run-length codes their lengths.
+     **********************************/
+    static DynamicHeader buildHeader(const uint32_t* literalFreq, const uint32_t* distanceFreq) {
+        DynamicHeader header;
+        buildLengths(literalFreq, 286, kMaxCodeLength, header.literalLengths.data());
+        buildLengths(distanceFreq, 30, kMaxCodeLength, header.distanceLengths.data());
+        assignCodes(header.literalLengths.data(), 286, header.literalCodes.data());
+        assignCodes(header.distanceLengths.data(), 30, header.distanceCodes.data());
+        for (int32_t symbol = 285; symbol >= 257; --symbol) {
+            if (header.literalLengths[symbol] != 0) {
+                header.literalCount = symbol + 1;
+                break;
+            }
+        }
+        for (int32_t symbol = 29; symbol >= 1; --symbol) {
+            if (header.distanceLengths[symbol] != 0) {
+                header.distanceCount = symbol + 1;
+                break;
+            }
+        }
+
+        // Both length sequences are coded as one, with repeat symbols 16, 17 and 18
+        vector<uint8_t> sequence(header.literalLengths.begin(), header.literalLengths.begin() + header.literalCount);
+        sequence.insert(sequence.end(), header.distanceLengths.begin(),
+                        header.distanceLengths.begin() + header.distanceCount);
+        array<uint32_t, 19> codeLengthFreq{};
+        for (size_t i = 0; i < sequence.size();) {
+            const uint8_t value = sequence[i];
+            size_t run = 1;
+            while (i + run < sequence.size() && sequence[i + run] == value) ++run;
+            if (value == 0 && run >= 3) {
+                run = min<size_t>(run, 138);
+                if (run >= 11) header.codeLengthTokens.emplace_back(18, static_cast<uint8_t>(run - 11));
+                else header.codeLengthTokens.emplace_back(17, static_cast<uint8_t>(run - 3));
+            } else if (value != 0 && run >= 4) {
+                run = min<size_t>(run, 7);
+                header.codeLengthTokens.emplace_back(value, 0);
+                header.codeLengthTokens.emplace_back(16, static_cast<uint8_t>(run - 4));
+            } else {
+                run = 1;
+                header.codeLengthTokens.emplace_back(value, 0);
+            }
+            i += run;
+        }
+        for (const pair<uint8_t, uint8_t>& token : header.codeLengthTokens) ++codeLengthFreq[token.first];
+        buildLengths(codeLengthFreq.data(), 19, kMaxCodeLengthCode, header.codeLengthLengths.data());
+        assignCodes(header.codeLengthLengths.data(), 19, header.codeLengthCodes.data());
+
+        const array<uint8_t, 19>& order = codeLengthOrder();
+        for (int32_t i = 18; i >= 4; --i) {
+            if (header.codeLengthLengths[order[i]] != 0) {
+                header.codeLengthCount = i + 1;
+                break;
+            }
+        }
+        header.bits = 5 + 5 + 4 + 3 * header.codeLengthCount;
+        for (const pair<uint8_t, uint8_t>& token : header.codeLengthTokens) {
+            header.bits += header.codeLengthLengths[token.first] + codeLengthExtraBits(token.first);
+        }
+        return header;
+    }
+
+    static void writeHeader(BitWriter& writer, const DynamicHeader& header) {
+        writer.put(header.literalCount - 257, 5);
+        writer.put(header.distanceCount - 1, 5);
+        writer.put(header.codeLengthCount - 4, 4);
+        const array<uint8_t, 19>& order = codeLengthOrder();
+        for (int32_t i = 0; i < header.codeLengthCount; ++i) {
+            writer.put(header.codeLengthLengths[order[i]], 3);
+        }
+        for (const pair<uint8_t, uint8_t>& token : header.codeLengthTokens) {
+            writer.put(header.codeLengthCodes[token.first], header.codeLengthLengths[token.first]);
+            writer.put(token.second, codeLengthExtraBits(token.first));
+        }
+    }
+
+    static int32_t codeLengthExtraBits(uint8_t symbol) {
+        return symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0;
+    }
+
+    static const array<uint8_t, 19>& codeLengthOrder() {
+        static const array<uint8_t, 19> order = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        return order;
+    }
+};
+
+#endif // DEFLATE_H
@@ -0,0 +1,110 @@
+/**********************************
+ * @file framepool.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the FramePool class, a free list of image buffers reused
+ * across frames.
+ *
+ * @details
+ * - acquire() hands out an Image built on a released buffer when one is
+ *   large enough, so steady state frame production does not allocate nor
+ *   zero fill. Only a fresh allocation is zeroed.
+ * - release() takes the buffer back from an Image the consumer is done
+ *   with. Frames never released are simply freed by their last owner.
+ * - The pool keeps at most `capacity` buffers, extra releases are freed.
+ * - Safe to share between threads, e.g. a producer calculator and an
+ *   output consumer returning frames.
+ *
+ * Constraints:
+ * - Pixels of a reused buffer are left from its previous frame, the
+ *   caller must write every pixel it emits.
+ **********************************/
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "image.h"
+
+using namespace std;
+
+class FramePool {
+private:
+    mutable mutex lock;                 // Protects buffers
+    vector<vector<uint8_t>> buffers;    // Released buffers
+    size_t capacity;                    // Maximum number of buffers kept
+    size_t allocations;                 // Buffers allocated by acquire()
+
+public:
+    /**********************************
+     * Constructor.
+     * @param newCapacity Maximum number of released buffers kept.
+     **********************************/
+    explicit FramePool(size_t newCapacity = 4) : capacity(newCapacity), allocations(0) {}
+
+    /**********************************
+     * Retrieves an image, reusing a released buffer if one is large enough.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @param format The pixel format of the image.
+     * @return The image, its pixels are undefined when the buffer is reused.
+     * @throws ImageException if dimensions or format are invalid.
+     **********************************/
+    Image acquire(int32_t width, int32_t height, PixelFormat format) {
+        if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN) {
+            throw ImageException("Error FramePool: Invalid image dimensions or format.");
+        }
+        const size_t bytes = static_cast<size_t>(height) *
+                             ((static_cast<size_t>(width) * Image::bitsPerPixel(format) + 7) / 8);
+        {
+            lock_guard<mutex> guard(lock);
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                if (buffers[i].capacity() < bytes) continue;
+                vector<uint8_t> buffer = std::move(buffers[i]);
+                buffers[i] = std::move(buffers.back());
+                buffers.pop_back();
+                buffer.resize(bytes);
+                return Image(width, height, format, std::move(buffer));
+            }
+            allocations++;
+        }
+        return Image(width, height, format, vector<uint8_t>(bytes));
+    }
+
+    /**********************************
+     * Returns the buffer of an image to the pool.
+     * The image is left without pixels and must not be used afterwards.
+     * @param image The image to recycle.
+     **********************************/
+    void release(Image&& image) {
+        vector<uint8_t> buffer = std::move(image.getData());
+        if (buffer.capacity() == 0) return;
+        lock_guard<mutex> guard(lock);
+        if (buffers.size() < capacity) {
+            buffers.push_back(std::move(buffer));
+        }
+    }
+
+    /**********************************
+     * Retrieves the number of buffers ready to be reused.
+     * @return The number of released buffers held.
+     **********************************/
+    size_t size() const {
+        lock_guard<mutex> guard(lock);
+        return buffers.size();
+    }
+
+    /**********************************
+     * Retrieves the number of buffers acquire() had to allocate.
+     * @return The allocation count.
+     **********************************/
+    size_t getAllocationCount() const {
+        lock_guard<mutex> guard(lock);
+        return allocations;
+    }
+
+    size_t getCapacity() const { return capacity; }
+};
+
+#endif // FRAME_POOL_H
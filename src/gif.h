@@ -0,0 +1,554 @@
+/**********************************
+ * @file gif.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the GifPalette, GifLzw and GifWriter classes, an animated
+ * GIF encoder running on its own writer thread.
+ *
+ * @details
+ * - GifPalette is a lattice of evenly spaced levels per channel, the same
+ *   levels DitherKernel quantizes to, so dithered frames map onto it
+ *   exactly with one table lookup per channel. Other frames map to the
+ *   nearest lattice color. The last entry is reserved for transparency.
+ * - GifLzw compresses index frames with a hashed dictionary: a 8192 slot
+ *   open-addressing table keyed by prefix code and next index.
+ * - GifWriter queues index frames and encodes them on a writer thread, so
+ *   encoding overlaps processing. Only the rectangle that changed since
+ *   the previous frame is stored, unchanged pixels inside it become
+ *   transparent. Frames without changes extend the delay of the previous
+ *   frame instead of being stored.
+ *   https://www.w3.org/Graphics/GIF/spec-gif89a.txt
+ *
+ * Constraints:
+ * - At most 255 palette colors, the lattice product must not exceed it.
+ * - Frame delays have centisecond resolution, rounding does not drift.
+ **********************************/
+
+#ifndef GIF_H
+#define GIF_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bitpacking.h"
+#include "image.h"
+
+using namespace std;
+
+/**********************************
+ * @class GifPalette
+ * @brief A palette of evenly spaced color or gray levels.
+ **********************************/
+class GifPalette {
+private:
+    int32_t redLevels;      // Levels per channel, all equal for gray palettes
+    int32_t greenLevels;
+    int32_t blueLevels;
+    bool isGray;            // True if entries are gray levels
+    array<array<uint8_t, 256>, 3> channelIndex;     // Value to index contribution, per channel
+    vector<uint8_t> colors;                         // RGB triplets, padded to a power of two
+
+public:
+    /**********************************
+     * Constructor of a color lattice.
+     * @param red Number of red levels.
+     * @param green Number of green levels.
+     * @param blue Number of blue levels.
+     * @throws ImageException if the levels are below 2 or exceed 255 colors.
+     **********************************/
+    GifPalette(int32_t red, int32_t green, int32_t blue)
+        : redLevels(red), greenLevels(green), blueLevels(blue), isGray(false) {
+        if (red < 2 || green < 2 || blue < 2 || red * green * blue > 255) {
+            throw ImageException("Error GifPalette: Levels must be at least 2 and at most 255 colors.");
+        }
+        build();
+    }
+
+    /**********************************
+     * Creates a gray palette.
+     * @param levels Number of gray levels, 2 to 255.
+     * @return The palette.
+     * @throws ImageException if the levels are out of range.
+     **********************************/
+    static GifPalette gray(int32_t levels) {
+        if (levels < 2 || levels > 255) {
+            throw ImageException("Error GifPalette: Gray levels must be in [2, 255].");
+        }
+        return GifPalette(levels);
+    }
+
+    /**********************************
+     * Maps an image to palette indexes.
+     * Packed gray images must use a gray palette of 2, 4 or 16 levels
+     * matching their depth, their levels are the indexes.
+     * @param image The frame.
+     * @param indexes Receives one index per pixel, row by row.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    void map(const Image& image, vector<uint8_t>& indexes) const {
+        const int32_t width = image.getWidth();
+        indexes.resize(static_cast<size_t>(width) * image.getHeight());
+        const int32_t bits = Image::bitsPerPixel(image.getFormat());
+        if (bits > 0 && bits < 8) {
+            if (!isGray || redLevels != (1 << bits)) {
+                throw ImageException("Error GifPalette: Packed gray frames need a gray palette of their depth.");
+            }
+            for (int32_t y = 0; y < image.getHeight(); ++y) {
+                BitPacking::unpackRow(image.getData().data() + static_cast<size_t>(y) * image.getStride(),
+                                      width, bits, indexes.data() + static_cast<size_t>(y) * width);
+            }
+            return;
+        }
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                using Traits = typename decltype(tag)::Traits;
+                uint8_t* target = indexes.data();
+                for (int32_t y = 0; y < image.getHeight(); ++y) {
+                    const uint8_t* pixel = image.getData().data() + static_cast<size_t>(y) * image.getStride();
+                    for (int32_t x = 0; x < width; ++x, pixel += Traits::bytesPerPixel) {
+                        if (isGray) {
+                            // BT.709 luma, as the rest of the pipeline
+                            uint8_t luma = pixel[0];
+                            if constexpr (Traits::channels > 1) {
+                                luma = static_cast<uint8_t>((54 * pixel[Traits::redOffset] +
+                                    183 * pixel[Traits::greenOffset] + 19 * pixel[Traits::blueOffset]) >> 8);
+                            }
+                            *target++ = channelIndex[0][luma];
+                        } else {
+                            *target++ = static_cast<uint8_t>(channelIndex[0][pixel[Traits::redOffset]] +
+                                channelIndex[1][pixel[Traits::greenOffset]] + channelIndex[2][pixel[Traits::blueOffset]]);
+                        }
+                    }
+                }
+            });
+        if (!matched) {
+            throw ImageException("Error GifPalette: Unsupported pixel format.");
+        }
+    }
+
+    /**********************************
+     * Retrieves the color table.
+     * @return RGB triplets, a power of two of them, at least 4.
+     **********************************/
+    const vector<uint8_t>& getColors() const { return colors; }
+
+    /**********************************
+     * Retrieves the index reserved for transparent pixels.
+     * @return The index following the last color.
+     **********************************/
+    uint8_t getTransparentIndex() const {
+        return static_cast<uint8_t>(isGray ? redLevels : redLevels * greenLevels * blueLevels);
+    }
+
+    /**********************************
+     * Retrieves the number of bits of an index, the size of the color table.
+     * @return 2 to 8.
+     **********************************/
+    int32_t getIndexBits() const {
+        int32_t bits = 2;
+        while ((1 << bits) < getTransparentIndex() + 1) ++bits;
+        return bits;
+    }
+
+private:
+    explicit GifPalette(int32_t levels)
+        : redLevels(levels), greenLevels(levels), blueLevels(levels), isGray(true) {
+        build();
+    }
+
+    /**********************************
+     * Value of a level, the same rounding DitherKernel uses.
+     **********************************/
+    static uint8_t levelValue(int32_t level, int32_t levels) {
+        return static_cast<uint8_t>((level / (levels - 1.0)) * 255.0);
+    }
+
+    void build() {
+        // Index = (r * greenLevels + g) * blueLevels + b, split into per-channel terms
+        const int32_t levels[3] = {redLevels, greenLevels, blueLevels};
+        const int32_t weights[3] = {isGray ? 1 : greenLevels * blueLevels, blueLevels, 1};
+        for (int32_t channel = 0; channel < 3; ++channel) {
+            for (int32_t value = 0; value < 256; ++value) {
+                const int32_t level = (value * (levels[channel] - 1) + 127) / 255;
+                channelIndex[channel][value] = static_cast<uint8_t>(level * weights[channel]);
+            }
+        }
+
+        colors.assign(3 << getIndexBits(), 0);
+        if (isGray) {
+            for (int32_t level = 0; level < redLevels; ++level) {
+                memset(colors.data() + 3 * level, levelValue(level, redLevels), 3);
+            }
+            return;
+        }
+        for (int32_t r = 0; r < redLevels; ++r) {
+            for (int32_t g = 0; g < greenLevels; ++g) {
+                for (int32_t b = 0; b < blueLevels; ++b) {
+                    uint8_t* color = colors.data() + 3 * ((r * greenLevels + g) * blueLevels + b);
+                    color[0] = levelValue(r, redLevels);
+                    color[1] = levelValue(g, greenLevels);
+                    color[2] = levelValue(b, blueLevels);
+                }
+            }
+        }
+    }
+};
+
+/**********************************
+ * @class GifLzw
+ * @brief Variable-length LZW compression of palette indexes.
+ **********************************/
+class GifLzw {
+public:
+    static const int32_t kMaxCodes = 4096;      // 12-bit codes
+    static const int32_t kTableBits = 13;       // Dictionary hash table of 8192 slots
+
+    /**********************************
+     * Compresses a rectangle of an index frame into GIF data sub-blocks.
+     * @param indexes The index frame.
+     * @param stride Indexes per frame row.
+     * @param x Left of the rectangle.
+     * @param y Top of the rectangle.
+     * @param width Width of the rectangle.
+     * @param height Height of the rectangle.
+     * @param minCodeSize Bits of an index, 2 to 8.
+     * @param out Receives the minimum code size, the sub-blocks and the terminator.
+     **********************************/
+    static void encode(const uint8_t* indexes, size_t stride, int32_t x, int32_t y, int32_t width,
+                       int32_t height, int32_t minCodeSize, vector<uint8_t>& out) {
+        const uint32_t clearCode = 1u << minCodeSize;
+        vector<int32_t> keys(1 << kTableBits);
+        vector<uint16_t> codes(1 << kTableBits);
+        vector<uint8_t> packed;
+        packed.reserve(static_cast<size_t>(width) * height / 2 + 16);
+
+        uint64_t bits = 0;
+        int32_t bitCount = 0;
+        auto put = [&](uint32_t code, int32_t size) {
+            bits |= static_cast<uint64_t>(code) << bitCount;
+            bitCount += size;
+            while (bitCount >= 8) {
+                packed.push_back(static_cast<uint8_t>(bits));
+                bits >>= 8;
+                bitCount -= 8;
+            }
+        };
+
+        uint32_t nextCode = 0;
+        int32_t codeSize = 0;
+        auto reset = [&] {
+            fill(keys.begin(), keys.end(), -1);
+            nextCode = clearCode + 2;
+            codeSize = minCodeSize + 1;
+        };
+        reset();
+        put(clearCode, codeSize);
+
+        int32_t prefix = indexes[y * stride + x];
+        bool first = true;
+        for (int32_t row = y; row < y + height; ++row) {
+            const uint8_t* line = indexes + row * stride;
+            for (int32_t col = x; col < x + width; ++col) {
+                if (first) {
+                    first = false;
+                    continue;
+                }
+                const uint8_t index = line[col];
+                const int32_t key = prefix << 8 | index;
+                uint32_t slot = (static_cast<uint32_t>(key) * 2654435761u) >> (32 - kTableBits);
+                while (keys[slot] != -1 && keys[slot] != key) slot = (slot + 1) & ((1 << kTableBits) - 1);
+                if (keys[slot] == key) {
+                    prefix = codes[slot];
+                    continue;
+                }
+
+                put(prefix, codeSize);
+                // The decoder adds its entry one code later, so it grows one code later too
+                if (nextCode < kMaxCodes - 1) {
+                    keys[slot] = key;
+                    codes[slot] = static_cast<uint16_t>(nextCode++);
+                    if (nextCode > (1u << codeSize) && codeSize < 12) ++codeSize;
+                } else {
+                    put(clearCode, codeSize);
+                    reset();
+                }
+                prefix = index;
+            }
+        }
+        put(prefix, codeSize);
+        put(clearCode + 1, codeSize);
+        if (bitCount > 0) packed.push_back(static_cast<uint8_t>(bits));
+
+        out.push_back(static_cast<uint8_t>(minCodeSize));
+        for (size_t offset = 0; offset < packed.size(); offset += 255) {
+            const size_t length = min<size_t>(255, packed.size() - offset);
+            out.push_back(static_cast<uint8_t>(length));
+            out.insert(out.end(), packed.begin() + offset, packed.begin() + offset + length);
+        }
+        out.push_back(0);
+    }
+};
+
+/**********************************
+ * @class GifWriter
+ * @brief Writes an animated GIF file from index frames on a writer thread.
+ **********************************/
+class GifWriter {
+private:
+    /**********************************
+     * @struct Frame
+     * @brief A queued index frame.
+     **********************************/
+    struct Frame {
+        vector<uint8_t> indexes;    // One palette index per pixel
+        long long timestamp;        // Presentation time in microseconds
+    };
+
+    ofstream file;                  // Output file, only used by the writer thread after construction
+    int32_t width;                  // Frame width
+    int32_t height;                 // Frame height
+    GifPalette palette;             // Global color table
+    size_t capacity;                // Queued frames before addFrame() blocks
+
+    mutex lock;                     // Guards the queue, closing and error
+    condition_variable changed;     // Signals queue changes both ways
+    deque<Frame> queue;             // Frames waiting for the writer thread
+    bool closing = false;           // No more frames will be added
+    exception_ptr error;            // First error of the writer thread
+    thread writer;                  // Encodes and writes queued frames
+
+    // Writer thread state
+    vector<uint8_t> previous;       // Indexes of the last stored frame
+    vector<uint8_t> pending;        // Encoded last frame, held until its delay is known
+    long long pendingTimestamp = 0; // Timestamp of the pending frame
+    long long latestTimestamp = 0;  // Timestamp of the last frame, stored or merged
+    long long frameInterval = 4;    // Centiseconds between the last two frames, for the final one
+    size_t storedFrames = 0;        // Frames written to the file
+    size_t mergedFrames = 0;        // Unchanged frames folded into a previous delay
+
+public:
+    /**********************************
+     * Constructor. Writes the file header and starts the writer thread.
+     * @param filename The path of the GIF file.
+     * @param frameWidth Width of every frame.
+     * @param frameHeight Height of every frame.
+     * @param framePalette Global palette, frames are indexes into it.
+     * @param loopCount Animation repetitions, 0 loops forever.
+     * @param queueCapacity Queued frames before addFrame() blocks.
+     * @throws runtime_error if the file cannot be opened.
+     * @throws ImageException if the size is invalid.
+     **********************************/
+    GifWriter(const string& filename, int32_t frameWidth, int32_t frameHeight, const GifPalette& framePalette,
+              int32_t loopCount = 0, size_t queueCapacity = 4)
+        : file(filename, ios::binary), width(frameWidth), height(frameHeight), palette(framePalette),
+          capacity(max<size_t>(1, queueCapacity)) {
+        if (frameWidth <= 0 || frameHeight <= 0 || frameWidth > 65535 || frameHeight > 65535) {
+            throw ImageException("Error GifWriter: Invalid frame size.");
+        }
+        if (!file.is_open()) {
+            throw runtime_error("Error GifWriter: Unable to open file " + filename);
+        }
+        writeHeader(loopCount);
+        writer = thread([this] { run(); });
+    }
+
+    GifWriter(const GifWriter&) = delete;
+    GifWriter& operator=(const GifWriter&) = delete;
+
+    /**********************************
+     * Destructor. Finishes the file, errors are dropped.
+     **********************************/
+    ~GifWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    /**********************************
+     * Queues a frame, blocking while the queue is full.
+     * @param indexes Palette indexes of the frame, see GifPalette::map().
+     * @param timestamp Presentation time in microseconds, increasing.
+     * @throws ImageException if the frame size does not match.
+     * @throws runtime_error if the writer failed or was closed.
+     **********************************/
+    void addFrame(vector<uint8_t>&& indexes, long long timestamp) {
+        if (indexes.size() != static_cast<size_t>(width) * height) {
+            throw ImageException("Error GifWriter: Frame size does not match.");
+        }
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [this] { return queue.size() < capacity || error || closing; });
+        if (error) rethrow_exception(error);
+        if (closing) throw runtime_error("Error GifWriter: Writer is closed.");
+        queue.push_back(Frame{std::move(indexes), timestamp});
+        changed.notify_all();
+    }
+
+    /**********************************
+     * Encodes the queued frames, writes the trailer and stops the writer thread.
+     * @throws runtime_error if the writer failed.
+     **********************************/
+    void close() {
+        {
+            lock_guard<mutex> guard(lock);
+            closing = true;
+        }
+        changed.notify_all();
+        if (writer.joinable()) writer.join();
+        if (error) rethrow_exception(error);
+    }
+
+    /**********************************
+     * Retrieves the number of frames stored in the file.
+     * Only stable after close().
+     **********************************/
+    size_t getStoredFrameCount() const { return storedFrames; }
+
+    /**********************************
+     * Retrieves the number of unchanged frames merged into a delay.
+     * Only stable after close().
+     **********************************/
+    size_t getMergedFrameCount() const { return mergedFrames; }
+
+private:
+    void writeHeader(int32_t loopCount) {
+        const int32_t bits = palette.getIndexBits();
+        vector<uint8_t> header = {'G', 'I', 'F', '8', '9', 'a'};
+        putShort(header, width);
+        putShort(header, height);
+        header.push_back(static_cast<uint8_t>(0x80 | (bits - 1) << 4 | (bits - 1)));  // Global table
+        header.push_back(0);    // Background color
+        header.push_back(0);    // Square pixels
+        header.insert(header.end(), palette.getColors().begin(), palette.getColors().end());
+
+        // Looping, as every browser understands it
+        const char* application = "NETSCAPE2.0";
+        header.insert(header.end(), {0x21, 0xFF, 0x0B});
+        header.insert(header.end(), application, application + 11);
+        header.insert(header.end(), {0x03, 0x01});
+        putShort(header, loopCount);
+        header.push_back(0);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    }
+
+    /**********************************
+     * Writer thread: encodes frames until the queue is closed and empty.
+     **********************************/
+    void run() {
+        try {
+            while (true) {
+                Frame frame;
+                {
+                    unique_lock<mutex> guard(lock);
+                    changed.wait(guard, [this] { return !queue.empty() || closing; });
+                    if (queue.empty()) break;
+                    frame = std::move(queue.front());
+                    queue.pop_front();
+                }
+                changed.notify_all();
+                encodeFrame(frame);
+            }
+            // The last frame also shows for the frames merged into it
+            flushPending(centiseconds(latestTimestamp) - centiseconds(pendingTimestamp) + frameInterval);
+            file.put(0x3B);
+            file.flush();
+            if (!file) throw runtime_error("Error GifWriter: Write failed.");
+        } catch (...) {
+            lock_guard<mutex> guard(lock);
+            error = current_exception();
+            changed.notify_all();
+        }
+    }
+
+    void encodeFrame(const Frame& frame) {
+        if (!previous.empty()) {
+            frameInterval = max(1LL, centiseconds(frame.timestamp) - centiseconds(latestTimestamp));
+        }
+        latestTimestamp = frame.timestamp;
+
+        // Changed rectangle, the whole frame for the first one
+        int32_t top = 0, bottom = height, left = 0, right = width;
+        if (!previous.empty()) {
+            top = height;
+            bottom = 0;
+            left = width;
+            right = 0;
+            for (int32_t y = 0; y < height; ++y) {
+                const uint8_t* now = frame.indexes.data() + static_cast<size_t>(y) * width;
+                const uint8_t* before = previous.data() + static_cast<size_t>(y) * width;
+                if (memcmp(now, before, width) == 0) continue;
+                int32_t first = 0;
+                while (now[first] == before[first]) ++first;
+                int32_t last = width - 1;
+                while (now[last] == before[last]) --last;
+                top = min(top, y);
+                bottom = y + 1;
+                left = min(left, first);
+                right = max(right, last + 1);
+            }
+            if (top >= bottom) {
+                ++mergedFrames;
+                return;
+            }
+        }
+
+        // The delay of the pending frame is known now
+        flushPending(centiseconds(frame.timestamp) - centiseconds(pendingTimestamp));
+
+        vector<uint8_t> rectangle = frame.indexes;
+        const bool transparent = !previous.empty();
+        if (transparent) {
+            const uint8_t clear = palette.getTransparentIndex();
+            for (int32_t y = top; y < bottom; ++y) {
+                uint8_t* now = rectangle.data() + static_cast<size_t>(y) * width;
+                const uint8_t* before = previous.data() + static_cast<size_t>(y) * width;
+                for (int32_t x = left; x < right; ++x) {
+                    if (now[x] == before[x]) now[x] = clear;
+                }
+            }
+        }
+
+        // Graphic control: keep the previous frame under transparent pixels, delay patched later
+        pending = {0x21, 0xF9, 0x04, static_cast<uint8_t>(1 << 2 | (transparent ? 1 : 0)), 0, 0,
+                   palette.getTransparentIndex(), 0, 0x2C};
+        putShort(pending, left);
+        putShort(pending, top);
+        putShort(pending, right - left);
+        putShort(pending, bottom - top);
+        pending.push_back(0);
+        GifLzw::encode(rectangle.data(), width, left, top, right - left, bottom - top,
+                       palette.getIndexBits(), pending);
+        pendingTimestamp = frame.timestamp;
+        previous = frame.indexes;
+    }
+
+    void flushPending(long long delay) {
+        if (pending.empty()) return;
+        delay = clamp<long long>(delay, 0, 65535);
+        pending[4] = static_cast<uint8_t>(delay);
+        pending[5] = static_cast<uint8_t>(delay >> 8);
+        file.write(reinterpret_cast<const char*>(pending.data()), pending.size());
+        pending.clear();
+        ++storedFrames;
+    }
+
+    static long long centiseconds(long long microseconds) {
+        return (microseconds + 5000) / 10000;
+    }
+
+    static void putShort(vector<uint8_t>& out, int32_t value) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+};
+
+#endif // GIF_H
@@ -0,0 +1,180 @@
+/**********************************
+ * @file glyphatlas.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the GlyphAtlas class, a bitmap font rasterized once into
+ * a single coverage image.
+ *
+ * @details
+ * - Embeds a 5x7 pixel font covering digits, upper case letters, space
+ *   and common punctuation. Lower case letters use the upper case glyphs,
+ *   any other character is drawn as '?'.
+ * - The font is scaled by an integer factor and rasterized into one
+ *   GRAYSCALE8 atlas with a fixed size cell per glyph, so drawing a glyph
+ *   is a copy of cellHeight rows of cellWidth bytes.
+ * - Cells include the spacing: one blank column on the right, one blank
+ *   row above and one below the glyph.
+ *
+ * Constraints:
+ * - Coverage is binary, glyph pixels get the atlas coverage value and
+ *   everything else is 0.
+ **********************************/
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "image.h"
+
+using namespace std;
+
+class GlyphAtlas {
+private:
+    static const int32_t kGlyphWidth = 5;       // Font pixels per glyph row
+    static const int32_t kGlyphHeight = 7;      // Font pixel rows per glyph
+
+    /**********************************
+     * @struct GlyphBitmap
+     * @brief One glyph of the embedded font, '#' marks a set pixel.
+     **********************************/
+    struct GlyphBitmap {
+        char code;
+        const char* rows[kGlyphHeight];
+    };
+
+    static constexpr GlyphBitmap kFont[] = {
+        {' ', {"     ", "     ", "     ", "     ", "     ", "     ", "     "}},
+        {'0', {" ### ", "#   #", "#  ##", "# # #", "##  #", "#   #", " ### "}},
+        {'1', {"  #  ", " ##  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### "}},
+        {'2', {" ### ", "#   #", "    #", "   # ", "  #  ", " #   ", "#####"}},
+        {'3', {"#####", "   # ", "  #  ", "   # ", "    #", "#   #", " ### "}},
+        {'4', {"   # ", "  ## ", " # # ", "#  # ", "#####", "   # ", "   # "}},
+        {'5', {"#####", "#    ", "#### ", "    #", "    #", "#   #", " ### "}},
+        {'6', {"  ## ", " #   ", "#    ", "#### ", "#   #", "#   #", " ### "}},
+        {'7', {"#####", "    #", "   # ", "  #  ", " #   ", " #   ", " #   "}},
+        {'8', {" ### ", "#   #", "#   #", " ### ", "#   #", "#   #", " ### "}},
+        {'9', {" ### ", "#   #", "#   #", " ####", "    #", "   # ", " ##  "}},
+        {'A', {" ### ", "#   #", "#   #", "#####", "#   #", "#   #", "#   #"}},
+        {'B', {"#### ", "#   #", "#   #", "#### ", "#   #", "#   #", "#### "}},
+        {'C', {" ### ", "#   #", "#    ", "#    ", "#    ", "#   #", " ### "}},
+        {'D', {"###  ", "#  # ", "#   #", "#   #", "#   #", "#  # ", "###  "}},
+        {'E', {"#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#####"}},
+        {'F', {"#####", "#    ", "#    ", "#### ", "#    ", "#    ", "#    "}},
+        {'G', {" ### ", "#   #", "#    ", "# ###", "#   #", "#   #", " ####"}},
+        {'H', {"#   #", "#   #", "#   #", "#####", "#   #", "#   #", "#   #"}},
+        {'I', {" ### ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", " ### "}},
+        {'J', {"  ###", "   # ", "   # ", "   # ", "   # ", "#  # ", " ##  "}},
+        {'K', {"#   #", "#  # ", "# #  ", "##   ", "# #  ", "#  # ", "#   #"}},
+        {'L', {"#    ", "#    ", "#    ", "#    ", "#    ", "#    ", "#####"}},
+        {'M', {"#   #", "## ##", "# # #", "# # #", "#   #", "#   #", "#   #"}},
+        {'N', {"#   #", "#   #", "##  #", "# # #", "#  ##", "#   #", "#   #"}},
+        {'O', {" ### ", "#   #", "#   #", "#   #", "#   #", "#   #", " ### "}},
+        {'P', {"#### ", "#   #", "#   #", "#### ", "#    ", "#    ", "#    "}},
+        {'Q', {" ### ", "#   #", "#   #", "#   #", "# # #", "#  # ", " ## #"}},
+        {'R', {"#### ", "#   #", "#   #", "#### ", "# #  ", "#  # ", "#   #"}},
+        {'S', {" ####", "#    ", "#    ", " ### ", "    #", "    #", "#### "}},
+        {'T', {"#####", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  "}},
+        {'U', {"#   #", "#   #", "#   #", "#   #", "#   #", "#   #", " ### "}},
+        {'V', {"#   #", "#   #", "#   #", "#   #", "#   #", " # # ", "  #  "}},
+        {'W', {"#   #", "#   #", "#   #", "# # #", "# # #", "# # #", " # # "}},
+        {'X', {"#   #", "#   #", " # # ", "  #  ", " # # ", "#   #", "#   #"}},
+        {'Y', {"#   #", "#   #", " # # ", "  #  ", "  #  ", "  #  ", "  #  "}},
+        {'Z', {"#####", "    #", "   # ", "  #  ", " #   ", "#    ", "#####"}},
+        {':', {"     ", "  #  ", "  #  ", "     ", "  #  ", "  #  ", "     "}},
+        {'.', {"     ", "     ", "     ", "     ", "     ", " ##  ", " ##  "}},
+        {',', {"     ", "     ", "     ", "     ", " ##  ", "  #  ", " #   "}},
+        {'-', {"     ", "     ", "     ", "#####", "     ", "     ", "     "}},
+        {'_', {"     ", "     ", "     ", "     ", "     ", "     ", "#####"}},
+        {'/', {"     ", "    #", "   # ", "  #  ", " #   ", "#    ", "     "}},
+        {'+', {"     ", "  #  ", "  #  ", "#####", "  #  ", "  #  ", "     "}},
+        {'=', {"     ", "     ", "#####", "     ", "#####", "     ", "     "}},
+        {'#', {" # # ", " # # ", "#####", " # # ", "#####", " # # ", " # # "}},
+        {'(', {"   # ", "  #  ", " #   ", " #   ", " #   ", "  #  ", "   # "}},
+        {')', {" #   ", "  #  ", "   # ", "   # ", "   # ", "  #  ", " #   "}},
+        {'[', {" ### ", " #   ", " #   ", " #   ", " #   ", " #   ", " ### "}},
+        {']', {" ### ", "   # ", "   # ", "   # ", "   # ", "   # ", " ### "}},
+        {'%', {"##   ", "##  #", "   # ", "  #  ", " #   ", "#  ##", "   ##"}},
+        {'!', {"  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "     ", "  #  "}},
+        {'?', {" ### ", "#   #", "    #", "   # ", "  #  ", "     ", "  #  "}},
+        {'\'', {"  #  ", "  #  ", " #   ", "     ", "     ", "     ", "     "}},
+        {'|', {"  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  ", "  #  "}},
+        {'*', {"     ", "  #  ", "# # #", " ### ", "# # #", "  #  ", "     "}},
+    };
+
+    static constexpr int32_t kGlyphCount = sizeof(kFont) / sizeof(kFont[0]);
+
+    int32_t scale;              // Atlas pixels per font pixel
+    int32_t cellWidth;          // Horizontal advance in pixels
+    int32_t cellHeight;         // Line height in pixels
+    Image atlas;                // GRAYSCALE8, one cell per glyph side by side
+    array<int16_t, 128> index;  // Cell of every ASCII character
+
+public:
+    /**********************************
+     * Rasterizes the embedded font.
+     * @param newScale Atlas pixels per font pixel, at least 1.
+     * @param coverage Value of glyph pixels in the atlas.
+     * @throws ImageException if the scale is below 1.
+     **********************************/
+    explicit GlyphAtlas(int32_t newScale = 2, uint8_t coverage = 255)
+        : scale(newScale), cellWidth((kGlyphWidth + 1) * newScale),
+          cellHeight((kGlyphHeight + 2) * newScale),
+          atlas(kGlyphCount * std::max(cellWidth, 1), std::max(cellHeight, 1), PixelFormat::GRAYSCALE8) {
+        if (scale < 1) {
+            throw ImageException("Error GlyphAtlas: Scale must be at least 1.");
+        }
+
+        int16_t fallback = 0;
+        for (int32_t glyph = 0; glyph < kGlyphCount; ++glyph) {
+            if (kFont[glyph].code == '?') fallback = static_cast<int16_t>(glyph);
+        }
+        index.fill(fallback);
+
+        uint8_t* atlasData = atlas.getData().data();
+        const size_t atlasStride = atlas.getStride();
+        for (int32_t glyph = 0; glyph < kGlyphCount; ++glyph) {
+            const GlyphBitmap& bitmap = kFont[glyph];
+            index[static_cast<unsigned char>(bitmap.code)] = static_cast<int16_t>(glyph);
+            if (bitmap.code >= 'A' && bitmap.code <= 'Z') {
+                index[bitmap.code - 'A' + 'a'] = static_cast<int16_t>(glyph);
+            }
+
+            // Each font pixel becomes a scale x scale square, one blank row on top
+            for (int32_t y = 0; y < kGlyphHeight * scale; ++y) {
+                uint8_t* row = atlasData + (y + scale) * atlasStride + glyph * cellWidth;
+                const char* fontRow = bitmap.rows[y / scale];
+                for (int32_t x = 0; x < kGlyphWidth * scale; ++x) {
+                    row[x] = fontRow[x / scale] == '#' ? coverage : 0;
+                }
+            }
+        }
+    }
+
+    /**********************************
+     * Retrieves the atlas cell of a character.
+     * @param code The character.
+     * @return The cell index, the '?' cell for unsupported characters.
+     **********************************/
+    int32_t cellOf(char code) const {
+        const unsigned char value = static_cast<unsigned char>(code);
+        return value < index.size() ? index[value] : index['?'];
+    }
+
+    /**********************************
+     * Retrieves one row of a cell.
+     * @param cell The cell index.
+     * @param y The row within the cell, below cellHeight.
+     * @return Pointer to cellWidth coverage bytes.
+     **********************************/
+    const uint8_t* cellRow(int32_t cell, int32_t y) const {
+        return atlas.getData().data() + y * atlas.getStride() + cell * cellWidth;
+    }
+
+    int32_t getScale() const { return scale; }
+    int32_t getCellWidth() const { return cellWidth; }
+    int32_t getCellHeight() const { return cellHeight; }
+};
+
+#endif // GLYPH_ATLAS_H
@@ -8,6 +8,10 @@
  * - Supports deep copy and move semantics for efficient memory management.
  * - Ensures image validity through dimension, format, and data size checks.
  * - Includes static utility methods for mapping pixel formats and bit depth.
+ * - Rows are tightly packed, the stride is the number of bytes needed
+ *   to hold `width` pixels of the format.
+ * - Compressed formats (JPEG) hold the encoded stream, of any nonzero
+ *   size, and have a stride of 0. See JpegCodec.
  *
  * Constraints:
  * - The width, height, and format must be valid for the Image to be considered valid.
@@ -23,6 +27,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <map>
+#include "pixelformat.h"
 
 using namespace std;
 
@@ -50,21 +55,6 @@ public:
     }
 };
 
-/**********************************
- * @enum PixelFormat
- * @brief Enumerates supported pixel formats for images.
- **********************************/
-enum class PixelFormat {
-    UNKNOWN = 0,
-    GRAYSCALE1,
-    GRAYSCALE2,
-    GRAYSCALE4,
-    GRAYSCALE8,
-    RGB24,
-    RGBA32,
-    JPEG,
-};
-
 /**********************************
  * @class Image
  * @brief Manages image data, dimensions, and pixel formats.
@@ -102,13 +92,17 @@ public:
      * @param format The pixel format.
      * @return The number of bits per pixel for the format, or 0 if unknown.
      **********************************/
-    static int32_t bitsPerPixel(PixelFormat format) {
-        for (const auto& pair : kBitDepthPixelMap) {
-            if (pair.second == format) {
-                return pair.first;
-            }
-        }
-        return 0;
+    static constexpr int32_t bitsPerPixel(PixelFormat format) {
+        return pixelFormatBits(format);
+    }
+
+    /**********************************
+     * Checks whether a PixelFormat holds a compressed stream.
+     * @param format The pixel format.
+     * @return True if the data is a compressed stream rather than pixel rows.
+     **********************************/
+    static constexpr bool isCompressed(PixelFormat format) {
+        return pixelFormatCompressed(format);
     }
 
     /**********************************
@@ -127,8 +121,8 @@ public:
         : width(width),
           height(height),
           format(format),
-          stride(width * bytesPerStride(bitsPerPixel(format))),
-          buffer(width * height * bytesPerStride(bitsPerPixel(format)), 0),
+          stride(bytesPerLine(width * bitsPerPixel(format))),
+          buffer(height * bytesPerLine(width * bitsPerPixel(format)), 0),
           isValid(false) {
         if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN) {
             throw ImageException("Invalid image dimensions or format");
@@ -147,11 +141,10 @@ public:
         : width(width),
           height(height),
           format(format),
-          stride(width * bytesPerStride(bitsPerPixel(format))),
+          stride(bytesPerLine(width * bitsPerPixel(format))),
           buffer(data),
           isValid(true) {
-        if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN || 
-            data.size() != static_cast<size_t>(height * stride)) {
+        if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN || !sizeMatches(data.size())) {
             throw ImageException("Invalid image dimensions, format, or data size");
         }
     }
@@ -168,11 +161,10 @@ public:
         : width(width),
           height(height),
           format(format),
-          stride(width * bytesPerStride(bitsPerPixel(format))),
+          stride(bytesPerLine(width * bitsPerPixel(format))),
           buffer(std::move(data)),
           isValid(true) {
-        if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN || 
-            buffer.size() != static_cast<size_t>(height * stride)) {
+        if (width <= 0 || height <= 0 || format == PixelFormat::UNKNOWN || !sizeMatches(buffer.size())) {
             throw ImageException("Invalid image dimensions, format, or data size");
         }
     }
@@ -282,7 +274,7 @@ public:
      * @throws ImageException if the data size does not match the image dimensions.
      **********************************/
     void setData(const vector<uint8_t>& data) {
-        if (data.size() != static_cast<size_t>(height * stride)) {
+        if (!sizeMatches(data.size())) {
             throw ImageException("Image setData size mismatch");
         }
         buffer = data;
@@ -295,7 +287,7 @@ public:
      * @throws ImageException if the data size does not match the image dimensions.
      **********************************/
     void setData(vector<uint8_t>&& data) {
-        if (data.size() != static_cast<size_t>(height * stride)) {
+        if (!sizeMatches(data.size())) {
             throw ImageException("Image setData size mismatch");
         }
         buffer = std::move(data);
@@ -310,12 +302,13 @@ public:
 
 private:
     /**********************************
-     * Calculates the number of bytes per stride for the given bit depth.
-     * @param bitsPerLine The number of bits per line.
-     * @return The number of bytes per stride.
+     * Checks a data size against the dimensions, compressed streams only
+     * need to be nonempty.
+     * @param size The data size in bytes.
+     * @return True if the size is valid for the image.
      **********************************/
-    uint32_t bytesPerStride(uint32_t bitsPerLine) const {
-        return (((bitsPerLine + 31) / 32) * 32) / 8;
+    bool sizeMatches(size_t size) const {
+        return isCompressed(format) ? size > 0 : size == static_cast<size_t>(height * stride);
     }
 
     /**********************************
@@ -323,7 +316,7 @@ private:
      * @param bitsPerLine The number of bits per line.
      * @return The number of bytes per line.
      **********************************/
-    uint32_t bytesPerLine(uint32_t bitsPerLine) {
+    static int32_t bytesPerLine(int32_t bitsPerLine) {
         return ((bitsPerLine + 7) / 8);
     }
 };
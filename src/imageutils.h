@@ -7,7 +7,17 @@
  * @details
  * - Defines functions for reading and writing BMP files.
  * - Supports 24-bit (RGB) and 32-bit (RGBA) BMP files.
+ * - Supports 1, 4 and 8-bit palette BMP files, a gray palette maps onto
+ *   GRAYSCALE8 and any other palette is expanded to RGB24.
+ * - Writes GRAYSCALE1 and GRAYSCALE4 images as 1 and 4-bit BMP files,
+ *   GRAYSCALE2 is stored as a 4-bit BMP with a 4 entry palette.
+ * - Expands GRAYSCALE8 and RGB24 images to RGBA32 for raw RGBA sinks.
  * - Includes utilities for converting pixel formats and validating headers.
+ * - Reads and writes lossless QOI files (see QoiCodec), 1.8x smaller than
+ *   raw RGBA on assets/lena_color.bmp, to a path or straight to a file descriptor.
+ * - Writes PNG files (see PngEncoder), compressed on all threads.
+ * - Reads and writes baseline JPEG files (see JpegCodec), encoded and
+ *   decoded on all threads. PixelFormat::JPEG images are written as is.
  * - Contains a hexdump function for debugging byte arrays.
  * - Provides a function to print BMP headers for detailed inspection.
  *
@@ -21,9 +31,10 @@
  * - Debugging support with hexdump and BMP header printing utilities.
  *
  * Constraints:
- * - Only 24-bit and 32-bit uncompressed BMP files are supported.
+ * - Only 1, 4, 8, 24 and 32-bit uncompressed BMP files are supported.
  * - Header validation must pass for BMP files to be processed correctly.
  * - Pixel data is assumed to be bottom-up as per BMP standard.
+ * - BMP rows are padded to 4 bytes on disk, Image rows are tightly packed.
  *
  * Algorithm adapted and used from: 
  *
@@ -34,6 +45,7 @@
 #ifndef IMAGE_UTILS_H
 #define IMAGE_UTILS_H
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 #include <string>
@@ -41,7 +53,17 @@
 #include <cassert>
 #include <iomanip>
 #include "image.h" 
+#include "bitpacking.h"
+#include "imageview.h"
+#include "jpeg.h"
+#include "png.h"
+#include "qoi.h"
 #include <stdexcept>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -160,9 +182,14 @@ public:
         // Read BMP info header
         file.read(reinterpret_cast<char*>(&infoHeader), sizeof(infoHeader));
 
+        // Palette images are handled separately
+        if (infoHeader.bit_count == 8 || infoHeader.bit_count == 4 || infoHeader.bit_count == 1) {
+            return readPaletteBMP(file, fileHeader, infoHeader);
+        }
+
         // Validate bit depth
         if (infoHeader.bit_count != 32 && infoHeader.bit_count != 24) {
-            throw ImageException("Error: Only 32-bit and 24-bit BMP files are supported.");
+            throw ImageException("Error: Only 32, 24, 8, 4 and 1-bit BMP files are supported.");
         }
 
         // Handle 32-bit BMPs with color masks
@@ -178,68 +205,24 @@ public:
         // Move to pixel data location
         file.seekg(fileHeader.offset_data, file.beg);
 
-        // Read pixel data
-        data.resize(infoHeader.width * infoHeader.height * (infoHeader.bit_count / 8));
+        // Read pixel data, BMP rows are padded to a multiple of 4 bytes
+        size_t paddedRowSize = bmpRowSize(infoHeader.width, infoHeader.bit_count);
+        data.resize(paddedRowSize * infoHeader.height);
         file.read(reinterpret_cast<char*>(data.data()), data.size());
 
         // Convert pixel data to RGBA or RGB
         PixelFormat format = 
             infoHeader.bit_count == 32 ? PixelFormat::RGBA32 : PixelFormat::RGB24;
 
-        if (infoHeader.bit_count == 32) {
-            // Allocate a new vector to store the corrected data
-            vector<uint8_t> correctedData(data.size());
-
-            // Calculate row size in bytes, including any padding
-            size_t rowSize = infoHeader.width * 4;
-
-            for (size_t row = 0; row < infoHeader.height; ++row) {
-                // Calculate the start index for the bottom row and the target top row
-                size_t sourceRowIndex = (infoHeader.height - 1 - row) * rowSize;
-                size_t targetRowIndex = row * rowSize;
-
-                // Copy the row while swapping the blue and red channels
-                for (size_t col = 0; col < infoHeader.width; ++col) {
-                    size_t sourceIndex = sourceRowIndex + col * 4;
-                    size_t targetIndex = targetRowIndex + col * 4;
-
-                    correctedData[targetIndex] = data[sourceIndex + 2];       // Red
-                    correctedData[targetIndex + 1] = data[sourceIndex + 1];   // Green
-                    correctedData[targetIndex + 2] = data[sourceIndex];       // Blue
-                    correctedData[targetIndex + 3] = data[sourceIndex + 3];   
-                }
-            }
-
-            // Replace original data with the corrected data
-            data = std::move(correctedData);
+        // BMP rows are stored bottom-up, copy them through a flipped view
+        ConstImageView fileRows(data.data(), infoHeader.width, infoHeader.height, format,
+                                static_cast<ptrdiff_t>(paddedRowSize));
+        Image image(infoHeader.width, infoHeader.height, format);
+        ImageTransform::copy(fileRows.flippedVertical(), ImageView(image));
 
-        } else if (infoHeader.bit_count == 24) {
-            // Allocate a new vector to store the corrected data
-            vector<uint8_t> correctedData(data.size());
-
-            // Calculate row size in bytes, including any padding
-            size_t rowSize = infoHeader.width * 3;
-
-            for (size_t row = 0; row < infoHeader.height; ++row) {
-                // Calculate the start index for the bottom row and the target top row
-                size_t sourceRowIndex = (infoHeader.height - 1 - row) * rowSize;
-                size_t targetRowIndex = row * rowSize;
-
-                // Copy the row while swapping the blue and red channels
-                for (size_t col = 0; col < infoHeader.width; ++col) {
-                    size_t sourceIndex = sourceRowIndex + col * 3;
-                    size_t targetIndex = targetRowIndex + col * 3;
-
-                    correctedData[targetIndex] = data[sourceIndex + 2];       // Red
-                    correctedData[targetIndex + 1] = data[sourceIndex + 1];   // Green
-                    correctedData[targetIndex + 2] = data[sourceIndex];       // Blue
-                }
-            }
-
-            data = std::move(correctedData);
-        }
-
-        return Image(infoHeader.width, infoHeader.height, format, std::move(data));
+        // Swap the blue and red channels
+        swapRedBlue(ImageView(image));
+        return image;
     }
 
     /**********************************
@@ -250,6 +233,14 @@ public:
      * @throws runtime_error if the file cannot be opened.
      **********************************/
     static void writeBMP(const std::string& filename, const Image& image) {
+        if (image.getFormat() == PixelFormat::GRAYSCALE8 ||
+            image.getFormat() == PixelFormat::GRAYSCALE4 ||
+            image.getFormat() == PixelFormat::GRAYSCALE2 ||
+            image.getFormat() == PixelFormat::GRAYSCALE1) {
+            writePaletteBMP(filename, image);
+            return;
+        }
+
         BMPFileHeader fileHeader;
         BMPInfoHeader infoHeader;
         BMPColorHeader colorHeader;
@@ -265,68 +256,26 @@ public:
             infoHeader.compression = 3;
         }
 
-        fileHeader.file_size = fileHeader.offset_data + image.getData().size();
         infoHeader.width = image.getWidth();
         infoHeader.height = image.getHeight();
         infoHeader.planes = 1;
         infoHeader.bit_count = image.getFormat() == PixelFormat::RGBA32 ? 32 : 24;
-        infoHeader.size_image = static_cast<uint32_t>(image.getData().size());
-
-        vector<uint8_t> data = image.getData();
-        if (infoHeader.bit_count == 32) {
-            // Allocate a new vector to store the corrected data
-            std::vector<uint8_t> correctedData(data.size());
-
-            // Calculate row size in bytes, including any padding
-            size_t rowSize = infoHeader.width * 4;
-
-            for (size_t row = 0; row < infoHeader.height; ++row) {
-                // Calculate the start index for the top row and the target bottom row
-                size_t sourceRowIndex = row * rowSize;
-                size_t targetRowIndex = (infoHeader.height - 1 - row) * rowSize;
-
-                // Copy the row while swapping the red and blue channels
-                for (size_t col = 0; col < infoHeader.width; ++col) {
-                    size_t sourceIndex = sourceRowIndex + col * 4;
-                    size_t targetIndex = targetRowIndex + col * 4;
-
-                    correctedData[targetIndex] = data[sourceIndex + 2];       // Blue
-                    correctedData[targetIndex + 1] = data[sourceIndex + 1];   // Green
-                    correctedData[targetIndex + 2] = data[sourceIndex];       // Red
-                    correctedData[targetIndex + 3] = data[sourceIndex + 3];   
-                }
-            }
+        size_t paddedRowSize = bmpRowSize(infoHeader.width, infoHeader.bit_count);
+        infoHeader.size_image = static_cast<uint32_t>(paddedRowSize * infoHeader.height);
+        fileHeader.file_size = fileHeader.offset_data + infoHeader.size_image;
 
-            // Replace original data with the corrected data
-            data = std::move(correctedData);
-
-        } else if (infoHeader.bit_count == 24) {
-            // Allocate a new vector to store the corrected data
-            std::vector<uint8_t> correctedData(data.size());
-
-            // Calculate row size in bytes, including any padding
-            size_t rowSize = infoHeader.width * 3;
-
-            for (size_t row = 0; row < infoHeader.height; ++row) {
-                // Calculate the start index for the top row and the target bottom row
-                size_t sourceRowIndex = row * rowSize;
-                size_t targetRowIndex = (infoHeader.height - 1 - row) * rowSize;
+        // BMP rows are stored bottom-up and padded, copy through a flipped view
+        vector<uint8_t> data(infoHeader.size_image, 0);
+        PixelFormat format =
+            infoHeader.bit_count == 32 ? PixelFormat::RGBA32 : PixelFormat::RGB24;
+        ImageView fileRows = ImageView(data.data(), infoHeader.width, infoHeader.height, format,
+                                       static_cast<ptrdiff_t>(paddedRowSize)).flippedVertical();
+        ImageTransform::copy(ConstImageView(image), fileRows);
 
-                // Copy the row while swapping the red and blue channels
-                for (size_t col = 0; col < infoHeader.width; ++col) {
-                    size_t sourceIndex = sourceRowIndex + col * 3;
-                    size_t targetIndex = targetRowIndex + col * 3;
+        // Swap the red and blue channels
+        swapRedBlue(fileRows);
 
-                    correctedData[targetIndex] = data[sourceIndex + 2];       // Blue
-                    correctedData[targetIndex + 1] = data[sourceIndex + 1];   // Green
-                    correctedData[targetIndex + 2] = data[sourceIndex];       // Red
-                }
-            }
-
-            // Replace original data with the corrected data
-            data = std::move(correctedData);
-        }
-       // Write BMP file
+        // Write BMP file
         ofstream file(filename, ios::binary);
         if (!file.is_open()) {
             throw runtime_error("Error: Unable to open file " + filename);
@@ -341,6 +290,253 @@ public:
     }
 
 
+    /**********************************
+     * Reads a QOI file and creates an Image object.
+     * @param filename The path to the QOI file.
+     * @return An RGB24 image for 3 channel files, RGBA32 otherwise.
+     * @throws runtime_error if the file cannot be read or is not a valid QOI file.
+     **********************************/
+    static Image readQOI(const std::string& filename) {
+        ifstream file(filename, ios::binary | ios::ate);
+        if (!file.is_open()) {
+            throw runtime_error("Error readQOI: Unable to open file " + filename);
+        }
+        vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0, file.beg);
+        file.read(reinterpret_cast<char*>(data.data()), data.size());
+        return QoiCodec::decode(data.data(), data.size());
+    }
+
+    /**********************************
+     * Writes an Image object to a QOI file.
+     * GRAYSCALE images are stored as RGB.
+     * @param filename The path to save the QOI file.
+     * @param image The Image object to be saved.
+     * @throws runtime_error if the file cannot be written.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writeQOI(const std::string& filename, const Image& image) {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Error writeQOI: Unable to open file " + filename);
+        }
+        try {
+            writeQOI(fd, image);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw runtime_error("Error writeQOI: Unable to close file " + filename);
+        }
+    }
+
+    /**********************************
+     * Streams an Image object as a QOI file to a file descriptor.
+     * Bands are encoded in parallel and sent with gathered writes, without
+     * assembling the file in memory. The descriptor is not closed.
+     * @param fd A file, pipe or socket descriptor opened for writing.
+     * @param image The Image object to be saved.
+     * @throws runtime_error if a write fails.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writeQOI(int fd, const Image& image) {
+        if (Image::bitsPerPixel(image.getFormat()) > 0 && Image::bitsPerPixel(image.getFormat()) < 8) {
+            writeQOI(fd, unpackGrayscale(image));
+            return;
+        }
+        const array<uint8_t, QoiCodec::kHeaderSize> header = QoiCodec::header(image);
+        const vector<vector<uint8_t>> bands = QoiCodec::encodeBands(image);
+
+        vector<iovec> pieces;
+        pieces.reserve(bands.size() + 2);
+        pieces.push_back({const_cast<uint8_t*>(header.data()), header.size()});
+        for (const vector<uint8_t>& band : bands) {
+            if (!band.empty()) pieces.push_back({const_cast<uint8_t*>(band.data()), band.size()});
+        }
+        pieces.push_back({const_cast<uint8_t*>(QoiCodec::endMarker().data()), QoiCodec::kEndMarkerSize});
+        writeAll(fd, pieces, "writeQOI");
+    }
+
+    /**********************************
+     * Writes an Image object to a PNG file.
+     * @param filename The path to save the PNG file.
+     * @param image The Image object to be saved.
+     * @param mode Deflate mode, RLE suits flat content, HUFFMAN_ONLY is faster on photos.
+     * @throws runtime_error if the file cannot be written.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writePNG(const std::string& filename, const Image& image, DeflateMode mode = DeflateMode::RLE) {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Error writePNG: Unable to open file " + filename);
+        }
+        try {
+            writePNG(fd, image, mode);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw runtime_error("Error writePNG: Unable to close file " + filename);
+        }
+    }
+
+    /**********************************
+     * Streams an Image object as a PNG file to a file descriptor.
+     * The descriptor is not closed.
+     * @param fd A file, pipe or socket descriptor opened for writing.
+     * @param image The Image object to be saved.
+     * @param mode Deflate mode of the image data.
+     * @throws runtime_error if a write fails.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writePNG(int fd, const Image& image, DeflateMode mode = DeflateMode::RLE) {
+        const vector<vector<uint8_t>> buffers = PngEncoder::encodeChunks(image, mode);
+        vector<iovec> pieces;
+        pieces.reserve(buffers.size());
+        for (const vector<uint8_t>& buffer : buffers) {
+            pieces.push_back({const_cast<uint8_t*>(buffer.data()), buffer.size()});
+        }
+        writeAll(fd, pieces, "writePNG");
+    }
+
+    /**********************************
+     * Reads a JPEG file and creates an Image object.
+     * @param filename The path to the JPEG file.
+     * @return A GRAYSCALE8 image for gray files, RGB24 otherwise.
+     * @throws runtime_error if the file cannot be read or is not a supported JPEG file.
+     **********************************/
+    static Image readJPEG(const std::string& filename) {
+        ifstream file(filename, ios::binary | ios::ate);
+        if (!file.is_open()) {
+            throw runtime_error("Error readJPEG: Unable to open file " + filename);
+        }
+        vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+        file.seekg(0, file.beg);
+        file.read(reinterpret_cast<char*>(data.data()), data.size());
+        return JpegCodec::decode(data.data(), data.size());
+    }
+
+    /**********************************
+     * Writes an Image object to a JPEG file.
+     * @param filename The path to save the JPEG file.
+     * @param image The Image object to be saved.
+     * @param quality IJG quality, 1 to 100.
+     * @throws runtime_error if the file cannot be written.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writeJPEG(const std::string& filename, const Image& image, int32_t quality = JpegCodec::kDefaultQuality) {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Error writeJPEG: Unable to open file " + filename);
+        }
+        try {
+            writeJPEG(fd, image, quality);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw runtime_error("Error writeJPEG: Unable to close file " + filename);
+        }
+    }
+
+    /**********************************
+     * Streams an Image object as a JPEG file to a file descriptor.
+     * Rows of MCUs are encoded in parallel and sent with gathered writes.
+     * A PixelFormat::JPEG image is written unchanged. The descriptor is
+     * not closed.
+     * @param fd A file, pipe or socket descriptor opened for writing.
+     * @param image The Image object to be saved.
+     * @param quality IJG quality, 1 to 100.
+     * @throws runtime_error if a write fails.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static void writeJPEG(int fd, const Image& image, int32_t quality = JpegCodec::kDefaultQuality) {
+        if (image.getFormat() == PixelFormat::JPEG) {
+            vector<iovec> pieces = {{const_cast<uint8_t*>(image.getData().data()), image.getData().size()}};
+            writeAll(fd, pieces, "writeJPEG");
+            return;
+        }
+        if (Image::bitsPerPixel(image.getFormat()) > 0 && Image::bitsPerPixel(image.getFormat()) < 8) {
+            writeJPEG(fd, unpackGrayscale(image), quality);
+            return;
+        }
+        const vector<vector<uint8_t>> segments = JpegCodec::encodeSegments(image, quality);
+        vector<iovec> pieces;
+        pieces.reserve(segments.size());
+        for (const vector<uint8_t>& segment : segments) {
+            if (!segment.empty()) pieces.push_back({const_cast<uint8_t*>(segment.data()), segment.size()});
+        }
+        writeAll(fd, pieces, "writeJPEG");
+    }
+
+    /**********************************
+     * Expands an image to RGBA32.
+     * GRAYSCALE8 replicates luma into red, green and blue, formats
+     * without alpha get an opaque alpha channel.
+     * @param image The image to expand.
+     * @return An RGBA32 copy of the image.
+     * @throws ImageException if the format cannot be expanded.
+     **********************************/
+    static Image toRGBA32(const Image& image) {
+        if (Image::bitsPerPixel(image.getFormat()) > 0 && Image::bitsPerPixel(image.getFormat()) < 8) {
+            return toRGBA32(unpackGrayscale(image));
+        }
+        vector<uint8_t> rgbaData(static_cast<size_t>(image.getWidth()) * image.getHeight() * 4);
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                using Traits = typename decltype(tag)::Traits;
+                const uint8_t* source = image.getData().data();
+                uint8_t* target = rgbaData.data();
+                for (int32_t y = 0; y < image.getHeight(); ++y) {
+                    const uint8_t* row = source + static_cast<size_t>(y) * image.getStride();
+                    for (int32_t x = 0; x < image.getWidth(); ++x, target += 4) {
+                        const uint8_t* pixel = row + x * Traits::bytesPerPixel;
+                        target[0] = pixel[Traits::redOffset];
+                        target[1] = pixel[Traits::greenOffset];
+                        target[2] = pixel[Traits::blueOffset];
+                        if constexpr (Traits::hasAlpha) {
+                            target[3] = pixel[Traits::alphaOffset];
+                        } else {
+                            target[3] = 255;
+                        }
+                    }
+                }
+            });
+        if (!matched) {
+            throw ImageException("Error toRGBA32: Unsupported pixel format.");
+        }
+        return Image(image.getWidth(), image.getHeight(), PixelFormat::RGBA32, std::move(rgbaData));
+    }
+
+    /**********************************
+     * Unpacks a GRAYSCALE1, GRAYSCALE2 or GRAYSCALE4 image to GRAYSCALE8.
+     * Levels are scaled to the full 0-255 range.
+     * @param image The packed image.
+     * @return A GRAYSCALE8 image.
+     * @throws ImageException if the image is not a packed gray format.
+     **********************************/
+    static Image unpackGrayscale(const Image& image) {
+        int bits = Image::bitsPerPixel(image.getFormat());
+        if (bits != 1 && bits != 2 && bits != 4) {
+            throw ImageException("Error unpackGrayscale: Image is not a packed gray format.");
+        }
+        const int scale = 255 / ((1 << bits) - 1);
+        size_t width = image.getWidth();
+        vector<uint8_t> grayData(width * image.getHeight());
+        for (int32_t y = 0; y < image.getHeight(); ++y) {
+            uint8_t* row = grayData.data() + y * width;
+            BitPacking::unpackRow(image.getData().data() + static_cast<size_t>(y) * image.getStride(),
+                                  width, bits, row);
+            for (size_t x = 0; x < width; ++x) {
+                row[x] = static_cast<uint8_t>(row[x] * scale);
+            }
+        }
+        return Image(image.getWidth(), image.getHeight(), PixelFormat::GRAYSCALE8, std::move(grayData));
+    }
+
    static void printBMPHeaders(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader, const BMPColorHeader& colorHeader) {
         // Read BMP File Header
         cout << "BMP File Header:" << endl;
@@ -382,6 +578,183 @@ public:
 
 private:
 
+    /**********************************
+     * Calculates the size of a BMP row on disk.
+     * BMP rows are padded to a multiple of 4 bytes.
+     * @param width The width of the image in pixels.
+     * @param bitCount The bits per pixel.
+     * @return The padded row size in bytes.
+     **********************************/
+    static size_t bmpRowSize(int32_t width, uint16_t bitCount) {
+        return ((static_cast<size_t>(width) * bitCount + 31) / 32) * 4;
+    }
+
+    /**********************************
+     * Swaps the first and third channel of every pixel, BGR(A) <-> RGB(A).
+     * @param view An RGB24 or RGBA32 view, rows are processed in place.
+     **********************************/
+    static void swapRedBlue(const ImageView& view) {
+        const size_t bytesPerPixel = Image::bitsPerPixel(view.getFormat()) / 8;
+        const size_t rowBytes = view.getRowBytes();
+        for (int32_t row = 0; row < view.getHeight(); ++row) {
+            uint8_t* pixel = view.row(row);
+            for (size_t offset = 0; offset < rowBytes; offset += bytesPerPixel) {
+                std::swap(pixel[offset], pixel[offset + 2]);
+            }
+        }
+    }
+
+    /**********************************
+     * Reads the pixel data of a 1, 4 or 8-bit palette BMP file.
+     * A gray palette produces a GRAYSCALE8 image, any other
+     * palette is expanded to RGB24.
+     * @param file The open BMP file, positioned after the info header.
+     * @param fileHeader The BMP file header.
+     * @param infoHeader The BMP info header.
+     * @return An Image object representing the BMP file.
+     **********************************/
+    static Image readPaletteBMP(ifstream& file, const BMPFileHeader& fileHeader,
+                                const BMPInfoHeader& infoHeader) {
+        // Read the palette, stored as BGRA entries after the info header
+        size_t colors = infoHeader.colors_used != 0 ? infoHeader.colors_used :
+                        (size_t(1) << infoHeader.bit_count);
+        vector<uint8_t> palette(256 * 4, 0);
+        file.seekg(sizeof(BMPFileHeader) + infoHeader.size, file.beg);
+        file.read(reinterpret_cast<char*>(palette.data()), min<size_t>(colors, 256) * 4);
+
+        bool isGray = true;
+        for (size_t i = 0; i < colors && i < 256; ++i) {
+            if (palette[i * 4] != palette[i * 4 + 1] || palette[i * 4] != palette[i * 4 + 2]) {
+                isGray = false;
+                break;
+            }
+        }
+
+        // Read the padded rows
+        size_t width = infoHeader.width;
+        size_t height = infoHeader.height;
+        size_t paddedRowSize = bmpRowSize(infoHeader.width, infoHeader.bit_count);
+        vector<uint8_t> data(paddedRowSize * height);
+        file.seekg(fileHeader.offset_data, file.beg);
+        file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+        PixelFormat format = isGray ? PixelFormat::GRAYSCALE8 : PixelFormat::RGB24;
+        size_t pixelSize = isGray ? 1 : 3;
+        vector<uint8_t> correctedData(width * height * pixelSize);
+        vector<uint8_t> indexRow(width);
+
+        for (size_t row = 0; row < height; ++row) {
+            const uint8_t* source = data.data() + (height - 1 - row) * paddedRowSize;
+            if (infoHeader.bit_count != 8) {
+                BitPacking::unpackRow(source, width, infoHeader.bit_count, indexRow.data());
+                source = indexRow.data();
+            }
+            uint8_t* target = correctedData.data() + row * width * pixelSize;
+            for (size_t col = 0; col < width; ++col) {
+                const uint8_t* entry = palette.data() + source[col] * 4;
+                if (isGray) {
+                    target[col] = entry[0];
+                } else {
+                    target[col * 3] = entry[2];       // Red
+                    target[col * 3 + 1] = entry[1];   // Green
+                    target[col * 3 + 2] = entry[0];   // Blue
+                }
+            }
+        }
+
+        return Image(infoHeader.width, infoHeader.height, format, std::move(correctedData));
+    }
+
+    /**********************************
+     * Writes a gray image as a palette BMP with a gray palette.
+     * GRAYSCALE8, GRAYSCALE4 and GRAYSCALE1 keep their depth,
+     * GRAYSCALE2 is widened to 4 bits per pixel.
+     * @param filename The path to save the BMP file.
+     * @param image The gray image to be saved.
+     * @throws runtime_error if the file cannot be opened.
+     **********************************/
+    static void writePaletteBMP(const std::string& filename, const Image& image) {
+        BMPFileHeader fileHeader;
+        BMPInfoHeader infoHeader;
+
+        int imageBits = Image::bitsPerPixel(image.getFormat());
+        uint16_t bmpBits = imageBits == 2 ? 4 : static_cast<uint16_t>(imageBits);
+        size_t colors = size_t(1) << imageBits;
+
+        vector<uint8_t> palette(colors * 4, 0);
+        for (size_t i = 0; i < colors; ++i) {
+            uint8_t gray = static_cast<uint8_t>(i * 255 / (colors - 1));
+            palette[i * 4] = palette[i * 4 + 1] = palette[i * 4 + 2] = gray;
+        }
+
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t paddedRowSize = bmpRowSize(image.getWidth(), bmpBits);
+
+        infoHeader.size = sizeof(BMPInfoHeader);
+        infoHeader.width = image.getWidth();
+        infoHeader.height = image.getHeight();
+        infoHeader.planes = 1;
+        infoHeader.bit_count = bmpBits;
+        infoHeader.compression = 0;
+        infoHeader.size_image = static_cast<uint32_t>(paddedRowSize * height);
+        infoHeader.colors_used = static_cast<uint32_t>(colors);
+        fileHeader.offset_data = sizeof(BMPFileHeader) + sizeof(BMPInfoHeader) + palette.size();
+        fileHeader.file_size = fileHeader.offset_data + infoHeader.size_image;
+
+        // Flip the rows to bottom-up order, packed rows are copied as is
+        vector<uint8_t> data(infoHeader.size_image, 0);
+        vector<uint8_t> levelRow(imageBits == bmpBits ? 0 : width);
+        const uint8_t* source = image.getData().data();
+        for (size_t row = 0; row < height; ++row) {
+            const uint8_t* sourceRow = source + row * image.getStride();
+            uint8_t* targetRow = data.data() + (height - 1 - row) * paddedRowSize;
+            if (imageBits == bmpBits) {
+                copy(sourceRow, sourceRow + image.getStride(), targetRow);
+            } else {
+                BitPacking::unpackRow(sourceRow, width, imageBits, levelRow.data());
+                BitPacking::packRow(levelRow.data(), width, bmpBits, targetRow);
+            }
+        }
+
+        ofstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Error: Unable to open file " + filename);
+        }
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+        file.write(reinterpret_cast<const char*>(palette.data()), palette.size());
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    /**********************************
+     * Writes every buffer to a descriptor, resuming after partial writes.
+     * @param fd The descriptor.
+     * @param pieces The buffers, consumed in place.
+     * @param caller Name of the calling function, for errors.
+     * @throws runtime_error if a write fails.
+     **********************************/
+    static void writeAll(int fd, vector<iovec>& pieces, const string& caller) {
+        size_t first = 0;
+        while (first < pieces.size()) {
+            const int count = static_cast<int>(min<size_t>(pieces.size() - first, IOV_MAX));
+            ssize_t written = ::writev(fd, pieces.data() + first, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error("Error " + caller + ": Write failed.");
+            }
+            // Skip what was written, the last piece may be partial
+            while (first < pieces.size() && static_cast<size_t>(written) >= pieces[first].iov_len) {
+                written -= pieces[first].iov_len;
+                ++first;
+            }
+            if (written > 0) {
+                pieces[first].iov_base = static_cast<uint8_t*>(pieces[first].iov_base) + written;
+                pieces[first].iov_len -= written;
+            }
+        }
+    }
+
     /**********************************
      * Validates the color header for 32-bit BMP files.
      * @param colorHeader The BMPColorHeader to validate.
@@ -0,0 +1,360 @@
+/**********************************
+ * @file imageview.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines non-owning views over image rows and the blocked
+ * geometric primitives built on them.
+ *
+ * @details
+ * - A view is a pointer to its first row, a size, a format and a row
+ *   stride in bytes. The stride may be negative, so a vertically
+ *   flipped view costs nothing.
+ * - subView() narrows a view to a rectangle of the same image, writing
+ *   through it renders straight into that region.
+ * - ImageTransform copies, transposes and mirrors views. Rotations are
+ *   a transpose of a flipped view.
+ * - Transposes walk the image in tiles that fit in L1. With SSE2, 8-bit
+ *   pixels are moved as 8x8 blocks and 32-bit pixels as 4x4 blocks of
+ *   register unpacks.
+ *
+ * Constraints:
+ * - Views only support byte addressable formats.
+ * - A view does not own its pixels, the image must outlive it.
+ **********************************/
+
+#ifndef IMAGE_VIEW_H
+#define IMAGE_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "image.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**********************************
+ * @class BasicImageView
+ * @brief Non-owning view over the rows of an image.
+ * @tparam T uint8_t for a mutable view, const uint8_t for a read-only one.
+ **********************************/
+template <typename T>
+class BasicImageView {
+private:
+    T* origin;          // First byte of the first row
+    int32_t width;      // Width in pixels
+    int32_t height;     // Height in pixels
+    PixelFormat format; // Pixel format
+    ptrdiff_t stride;   // Bytes from one row to the next, may be negative
+
+public:
+    /**********************************
+     * Constructor.
+     * @param newOrigin First byte of the first row.
+     * @param newWidth Width in pixels.
+     * @param newHeight Height in pixels.
+     * @param newFormat Pixel format.
+     * @param newStride Bytes from one row to the next.
+     **********************************/
+    BasicImageView(T* newOrigin, int32_t newWidth, int32_t newHeight, PixelFormat newFormat,
+                   ptrdiff_t newStride)
+        : origin(newOrigin), width(newWidth), height(newHeight), format(newFormat),
+          stride(newStride) {}
+
+    /**********************************
+     * Creates a view over a whole image.
+     * @param image The image.
+     **********************************/
+    BasicImageView(Image& image)
+        : BasicImageView(image.getData().data(), image.getWidth(), image.getHeight(),
+                         image.getFormat(), image.getStride()) {}
+
+    /**********************************
+     * Creates a read-only view over a whole image.
+     * @param image The image.
+     **********************************/
+    BasicImageView(const Image& image)
+        : BasicImageView(image.getData().data(), image.getWidth(), image.getHeight(),
+                         image.getFormat(), image.getStride()) {}
+
+    /**********************************
+     * Converts a mutable view into a read-only one.
+     * @param other The view to convert.
+     **********************************/
+    template <typename U, typename = enable_if_t<is_convertible<U*, T*>::value>>
+    BasicImageView(const BasicImageView<U>& other)
+        : BasicImageView(other.row(0), other.getWidth(), other.getHeight(),
+                         other.getFormat(), other.getStride()) {}
+
+    /**********************************
+     * Retrieves a row.
+     * @param y The row index.
+     * @return Pointer to the first byte of the row.
+     **********************************/
+    T* row(int32_t y) const {
+        return origin + static_cast<ptrdiff_t>(y) * stride;
+    }
+
+    /**********************************
+     * Creates a view with the rows in reverse order, without copying.
+     * @return The flipped view.
+     **********************************/
+    BasicImageView flippedVertical() const {
+        return BasicImageView(height > 0 ? row(height - 1) : origin, width, height, format, -stride);
+    }
+
+    /**********************************
+     * Creates a view over a rectangle of this view, without copying.
+     * @param x Left column of the rectangle.
+     * @param y Top row of the rectangle.
+     * @param newWidth Width of the rectangle.
+     * @param newHeight Height of the rectangle.
+     * @return The view over the rectangle.
+     * @throws ImageException if the rectangle is not inside the view.
+     **********************************/
+    BasicImageView subView(int32_t x, int32_t y, int32_t newWidth, int32_t newHeight) const {
+        if (x < 0 || y < 0 || newWidth < 0 || newHeight < 0 ||
+            x + newWidth > width || y + newHeight > height) {
+            throw ImageException("Error subView: Rectangle outside of the view.");
+        }
+        const ptrdiff_t offset = static_cast<ptrdiff_t>(x) * Image::bitsPerPixel(format) / 8;
+        return BasicImageView(row(y) + offset, newWidth, newHeight, format, stride);
+    }
+
+    /**********************************
+     * Copies the viewed pixels into a new tightly packed image.
+     * @return The image.
+     **********************************/
+    Image toImage() const {
+        Image image(width, height, format);
+        const size_t rowBytes = image.getStride();
+        for (int32_t y = 0; y < height; ++y) {
+            memcpy(image.getData().data() + y * rowBytes, row(y), rowBytes);
+        }
+        return image;
+    }
+
+    int32_t getWidth() const { return width; }
+    int32_t getHeight() const { return height; }
+    PixelFormat getFormat() const { return format; }
+    ptrdiff_t getStride() const { return stride; }
+
+    /**********************************
+     * Retrieves the number of bytes of pixel data in a row.
+     * @return Width times bytes per pixel.
+     **********************************/
+    size_t getRowBytes() const {
+        return static_cast<size_t>(width) * Image::bitsPerPixel(format) / 8;
+    }
+};
+
+using ImageView = BasicImageView<uint8_t>;
+using ConstImageView = BasicImageView<const uint8_t>;
+
+/**********************************
+ * @class ImageTransform
+ * @brief Row copies, transposes and mirrors over image views.
+ **********************************/
+class ImageTransform {
+public:
+    static const int32_t kTileSize = 32;    // Tile side in pixels, 32x32x4 bytes fits in L1
+
+    /**********************************
+     * Copies the rows of a view into another view of the same size.
+     * @param source The source view.
+     * @param target The target view.
+     **********************************/
+    static void copy(const ConstImageView& source, const ImageView& target) {
+        const size_t rowBytes = source.getRowBytes();
+        for (int32_t y = 0; y < source.getHeight(); ++y) {
+            memcpy(target.row(y), source.row(y), rowBytes);
+        }
+    }
+
+    /**********************************
+     * Transposes a view: target(x, y) = source(y, x).
+     * The target must be source height wide and source width tall.
+     * @param source The source view.
+     * @param target The target view.
+     * @throws ImageException if the sizes or the pixel size are not supported.
+     **********************************/
+    static void transpose(const ConstImageView& source, const ImageView& target) {
+        if (target.getWidth() != source.getHeight() || target.getHeight() != source.getWidth()) {
+            throw ImageException("Error transpose: Target size does not match the source.");
+        }
+        switch (Image::bitsPerPixel(source.getFormat())) {
+            case 8: transposeTiles<1>(source, target); break;
+            case 24: transposeTiles<3>(source, target); break;
+            case 32: transposeTiles<4>(source, target); break;
+            default: throw ImageException("Error transpose: Unsupported pixel format.");
+        }
+    }
+
+    /**********************************
+     * Mirrors every row of a view in place.
+     * @param view The view to mirror.
+     * @throws ImageException if the pixel size is not supported.
+     **********************************/
+    static void flipHorizontal(const ImageView& view) {
+        switch (Image::bitsPerPixel(view.getFormat())) {
+            case 8: flipRows<1>(view); break;
+            case 24: flipRows<3>(view); break;
+            case 32: flipRows<4>(view); break;
+            default: throw ImageException("Error flipHorizontal: Unsupported pixel format.");
+        }
+    }
+
+    /**********************************
+     * Reverses the order of the rows of a view in place.
+     * @param view The view to flip.
+     **********************************/
+    static void flipVertical(const ImageView& view) {
+        const size_t rowBytes = view.getRowBytes();
+        vector<uint8_t> temporary(rowBytes);
+        for (int32_t top = 0, bottom = view.getHeight() - 1; top < bottom; ++top, --bottom) {
+            memcpy(temporary.data(), view.row(top), rowBytes);
+            memcpy(view.row(top), view.row(bottom), rowBytes);
+            memcpy(view.row(bottom), temporary.data(), rowBytes);
+        }
+    }
+
+private:
+    /**********************************
+     * Transposes tile by tile so source and target lines stay cached.
+     * @tparam BPP Bytes per pixel.
+     **********************************/
+    template <int BPP>
+    static void transposeTiles(const ConstImageView& source, const ImageView& target) {
+        const int32_t width = source.getWidth();
+        const int32_t height = source.getHeight();
+        for (int32_t y0 = 0; y0 < height; y0 += kTileSize) {
+            const int32_t y1 = std::min(y0 + kTileSize, height);
+            for (int32_t x0 = 0; x0 < width; x0 += kTileSize) {
+                const int32_t x1 = std::min(x0 + kTileSize, width);
+                transposeTile<BPP>(source, target, x0, x1, y0, y1);
+            }
+        }
+    }
+
+    /**********************************
+     * Transposes the source rectangle [x0, x1) x [y0, y1).
+     * @tparam BPP Bytes per pixel.
+     **********************************/
+    template <int BPP>
+    static void transposeTile(const ConstImageView& source, const ImageView& target,
+                              int32_t x0, int32_t x1, int32_t y0, int32_t y1) {
+        int32_t y = y0;
+#ifdef __SSE2__
+        if constexpr (BPP == 1 || BPP == 4) {
+            // Whole SIMD blocks, the leftover columns of each block row are copied one by one
+            const int32_t block = BPP == 1 ? 8 : 4;
+            for (; y + block <= y1; y += block) {
+                int32_t x = x0;
+                for (; x + block <= x1; x += block) {
+                    if constexpr (BPP == 1) {
+                        transpose8x8(source.row(y) + x, source.getStride(),
+                                     target.row(x) + y, target.getStride());
+                    } else {
+                        transpose4x4(source.row(y) + x * 4, source.getStride(),
+                                     target.row(x) + y * 4, target.getStride());
+                    }
+                }
+                transposeScalar<BPP>(source, target, x, x1, y, y + block);
+            }
+        }
+#endif
+        transposeScalar<BPP>(source, target, x0, x1, y, y1);
+    }
+
+    /**********************************
+     * Transposes a small rectangle pixel by pixel, writing target rows
+     * contiguously.
+     * @tparam BPP Bytes per pixel.
+     **********************************/
+    template <int BPP>
+    static void transposeScalar(const ConstImageView& source, const ImageView& target,
+                                int32_t x0, int32_t x1, int32_t y0, int32_t y1) {
+        for (int32_t x = x0; x < x1; ++x) {
+            const uint8_t* sourcePixel = source.row(y0) + x * BPP;
+            uint8_t* targetPixel = target.row(x) + y0 * BPP;
+            for (int32_t y = y0; y < y1; ++y, sourcePixel += source.getStride(), targetPixel += BPP) {
+                memcpy(targetPixel, sourcePixel, BPP);
+            }
+        }
+    }
+
+#ifdef __SSE2__
+    /**********************************
+     * Transposes a 4x4 block of 32-bit pixels in registers.
+     **********************************/
+    static void transpose4x4(const uint8_t* source, ptrdiff_t sourceStride,
+                             uint8_t* target, ptrdiff_t targetStride) {
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + sourceStride));
+        __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * sourceStride));
+        __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 3 * sourceStride));
+
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);   // a0 b0 a1 b1
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);   // c0 d0 c1 d1
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);   // a2 b2 a3 b3
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);   // c2 d2 c3 d3
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + targetStride), _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 2 * targetStride), _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 3 * targetStride), _mm_unpackhi_epi64(t2, t3));
+    }
+
+    /**********************************
+     * Transposes an 8x8 block of 8-bit pixels in registers.
+     **********************************/
+    static void transpose8x8(const uint8_t* source, ptrdiff_t sourceStride,
+                             uint8_t* target, ptrdiff_t targetStride) {
+        __m128i r[8];
+        for (int i = 0; i < 8; ++i) {
+            r[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i * sourceStride));
+        }
+
+        // Interleave bytes, then pairs, then quadruplets of rows
+        __m128i a0 = _mm_unpacklo_epi8(r[0], r[1]);
+        __m128i a1 = _mm_unpacklo_epi8(r[2], r[3]);
+        __m128i a2 = _mm_unpacklo_epi8(r[4], r[5]);
+        __m128i a3 = _mm_unpacklo_epi8(r[6], r[7]);
+        __m128i b0 = _mm_unpacklo_epi16(a0, a1);   // Columns 0-3 of rows 0-3
+        __m128i b1 = _mm_unpackhi_epi16(a0, a1);   // Columns 4-7 of rows 0-3
+        __m128i b2 = _mm_unpacklo_epi16(a2, a3);   // Columns 0-3 of rows 4-7
+        __m128i b3 = _mm_unpackhi_epi16(a2, a3);   // Columns 4-7 of rows 4-7
+        __m128i c[4] = {_mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2),
+                        _mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3)};
+
+        for (int i = 0; i < 4; ++i) {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(target + 2 * i * targetStride), c[i]);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(target + (2 * i + 1) * targetStride),
+                             _mm_unpackhi_epi64(c[i], c[i]));
+        }
+    }
+#endif
+
+    /**********************************
+     * Reverses the pixels of every row.
+     * @tparam BPP Bytes per pixel.
+     **********************************/
+    template <int BPP>
+    static void flipRows(const ImageView& view) {
+        for (int32_t y = 0; y < view.getHeight(); ++y) {
+            uint8_t* left = view.row(y);
+            uint8_t* right = left + (view.getWidth() - 1) * BPP;
+            for (; left < right; left += BPP, right -= BPP) {
+                uint8_t pixel[BPP];
+                memcpy(pixel, left, BPP);
+                memcpy(left, right, BPP);
+                memcpy(right, pixel, BPP);
+            }
+        }
+    }
+};
+
+#endif // IMAGE_VIEW_H
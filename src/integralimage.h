@@ -0,0 +1,220 @@
+/**********************************
+ * @file integralimage.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the IntegralImage class, a summed-area table answering
+ * rectangle sums in constant time.
+ *
+ * @details
+ * - Entry (x, y) holds the per-channel sum of all pixels above and left
+ *   of it. The table has one extra zero row and column, so any rectangle
+ *   sum is four lookups with no border cases.
+ *   https://en.wikipedia.org/wiki/Summed-area_table
+ * - Built in two parallel passes: horizontal prefix sums over bands of
+ *   rows, then vertical accumulation over bands of columns. Both passes
+ *   walk memory in order.
+ * - Accumulators are 32-bit. Sums wrap modulo 2^32 on very large frames,
+ *   but a rectangle sum stays exact while the true rectangle sum fits in
+ *   32 bits (any rectangle up to 16.8 million pixels).
+ * - Built once per frame, the table can be attached to the frame Packet
+ *   so downstream calculators reuse it.
+ * - The table is not zero filled on allocation, only its border is, every
+ *   other entry is written exactly once per pass. IntegralImage is move only.
+ *
+ * Constraints:
+ * - Supports GRAYSCALE8, RGB24 and RGBA32 images, alpha is summed too.
+ **********************************/
+
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include "image.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+class IntegralImage {
+private:
+    int32_t width;              // Width of the source image in pixels
+    int32_t height;             // Height of the source image in pixels
+    int32_t channels;           // Channels per entry
+    size_t stride;              // Entries per table row, (width + 1) * channels
+    unique_ptr<uint32_t[]> table;   // (height + 1) rows of (width + 1) entries
+
+public:
+    /**********************************
+     * Builds the summed-area table of an image.
+     * @param image A GRAYSCALE8, RGB24 or RGBA32 image.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    explicit IntegralImage(const Image& image)
+        : width(image.getWidth()), height(image.getHeight()), channels(0), stride(0) {
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                build<decltype(tag)::format>(image);
+            });
+        if (!matched) {
+            throw ImageException("Error IntegralImage: Unsupported pixel format.");
+        }
+    }
+
+    /**********************************
+     * Sums one channel over the rectangle [x0, x1) x [y0, y1).
+     * The rectangle is clipped to the image.
+     * @param x0 Left column, inclusive.
+     * @param y0 Top row, inclusive.
+     * @param x1 Right column, exclusive.
+     * @param y1 Bottom row, exclusive.
+     * @param channel The channel to sum.
+     * @return The sum of the channel over the rectangle.
+     **********************************/
+    uint32_t sum(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t channel = 0) const {
+        clip(x0, y0, x1, y1);
+        const uint32_t* top = table.get() + y0 * stride + channel;
+        const uint32_t* bottom = table.get() + y1 * stride + channel;
+        // Unsigned wrap around cancels out in the difference
+        return bottom[x1 * channels] - bottom[x0 * channels] - top[x1 * channels] + top[x0 * channels];
+    }
+
+    /**********************************
+     * Sums every channel over the rectangle [x0, x1) x [y0, y1).
+     * The rectangle is clipped to the image.
+     * @param x0 Left column, inclusive.
+     * @param y0 Top row, inclusive.
+     * @param x1 Right column, exclusive.
+     * @param y1 Bottom row, exclusive.
+     * @param out Receives one sum per channel.
+     **********************************/
+    void sums(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t* out) const {
+        clip(x0, y0, x1, y1);
+        const uint32_t* top = table.get() + y0 * stride;
+        const uint32_t* bottom = table.get() + y1 * stride;
+        for (int32_t channel = 0; channel < channels; ++channel) {
+            out[channel] = bottom[x1 * channels + channel] - bottom[x0 * channels + channel] -
+                           top[x1 * channels + channel] + top[x0 * channels + channel];
+        }
+    }
+
+    /**********************************
+     * Averages every channel over the rectangle [x0, x1) x [y0, y1),
+     * rounded to the nearest integer. The rectangle is clipped to the image.
+     * @param x0 Left column, inclusive.
+     * @param y0 Top row, inclusive.
+     * @param x1 Right column, exclusive.
+     * @param y1 Bottom row, exclusive.
+     * @param out Receives one mean per channel, untouched for an empty rectangle.
+     **********************************/
+    void means(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t* out) const {
+        clip(x0, y0, x1, y1);
+        const uint32_t area = static_cast<uint32_t>(x1 - x0) * static_cast<uint32_t>(y1 - y0);
+        if (area == 0) return;
+        uint32_t total[4];
+        sums(x0, y0, x1, y1, total);
+        for (int32_t channel = 0; channel < channels; ++channel) {
+            out[channel] = static_cast<uint8_t>((static_cast<uint64_t>(total[channel]) + area / 2) / area);
+        }
+    }
+
+    int32_t getWidth() const { return width; }
+    int32_t getHeight() const { return height; }
+    int32_t getChannels() const { return channels; }
+
+private:
+    /**********************************
+     * Builds the table for an image of a known format.
+     * @tparam F The pixel format of the image.
+     * @param image The source image.
+     **********************************/
+    template <PixelFormat F>
+    void build(const Image& image) {
+        using Traits = PixelFormatTraits<F>;
+        channels = Traits::channels;
+        stride = static_cast<size_t>(width + 1) * channels;
+        table.reset(new uint32_t[(height + 1) * stride]);
+
+        // Zero the border row and column
+        memset(table.get(), 0, stride * sizeof(uint32_t));
+        for (int32_t row = 1; row <= height; ++row) {
+            memset(table.get() + row * stride, 0, channels * sizeof(uint32_t));
+        }
+
+        // Pass 1: running sums along every row
+        const uint8_t* pixelData = image.getData().data();
+        const size_t imageStride = image.getStride();
+        Parallel::forRows(height, [&](int32_t begin, int32_t end) {
+            for (int32_t row = begin; row < end; ++row) {
+                prefixRow<Traits::channels, Traits::bytesPerPixel>(
+                    pixelData + row * imageStride, table.get() + (row + 1) * stride + channels);
+            }
+        });
+
+        // Pass 2: accumulate down the columns, each band owns a run of entries
+        const int32_t rowEntries = width * channels;
+        Parallel::forRows(rowEntries, [&](int32_t begin, int32_t end) {
+            for (int32_t row = 2; row <= height; ++row) {
+                const uint32_t* above = table.get() + (row - 1) * stride + channels;
+                uint32_t* entry = table.get() + row * stride + channels;
+                for (int32_t i = begin; i < end; ++i) {
+                    entry[i] += above[i];
+                }
+            }
+        }, 64);
+    }
+
+    /**********************************
+     * Writes the running per-channel sums of a row of pixels.
+     * @tparam C Channels per pixel.
+     * @tparam BPP Bytes per pixel.
+     * @param pixel First pixel of the row.
+     * @param entry First table entry of the row, past the border column.
+     **********************************/
+    template <int32_t C, int32_t BPP>
+    void prefixRow(const uint8_t* pixel, uint32_t* entry) const {
+#ifdef __SSE2__
+        if constexpr (C == 3 || C == 4) {
+            // All channels of a pixel in one register, one add per pixel
+            const __m128i zero = _mm_setzero_si128();
+            __m128i running = zero;
+            for (int32_t col = 0; col < width; ++col, pixel += BPP, entry += C) {
+                int32_t packed = 0;
+                memcpy(&packed, pixel, C);
+                __m128i value = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+                running = _mm_add_epi32(running, value);
+                if constexpr (C == 4) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(entry), running);
+                } else {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(entry), running);
+                    entry[2] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(running, 8)));
+                }
+            }
+            return;
+        }
+#endif
+        uint32_t running[C] = {};
+        for (int32_t col = 0; col < width; ++col, pixel += BPP) {
+            for (int32_t channel = 0; channel < C; ++channel) {
+                running[channel] += pixel[channel];
+                *entry++ = running[channel];
+            }
+        }
+    }
+
+    /**********************************
+     * Clips a rectangle to the image.
+     **********************************/
+    void clip(int32_t& x0, int32_t& y0, int32_t& x1, int32_t& y1) const {
+        x0 = std::clamp(x0, 0, width);
+        x1 = std::clamp(x1, x0, width);
+        y0 = std::clamp(y0, 0, height);
+        y1 = std::clamp(y1, y0, height);
+    }
+};
+
+#endif // INTEGRAL_IMAGE_H
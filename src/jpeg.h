@@ -0,0 +1,1342 @@
+/**********************************
+ * @file jpeg.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the JpegCodec class, a self-contained baseline JPEG
+ * encoder and decoder.
+ *
+ * @details
+ * - 8x8 blocks go through the integer AAN DCT and IDCT (the "fast"
+ *   transforms of libjpeg), 8 lanes at a time with SSE2 when available.
+ *   The AAN scale factors are folded into the quantization tables.
+ * - Color frames are stored as YCbCr with 4:2:0 chroma subsampling. The
+ *   encoder averages chroma over 2x2 pixels, the decoder upsamples it
+ *   with the triangle filter.
+ * - Huffman coding uses the standard tables of the specification
+ *   (Annex K) on encode and 9-bit lookup tables on decode.
+ * - The encoder ends every row of MCUs with a restart marker, so rows
+ *   are encoded on all threads and simply concatenated. The decoder
+ *   splits the entropy coded data at restart markers and decodes the
+ *   intervals in parallel, files without restart markers are decoded on
+ *   one thread. The output does not depend on the number of threads.
+ *   https://www.w3.org/Graphics/JPEG/itu-t81.pdf
+ *
+ * Constraints:
+ * - Encodes GRAYSCALE8 as 1 component files, RGB24 and RGBA32 as YCbCr
+ *   files, alpha is dropped. Decoding yields GRAYSCALE8 or RGB24.
+ * - Decodes baseline and extended sequential Huffman files with 8-bit
+ *   samples in a single scan, with sampling factors of 1 and 2.
+ *   Progressive and arithmetic coded files are rejected.
+ **********************************/
+
+#ifndef JPEG_H
+#define JPEG_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "image.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+class JpegCodec {
+public:
+    static const int32_t kDefaultQuality = 85;      // IJG quality scale, 1 to 100
+    static const int64_t kMaxPixels = 400000000;    // Largest frame accepted by the decoder
+
+private:
+    static const int32_t kFastBits = 9;             // Huffman codes resolved with one lookup
+
+    // Q16 fractions of the AAN multipliers, all below 0.5 so products fit in 16 bits
+    static const int16_t kFix0293 = 19195;          // 1 - 0.707106781
+    static const int16_t kFix0383 = 25080;          // 0.382683433
+    static const int16_t kFix0459 = 30068;          // 1 - 0.541196100
+    static const int16_t kFix0307 = 20091;          // 1.306562965 - 1
+    static const int16_t kFix0414 = 27146;          // 1.414213562 - 1
+    static const int16_t kFix0152 = 9977;           // 2 - 1.847759065
+    static const int16_t kFix0082 = 5400;           // 1.082392200 - 1
+    static const int16_t kFix0387 = 25354;          // 3 - 2.613125930
+    static const int16_t kFix0402 = 26345;          // 1.402 - 1, red from Cr
+    static const int16_t kFix0286 = 18734;          // 1 - 0.714136, green from Cr
+    static const int16_t kFix0344 = 22554;          // 0.344136, green from Cb
+    static const int16_t kFix0228 = 14942;          // 2 - 1.772, blue from Cb
+
+    // Zigzag position to natural (row major) position
+    static constexpr uint8_t kZigzag[64] = {
+         0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    // Annex K quantization tables for quality 50, natural order
+    static constexpr uint8_t kLumaQuant[64] = {
+        16, 11, 10, 16,  24,  40,  51,  61,  12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,  14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,  24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,  72, 92, 95, 98, 112, 100, 103,  99
+    };
+    static constexpr uint8_t kChromaQuant[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99,  18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,  47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,  99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,  99, 99, 99, 99, 99, 99, 99, 99
+    };
+
+    // Annex K Huffman tables: code counts per length, then symbols
+    static constexpr uint8_t kLumaDcBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    static constexpr uint8_t kChromaDcBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    static constexpr uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    static constexpr uint8_t kLumaAcBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+    static constexpr uint8_t kLumaAcValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+        0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+        0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+        0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA
+    };
+    static constexpr uint8_t kChromaAcBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    static constexpr uint8_t kChromaAcValues[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+        0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+        0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+        0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+        0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+        0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA
+    };
+
+    /**********************************
+     * Huffman code and length of every symbol, for the encoder.
+     **********************************/
+    struct HuffmanEncoder {
+        uint16_t codes[256] = {};
+        uint8_t lengths[256] = {};
+    };
+
+    /**********************************
+     * Huffman decoding tables.
+     **********************************/
+    struct HuffmanDecoder {
+        uint16_t fast[1 << kFastBits] = {};     // Length << 8 | symbol, 0 for longer codes
+        int32_t maxCode[18] = {};               // Largest code of each length, -1 if none
+        int32_t valueOffset[17] = {};           // Position in values minus the first code of a length
+        uint8_t values[256] = {};               // Symbols in code order
+        bool defined = false;
+    };
+
+    /**********************************
+     * Quantization and Huffman tables of the encoder.
+     **********************************/
+    struct EncoderTables {
+        uint8_t quant[2][64];       // Luma and chroma tables, natural order
+        float reciprocals[2][64];   // 1 / (quant * AAN scale), natural order
+        HuffmanEncoder dc[2];
+        HuffmanEncoder ac[2];
+    };
+
+    /**********************************
+     * A frame component and its decoded samples.
+     **********************************/
+    struct Component {
+        int32_t id = 0;
+        int32_t h = 1;                  // Horizontal sampling factor
+        int32_t v = 1;                  // Vertical sampling factor
+        int32_t quant = 0;              // Quantization table index
+        int32_t dc = 0;                 // DC Huffman table index
+        int32_t ac = 0;                 // AC Huffman table index
+        int32_t width = 0;              // Samples covering the image
+        int32_t height = 0;
+        int32_t stride = 0;             // Bytes per plane row, whole blocks
+        vector<uint8_t> plane;          // Decoded samples
+        int32_t dequant[64] = {};       // Dequantization table with the AAN scale, natural order
+    };
+
+    /**********************************
+     * Frame header and tables gathered while parsing.
+     **********************************/
+    struct Frame {
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t maxH = 1;
+        int32_t maxV = 1;
+        int32_t restartInterval = 0;
+        vector<Component> components;
+        vector<int32_t> scanOrder;      // Component indexes in scan order
+        uint16_t quant[4][64] = {};     // Natural order
+        bool quantDefined[4] = {};
+        HuffmanDecoder dc[4];
+        HuffmanDecoder ac[4];
+    };
+
+    /**********************************
+     * MSB-first bit writer with 0xFF byte stuffing.
+     **********************************/
+    class BitWriter {
+    private:
+        vector<uint8_t>& out;
+        size_t used;
+        uint64_t buffer = 0;
+        int32_t count = 0;
+
+    public:
+        explicit BitWriter(vector<uint8_t>& target) : out(target), used(target.size()) {}
+
+        void reserve(size_t bytes) {
+            if (out.size() < used + bytes) out.resize(max(out.size() * 2, used + bytes));
+        }
+
+        void put(uint32_t bits, int32_t length) {
+            buffer = buffer << length | bits;
+            count += length;
+            if (count >= 32) {
+                count -= 32;
+                emitWord(static_cast<uint32_t>(buffer >> count));
+            }
+        }
+
+        // Pads the last byte with 1 bits and trims the buffer
+        void finish() {
+            const int32_t padding = (8 - (count & 7)) & 7;
+            if (padding > 0) put((1u << padding) - 1, padding);
+            while (count >= 8) {
+                count -= 8;
+                emitByte(static_cast<uint8_t>(buffer >> count));
+            }
+            out.resize(used);
+        }
+
+    private:
+        void emitByte(uint8_t byte) {
+            out[used++] = byte;
+            if (byte == 0xFF) out[used++] = 0;
+        }
+
+        void emitWord(uint32_t word) {
+            // A byte of ~word is zero exactly where word has a 0xFF byte
+            if (((~word - 0x01010101u) & word & 0x80808080u) == 0) {
+                uint8_t* p = out.data() + used;
+                p[0] = static_cast<uint8_t>(word >> 24);
+                p[1] = static_cast<uint8_t>(word >> 16);
+                p[2] = static_cast<uint8_t>(word >> 8);
+                p[3] = static_cast<uint8_t>(word);
+                used += 4;
+                return;
+            }
+            for (int32_t shift = 24; shift >= 0; shift -= 8) emitByte(static_cast<uint8_t>(word >> shift));
+        }
+    };
+
+    /**********************************
+     * MSB-first bit reader over one entropy coded interval, stuffed bytes
+     * are skipped and zeros are read past the end.
+     **********************************/
+    struct BitReader {
+        const uint8_t* position;
+        const uint8_t* end;
+        uint64_t buffer = 0;
+        int32_t count = 0;
+
+        BitReader(const uint8_t* begin, const uint8_t* finish) : position(begin), end(finish) {}
+
+        void refill() {
+            while (count <= 56) {
+                uint64_t byte = 0;
+                if (position < end) {
+                    byte = *position++;
+                    if (byte == 0xFF && position < end && *position == 0) ++position;
+                }
+                buffer |= byte << (56 - count);
+                count += 8;
+            }
+        }
+
+        uint32_t peek(int32_t length) const {
+            return static_cast<uint32_t>(buffer >> (64 - length));
+        }
+
+        void skip(int32_t length) {
+            buffer <<= length;
+            count -= length;
+        }
+
+        // Reads a length bit magnitude and extends its sign (F.2.2.1)
+        int32_t receive(int32_t length) {
+            if (length == 0) return 0;
+            const int32_t value = static_cast<int32_t>(peek(length));
+            skip(length);
+            return value < (1 << (length - 1)) ? value - (1 << length) + 1 : value;
+        }
+    };
+
+#ifdef __SSE2__
+    using Lanes = __m128i;
+
+    static Lanes loadLanes(const int16_t* in) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)); }
+    static void storeLanes(int16_t* out, Lanes a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), a); }
+    static Lanes add(Lanes a, Lanes b) { return _mm_adds_epi16(a, b); }
+    static Lanes sub(Lanes a, Lanes b) { return _mm_subs_epi16(a, b); }
+    static Lanes fraction(Lanes a, int16_t k) { return _mm_mulhi_epi16(a, _mm_set1_epi16(k)); }
+
+    static void transpose(Lanes* r) {
+        const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+        const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+        const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+        const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+        const __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+        const __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+        const __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+        const __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+        r[0] = _mm_unpacklo_epi64(b0, b4);
+        r[1] = _mm_unpackhi_epi64(b0, b4);
+        r[2] = _mm_unpacklo_epi64(b1, b5);
+        r[3] = _mm_unpackhi_epi64(b1, b5);
+        r[4] = _mm_unpacklo_epi64(b2, b6);
+        r[5] = _mm_unpackhi_epi64(b2, b6);
+        r[6] = _mm_unpacklo_epi64(b3, b7);
+        r[7] = _mm_unpackhi_epi64(b3, b7);
+    }
+#else
+    // Same saturating 16-bit arithmetic as the SSE2 lanes
+    struct Lanes {
+        int16_t v[8];
+    };
+
+    static int16_t saturate(int32_t value) {
+        return static_cast<int16_t>(min(32767, max(-32768, value)));
+    }
+
+    static Lanes loadLanes(const int16_t* in) {
+        Lanes a;
+        memcpy(a.v, in, sizeof(a.v));
+        return a;
+    }
+
+    static void storeLanes(int16_t* out, const Lanes& a) { memcpy(out, a.v, sizeof(a.v)); }
+
+    static Lanes add(const Lanes& a, const Lanes& b) {
+        Lanes r;
+        for (int32_t i = 0; i < 8; ++i) r.v[i] = saturate(a.v[i] + b.v[i]);
+        return r;
+    }
+
+    static Lanes sub(const Lanes& a, const Lanes& b) {
+        Lanes r;
+        for (int32_t i = 0; i < 8; ++i) r.v[i] = saturate(a.v[i] - b.v[i]);
+        return r;
+    }
+
+    static Lanes fraction(const Lanes& a, int16_t k) {
+        Lanes r;
+        for (int32_t i = 0; i < 8; ++i) r.v[i] = static_cast<int16_t>((a.v[i] * k) >> 16);
+        return r;
+    }
+
+    static void transpose(Lanes* r) {
+        for (int32_t i = 0; i < 8; ++i) {
+            for (int32_t j = i + 1; j < 8; ++j) swap(r[i].v[j], r[j].v[i]);
+        }
+    }
+#endif
+
+public:
+    /**********************************
+     * Encodes an image as JPEG segments: the headers, one buffer per row
+     * of MCUs ending with its restart marker, and the end of image marker.
+     * Rows are encoded in parallel.
+     * @param image The image to encode.
+     * @param quality IJG quality, 1 to 100.
+     * @return The segments, in file order.
+     * @throws ImageException if the format or size is not supported.
+     **********************************/
+    static vector<vector<uint8_t>> encodeSegments(const Image& image, int32_t quality = kDefaultQuality) {
+        const PixelFormat format = image.getFormat();
+        if (format != PixelFormat::GRAYSCALE8 && format != PixelFormat::RGB24 && format != PixelFormat::RGBA32) {
+            throw ImageException("Error JpegCodec: Unsupported pixel format.");
+        }
+        if (image.getWidth() > 65535 || image.getHeight() > 65535) {
+            throw ImageException("Error JpegCodec: Image too large.");
+        }
+        const bool color = format != PixelFormat::GRAYSCALE8;
+        const int32_t mcuSize = color ? 16 : 8;
+        const int32_t mcusX = (image.getWidth() + mcuSize - 1) / mcuSize;
+        const int32_t mcusY = (image.getHeight() + mcuSize - 1) / mcuSize;
+        const EncoderTables tables = buildEncoderTables(quality);
+
+        vector<vector<uint8_t>> segments(mcusY + 2);
+        segments.front() = header(image, tables, mcusX);
+        Parallel::forRows(mcusY, [&](int32_t begin, int32_t end) {
+            vector<uint8_t> samples(static_cast<size_t>(mcusX) * mcuSize * mcuSize * 3 / 2);
+            vector<int16_t> chroma(static_cast<size_t>(mcusX) * mcuSize * 4);
+            for (int32_t row = begin; row < end; ++row) {
+                vector<uint8_t>& out = segments[row + 1];
+                out.reserve(static_cast<size_t>(mcusX) * mcuSize * mcuSize / 4);
+                if (color) {
+                    encodeColorRow(image, row, mcusX, tables, samples, chroma, out);
+                } else {
+                    encodeGrayRow(image, row, mcusX, tables, samples, out);
+                }
+                if (row + 1 < mcusY) {
+                    out.push_back(0xFF);
+                    out.push_back(static_cast<uint8_t>(0xD0 + (row & 7)));
+                }
+            }
+        }, 1);
+        segments.back() = {0xFF, 0xD9};
+        return segments;
+    }
+
+    /**********************************
+     * Encodes an image as a JPEG file.
+     * @param image The image to encode.
+     * @param quality IJG quality, 1 to 100.
+     * @return The file bytes.
+     * @throws ImageException if the format or size is not supported.
+     **********************************/
+    static vector<uint8_t> encode(const Image& image, int32_t quality = kDefaultQuality) {
+        const vector<vector<uint8_t>> segments = encodeSegments(image, quality);
+        size_t size = 0;
+        for (const vector<uint8_t>& segment : segments) size += segment.size();
+        vector<uint8_t> file;
+        file.reserve(size);
+        for (const vector<uint8_t>& segment : segments) file.insert(file.end(), segment.begin(), segment.end());
+        return file;
+    }
+
+    /**********************************
+     * Compresses an image into a PixelFormat::JPEG image holding the file.
+     * @param image The image to compress.
+     * @param quality IJG quality, 1 to 100.
+     * @return The compressed image, with the same dimensions.
+     * @throws ImageException if the format or size is not supported.
+     **********************************/
+    static Image compress(const Image& image, int32_t quality = kDefaultQuality) {
+        return Image(image.getWidth(), image.getHeight(), PixelFormat::JPEG, encode(image, quality));
+    }
+
+    /**********************************
+     * Decodes a JPEG file.
+     * @param data The file bytes.
+     * @param size The number of bytes.
+     * @return A GRAYSCALE8 image for 1 component files, RGB24 otherwise.
+     * @throws runtime_error if the data is not a supported JPEG file.
+     **********************************/
+    static Image decode(const uint8_t* data, size_t size) {
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+            throw runtime_error("Error decodeJPEG: Not a JPEG file.");
+        }
+        Frame frame;
+        size_t p = 2;
+        while (true) {
+            if (p + 4 > size) throw runtime_error("Error decodeJPEG: Truncated data.");
+            if (data[p] != 0xFF) throw runtime_error("Error decodeJPEG: Invalid marker.");
+            const uint8_t marker = data[p + 1];
+            if (marker == 0xFF) {
+                ++p;
+                continue;
+            }
+            if (marker == 0xD9) throw runtime_error("Error decodeJPEG: No image data.");
+            const size_t length = static_cast<size_t>(data[p + 2]) << 8 | data[p + 3];
+            if (length < 2 || p + 2 + length > size) throw runtime_error("Error decodeJPEG: Truncated data.");
+            const uint8_t* segment = data + p + 4;
+            const size_t segmentSize = length - 2;
+            p += 2 + length;
+            switch (marker) {
+                case 0xC0:
+                case 0xC1:
+                    parseFrame(segment, segmentSize, frame);
+                    break;
+                case 0xC4:
+                    parseHuffmanTables(segment, segmentSize, frame);
+                    break;
+                case 0xDB:
+                    parseQuantTables(segment, segmentSize, frame);
+                    break;
+                case 0xDD:
+                    if (segmentSize < 2) throw runtime_error("Error decodeJPEG: Invalid restart interval.");
+                    frame.restartInterval = segment[0] << 8 | segment[1];
+                    break;
+                case 0xDA:
+                    parseScan(segment, segmentSize, frame);
+                    return decodeScan(data + p, size - p, frame);
+                default:
+                    if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC8) {
+                        throw runtime_error("Error decodeJPEG: Only baseline and sequential Huffman files are supported.");
+                    }
+                    break;  // APPn, COM and other segments are skipped
+            }
+        }
+    }
+
+    /**********************************
+     * Decompresses a PixelFormat::JPEG image.
+     * @param image The compressed image.
+     * @return The decoded image.
+     * @throws ImageException if the image is not a JPEG image.
+     * @throws runtime_error if the data is not a supported JPEG file.
+     **********************************/
+    static Image decompress(const Image& image) {
+        if (image.getFormat() != PixelFormat::JPEG) {
+            throw ImageException("Error JpegCodec: Image is not compressed.");
+        }
+        return decode(image.getData().data(), image.getData().size());
+    }
+
+    /**********************************
+     * Forward AAN DCT of an 8x8 block of samples.
+     * Coefficient (u, v) comes out scaled by 16 * s(u) * s(v), with
+     * s(0) = 1 and s(k) = sqrt(2) * cos(k * pi / 16).
+     * @param samples The first sample of the block.
+     * @param stride Bytes between sample rows.
+     * @param out 64 coefficients, natural order.
+     **********************************/
+    static void forwardDct(const uint8_t* samples, size_t stride, int16_t* out) {
+        Lanes r[8];
+        int16_t row[8];
+        for (int32_t i = 0; i < 8; ++i) {
+            // Level shift, one extra bit of precision
+            for (int32_t j = 0; j < 8; ++j) row[j] = static_cast<int16_t>((samples[i * stride + j] - 128) * 2);
+            r[i] = loadLanes(row);
+        }
+        forwardPass(r);
+        transpose(r);
+        forwardPass(r);
+        transpose(r);
+        for (int32_t i = 0; i < 8; ++i) storeLanes(out + i * 8, r[i]);
+    }
+
+    /**********************************
+     * Inverse AAN DCT of an 8x8 block of dequantized coefficients.
+     * @param coefficients 64 coefficients from dequantize(), natural order.
+     * @param out The first sample of the block.
+     * @param stride Bytes between sample rows.
+     **********************************/
+    static void inverseDct(const int16_t* coefficients, uint8_t* out, size_t stride) {
+        Lanes r[8];
+        for (int32_t i = 0; i < 8; ++i) r[i] = loadLanes(coefficients + i * 8);
+        inversePass(r);
+        transpose(r);
+        inversePass(r);
+        transpose(r);
+        for (int32_t i = 0; i < 8; ++i) {
+#ifdef __SSE2__
+            // Remove the 2 fraction bits and the factor 8, round, undo the level shift
+            const __m128i shifted = _mm_srai_epi16(_mm_adds_epi16(r[i], _mm_set1_epi16(16 + (128 << 5))), 5);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * stride), _mm_packus_epi16(shifted, shifted));
+#else
+            for (int32_t j = 0; j < 8; ++j) {
+                out[i * stride + j] = static_cast<uint8_t>(min(255, max(0, saturate(r[i].v[j] + 16 + (128 << 5)) >> 5)));
+            }
+#endif
+        }
+    }
+
+    /**********************************
+     * Builds a dequantization table for dequantize().
+     * @param quant 64 quantization values, natural order.
+     * @param out 64 multipliers, quant * s(u) * s(v) with 10 fraction bits.
+     **********************************/
+    static void dequantTable(const uint16_t* quant, int32_t* out) {
+        for (int32_t i = 0; i < 64; ++i) {
+            out[i] = static_cast<int32_t>(floor(quant[i] * aanScale(i >> 3) * aanScale(i & 7) * 1024.0 + 0.5));
+        }
+    }
+
+    /**********************************
+     * Dequantizes one coefficient for inverseDct(), which works with 2
+     * fraction bits. The product is formed in 32 bits, small quantizers
+     * keep their precision.
+     * @param value The quantized coefficient.
+     * @param multiplier Its entry of dequantTable().
+     * @return The scaled coefficient, saturated to 16 bits.
+     **********************************/
+    static int16_t dequantize(int32_t value, int32_t multiplier) {
+        const int64_t scaled = (static_cast<int64_t>(value) * multiplier + 128) >> 8;
+        return static_cast<int16_t>(min<int64_t>(32767, max<int64_t>(-32768, scaled)));
+    }
+
+    /**********************************
+     * Retrieves the AAN scale factor of a frequency.
+     * @param k The frequency, 0 to 7.
+     * @return 1 for k = 0, sqrt(2) * cos(k * pi / 16) otherwise.
+     **********************************/
+    static double aanScale(int32_t k) {
+        return k == 0 ? 1.0 : sqrt(2.0) * cos(k * M_PI / 16.0);
+    }
+
+private:
+    /**********************************
+     * One 1-D AAN forward DCT over the 8 rows, on every lane.
+     **********************************/
+    static void forwardPass(Lanes* r) {
+        const Lanes t0 = add(r[0], r[7]), t7 = sub(r[0], r[7]);
+        const Lanes t1 = add(r[1], r[6]), t6 = sub(r[1], r[6]);
+        const Lanes t2 = add(r[2], r[5]), t5 = sub(r[2], r[5]);
+        const Lanes t3 = add(r[3], r[4]), t4 = sub(r[3], r[4]);
+
+        // Even part
+        const Lanes t10 = add(t0, t3), t13 = sub(t0, t3);
+        const Lanes t11 = add(t1, t2), t12 = sub(t1, t2);
+        r[0] = add(t10, t11);
+        r[4] = sub(t10, t11);
+        const Lanes sum = add(t12, t13);
+        const Lanes z1 = sub(sum, fraction(sum, kFix0293));            // * 0.707106781
+        r[2] = add(t13, z1);
+        r[6] = sub(t13, z1);
+
+        // Odd part
+        const Lanes o10 = add(t4, t5), o11 = add(t5, t6), o12 = add(t6, t7);
+        const Lanes z5 = fraction(sub(o10, o12), kFix0383);             // * 0.382683433
+        const Lanes z2 = add(sub(o10, fraction(o10, kFix0459)), z5);    // * 0.541196100
+        const Lanes z4 = add(add(o12, fraction(o12, kFix0307)), z5);    // * 1.306562965
+        const Lanes z3 = sub(o11, fraction(o11, kFix0293));             // * 0.707106781
+        const Lanes z11 = add(t7, z3), z13 = sub(t7, z3);
+        r[5] = add(z13, z2);
+        r[3] = sub(z13, z2);
+        r[1] = add(z11, z4);
+        r[7] = sub(z11, z4);
+    }
+
+    /**********************************
+     * One 1-D AAN inverse DCT over the 8 rows, on every lane.
+     **********************************/
+    static void inversePass(Lanes* r) {
+        // Even part
+        const Lanes t10 = add(r[0], r[4]), t11 = sub(r[0], r[4]);
+        const Lanes t13 = add(r[2], r[6]);
+        const Lanes difference = sub(r[2], r[6]);
+        const Lanes t12 = sub(add(difference, fraction(difference, kFix0414)), t13);   // * 1.414213562
+        const Lanes e0 = add(t10, t13), e3 = sub(t10, t13);
+        const Lanes e1 = add(t11, t12), e2 = sub(t11, t12);
+
+        // Odd part
+        const Lanes z13 = add(r[5], r[3]), z10 = sub(r[5], r[3]);
+        const Lanes z11 = add(r[1], r[7]), z12 = sub(r[1], r[7]);
+        const Lanes o7 = add(z11, z13);
+        const Lanes spread = sub(z11, z13);
+        const Lanes o11 = add(spread, fraction(spread, kFix0414));                     // * 1.414213562
+        const Lanes sum = add(z10, z12);
+        const Lanes z5 = sub(add(sum, sum), fraction(sum, kFix0152));                  // * 1.847759065
+        const Lanes o10 = sub(add(z12, fraction(z12, kFix0082)), z5);                  // * 1.082392200
+        const Lanes o12 = sub(z5, sub(add(add(z10, z10), z10), fraction(z10, kFix0387)));  // * -2.613125930
+        const Lanes o6 = sub(o12, o7);
+        const Lanes o5 = sub(o11, o6);
+        const Lanes o4 = add(o10, o5);
+
+        r[0] = add(e0, o7);
+        r[7] = sub(e0, o7);
+        r[1] = add(e1, o6);
+        r[6] = sub(e1, o6);
+        r[2] = add(e2, o5);
+        r[5] = sub(e2, o5);
+        r[4] = add(e3, o4);
+        r[3] = sub(e3, o4);
+    }
+
+    /**********************************
+     * Builds the quantization and Huffman tables of the encoder.
+     **********************************/
+    static EncoderTables buildEncoderTables(int32_t quality) {
+        quality = min(100, max(1, quality));
+        const int32_t scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        EncoderTables tables;
+        const uint8_t* bases[2] = {kLumaQuant, kChromaQuant};
+        for (int32_t t = 0; t < 2; ++t) {
+            for (int32_t i = 0; i < 64; ++i) {
+                const int32_t value = min(255, max(1, (bases[t][i] * scale + 50) / 100));
+                tables.quant[t][i] = static_cast<uint8_t>(value);
+                tables.reciprocals[t][i] = static_cast<float>(1.0 / (value * aanScale(i >> 3) * aanScale(i & 7) * 16.0));
+            }
+        }
+        tables.dc[0] = buildEncoder(kLumaDcBits, kDcValues);
+        tables.dc[1] = buildEncoder(kChromaDcBits, kDcValues);
+        tables.ac[0] = buildEncoder(kLumaAcBits, kLumaAcValues);
+        tables.ac[1] = buildEncoder(kChromaAcBits, kChromaAcValues);
+        return tables;
+    }
+
+    /**********************************
+     * Assigns canonical codes to symbols (C.2).
+     **********************************/
+    static HuffmanEncoder buildEncoder(const uint8_t* bits, const uint8_t* values) {
+        HuffmanEncoder table;
+        uint32_t code = 0;
+        int32_t k = 0;
+        for (int32_t length = 1; length <= 16; ++length) {
+            for (int32_t i = 0; i < bits[length - 1]; ++i, ++k) {
+                table.codes[values[k]] = static_cast<uint16_t>(code++);
+                table.lengths[values[k]] = static_cast<uint8_t>(length);
+            }
+            code <<= 1;
+        }
+        return table;
+    }
+
+    static void appendWord(vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void appendHuffmanTable(vector<uint8_t>& out, uint8_t classAndId, const uint8_t* bits, const uint8_t* values) {
+        out.push_back(classAndId);
+        out.insert(out.end(), bits, bits + 16);
+        int32_t count = 0;
+        for (int32_t i = 0; i < 16; ++i) count += bits[i];
+        out.insert(out.end(), values, values + count);
+    }
+
+    /**********************************
+     * Builds the headers, up to the start of scan.
+     **********************************/
+    static vector<uint8_t> header(const Image& image, const EncoderTables& tables, int32_t mcusX) {
+        const bool color = image.getFormat() != PixelFormat::GRAYSCALE8;
+        const int32_t components = color ? 3 : 1;
+        vector<uint8_t> out = {0xFF, 0xD8,
+                               0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00,
+                               0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+
+        out.insert(out.end(), {0xFF, 0xDB});
+        appendWord(out, 2 + 65 * (color ? 2 : 1));
+        for (int32_t t = 0; t < (color ? 2 : 1); ++t) {
+            out.push_back(static_cast<uint8_t>(t));
+            for (int32_t k = 0; k < 64; ++k) out.push_back(tables.quant[t][kZigzag[k]]);
+        }
+
+        out.insert(out.end(), {0xFF, 0xC0});
+        appendWord(out, 8 + 3 * components);
+        out.push_back(8);
+        appendWord(out, static_cast<uint32_t>(image.getHeight()));
+        appendWord(out, static_cast<uint32_t>(image.getWidth()));
+        out.push_back(static_cast<uint8_t>(components));
+        for (int32_t c = 0; c < components; ++c) {
+            out.push_back(static_cast<uint8_t>(c + 1));
+            out.push_back(c == 0 && color ? 0x22 : 0x11);
+            out.push_back(c == 0 ? 0 : 1);
+        }
+
+        out.insert(out.end(), {0xFF, 0xC4});
+        appendWord(out, 2 + (17 + 12 + 17 + 162) * (color ? 2 : 1));
+        appendHuffmanTable(out, 0x00, kLumaDcBits, kDcValues);
+        appendHuffmanTable(out, 0x10, kLumaAcBits, kLumaAcValues);
+        if (color) {
+            appendHuffmanTable(out, 0x01, kChromaDcBits, kDcValues);
+            appendHuffmanTable(out, 0x11, kChromaAcBits, kChromaAcValues);
+        }
+
+        // One restart interval per row of MCUs
+        out.insert(out.end(), {0xFF, 0xDD, 0x00, 0x04});
+        appendWord(out, static_cast<uint32_t>(mcusX));
+
+        out.insert(out.end(), {0xFF, 0xDA});
+        appendWord(out, 6 + 2 * components);
+        out.push_back(static_cast<uint8_t>(components));
+        for (int32_t c = 0; c < components; ++c) {
+            out.push_back(static_cast<uint8_t>(c + 1));
+            out.push_back(c == 0 ? 0x00 : 0x11);
+        }
+        out.insert(out.end(), {0x00, 0x3F, 0x00});
+        return out;
+    }
+
+    /**********************************
+     * Converts the rows of one MCU row to YCbCr 4:2:0 and encodes them.
+     * Samples past the right and bottom edges repeat the last pixel.
+     **********************************/
+    static void encodeColorRow(const Image& image, int32_t mcuRow, int32_t mcusX, const EncoderTables& tables,
+                               vector<uint8_t>& samples, vector<int16_t>& chroma, vector<uint8_t>& out) {
+        const int32_t width = image.getWidth();
+        const int32_t paddedWidth = mcusX * 16;
+        const int32_t chromaWidth = paddedWidth / 2;
+        const int32_t channels = image.getFormat() == PixelFormat::RGBA32 ? 4 : 3;
+        uint8_t* luma = samples.data();
+        uint8_t* cb = luma + 16 * paddedWidth;
+        uint8_t* cr = cb + 8 * chromaWidth;
+        int16_t* fullCb = chroma.data();            // Two full resolution rows each
+        int16_t* fullCr = fullCb + 2 * paddedWidth;
+
+        for (int32_t i = 0; i < 16; ++i) {
+            const int32_t y = min(mcuRow * 16 + i, image.getHeight() - 1);
+            const uint8_t* source = image.getData().data() + static_cast<size_t>(y) * image.getStride();
+            uint8_t* lumaRow = luma + i * paddedWidth;
+            int16_t* cbRow = fullCb + (i & 1) * paddedWidth;
+            int16_t* crRow = fullCr + (i & 1) * paddedWidth;
+            for (int32_t x = 0; x < width; ++x, source += channels) {
+                const int32_t r = source[0], g = source[1], b = source[2];
+                lumaRow[x] = static_cast<uint8_t>((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+                cbRow[x] = static_cast<int16_t>((-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32767) >> 16);
+                crRow[x] = static_cast<int16_t>((32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32767) >> 16);
+            }
+            for (int32_t x = width; x < paddedWidth; ++x) {
+                lumaRow[x] = lumaRow[width - 1];
+                cbRow[x] = cbRow[width - 1];
+                crRow[x] = crRow[width - 1];
+            }
+            if (i & 1) {
+                // Average 2x2 pixels, alternating the rounding bias like libjpeg
+                uint8_t* cbOut = cb + (i >> 1) * chromaWidth;
+                uint8_t* crOut = cr + (i >> 1) * chromaWidth;
+                for (int32_t x = 0; x < chromaWidth; ++x) {
+                    const int32_t bias = 1 + (x & 1);
+                    cbOut[x] = static_cast<uint8_t>((fullCb[2 * x] + fullCb[2 * x + 1] + fullCb[paddedWidth + 2 * x] +
+                                                     fullCb[paddedWidth + 2 * x + 1] + bias) >> 2);
+                    crOut[x] = static_cast<uint8_t>((fullCr[2 * x] + fullCr[2 * x + 1] + fullCr[paddedWidth + 2 * x] +
+                                                     fullCr[paddedWidth + 2 * x + 1] + bias) >> 2);
+                }
+            }
+        }
+
+        BitWriter writer(out);
+        int32_t predictors[3] = {0, 0, 0};
+        for (int32_t mx = 0; mx < mcusX; ++mx) {
+            writer.reserve(6 * 512);
+            const uint8_t* block = luma + mx * 16;
+            encodeBlock(block, paddedWidth, 0, tables, predictors[0], writer);
+            encodeBlock(block + 8, paddedWidth, 0, tables, predictors[0], writer);
+            encodeBlock(block + 8 * paddedWidth, paddedWidth, 0, tables, predictors[0], writer);
+            encodeBlock(block + 8 * paddedWidth + 8, paddedWidth, 0, tables, predictors[0], writer);
+            encodeBlock(cb + mx * 8, chromaWidth, 1, tables, predictors[1], writer);
+            encodeBlock(cr + mx * 8, chromaWidth, 1, tables, predictors[2], writer);
+        }
+        writer.finish();
+    }
+
+    /**********************************
+     * Encodes the rows of one MCU row of a gray image.
+     **********************************/
+    static void encodeGrayRow(const Image& image, int32_t mcuRow, int32_t mcusX, const EncoderTables& tables,
+                              vector<uint8_t>& samples, vector<uint8_t>& out) {
+        const int32_t width = image.getWidth();
+        const int32_t paddedWidth = mcusX * 8;
+        for (int32_t i = 0; i < 8; ++i) {
+            const int32_t y = min(mcuRow * 8 + i, image.getHeight() - 1);
+            uint8_t* row = samples.data() + i * paddedWidth;
+            memcpy(row, image.getData().data() + static_cast<size_t>(y) * image.getStride(), width);
+            memset(row + width, row[width - 1], paddedWidth - width);
+        }
+        BitWriter writer(out);
+        int32_t predictor = 0;
+        for (int32_t mx = 0; mx < mcusX; ++mx) {
+            writer.reserve(512);
+            encodeBlock(samples.data() + mx * 8, paddedWidth, 0, tables, predictor, writer);
+        }
+        writer.finish();
+    }
+
+    /**********************************
+     * Transforms, quantizes and Huffman codes one block.
+     * @param samples The first sample of the block.
+     * @param stride Bytes between sample rows.
+     * @param table 0 for luma tables, 1 for chroma tables.
+     * @param tables The encoder tables.
+     * @param predictor DC value of the previous block of the component.
+     * @param writer The bit writer.
+     **********************************/
+    static void encodeBlock(const uint8_t* samples, size_t stride, int32_t table, const EncoderTables& tables,
+                            int32_t& predictor, BitWriter& writer) {
+        alignas(16) int16_t coefficients[64];
+        alignas(16) int16_t quantized[64];
+        forwardDct(samples, stride, coefficients);
+        // Quantize, baseline codes magnitudes of up to 10 bits
+        const float* reciprocals = tables.reciprocals[table];
+#ifdef __SSE2__
+        for (int32_t i = 0; i < 64; i += 8) {
+            const __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(coefficients + i));
+            const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16);
+            const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16);
+            const __m128i qLow = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), _mm_loadu_ps(reciprocals + i)));
+            const __m128i qHigh = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), _mm_loadu_ps(reciprocals + i + 4)));
+            const __m128i q = _mm_packs_epi32(qLow, qHigh);
+            _mm_store_si128(reinterpret_cast<__m128i*>(quantized + i),
+                            _mm_max_epi16(_mm_min_epi16(q, _mm_set1_epi16(1023)), _mm_set1_epi16(-1023)));
+        }
+#else
+        for (int32_t i = 0; i < 64; ++i) {
+            quantized[i] = static_cast<int16_t>(min(1023L, max(-1023L, lrintf(coefficients[i] * reciprocals[i]))));
+        }
+#endif
+        alignas(16) int16_t zigzag[64];
+        for (int32_t k = 0; k < 64; ++k) zigzag[k] = quantized[kZigzag[k]];
+
+        // Bit k set for every nonzero coefficient k
+        uint64_t nonzero = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (int32_t i = 0; i < 64; i += 16) {
+            const __m128i a = _mm_cmpeq_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(zigzag + i)), zero);
+            const __m128i b = _mm_cmpeq_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(zigzag + i + 8)), zero);
+            nonzero |= static_cast<uint64_t>(static_cast<uint16_t>(~_mm_movemask_epi8(_mm_packs_epi16(a, b)))) << i;
+        }
+#else
+        for (int32_t k = 0; k < 64; ++k) nonzero |= static_cast<uint64_t>(zigzag[k] != 0) << k;
+#endif
+
+        const HuffmanEncoder& dc = tables.dc[table];
+        const HuffmanEncoder& ac = tables.ac[table];
+        const int32_t difference = zigzag[0] - predictor;
+        predictor = zigzag[0];
+        putValue(difference, 0, dc, writer);
+
+        int32_t last = 0;
+        for (uint64_t remaining = nonzero & ~1ULL; remaining != 0; remaining &= remaining - 1) {
+            const int32_t k = __builtin_ctzll(remaining);
+            int32_t run = k - last - 1;
+            for (; run >= 16; run -= 16) writer.put(ac.codes[0xF0], ac.lengths[0xF0]);
+            putValue(zigzag[k], run << 4, ac, writer);
+            last = k;
+        }
+        if (last != 63) writer.put(ac.codes[0x00], ac.lengths[0x00]);
+    }
+
+    /**********************************
+     * Writes the code of a size category and the value bits in one put.
+     **********************************/
+    static void putValue(int32_t value, int32_t runBits, const HuffmanEncoder& table, BitWriter& writer) {
+        const uint32_t magnitude = static_cast<uint32_t>(value < 0 ? -value : value);
+        const int32_t size = magnitude == 0 ? 0 : 32 - __builtin_clz(magnitude);
+        const uint32_t bits = static_cast<uint32_t>(value < 0 ? value - 1 : value) & ((1u << size) - 1);
+        const int32_t symbol = runBits | size;
+        writer.put(static_cast<uint32_t>(table.codes[symbol]) << size | bits, table.lengths[symbol] + size);
+    }
+
+    /**********************************
+     * Parses a start of frame segment.
+     **********************************/
+    static void parseFrame(const uint8_t* segment, size_t size, Frame& frame) {
+        if (!frame.components.empty()) throw runtime_error("Error decodeJPEG: Multiple frames.");
+        if (size < 6 || segment[0] != 8) throw runtime_error("Error decodeJPEG: Only 8-bit samples are supported.");
+        frame.height = segment[1] << 8 | segment[2];
+        frame.width = segment[3] << 8 | segment[4];
+        const int32_t count = segment[5];
+        if (frame.width == 0 || frame.height == 0 ||
+            static_cast<int64_t>(frame.width) * frame.height > kMaxPixels) {
+            throw runtime_error("Error decodeJPEG: Invalid image size.");
+        }
+        if ((count != 1 && count != 3) || size < 6 + 3 * static_cast<size_t>(count)) {
+            throw runtime_error("Error decodeJPEG: Only gray and YCbCr files are supported.");
+        }
+        for (int32_t c = 0; c < count; ++c) {
+            Component component;
+            component.id = segment[6 + 3 * c];
+            component.h = segment[7 + 3 * c] >> 4;
+            component.v = segment[7 + 3 * c] & 15;
+            component.quant = segment[8 + 3 * c];
+            if (component.h < 1 || component.h > 2 || component.v < 1 || component.v > 2 || component.quant > 3) {
+                throw runtime_error("Error decodeJPEG: Unsupported sampling factors.");
+            }
+            frame.maxH = max(frame.maxH, component.h);
+            frame.maxV = max(frame.maxV, component.v);
+            frame.components.push_back(component);
+        }
+    }
+
+    /**********************************
+     * Parses a define Huffman table segment.
+     **********************************/
+    static void parseHuffmanTables(const uint8_t* segment, size_t size, Frame& frame) {
+        size_t p = 0;
+        while (p < size) {
+            if (p + 17 > size) throw runtime_error("Error decodeJPEG: Invalid Huffman table.");
+            const int32_t tableClass = segment[p] >> 4;
+            const int32_t id = segment[p] & 15;
+            if (tableClass > 1 || id > 3) throw runtime_error("Error decodeJPEG: Invalid Huffman table.");
+            const uint8_t* bits = segment + p + 1;
+            int32_t count = 0;
+            for (int32_t i = 0; i < 16; ++i) count += bits[i];
+            if (count > 256 || p + 17 + count > size) throw runtime_error("Error decodeJPEG: Invalid Huffman table.");
+            buildDecoder(bits, segment + p + 17, tableClass == 0 ? frame.dc[id] : frame.ac[id]);
+            p += 17 + count;
+        }
+    }
+
+    /**********************************
+     * Builds the lookup and canonical decoding tables of a Huffman table.
+     **********************************/
+    static void buildDecoder(const uint8_t* bits, const uint8_t* values, HuffmanDecoder& table) {
+        table = HuffmanDecoder();
+        int32_t code = 0;
+        int32_t k = 0;
+        for (int32_t length = 1; length <= 16; ++length) {
+            table.valueOffset[length] = k - code;
+            if (code + bits[length - 1] > 1 << length) throw runtime_error("Error decodeJPEG: Invalid Huffman table.");
+            for (int32_t i = 0; i < bits[length - 1]; ++i, ++code, ++k) {
+                if (length <= kFastBits) {
+                    const int32_t first = code << (kFastBits - length);
+                    for (int32_t j = 0; j < 1 << (kFastBits - length); ++j) {
+                        table.fast[first + j] = static_cast<uint16_t>(length << 8 | values[k]);
+                    }
+                }
+            }
+            table.maxCode[length] = bits[length - 1] > 0 ? code - 1 : -1;
+            code <<= 1;
+        }
+        table.maxCode[17] = INT32_MAX;
+        memcpy(table.values, values, k);
+        table.defined = true;
+    }
+
+    /**********************************
+     * Parses a define quantization table segment.
+     **********************************/
+    static void parseQuantTables(const uint8_t* segment, size_t size, Frame& frame) {
+        size_t p = 0;
+        while (p < size) {
+            const int32_t precision = segment[p] >> 4;
+            const int32_t id = segment[p] & 15;
+            const size_t bytes = precision == 0 ? 64 : 128;
+            if (precision > 1 || id > 3 || p + 1 + bytes > size) {
+                throw runtime_error("Error decodeJPEG: Invalid quantization table.");
+            }
+            for (int32_t k = 0; k < 64; ++k) {
+                frame.quant[id][kZigzag[k]] = precision == 0 ? segment[p + 1 + k]
+                                                             : static_cast<uint16_t>(segment[p + 1 + 2 * k] << 8 | segment[p + 2 + 2 * k]);
+            }
+            frame.quantDefined[id] = true;
+            p += 1 + bytes;
+        }
+    }
+
+    /**********************************
+     * Parses a start of scan segment and prepares the component planes.
+     **********************************/
+    static void parseScan(const uint8_t* segment, size_t size, Frame& frame) {
+        if (frame.components.empty()) throw runtime_error("Error decodeJPEG: Scan before frame header.");
+        const size_t count = size > 0 ? segment[0] : 0;
+        if (count != frame.components.size()) {
+            throw runtime_error("Error decodeJPEG: Multi-scan files are not supported.");
+        }
+        if (size < 4 + 2 * count || segment[1 + 2 * count] != 0 || segment[2 + 2 * count] != 63 || segment[3 + 2 * count] != 0) {
+            throw runtime_error("Error decodeJPEG: Only baseline and sequential Huffman files are supported.");
+        }
+        const int32_t mcusX = (frame.width + 8 * frame.maxH - 1) / (8 * frame.maxH);
+        const int32_t mcusY = (frame.height + 8 * frame.maxV - 1) / (8 * frame.maxV);
+        for (size_t i = 0; i < count; ++i) {
+            auto component = find_if(frame.components.begin(), frame.components.end(),
+                                     [&](const Component& c) { return c.id == segment[1 + 2 * i]; });
+            const int32_t index = static_cast<int32_t>(component - frame.components.begin());
+            if (component == frame.components.end() ||
+                find(frame.scanOrder.begin(), frame.scanOrder.end(), index) != frame.scanOrder.end()) {
+                throw runtime_error("Error decodeJPEG: Invalid scan component.");
+            }
+            frame.scanOrder.push_back(index);
+            component->dc = segment[2 + 2 * i] >> 4;
+            component->ac = segment[2 + 2 * i] & 15;
+            if (component->dc > 3 || component->ac > 3 || !frame.dc[component->dc].defined ||
+                !frame.ac[component->ac].defined || !frame.quantDefined[component->quant]) {
+                throw runtime_error("Error decodeJPEG: Missing table.");
+            }
+            if (frame.maxH % component->h != 0 || frame.maxV % component->v != 0) {
+                throw runtime_error("Error decodeJPEG: Unsupported sampling factors.");
+            }
+            component->width = (frame.width * component->h + frame.maxH - 1) / frame.maxH;
+            component->height = (frame.height * component->v + frame.maxV - 1) / frame.maxV;
+            component->stride = mcusX * component->h * 8;
+            component->plane.assign(static_cast<size_t>(component->stride) * mcusY * component->v * 8, 128);
+            dequantTable(frame.quant[component->quant], component->dequant);
+        }
+    }
+
+    /**********************************
+     * Decodes the entropy coded data of the scan and converts the planes.
+     * @param data The data following the scan header.
+     * @param size The number of bytes to the end of the file.
+     * @param frame The parsed frame.
+     * @return The decoded image.
+     **********************************/
+    static Image decodeScan(const uint8_t* data, size_t size, Frame& frame) {
+        // Split the data at restart markers, stop at any other marker
+        vector<pair<size_t, size_t>> intervals;
+        size_t start = 0, p = 0;
+        while (p < size) {
+            const uint8_t* next = static_cast<const uint8_t*>(memchr(data + p, 0xFF, size - p));
+            if (next == nullptr || next + 1 >= data + size) {
+                p = size;
+                break;
+            }
+            p = next - data;
+            const uint8_t code = data[p + 1];
+            if (code == 0x00) {
+                p += 2;
+            } else if (code >= 0xD0 && code <= 0xD7) {
+                intervals.push_back({start, p});
+                p += 2;
+                start = p;
+            } else if (code == 0xFF) {
+                ++p;
+            } else {
+                break;
+            }
+        }
+        intervals.push_back({start, p});
+
+        // Interleaved scans code whole MCUs, a single component scan codes its blocks in raster order
+        const bool interleaved = frame.components.size() > 1;
+        const Component& first = frame.components.front();
+        const int32_t mcusX = interleaved ? (frame.width + 8 * frame.maxH - 1) / (8 * frame.maxH) : (first.width + 7) / 8;
+        const int32_t mcusY = interleaved ? (frame.height + 8 * frame.maxV - 1) / (8 * frame.maxV) : (first.height + 7) / 8;
+        const int64_t mcuCount = static_cast<int64_t>(mcusX) * mcusY;
+        const int64_t interval = frame.restartInterval > 0 ? frame.restartInterval : mcuCount;
+        const int32_t usable = static_cast<int32_t>(min<int64_t>(intervals.size(), (mcuCount + interval - 1) / interval));
+
+        atomic<bool> corrupt{false};
+        Parallel::forRows(usable, [&](int32_t begin, int32_t end) {
+            for (int32_t i = begin; i < end && !corrupt.load(memory_order_relaxed); ++i) {
+                const int64_t firstMcu = i * interval;
+                BitReader reader(data + intervals[i].first, data + intervals[i].second);
+                if (!decodeInterval(reader, frame, interleaved, mcusX, firstMcu, min(mcuCount, firstMcu + interval))) {
+                    corrupt = true;
+                }
+            }
+        }, 1);
+        if (corrupt) throw runtime_error("Error decodeJPEG: Corrupt entropy coded data.");
+        return convert(frame);
+    }
+
+    /**********************************
+     * Decodes MCUs [firstMcu, endMcu) of one restart interval.
+     * @return False if the data is corrupt.
+     **********************************/
+    static bool decodeInterval(BitReader& reader, Frame& frame, bool interleaved, int32_t mcusX,
+                               int64_t firstMcu, int64_t endMcu) {
+        alignas(16) int16_t block[64] = {};
+        int32_t predictors[3] = {0, 0, 0};
+        for (int64_t mcu = firstMcu; mcu < endMcu; ++mcu) {
+            const int32_t mx = static_cast<int32_t>(mcu % mcusX);
+            const int32_t my = static_cast<int32_t>(mcu / mcusX);
+            for (size_t c = 0; c < frame.scanOrder.size(); ++c) {
+                Component& component = frame.components[frame.scanOrder[c]];
+                const int32_t blocksX = interleaved ? component.h : 1;
+                const int32_t blocksY = interleaved ? component.v : 1;
+                for (int32_t by = 0; by < blocksY; ++by) {
+                    for (int32_t bx = 0; bx < blocksX; ++bx) {
+                        int32_t last = 0;
+                        if (!decodeBlock(reader, frame.dc[component.dc], frame.ac[component.ac], component.dequant,
+                                         predictors[c], block, last)) {
+                            return false;
+                        }
+                        uint8_t* out = component.plane.data() +
+                                       static_cast<size_t>((my * blocksY + by) * 8) * component.stride + (mx * blocksX + bx) * 8;
+                        if (last == 0) {
+                            // Flat block, the IDCT of a lone DC coefficient
+                            const uint8_t value = static_cast<uint8_t>(min(255, max(0, min(32767, block[0] + 16 + (128 << 5)) >> 5)));
+                            for (int32_t i = 0; i < 8; ++i) memset(out + i * component.stride, value, 8);
+                            block[0] = 0;
+                        } else {
+                            inverseDct(block, out, component.stride);
+                            memset(block, 0, sizeof(block));
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**********************************
+     * Decodes the next Huffman symbol.
+     * @return The symbol, or -1 for an invalid code.
+     **********************************/
+    static int32_t decodeSymbol(BitReader& reader, const HuffmanDecoder& table) {
+        const uint16_t entry = table.fast[reader.peek(kFastBits)];
+        if (entry != 0) {
+            reader.skip(entry >> 8);
+            return entry & 0xFF;
+        }
+        const int32_t code = static_cast<int32_t>(reader.peek(16));
+        for (int32_t length = kFastBits + 1; length <= 16; ++length) {
+            const int32_t prefix = code >> (16 - length);
+            if (prefix <= table.maxCode[length]) {
+                reader.skip(length);
+                return table.values[(table.valueOffset[length] + prefix) & 0xFF];
+            }
+        }
+        return -1;
+    }
+
+    /**********************************
+     * Decodes and dequantizes the coefficients of one block into natural order.
+     * @param last Set to the zigzag position of the last coded coefficient.
+     * @return False if the data is corrupt.
+     **********************************/
+    static bool decodeBlock(BitReader& reader, const HuffmanDecoder& dc, const HuffmanDecoder& ac, const int32_t* dequant,
+                            int32_t& predictor, int16_t* block, int32_t& last) {
+        // A symbol and its value take at most 27 bits
+        if (reader.count < 32) reader.refill();
+        const int32_t size = decodeSymbol(reader, dc);
+        if (size < 0 || size > 11) return false;
+        predictor += reader.receive(size);
+        block[0] = dequantize(predictor, dequant[0]);
+        for (int32_t k = 1; k < 64; ++k) {
+            if (reader.count < 32) reader.refill();
+            const int32_t symbol = decodeSymbol(reader, ac);
+            if (symbol < 0) return false;
+            const int32_t run = symbol >> 4;
+            const int32_t bits = symbol & 15;
+            if (bits == 0) {
+                if (run != 15) break;
+                k += 15;
+                continue;
+            }
+            k += run;
+            if (k > 63) return false;
+            const int32_t position = kZigzag[k];
+            block[position] = dequantize(reader.receive(bits), dequant[position]);
+            last = k;
+        }
+        return true;
+    }
+
+    /**********************************
+     * Upsamples one image row of a subsampled component with the
+     * triangle filter, weights 3/4 and 1/4 in each direction.
+     * @param vertical Scratch of component.width + 10 values.
+     * @param out Row of at least width + 16 samples.
+     **********************************/
+    static void upsampleRow(const Component& component, int32_t y, int32_t ratioX, int32_t ratioY, int32_t width,
+                            vector<int16_t>& vertical, uint8_t* out) {
+        const int32_t cy = y / ratioY;
+        const int32_t chromaWidth = component.width;
+        const uint8_t* nearRow = component.plane.data() + static_cast<size_t>(cy) * component.stride;
+        const uint8_t* farRow = nearRow;
+        if (ratioY == 2) {
+            const int32_t fy = (y & 1) ? min(cy + 1, component.height - 1) : max(cy - 1, 0);
+            farRow = component.plane.data() + static_cast<size_t>(fy) * component.stride;
+        }
+        // 3 * near + far, or 4 * near, edge columns repeated at -1 and chromaWidth
+        int16_t* column = vertical.data() + 1;
+        for (int32_t x = 0; x < chromaWidth; ++x) column[x] = static_cast<int16_t>(3 * nearRow[x] + farRow[x]);
+        column[-1] = column[0];
+        column[chromaWidth] = column[chromaWidth - 1];
+        if (ratioX == 1) {
+            for (int32_t x = 0; x < width; ++x) out[x] = static_cast<uint8_t>((column[x] + 2) >> 2);
+            return;
+        }
+        int32_t x = 0;
+#ifdef __SSE2__
+        const __m128i bias = _mm_set1_epi16(8);
+        for (; x + 8 <= chromaWidth; x += 8) {
+            const __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + x));
+            const __m128i three = _mm_add_epi16(_mm_add_epi16(center, center), _mm_add_epi16(center, bias));
+            const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + x - 1));
+            const __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + x + 1));
+            const __m128i even = _mm_srli_epi16(_mm_add_epi16(three, left), 4);
+            const __m128i odd = _mm_srli_epi16(_mm_sub_epi16(_mm_add_epi16(three, right), _mm_set1_epi16(1)), 4);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * x),
+                             _mm_packus_epi16(_mm_unpacklo_epi16(even, odd), _mm_unpackhi_epi16(even, odd)));
+        }
+#endif
+        for (; x < chromaWidth; ++x) {
+            out[2 * x] = static_cast<uint8_t>((3 * column[x] + column[x - 1] + 8) >> 4);
+            out[2 * x + 1] = static_cast<uint8_t>((3 * column[x] + column[x + 1] + 7) >> 4);
+        }
+    }
+
+    /**********************************
+     * Converts one row of YCbCr samples to RGB24.
+     * Works in 2 fraction bits: R = Y + 1.402 Cr, G = Y - 0.344136 Cb
+     * - 0.714136 Cr, B = Y + 1.772 Cb, with Cb and Cr centered on 0.
+     **********************************/
+    static void convertRow(const uint8_t* luma, const uint8_t* cb, const uint8_t* cr, int32_t width,
+                           uint8_t* planar, uint8_t* out) {
+        int32_t x = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i center = _mm_set1_epi16(128);
+        const __m128i round = _mm_set1_epi16(2);
+        for (; x + 8 <= width; x += 8) {
+            const __m128i y4 = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(luma + x)), zero), 2);
+            const __m128i b4 = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + x)), zero), center), 2);
+            const __m128i r4 = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + x)), zero), center), 2);
+            const __m128i yr = _mm_add_epi16(y4, round);
+            const __m128i red = _mm_add_epi16(_mm_add_epi16(yr, r4), _mm_mulhi_epi16(r4, _mm_set1_epi16(kFix0402)));
+            const __m128i green = _mm_sub_epi16(_mm_add_epi16(_mm_sub_epi16(yr, r4), _mm_mulhi_epi16(r4, _mm_set1_epi16(kFix0286))),
+                                                _mm_mulhi_epi16(b4, _mm_set1_epi16(kFix0344)));
+            const __m128i blue = _mm_sub_epi16(_mm_add_epi16(yr, _mm_add_epi16(b4, b4)), _mm_mulhi_epi16(b4, _mm_set1_epi16(kFix0228)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(planar + x), _mm_packus_epi16(_mm_srai_epi16(red, 2), zero));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(planar + width + x), _mm_packus_epi16(_mm_srai_epi16(green, 2), zero));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(planar + 2 * width + x), _mm_packus_epi16(_mm_srai_epi16(blue, 2), zero));
+        }
+#endif
+        for (; x < width; ++x) {
+            const int32_t y4 = luma[x] * 4 + 2;
+            const int32_t b4 = (cb[x] - 128) * 4;
+            const int32_t r4 = (cr[x] - 128) * 4;
+            const int32_t red = y4 + r4 + ((r4 * kFix0402) >> 16);
+            const int32_t green = y4 - r4 + ((r4 * kFix0286) >> 16) - ((b4 * kFix0344) >> 16);
+            const int32_t blue = y4 + 2 * b4 - ((b4 * kFix0228) >> 16);
+            planar[x] = static_cast<uint8_t>(min(255, max(0, red >> 2)));
+            planar[width + x] = static_cast<uint8_t>(min(255, max(0, green >> 2)));
+            planar[2 * width + x] = static_cast<uint8_t>(min(255, max(0, blue >> 2)));
+        }
+        for (x = 0; x < width; ++x, out += 3) {
+            out[0] = planar[x];
+            out[1] = planar[width + x];
+            out[2] = planar[2 * width + x];
+        }
+    }
+
+    /**********************************
+     * Converts the decoded planes to a GRAYSCALE8 or RGB24 image.
+     **********************************/
+    static Image convert(const Frame& frame) {
+        const int32_t width = frame.width;
+        const int32_t height = frame.height;
+        if (frame.components.size() == 1) {
+            const Component& gray = frame.components.front();
+            vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+            uint8_t* out = pixels.data();
+            Parallel::forRows(height, [&](int32_t begin, int32_t end) {
+                for (int32_t y = begin; y < end; ++y) {
+                    memcpy(out + static_cast<size_t>(y) * width, gray.plane.data() + static_cast<size_t>(y) * gray.stride, width);
+                }
+            });
+            return Image(width, height, PixelFormat::GRAYSCALE8, std::move(pixels));
+        }
+
+        vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+        uint8_t* out = pixels.data();
+        Parallel::forRows(height, [&](int32_t begin, int32_t end) {
+            vector<uint8_t> rows[3];
+            for (vector<uint8_t>& row : rows) row.resize(width + 16);
+            vector<int16_t> vertical(width + 10);
+            vector<uint8_t> planar(static_cast<size_t>(width) * 3);
+            for (int32_t y = begin; y < end; ++y) {
+                const uint8_t* planes[3];
+                for (int32_t c = 0; c < 3; ++c) {
+                    const Component& component = frame.components[c];
+                    const int32_t ratioX = frame.maxH / component.h;
+                    const int32_t ratioY = frame.maxV / component.v;
+                    if (ratioX == 1 && ratioY == 1) {
+                        planes[c] = component.plane.data() + static_cast<size_t>(y) * component.stride;
+                    } else {
+                        upsampleRow(component, y, ratioX, ratioY, width, vertical, rows[c].data());
+                        planes[c] = rows[c].data();
+                    }
+                }
+                convertRow(planes[0], planes[1], planes[2], width, planar.data(), out + static_cast<size_t>(y) * width * 3);
+            }
+        });
+        return Image(width, height, PixelFormat::RGB24, std::move(pixels));
+    }
+};
+
+#endif // JPEG_H
@@ -0,0 +1,292 @@
+/**********************************
+ * @file lut3d.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the Lut3D class, a 3D color lookup table with
+ * tetrahedral interpolation.
+ *
+ * @details
+ * - Loads Adobe/Resolve `.cube` files (LUT_3D_SIZE, DOMAIN_MIN,
+ *   DOMAIN_MAX and TITLE keywords).
+ * - Lattice points are stored as 8.8 fixed point RGBX quadruplets with
+ *   red varying fastest, the eight corners of a cell are at most two
+ *   planes apart.
+ * - The lattice index and fraction of every input byte are precomputed
+ *   per channel, the domain is folded into these tables.
+ * - Interpolation is tetrahedral: four corners per pixel instead of the
+ *   eight of trilinear interpolation, with integer weights summing to 256.
+ * - apply() processes the image in parallel row bands.
+ *   https://en.wikipedia.org/wiki/3D_lookup_table
+ *
+ * Constraints:
+ * - 1D LUTs in cube files are not supported.
+ * - Lattice sizes from 2 to 256 points per axis.
+ **********************************/
+
+#ifndef LUT3D_H
+#define LUT3D_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "image.h"
+#include "parallel.h"
+
+using namespace std;
+
+class Lut3D {
+private:
+    int32_t size;                       // Lattice points per axis
+    vector<uint16_t> lattice;           // RGBX 8.8 fixed point, red fastest
+    array<array<uint8_t, 256>, 3> base;     // Lattice index of every byte, per channel
+    array<array<uint16_t, 256>, 3> frac;    // Fraction in [0, 256] of every byte, per channel
+
+public:
+    static const int32_t kMinSize = 2;      // Smallest lattice
+    static const int32_t kMaxSize = 256;    // Largest lattice
+
+    /**********************************
+     * Constructor.
+     * @param newSize Lattice points per axis.
+     * @param rgb Output colors in [0, 1], red varying fastest, size^3 triplets.
+     * @param domainMin Input value mapped to the first lattice point, per channel.
+     * @param domainMax Input value mapped to the last lattice point, per channel.
+     * @throws ImageException if the size or the number of values is invalid.
+     **********************************/
+    Lut3D(int32_t newSize, const vector<float>& rgb,
+          const array<float, 3>& domainMin = {0.0f, 0.0f, 0.0f},
+          const array<float, 3>& domainMax = {1.0f, 1.0f, 1.0f})
+        : size(newSize) {
+        if (size < kMinSize || size > kMaxSize) {
+            throw ImageException("Invalid 3D LUT: size must be between 2 and 256.");
+        }
+        const size_t points = static_cast<size_t>(size) * size * size;
+        if (rgb.size() != points * 3) {
+            throw ImageException("Invalid 3D LUT: expected size^3 RGB triplets.");
+        }
+
+        lattice.resize(points * 4, 0);
+        for (size_t i = 0; i < points; ++i) {
+            for (size_t channel = 0; channel < 3; ++channel) {
+                float value = std::clamp(rgb[i * 3 + channel], 0.0f, 1.0f);
+                lattice[i * 4 + channel] = static_cast<uint16_t>(value * 255.0f * 256.0f + 0.5f);
+            }
+        }
+
+        for (size_t channel = 0; channel < 3; ++channel) {
+            float range = domainMax[channel] - domainMin[channel];
+            if (range <= 0.0f) {
+                throw ImageException("Invalid 3D LUT: domain max must be above domain min.");
+            }
+            for (int32_t value = 0; value < 256; ++value) {
+                float normalized = std::clamp((value / 255.0f - domainMin[channel]) / range, 0.0f, 1.0f);
+                int32_t position = static_cast<int32_t>(normalized * (size - 1) * 256.0f + 0.5f);
+                int32_t index = std::min(position >> 8, size - 2);
+                base[channel][value] = static_cast<uint8_t>(index);
+                frac[channel][value] = static_cast<uint16_t>(position - (index << 8));
+            }
+        }
+    }
+
+    /**********************************
+     * Builds a LUT that leaves colors unchanged.
+     * @param newSize Lattice points per axis.
+     * @return The identity LUT.
+     **********************************/
+    static Lut3D identity(int32_t newSize) {
+        vector<float> rgb;
+        rgb.reserve(static_cast<size_t>(newSize) * newSize * newSize * 3);
+        for (int32_t b = 0; b < newSize; ++b) {
+            for (int32_t g = 0; g < newSize; ++g) {
+                for (int32_t r = 0; r < newSize; ++r) {
+                    rgb.push_back(r / float(newSize - 1));
+                    rgb.push_back(g / float(newSize - 1));
+                    rgb.push_back(b / float(newSize - 1));
+                }
+            }
+        }
+        return Lut3D(newSize, rgb);
+    }
+
+    /**********************************
+     * Parses a LUT in the `.cube` format.
+     * @param input Stream positioned at the start of the cube data.
+     * @return The parsed LUT.
+     * @throws runtime_error if the data is malformed.
+     **********************************/
+    static Lut3D fromCube(istream& input) {
+        int32_t cubeSize = 0;
+        array<float, 3> domainMin = {0.0f, 0.0f, 0.0f};
+        array<float, 3> domainMax = {1.0f, 1.0f, 1.0f};
+        vector<float> rgb;
+
+        string line;
+        while (getline(input, line)) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == string::npos || line[start] == '#') continue;
+
+            istringstream fields(line.substr(start));
+            if (isalpha(static_cast<unsigned char>(line[start]))) {
+                string keyword;
+                fields >> keyword;
+                if (keyword == "LUT_3D_SIZE") {
+                    fields >> cubeSize;
+                } else if (keyword == "DOMAIN_MIN") {
+                    fields >> domainMin[0] >> domainMin[1] >> domainMin[2];
+                } else if (keyword == "DOMAIN_MAX") {
+                    fields >> domainMax[0] >> domainMax[1] >> domainMax[2];
+                } else if (keyword == "LUT_1D_SIZE") {
+                    throw runtime_error("Error readCube: 1D LUTs are not supported.");
+                } else if (keyword != "TITLE" && keyword != "LUT_3D_INPUT_RANGE") {
+                    throw runtime_error("Error readCube: Unknown keyword " + keyword);
+                }
+                if (fields.fail()) {
+                    throw runtime_error("Error readCube: Malformed line: " + line);
+                }
+                continue;
+            }
+
+            float r, g, b;
+            if (!(fields >> r >> g >> b)) {
+                throw runtime_error("Error readCube: Malformed line: " + line);
+            }
+            rgb.push_back(r);
+            rgb.push_back(g);
+            rgb.push_back(b);
+        }
+
+        if (cubeSize < kMinSize || cubeSize > kMaxSize) {
+            throw runtime_error("Error readCube: Missing or invalid LUT_3D_SIZE.");
+        }
+        if (rgb.size() != static_cast<size_t>(cubeSize) * cubeSize * cubeSize * 3) {
+            throw runtime_error("Error readCube: Expected LUT_3D_SIZE^3 entries.");
+        }
+        return Lut3D(cubeSize, rgb, domainMin, domainMax);
+    }
+
+    /**********************************
+     * Loads a `.cube` file.
+     * @param filename The path to the file.
+     * @return The parsed LUT.
+     * @throws runtime_error if the file cannot be opened or is malformed.
+     **********************************/
+    static Lut3D fromCubeFile(const string& filename) {
+        ifstream file(filename);
+        if (!file) {
+            throw runtime_error("Error: Unable to open file " + filename);
+        }
+        return fromCube(file);
+    }
+
+    /**********************************
+     * Retrieves the number of lattice points per axis.
+     * @return The lattice size.
+     **********************************/
+    int32_t getSize() const {
+        return size;
+    }
+
+    /**********************************
+     * Maps a single color through the LUT.
+     * @param r Red input.
+     * @param g Green input.
+     * @param b Blue input.
+     * @param out Receives the red, green and blue outputs.
+     **********************************/
+    void lookup(uint8_t r, uint8_t g, uint8_t b, uint8_t* out) const {
+        const int32_t fr = frac[0][r];
+        const int32_t fg = frac[1][g];
+        const int32_t fb = frac[2][b];
+
+        // Corner offsets along each axis, in lattice elements
+        const size_t dr = 4;
+        const size_t dg = dr * size;
+        const size_t db = dg * size;
+        const uint16_t* c000 = lattice.data() + base[0][r] * dr + base[1][g] * dg + base[2][b] * db;
+
+        // Pick the tetrahedron containing the point and its two inner corners
+        size_t first, second;
+        int32_t w0, w1, w2, w3;
+        if (fr > fg) {
+            if (fg > fb) {          // r > g > b
+                first = dr; second = dr + dg;
+                w0 = 256 - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+            } else if (fr > fb) {   // r > b >= g
+                first = dr; second = dr + db;
+                w0 = 256 - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+            } else {                // b >= r > g
+                first = db; second = dr + db;
+                w0 = 256 - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+            }
+        } else {
+            if (fb > fg) {          // b > g >= r
+                first = db; second = dg + db;
+                w0 = 256 - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+            } else if (fb > fr) {   // g >= b > r
+                first = dg; second = dg + db;
+                w0 = 256 - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+            } else {                // g >= r >= b
+                first = dg; second = dr + dg;
+                w0 = 256 - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+            }
+        }
+
+        const uint16_t* c1 = c000 + first;
+        const uint16_t* c2 = c000 + second;
+        const uint16_t* c3 = c000 + dr + dg + db;
+        for (int32_t channel = 0; channel < 3; ++channel) {
+            uint32_t sum = w0 * c000[channel] + w1 * c1[channel] + w2 * c2[channel] + w3 * c3[channel];
+            out[channel] = static_cast<uint8_t>((sum + 32768) >> 16);
+        }
+    }
+
+    /**********************************
+     * Maps every pixel of an image through the LUT in place.
+     * Alpha, when present, is left untouched.
+     * @param image An RGB24 or RGBA32 image.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    void apply(Image& image) const {
+        bool matched = dispatchPixelFormat<PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                applyFormat<decltype(tag)::format>(image);
+            });
+        if (!matched) {
+            throw ImageException("Error Lut3D: Unsupported pixel format.");
+        }
+    }
+
+private:
+    /**********************************
+     * Maps an image of a known format, one row band per thread.
+     * @tparam F The pixel format of the image.
+     * @param image The image to process in place.
+     **********************************/
+    template <PixelFormat F>
+    void applyFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* pixelData = image.getData().data();
+        const size_t width = image.getWidth();
+        const size_t stride = image.getStride();
+
+        Parallel::forRows(image.getHeight(), [&](int32_t begin, int32_t end) {
+            for (int32_t row = begin; row < end; ++row) {
+                uint8_t* pixel = pixelData + row * stride;
+                for (size_t col = 0; col < width; ++col, pixel += Traits::bytesPerPixel) {
+                    uint8_t mapped[3];
+                    lookup(pixel[Traits::redOffset], pixel[Traits::greenOffset],
+                           pixel[Traits::blueOffset], mapped);
+                    pixel[Traits::redOffset] = mapped[0];
+                    pixel[Traits::greenOffset] = mapped[1];
+                    pixel[Traits::blueOffset] = mapped[2];
+                }
+            }
+        });
+    }
+};
+
+#endif // LUT3D_H
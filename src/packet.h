@@ -7,6 +7,12 @@
  * - Templated class for managing ownership of dynamically allocated data of type `T`.
  * - Includes support for timestamps in microseconds since epoch for unique identification.
  * - Handles dynamic casting to ensure type safety when accessing data.
+ * - Carries named attachments, data derived from the payload (e.g. an
+ *   integral image) that downstream calculators can reuse. Attachments
+ *   follow the packet when it is moved and are immutable once attached.
+ * - share() hands the same payload to another Packet. The mutable get<T>()
+ *   copies a shared payload first, so packets that only read it through
+ *   const access never copy.
  *
  * Constraints:
  * - The template type `T` must be copyable and movable for deep copies and moves.
@@ -21,7 +27,9 @@
 #include <sys/time.h>
 #include "packetholder.h"
 #include "packetexception.h"
+#include <map>
 #include <memory>
+#include <typeindex>
 
 using namespace std;
 
@@ -33,8 +41,9 @@ using namespace std;
  **********************************/
 class Packet {
 private:
-    unique_ptr<PacketHolderBase> holder;  // Polymorphic storage for any type
+    shared_ptr<PacketHolderBase> holder;  // Polymorphic storage for any type, copied on write when shared
     long long timestamp;                  // Timestamp in microseconds since epoch
+    map<string, shared_ptr<const PacketHolderBase>> attachments;  // Data derived from the payload
 
 public:
     /**********************************
@@ -56,12 +65,13 @@ public:
 
     /**********************************
      * Constructs a Packet by creating a PacketHolder for the given value.
+     * The value is moved into the holder, pass an rvalue to avoid any copy.
      * @tparam T The type of the provided value.
      * @param value The value to be stored in the Packet.
      **********************************/
     template <typename T>
-    Packet(const T value) {
-        holder = make_unique<PacketHolder<T>>(PacketHolder<T>(value));
+    Packet(T value) {
+        holder = make_unique<PacketHolder<T>>(std::move(value));
         timestamp = currentTimestamp();
     }
 
@@ -72,8 +82,10 @@ public:
     Packet(Packet&& other) {
         holder = std::move(other.holder);
         timestamp = other.timestamp;
+        attachments = std::move(other.attachments);
         other.holder = nullptr;
         other.timestamp = Packet::kInvalidTimestamp;
+        other.attachments.clear();
     }
 
     /**********************************
@@ -85,12 +97,29 @@ public:
         if (this != &other) {
             holder = std::move(other.holder);
             timestamp = other.timestamp;
+            attachments = std::move(other.attachments);
             other.holder = nullptr;
             other.timestamp = Packet::kInvalidTimestamp;
+            other.attachments.clear();
         }
         return *this;
     }
 
+    /**********************************
+     * Creates a Packet sharing the payload and attachments, with a new
+     * timestamp so it can be written to a port after the original. The
+     * payload is copied only when either Packet asks for mutable access.
+     * @return The shared Packet, an empty Packet if this one is empty.
+     **********************************/
+    Packet share() const {
+        Packet copy;
+        if (!holder) return copy;
+        copy.holder = holder;
+        copy.timestamp = currentTimestamp();
+        copy.attachments = attachments;
+        return copy;
+    }
+
     /**********************************
      * Overloaded output operator for printing the Packet's timestamp.
      * @param os The output stream.
@@ -157,10 +186,12 @@ public:
     }
 
     /**********************************
-     * Retrieves the data as a mutable reference.
+     * Retrieves the data as a mutable reference. A payload shared with
+     * another Packet (see share()) is copied first.
      * @tparam T The type of the data.
      * @return A mutable reference to the data.
-     * @throws PacketException if the data type does not match or the Packet is empty.
+     * @throws PacketException if the data type does not match, the Packet
+     *         is empty, or a shared payload is move-only.
      **********************************/
     template <typename T>
     T& get() {
@@ -171,9 +202,65 @@ public:
         if (!typedHolder) {
             throw PacketException("get<T> Invalid T type access in Packet");
         }
+        if (holder.use_count() > 1) {
+            holder = holder->clone();
+            typedHolder = static_cast<PacketHolder<T>*>(holder.get());
+        }
+        return typedHolder->get();
+    }
+
+    /**********************************
+     * Attaches data derived from the payload, replacing any previous
+     * attachment with the same key.
+     * @tparam T The type of the attachment.
+     * @param key Name of the attachment.
+     * @param value The attachment.
+     **********************************/
+    template <typename T>
+    void attach(const string& key, T value) {
+        attachments[key] = make_shared<const PacketHolder<T>>(std::move(value));
+    }
+
+    /**********************************
+     * Checks if an attachment exists.
+     * @param key Name of the attachment.
+     * @return True if the Packet carries the attachment.
+     **********************************/
+    bool hasAttachment(const string& key) const {
+        return attachments.find(key) != attachments.end();
+    }
+
+    /**********************************
+     * Retrieves an attachment.
+     * @tparam T The type of the attachment.
+     * @param key Name of the attachment.
+     * @return A constant reference to the attachment, valid while the Packet lives.
+     * @throws PacketException if the attachment is missing or of another type.
+     **********************************/
+    template <typename T>
+    const T& getAttachment(const string& key) const {
+        auto it = attachments.find(key);
+        if (it == attachments.end()) {
+            throw PacketException("getAttachment<T> No attachment " + key);
+        }
+        auto typedHolder = dynamic_cast<const PacketHolder<T>*>(it->second.get());
+        if (!typedHolder) {
+            throw PacketException("getAttachment<T> Invalid T type access in Packet");
+        }
         return typedHolder->get();
     }
 
+    /**********************************
+     * Retrieves the dynamic type of the payload, a key for per-type
+     * handlers such as the PacketSerializer registry.
+     * @return typeid(PacketHolder<T>) for a payload of type T,
+     *         typeid(void) for an empty Packet.
+     **********************************/
+    type_index getType() const {
+        if (!holder) return type_index(typeid(void));
+        return type_index(typeid(*holder));
+    }
+
     /***********************************
      *  Returns the timestamp of the packet
      ***********************************/
@@ -190,10 +277,10 @@ private:
      * returned twice.
      * @return A unique timestamp.
      **********************************/
-    long long currentTimestamp() {
+    static long long currentTimestamp() {
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
-        long long current = static_cast<long long>(ts.tv_sec) * 10000000LL + ts.tv_nsec;
+        long long current = static_cast<long long>(ts.tv_sec) * 1000000LL + ts.tv_nsec / 1000;
         if (current <= lastTimestamp) {
             current = lastTimestamp + 1;
         }
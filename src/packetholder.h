@@ -20,6 +20,7 @@
 #define PACKET_HOLDER_H
 
 #include <memory>
+#include <type_traits>
 #include "packetexception.h"  
 using namespace std;
 
@@ -34,6 +35,13 @@ public:
      * cleanup for derived classes.
      **********************************/
     virtual ~PacketHolderBase() = default;
+
+    /**********************************
+     * Creates a deep copy of the holder.
+     * @return A new holder owning a copy of the data.
+     * @throws PacketException if the data cannot be copied.
+     **********************************/
+    virtual unique_ptr<PacketHolderBase> clone() const = 0;
 };
 
 /**********************************
@@ -107,6 +115,19 @@ class PacketHolder : public PacketHolderBase {
          **********************************/
         ~PacketHolder() override = default;  
 
+        /**********************************
+         * Creates a deep copy of the holder.
+         * @return A new PacketHolder<T> owning a copy of the data.
+         * @throws PacketException if T is move-only.
+         **********************************/
+        unique_ptr<PacketHolderBase> clone() const override {
+            if constexpr (is_copy_constructible<T>::value) {
+                return make_unique<PacketHolder<T>>(*data);
+            } else {
+                throw PacketException("clone Payload type is not copyable");
+            }
+        }
+
         /**********************************
          * Retrieves the data as a constant reference.
          * @return A constant reference to the managed data.
@@ -0,0 +1,532 @@
+/**********************************
+ * @file packetrecording.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines PacketRecorder and PacketReplay, a file format to
+ * capture a packet stream and feed it back to a Scheduler.
+ *
+ * @details
+ * - PacketRecorder appends each packet as a record: a 16 byte header
+ *   (kind, type id, size, timestamp) followed by the payload serialized
+ *   by PacketSerializer. A type name is stored once, in a type record
+ *   before the first packet of that type.
+ * - close() appends an index (type names, then timestamp, offset, type
+ *   and size of every packet) and stores its offset in the file header,
+ *   so opening a recording reads the index instead of the whole file.
+ *   A recording that was never closed is still readable: the records
+ *   are scanned and a truncated last record is ignored.
+ * - PacketReplay replays a recording at its original timing, a packet
+ *   is released once as much time passed since the first one as in the
+ *   recording, or at maximum speed. Random access through the index
+ *   allows seeking to any packet.
+ * - PacketRecorder::writePacket() is an output callback and
+ *   PacketReplay::readPacket() an input callback for the Scheduler,
+ *   e.g. to capture a production stream and replay it as a
+ *   reproducible benchmark input.
+ *
+ * File layout (integers little endian):
+ * - Header: "PKTR", version (32 bits), index offset (64 bits, 0 if absent).
+ * - Record: kind (8 bits), reserved (8 bits), type id (16 bits),
+ *   payload size (32 bits), timestamp (64 bits), payload.
+ * - Index: "PIDX", type count (32 bits), for each type its name size
+ *   (16 bits) and name, packet count (64 bits), for each packet its
+ *   timestamp, record offset (64 bits), type id (16 bits), reserved
+ *   (16 bits) and payload size (32 bits).
+ *
+ * Constraints:
+ * - Payloads whose type is not registered with PacketSerializer are
+ *   skipped, attachments are not recorded.
+ * - Replayed packets get new timestamps, ports need increasing ones, the
+ *   recorded timestamps are available from PacketReplay.
+ **********************************/
+
+#ifndef PACKET_RECORDING_H
+#define PACKET_RECORDING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <vector>
+#include "packet.h"
+#include "packetexception.h"
+#include "packetserializer.h"
+
+using namespace std;
+
+/**********************************
+ * @enum ReplayMode
+ * @brief Selects how fast PacketReplay releases packets.
+ **********************************/
+enum class ReplayMode {
+    ORIGINAL_TIMING,    // Spaced as in the recording
+    MAX_SPEED           // As fast as they are read
+};
+
+/**********************************
+ * Constants of the recording file format.
+ **********************************/
+struct PacketRecordingFormat {
+    enum Kind : uint8_t {
+        TYPE = 1,
+        PACKET = 2,
+    };
+
+    static const uint32_t kVersion = 1;
+    static const size_t kHeaderBytes = 16;
+    static const size_t kRecordBytes = 16;
+    static const size_t kIndexEntryBytes = 24;
+    static const uint32_t kMaxTypes = 65535;
+    static const uint64_t kMaxPayloadBytes = 0xFFFFFFFFull;
+
+    static constexpr char kMagic[4] = {'P', 'K', 'T', 'R'};
+    static constexpr char kIndexMagic[4] = {'P', 'I', 'D', 'X'};
+};
+
+/**********************************
+ * @class PacketRecorder
+ * @brief Writes packets to a recording file.
+ **********************************/
+class PacketRecorder {
+private:
+    ofstream file;
+    map<type_index, uint16_t> typeIds;   // Ids of the types already named in the file
+    vector<string> typeNames;            // Names by id
+    struct IndexEntry {
+        long long timestamp;
+        uint64_t offset;
+        uint16_t type;
+        uint32_t size;
+    };
+    vector<IndexEntry> index;            // Every packet record, for close()
+    vector<uint8_t> buffer;              // Record being written
+    uint64_t offset = 0;                 // End of the file
+    size_t skipped = 0;                  // Packets that could not be serialized
+    bool closed = false;
+
+public:
+    /**********************************
+     * Constructor. Creates the file and writes its header.
+     * @param filename The path of the recording.
+     * @throws runtime_error if the file cannot be opened.
+     **********************************/
+    explicit PacketRecorder(const string& filename) : file(filename, ios::binary | ios::trunc) {
+        if (!file.is_open()) {
+            throw runtime_error("Error PacketRecorder: Unable to open file " + filename);
+        }
+        buffer.assign(PacketRecordingFormat::kMagic, PacketRecordingFormat::kMagic + 4);
+        PacketSerializer::putU32(buffer, PacketRecordingFormat::kVersion);
+        PacketSerializer::putU64(buffer, 0);
+        writeBuffer();
+    }
+
+    PacketRecorder(const PacketRecorder&) = delete;
+    PacketRecorder& operator=(const PacketRecorder&) = delete;
+
+    /**********************************
+     * Destructor. Writes the index, errors are dropped.
+     **********************************/
+    ~PacketRecorder() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    /**********************************
+     * Appends a packet with its own timestamp.
+     * @param packet The packet.
+     * @return False if the packet is empty or its payload type is not registered.
+     * @throws runtime_error if the recorder is closed or the write failed.
+     * @throws PacketException if the payload is too large.
+     **********************************/
+    bool record(const Packet& packet) {
+        return record(packet, packet.getTimestamp());
+    }
+
+    /**********************************
+     * Appends a packet with a given timestamp.
+     * @param packet The packet.
+     * @param timestamp Timestamp in microseconds stored with the packet.
+     * @return False if the packet is empty or its payload type is not registered.
+     * @throws runtime_error if the recorder is closed or the write failed.
+     * @throws PacketException if the payload is too large.
+     **********************************/
+    bool record(const Packet& packet, long long timestamp) {
+        if (closed) throw runtime_error("Error PacketRecorder: Recorder is closed.");
+        if (!packet.isValid() || !PacketSerializer::isRegistered(packet)) {
+            ++skipped;
+            return false;
+        }
+        const uint16_t type = typeId(packet);
+
+        buffer.clear();
+        putRecordHeader(PacketRecordingFormat::PACKET, type, 0, timestamp);
+        PacketSerializer::serialize(packet, buffer);
+        const uint64_t size = buffer.size() - PacketRecordingFormat::kRecordBytes;
+        if (size > PacketRecordingFormat::kMaxPayloadBytes) {
+            throw PacketException("record Payload of " + to_string(size) + " bytes is too large");
+        }
+        for (int i = 0; i < 4; ++i) buffer[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+        const uint64_t recordOffset = offset;
+        writeBuffer();
+        index.push_back(IndexEntry{timestamp, recordOffset, type, static_cast<uint32_t>(size)});
+        return true;
+    }
+
+    /**********************************
+     * Writes the index and closes the file. Further records throw.
+     * @throws runtime_error if the write failed.
+     **********************************/
+    void close() {
+        if (closed) return;
+        closed = true;
+        const uint64_t indexOffset = offset;
+        buffer.assign(PacketRecordingFormat::kIndexMagic, PacketRecordingFormat::kIndexMagic + 4);
+        PacketSerializer::putU32(buffer, static_cast<uint32_t>(typeNames.size()));
+        for (const string& name : typeNames) {
+            buffer.push_back(static_cast<uint8_t>(name.size()));
+            buffer.push_back(static_cast<uint8_t>(name.size() >> 8));
+            buffer.insert(buffer.end(), name.begin(), name.end());
+        }
+        PacketSerializer::putU64(buffer, index.size());
+        for (const IndexEntry& entry : index) {
+            PacketSerializer::putU64(buffer, static_cast<uint64_t>(entry.timestamp));
+            PacketSerializer::putU64(buffer, entry.offset);
+            PacketSerializer::putU32(buffer, entry.type);
+            PacketSerializer::putU32(buffer, entry.size);
+        }
+        writeBuffer();
+
+        // The index is only trusted once the header points at it
+        buffer.clear();
+        PacketSerializer::putU64(buffer, indexOffset);
+        file.seekp(8);
+        writeBuffer();
+        file.close();
+        if (file.fail()) {
+            throw runtime_error("Error PacketRecorder: Unable to write the index.");
+        }
+    }
+
+    /**********************************
+     * Retrieves the number of packets recorded.
+     **********************************/
+    size_t getRecordedCount() const { return index.size(); }
+
+    /**********************************
+     * Retrieves the number of packets skipped by record().
+     **********************************/
+    size_t getSkippedCount() const { return skipped; }
+
+    /**********************************
+     * Output callback for the Scheduler, records every output packet.
+     * @param packet The output packet.
+     * @param recorder The PacketRecorder.
+     **********************************/
+    static void writePacket(const Packet& packet, void* recorder) {
+        static_cast<PacketRecorder*>(recorder)->record(packet);
+    }
+
+private:
+    uint16_t typeId(const Packet& packet) {
+        auto found = typeIds.find(packet.getType());
+        if (found != typeIds.end()) return found->second;
+
+        const string& name = PacketSerializer::getTypeName(packet);
+        if (typeNames.size() >= PacketRecordingFormat::kMaxTypes || name.size() > 0xFFFF) {
+            throw PacketException("record Too many types or type name too long");
+        }
+        const uint16_t id = static_cast<uint16_t>(typeNames.size());
+        buffer.clear();
+        putRecordHeader(PacketRecordingFormat::TYPE, id, static_cast<uint32_t>(name.size()), 0);
+        buffer.insert(buffer.end(), name.begin(), name.end());
+        writeBuffer();
+        typeIds.emplace(packet.getType(), id);
+        typeNames.push_back(name);
+        return id;
+    }
+
+    void putRecordHeader(uint8_t kind, uint16_t type, uint32_t size, long long timestamp) {
+        buffer.push_back(kind);
+        buffer.push_back(0);
+        buffer.push_back(static_cast<uint8_t>(type));
+        buffer.push_back(static_cast<uint8_t>(type >> 8));
+        PacketSerializer::putU32(buffer, size);
+        PacketSerializer::putU64(buffer, static_cast<uint64_t>(timestamp));
+    }
+
+    void writeBuffer() {
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        if (file.fail()) {
+            throw runtime_error("Error PacketRecorder: Write failed.");
+        }
+        offset += buffer.size();
+    }
+};
+
+/**********************************
+ * @class PacketReplay
+ * @brief Reads a recording back as a packet source.
+ **********************************/
+class PacketReplay {
+private:
+    ifstream file;
+    vector<string> typeNames;            // Names by type id
+    struct IndexEntry {
+        long long timestamp;
+        uint64_t offset;
+        uint16_t type;
+        uint32_t size;
+    };
+    vector<IndexEntry> index;            // Every packet of the recording
+    vector<uint8_t> buffer;              // Payload being decoded
+    size_t position = 0;                 // Next packet
+    ReplayMode mode;
+    bool started = false;                // The clock runs from the first packet
+    chrono::steady_clock::time_point startTime;
+    long long startTimestamp = 0;
+
+public:
+    /**********************************
+     * Constructor. Opens a recording and loads its index.
+     * @param filename The path of the recording.
+     * @param replayMode Timing of next() and readPacket().
+     * @throws runtime_error if the file cannot be read or is not a recording.
+     **********************************/
+    explicit PacketReplay(const string& filename, ReplayMode replayMode = ReplayMode::ORIGINAL_TIMING)
+        : file(filename, ios::binary), mode(replayMode) {
+        if (!file.is_open()) {
+            throw runtime_error("Error PacketReplay: Unable to open file " + filename);
+        }
+        uint8_t header[PacketRecordingFormat::kHeaderBytes];
+        if (!readAt(0, header, sizeof(header)) || memcmp(header, PacketRecordingFormat::kMagic, 4) != 0) {
+            throw runtime_error("Error PacketReplay: Not a recording " + filename);
+        }
+        if (PacketSerializer::getU32(header + 4) != PacketRecordingFormat::kVersion) {
+            throw runtime_error("Error PacketReplay: Unsupported version in " + filename);
+        }
+        const uint64_t indexOffset = PacketSerializer::getU64(header + 8);
+        if (indexOffset == 0 || !loadIndex(indexOffset)) {
+            scanRecords();
+        }
+    }
+
+    PacketReplay(const PacketReplay&) = delete;
+    PacketReplay& operator=(const PacketReplay&) = delete;
+
+    /**********************************
+     * Retrieves the number of packets in the recording.
+     **********************************/
+    size_t size() const { return index.size(); }
+
+    /**********************************
+     * Retrieves the recorded timestamp of a packet.
+     * @param i Packet number, below size().
+     **********************************/
+    long long getTimestamp(size_t i) const { return index.at(i).timestamp; }
+
+    /**********************************
+     * Retrieves the type name of a packet.
+     * @param i Packet number, below size().
+     **********************************/
+    const string& getTypeName(size_t i) const { return typeNames.at(index.at(i).type); }
+
+    /**********************************
+     * Retrieves the recorded duration, from the first to the last packet.
+     * @return Microseconds, 0 for fewer than two packets.
+     **********************************/
+    long long getDuration() const {
+        return index.size() < 2 ? 0 : index.back().timestamp - index.front().timestamp;
+    }
+
+    /**********************************
+     * Decodes a packet, independently of the replay position.
+     * @param i Packet number, below size().
+     * @return The packet, with a new timestamp.
+     * @throws runtime_error if the record cannot be read.
+     * @throws PacketException if the type is not registered or the payload is malformed.
+     **********************************/
+    Packet get(size_t i) {
+        const IndexEntry& entry = index.at(i);
+        buffer.resize(entry.size);
+        if (!readAt(entry.offset + PacketRecordingFormat::kRecordBytes, buffer.data(), entry.size)) {
+            throw runtime_error("Error PacketReplay: Unable to read packet " + to_string(i));
+        }
+        return PacketSerializer::deserialize(typeNames[entry.type], buffer.data(), buffer.size());
+    }
+
+    /**********************************
+     * Moves the replay position, the timing restarts from that packet.
+     * @param i Packet number, size() ends the replay.
+     **********************************/
+    void seek(size_t i) {
+        position = min(i, index.size());
+        started = false;
+    }
+
+    /**********************************
+     * Retrieves the replay position, the number of the next packet.
+     **********************************/
+    size_t tell() const { return position; }
+
+    /**********************************
+     * Checks if every packet was replayed.
+     **********************************/
+    bool isFinished() const { return position >= index.size(); }
+
+    /**********************************
+     * Changes the timing, the clock restarts from the next packet.
+     * @param replayMode The new mode.
+     **********************************/
+    void setMode(ReplayMode replayMode) {
+        mode = replayMode;
+        started = false;
+    }
+
+    /**********************************
+     * Replays the next packet, waiting until it is due.
+     * @param packet Receives the packet.
+     * @param timestamp Receives its recorded timestamp.
+     * @return False once every packet was replayed.
+     * @throws runtime_error, PacketException as get().
+     **********************************/
+    bool next(Packet& packet, long long& timestamp) {
+        if (isFinished()) return false;
+        const long long wait = microsecondsUntilDue();
+        if (wait > 0) this_thread::sleep_for(chrono::microseconds(wait));
+        return take(packet, timestamp);
+    }
+
+    /**********************************
+     * Replays the next packet if it is due, without waiting.
+     * @param packet Receives the packet.
+     * @param timestamp Receives its recorded timestamp.
+     * @return False if no packet is due or every packet was replayed.
+     * @throws runtime_error, PacketException as get().
+     **********************************/
+    bool poll(Packet& packet, long long& timestamp) {
+        if (isFinished() || microsecondsUntilDue() > 0) return false;
+        return take(packet, timestamp);
+    }
+
+    /**********************************
+     * Input callback for the Scheduler, returns the next packet once it
+     * is due.
+     * @param replay The PacketReplay.
+     * @return The packet, or an empty Packet if none is due.
+     **********************************/
+    static Packet readPacket(void* replay) {
+        Packet packet;
+        long long timestamp;
+        static_cast<PacketReplay*>(replay)->poll(packet, timestamp);
+        return packet;
+    }
+
+private:
+    bool take(Packet& packet, long long& timestamp) {
+        timestamp = index[position].timestamp;
+        packet = get(position);
+        ++position;
+        return true;
+    }
+
+    // Starts the clock on the first packet, 0 once the next packet is due
+    long long microsecondsUntilDue() {
+        if (mode == ReplayMode::MAX_SPEED) return 0;
+        const auto now = chrono::steady_clock::now();
+        if (!started) {
+            started = true;
+            startTime = now;
+            startTimestamp = index[position].timestamp;
+            return 0;
+        }
+        const long long elapsed = chrono::duration_cast<chrono::microseconds>(now - startTime).count();
+        return index[position].timestamp - startTimestamp - elapsed;
+    }
+
+    bool readAt(uint64_t offset, uint8_t* out, size_t size) {
+        file.clear();
+        file.seekg(static_cast<streamoff>(offset));
+        file.read(reinterpret_cast<char*>(out), static_cast<streamsize>(size));
+        return static_cast<size_t>(file.gcount()) == size;
+    }
+
+    // Reads the index written by close(), false if it is damaged
+    bool loadIndex(uint64_t indexOffset) {
+        file.clear();
+        file.seekg(0, ios::end);
+        const uint64_t end = static_cast<uint64_t>(file.tellg());
+        if (indexOffset > end) return false;
+        vector<uint8_t> bytes(end - indexOffset);
+        if (!readAt(indexOffset, bytes.data(), bytes.size())) return false;
+
+        size_t at = 0;
+        auto has = [&](size_t count) { return bytes.size() - at >= count; };
+        if (!has(8) || memcmp(bytes.data(), PacketRecordingFormat::kIndexMagic, 4) != 0) return false;
+        const uint32_t typeCount = PacketSerializer::getU32(bytes.data() + 4);
+        at = 8;
+        vector<string> names;
+        for (uint32_t i = 0; i < typeCount; ++i) {
+            if (!has(2)) return false;
+            const size_t length = bytes[at] | bytes[at + 1] << 8;
+            at += 2;
+            if (!has(length)) return false;
+            names.emplace_back(reinterpret_cast<const char*>(bytes.data() + at), length);
+            at += length;
+        }
+        if (!has(8)) return false;
+        const uint64_t count = PacketSerializer::getU64(bytes.data() + at);
+        at += 8;
+        if ((bytes.size() - at) / PacketRecordingFormat::kIndexEntryBytes < count) return false;
+
+        vector<IndexEntry> entries(count);
+        for (IndexEntry& entry : entries) {
+            const uint8_t* in = bytes.data() + at;
+            entry.timestamp = static_cast<long long>(PacketSerializer::getU64(in));
+            entry.offset = PacketSerializer::getU64(in + 8);
+            entry.type = static_cast<uint16_t>(PacketSerializer::getU32(in + 16));
+            entry.size = PacketSerializer::getU32(in + 20);
+            if (entry.type >= names.size() || entry.offset + PacketRecordingFormat::kRecordBytes + entry.size > indexOffset) {
+                return false;
+            }
+            at += PacketRecordingFormat::kIndexEntryBytes;
+        }
+        typeNames = std::move(names);
+        index = std::move(entries);
+        return true;
+    }
+
+    // Rebuilds the index from the records, up to the first incomplete one
+    void scanRecords() {
+        typeNames.clear();
+        index.clear();
+        uint64_t offset = PacketRecordingFormat::kHeaderBytes;
+        uint8_t header[PacketRecordingFormat::kRecordBytes];
+        while (readAt(offset, header, sizeof(header))) {
+            const uint16_t type = static_cast<uint16_t>(header[2] | header[3] << 8);
+            const uint32_t size = PacketSerializer::getU32(header + 4);
+            const long long timestamp = static_cast<long long>(PacketSerializer::getU64(header + 8));
+            if (header[0] == PacketRecordingFormat::TYPE && type == typeNames.size()) {
+                string name(size, '\0');
+                if (!readAt(offset + sizeof(header), reinterpret_cast<uint8_t*>(&name[0]), size)) break;
+                typeNames.push_back(std::move(name));
+            } else if (header[0] == PacketRecordingFormat::PACKET && type < typeNames.size()) {
+                // The payload must be complete
+                uint8_t last;
+                if (size > 0 && !readAt(offset + sizeof(header) + size - 1, &last, 1)) break;
+                index.push_back(IndexEntry{timestamp, offset, type, size});
+            } else {
+                break;
+            }
+            offset += sizeof(header) + size;
+        }
+    }
+};
+
+#endif // PACKET_RECORDING_H
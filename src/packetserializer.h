@@ -0,0 +1,266 @@
+/**********************************
+ * @file packetserializer.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines PacketSerializer, a registry of payload types that can
+ * be written to and read back from bytes.
+ *
+ * @details
+ * - Each payload type is registered once with a name and a pair of
+ *   functions: one appends the value to a byte buffer, the other
+ *   rebuilds the value from bytes.
+ * - Packets are matched to their serializer by the dynamic type of
+ *   their payload (Packet::getType()), a single map lookup.
+ * - Built-in types: int ("int32"), long long ("int64"), float
+ *   ("float32"), double ("float64"), bool ("bool"), string ("string"),
+ *   vector<uint8_t> ("bytes") and Image ("Image").
+ * - User types are added with registerType<T>(), e.g. at the start of
+ *   main(), before anything is recorded or replayed.
+ *
+ * Constraints:
+ * - Registration is not synchronized with lookups, register every type
+ *   before the threads that serialize packets start.
+ * - Only the payload is serialized, the timestamp and attachments are not.
+ * - Integers are little endian in the serialized bytes.
+ **********************************/
+
+#ifndef PACKET_SERIALIZER_H
+#define PACKET_SERIALIZER_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <typeindex>
+#include <vector>
+#include "image.h"
+#include "packet.h"
+#include "packetexception.h"
+
+using namespace std;
+
+/**********************************
+ * @class PacketSerializer
+ * @brief Registry of serializable payload types.
+ **********************************/
+class PacketSerializer {
+private:
+    struct Entry {
+        string name;
+        type_index type;
+        function<void(const Packet&, vector<uint8_t>&)> write;
+        function<Packet(const uint8_t*, size_t)> read;
+    };
+
+    map<type_index, Entry> byType;              // Entries by payload type
+    map<string, const Entry*> byName;           // The same entries by name
+
+public:
+    /**********************************
+     * Registers a payload type, replacing a previous registration of T.
+     * @tparam T The payload type.
+     * @param name Name stored with serialized values, unique per type.
+     * @param write Appends a value to a byte buffer.
+     * @param read Rebuilds a value from the bytes written by write.
+     *        Throws PacketException on malformed bytes.
+     * @throws PacketException if the name belongs to another type.
+     **********************************/
+    template <typename T>
+    static void registerType(const string& name, void (*write)(const T&, vector<uint8_t>&),
+                             T (*read)(const uint8_t*, size_t)) {
+        instance().add<T>(name, write, read);
+    }
+
+    /**********************************
+     * Checks if the payload of a Packet can be serialized.
+     * @param packet The packet.
+     * @return True if its payload type is registered.
+     **********************************/
+    static bool isRegistered(const Packet& packet) {
+        return instance().byType.count(packet.getType()) > 0;
+    }
+
+    /**********************************
+     * Retrieves the registered name of a Packet payload.
+     * @param packet The packet.
+     * @return The name given to registerType().
+     * @throws PacketException if the payload type is not registered.
+     **********************************/
+    static const string& getTypeName(const Packet& packet) {
+        return find(packet).name;
+    }
+
+    /**********************************
+     * Appends the serialized payload of a Packet to a buffer.
+     * @param packet The packet.
+     * @param out Buffer the bytes are appended to.
+     * @throws PacketException if the packet is empty or its type not registered.
+     **********************************/
+    static void serialize(const Packet& packet, vector<uint8_t>& out) {
+        find(packet).write(packet, out);
+    }
+
+    /**********************************
+     * Rebuilds a Packet from serialized bytes. The Packet gets a new timestamp.
+     * @param name Registered name of the payload type.
+     * @param data Bytes written by serialize().
+     * @param size Number of bytes.
+     * @return The packet.
+     * @throws PacketException if the name is unknown or the bytes are malformed.
+     **********************************/
+    static Packet deserialize(const string& name, const uint8_t* data, size_t size) {
+        const PacketSerializer& registry = instance();
+        auto named = registry.byName.find(name);
+        if (named == registry.byName.end()) {
+            throw PacketException("deserialize Unknown type " + name);
+        }
+        return named->second->read(data, size);
+    }
+
+    // Little endian helpers for serializers
+
+    static void putU32(vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    static void putU64(vector<uint8_t>& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    static uint32_t getU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = value << 8 | in[i];
+        return value;
+    }
+
+    static uint64_t getU64(const uint8_t* in) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = value << 8 | in[i];
+        return value;
+    }
+
+    /**********************************
+     * Checks the size of serialized bytes.
+     * @param size Number of bytes received by a reader.
+     * @param expected Number of bytes the reader needs.
+     * @param name Type name for the error message.
+     * @throws PacketException if the sizes differ.
+     **********************************/
+    static void expectSize(size_t size, size_t expected, const string& name) {
+        if (size != expected) {
+            throw PacketException("deserialize Malformed " + name + " of " + to_string(size) + " bytes");
+        }
+    }
+
+private:
+    // The built-in types
+    PacketSerializer() {
+        add<int>("int32",
+            [](const int& value, vector<uint8_t>& out) { putU32(out, static_cast<uint32_t>(value)); },
+            [](const uint8_t* data, size_t size) {
+                expectSize(size, 4, "int32");
+                return static_cast<int>(getU32(data));
+            });
+        add<long long>("int64",
+            [](const long long& value, vector<uint8_t>& out) { putU64(out, static_cast<uint64_t>(value)); },
+            [](const uint8_t* data, size_t size) {
+                expectSize(size, 8, "int64");
+                return static_cast<long long>(getU64(data));
+            });
+        add<float>("float32",
+            [](const float& value, vector<uint8_t>& out) {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                putU32(out, bits);
+            },
+            [](const uint8_t* data, size_t size) {
+                expectSize(size, 4, "float32");
+                const uint32_t bits = getU32(data);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                return value;
+            });
+        add<double>("float64",
+            [](const double& value, vector<uint8_t>& out) {
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                putU64(out, bits);
+            },
+            [](const uint8_t* data, size_t size) {
+                expectSize(size, 8, "float64");
+                const uint64_t bits = getU64(data);
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                return value;
+            });
+        add<bool>("bool",
+            [](const bool& value, vector<uint8_t>& out) { out.push_back(value ? 1 : 0); },
+            [](const uint8_t* data, size_t size) {
+                expectSize(size, 1, "bool");
+                return data[0] != 0;
+            });
+        add<string>("string",
+            [](const string& value, vector<uint8_t>& out) { out.insert(out.end(), value.begin(), value.end()); },
+            [](const uint8_t* data, size_t size) { return string(reinterpret_cast<const char*>(data), size); });
+        add<vector<uint8_t>>("bytes",
+            [](const vector<uint8_t>& value, vector<uint8_t>& out) { out.insert(out.end(), value.begin(), value.end()); },
+            [](const uint8_t* data, size_t size) { return vector<uint8_t>(data, data + size); });
+        add<Image>("Image", writeImage, readImage);
+    }
+
+    static PacketSerializer& instance() {
+        static PacketSerializer registry;
+        return registry;
+    }
+
+    template <typename T>
+    void add(const string& name, void (*write)(const T&, vector<uint8_t>&), T (*read)(const uint8_t*, size_t)) {
+        const type_index type(typeid(PacketHolder<T>));
+        auto named = byName.find(name);
+        if (named != byName.end() && named->second->type != type) {
+            throw PacketException("registerType Name " + name + " is already registered");
+        }
+        auto previous = byType.find(type);
+        if (previous != byType.end()) {
+            byName.erase(previous->second.name);
+            byType.erase(previous);
+        }
+        Entry entry{name, type,
+                    [write](const Packet& packet, vector<uint8_t>& out) { write(packet.get<T>(), out); },
+                    [read](const uint8_t* data, size_t size) { return Packet(read(data, size)); }};
+        auto added = byType.emplace(type, std::move(entry)).first;
+        byName[name] = &added->second;
+    }
+
+    static const Entry& find(const Packet& packet) {
+        if (!packet.isValid()) {
+            throw PacketException("serialize Packet is empty");
+        }
+        const PacketSerializer& registry = instance();
+        auto found = registry.byType.find(packet.getType());
+        if (found == registry.byType.end()) {
+            throw PacketException("serialize Payload type is not registered");
+        }
+        return found->second;
+    }
+
+    // Image: width, height, format (32 bits), then the pixel or compressed data
+    static void writeImage(const Image& image, vector<uint8_t>& out) {
+        putU32(out, static_cast<uint32_t>(image.getWidth()));
+        putU32(out, static_cast<uint32_t>(image.getHeight()));
+        putU32(out, static_cast<uint32_t>(image.getFormat()));
+        out.insert(out.end(), image.getData().begin(), image.getData().end());
+    }
+
+    static Image readImage(const uint8_t* data, size_t size) {
+        if (size < 12) expectSize(size, 12, "Image");
+        try {
+            return Image(static_cast<int32_t>(getU32(data)), static_cast<int32_t>(getU32(data + 4)),
+                         static_cast<PixelFormat>(getU32(data + 8)), vector<uint8_t>(data + 12, data + size));
+        } catch (const ImageException& e) {
+            throw PacketException(string("deserialize Malformed Image: ") + e.what());
+        }
+    }
+};
+
+#endif // PACKET_SERIALIZER_H
@@ -0,0 +1,190 @@
+/**********************************
+ * @file parallel.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the Parallel class, which splits image rows into bands
+ * processed by a shared pool of worker threads.
+ *
+ * @details
+ * - Workers are started once and parked on a condition variable, a
+ *   call costs a wake-up instead of a thread creation.
+ * - The calling thread processes bands too and returns when every
+ *   band is done.
+ * - Bands are contiguous row ranges, so each worker streams through
+ *   its own part of the image.
+ *
+ * Usage:
+ * - Parallel::forRows(height, [&](int32_t begin, int32_t end) { ... });
+ *
+ * Constraints:
+ * - Calls from inside a band run serially on the calling thread.
+ * - Concurrent calls from different threads are serialized.
+ **********************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class Parallel {
+private:
+    /**********************************
+     * @class Pool
+     * @brief Worker threads sharing one job at a time.
+     **********************************/
+    class Pool {
+    private:
+        vector<thread> workers;                         // Worker threads
+        mutex submitLock;                               // Serializes callers
+        mutex lock;                                     // Protects the job state
+        condition_variable wake;                        // Workers wait for a job here
+        condition_variable done;                        // The caller waits for the bands here
+        const function<void(int32_t)>* job = nullptr;   // Runs one band, owned by run()
+        int32_t bandCount = 0;                          // Bands of the current job
+        atomic<int32_t> nextBand{0};                    // Next band to claim
+        int32_t pendingBands = 0;                       // Bands not finished yet
+        int32_t activeWorkers = 0;                      // Workers claiming bands
+        unsigned long long generation = 0;              // Bumped for every job
+        bool stopping = false;                          // Set on destruction
+
+    public:
+        explicit Pool(int32_t workerCount) {
+            for (int32_t i = 0; i < workerCount; ++i) {
+                workers.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ~Pool() {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        int32_t size() const {
+            return static_cast<int32_t>(workers.size()) + 1;
+        }
+
+        /**********************************
+         * Runs bands [0, count) on the workers and the calling thread.
+         * @param count Number of bands.
+         * @param runBand Callable taking the band index.
+         **********************************/
+        void run(int32_t count, const function<void(int32_t)>& runBand) {
+            lock_guard<mutex> submit(submitLock);
+            {
+                unique_lock<mutex> guard(lock);
+                // A worker woken late for the previous job may still be claiming
+                done.wait(guard, [this] { return activeWorkers == 0; });
+                job = &runBand;
+                bandCount = count;
+                pendingBands = count;
+                nextBand.store(0);
+                generation++;
+            }
+            wake.notify_all();
+
+            insideBand() = true;
+            claimBands(runBand, count);
+            insideBand() = false;
+
+            unique_lock<mutex> guard(lock);
+            done.wait(guard, [this] { return pendingBands == 0 && activeWorkers == 0; });
+            job = nullptr;
+            bandCount = 0;
+        }
+
+    private:
+        void workerLoop() {
+            unsigned long long seen = 0;
+            insideBand() = true;
+            while (true) {
+                const function<void(int32_t)>* current;
+                int32_t count;
+                {
+                    // The job is read under the lock, run() only replaces it once no worker is active
+                    unique_lock<mutex> guard(lock);
+                    wake.wait(guard, [&] { return stopping || generation != seen; });
+                    if (stopping) return;
+                    seen = generation;
+                    current = job;
+                    count = bandCount;
+                    activeWorkers++;
+                }
+                if (current) claimBands(*current, count);
+                lock_guard<mutex> guard(lock);
+                activeWorkers--;
+                if (pendingBands == 0 && activeWorkers == 0) done.notify_all();
+            }
+        }
+
+        void claimBands(const function<void(int32_t)>& runBand, int32_t count) {
+            int32_t finished = 0;
+            for (int32_t band = nextBand.fetch_add(1); band < count; band = nextBand.fetch_add(1)) {
+                runBand(band);
+                finished++;
+            }
+            if (finished > 0) {
+                lock_guard<mutex> guard(lock);
+                pendingBands -= finished;
+                if (pendingBands == 0 && activeWorkers == 0) done.notify_all();
+            }
+        }
+    };
+
+    static Pool& pool() {
+        static Pool instance(max(1, static_cast<int32_t>(thread::hardware_concurrency())) - 1);
+        return instance;
+    }
+
+    static bool& insideBand() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+public:
+    static const int32_t kMinRowsPerBand = 16;  // Smaller bands are not worth a wake-up
+
+    /**********************************
+     * Retrieves the number of threads processing bands.
+     * @return The worker count plus the calling thread.
+     **********************************/
+    static int32_t getThreadCount() {
+        return pool().size();
+    }
+
+    /**********************************
+     * Processes rows [0, rows) in contiguous bands in parallel.
+     * @param rows Number of rows.
+     * @param fn Callable taking the first row and one past the last row of a band.
+     * @param minRowsPerBand Minimum number of rows per band.
+     **********************************/
+    template <typename Fn>
+    static void forRows(int32_t rows, Fn&& fn, int32_t minRowsPerBand = kMinRowsPerBand) {
+        if (rows <= 0) return;
+        int32_t bands = min(getThreadCount(), max(1, rows / max(1, minRowsPerBand)));
+        if (bands <= 1 || insideBand()) {
+            fn(0, rows);
+            return;
+        }
+        pool().run(bands, [&](int32_t band) {
+            int32_t begin = static_cast<int32_t>(static_cast<int64_t>(rows) * band / bands);
+            int32_t end = static_cast<int32_t>(static_cast<int64_t>(rows) * (band + 1) / bands);
+            fn(begin, end);
+        });
+    }
+};
+
+#endif // PARALLEL_H
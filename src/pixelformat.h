@@ -0,0 +1,173 @@
+/**********************************
+ * @file pixelformat.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the PixelFormat enum and its compile-time traits.
+ *
+ * @details
+ * - PixelFormatTraits<F> describes the memory layout of a format:
+ *   bits and bytes per pixel, channel count, channel offsets,
+ *   alpha presence and number of planes.
+ * - pixelFormatBits() is a constexpr lookup usable at runtime
+ *   without scanning a map.
+ * - dispatchPixelFormat() maps a runtime PixelFormat onto a
+ *   compile-time tag so kernels can be instantiated per format.
+ *
+ * Usage:
+ * - Write kernels as templates over PixelFormat and call them through
+ *   dispatchPixelFormat<Formats...>(format, fn), listing the formats
+ *   the kernel supports.
+ *
+ * Constraints:
+ * - Channel offsets are only meaningful for byte addressable formats,
+ *   sub-byte formats report bytesPerPixel as 0.
+ **********************************/
+
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <cstdint>
+#include <type_traits>
+
+using namespace std;
+
+/**********************************
+ * @enum PixelFormat
+ * @brief Enumerates supported pixel formats for images.
+ **********************************/
+enum class PixelFormat {
+    UNKNOWN = 0,
+    GRAYSCALE1,
+    GRAYSCALE2,
+    GRAYSCALE4,
+    GRAYSCALE8,
+    RGB24,
+    RGBA32,
+    JPEG,
+};
+
+/**********************************
+ * @struct PixelFormatTraits
+ * @brief Compile-time layout of a pixel format.
+ * @tparam F The pixel format.
+ **********************************/
+template <PixelFormat F>
+struct PixelFormatTraits {
+    static constexpr int32_t bitsPerPixel = 0;
+    static constexpr int32_t bytesPerPixel = 0;
+    static constexpr int32_t channels = 0;
+    static constexpr int32_t planes = 0;
+    static constexpr bool hasAlpha = false;
+    static constexpr int32_t redOffset = -1;
+    static constexpr int32_t greenOffset = -1;
+    static constexpr int32_t blueOffset = -1;
+    static constexpr int32_t alphaOffset = -1;
+};
+
+/**********************************
+ * Traits for single channel sub-byte and 8-bit gray formats.
+ * The gray value is stored in the red, green and blue offsets
+ * so RGB kernels read luma from the same byte.
+ **********************************/
+template <int32_t Bits>
+struct GrayscaleFormatTraits {
+    static constexpr int32_t bitsPerPixel = Bits;
+    static constexpr int32_t bytesPerPixel = Bits / 8;
+    static constexpr int32_t channels = 1;
+    static constexpr int32_t planes = 1;
+    static constexpr bool hasAlpha = false;
+    static constexpr int32_t redOffset = 0;
+    static constexpr int32_t greenOffset = 0;
+    static constexpr int32_t blueOffset = 0;
+    static constexpr int32_t alphaOffset = -1;
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::GRAYSCALE1> : GrayscaleFormatTraits<1> {};
+
+template <>
+struct PixelFormatTraits<PixelFormat::GRAYSCALE2> : GrayscaleFormatTraits<2> {};
+
+template <>
+struct PixelFormatTraits<PixelFormat::GRAYSCALE4> : GrayscaleFormatTraits<4> {};
+
+template <>
+struct PixelFormatTraits<PixelFormat::GRAYSCALE8> : GrayscaleFormatTraits<8> {};
+
+template <>
+struct PixelFormatTraits<PixelFormat::RGB24> {
+    static constexpr int32_t bitsPerPixel = 24;
+    static constexpr int32_t bytesPerPixel = 3;
+    static constexpr int32_t channels = 3;
+    static constexpr int32_t planes = 1;
+    static constexpr bool hasAlpha = false;
+    static constexpr int32_t redOffset = 0;
+    static constexpr int32_t greenOffset = 1;
+    static constexpr int32_t blueOffset = 2;
+    static constexpr int32_t alphaOffset = -1;
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::RGBA32> {
+    static constexpr int32_t bitsPerPixel = 32;
+    static constexpr int32_t bytesPerPixel = 4;
+    static constexpr int32_t channels = 4;
+    static constexpr int32_t planes = 1;
+    static constexpr bool hasAlpha = true;
+    static constexpr int32_t redOffset = 0;
+    static constexpr int32_t greenOffset = 1;
+    static constexpr int32_t blueOffset = 2;
+    static constexpr int32_t alphaOffset = 3;
+};
+
+/**********************************
+ * Retrieves the bits per pixel of a format without a map lookup.
+ * @param format The pixel format.
+ * @return The bits per pixel, or 0 for unknown and compressed formats.
+ **********************************/
+constexpr int32_t pixelFormatBits(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::GRAYSCALE1: return PixelFormatTraits<PixelFormat::GRAYSCALE1>::bitsPerPixel;
+        case PixelFormat::GRAYSCALE2: return PixelFormatTraits<PixelFormat::GRAYSCALE2>::bitsPerPixel;
+        case PixelFormat::GRAYSCALE4: return PixelFormatTraits<PixelFormat::GRAYSCALE4>::bitsPerPixel;
+        case PixelFormat::GRAYSCALE8: return PixelFormatTraits<PixelFormat::GRAYSCALE8>::bitsPerPixel;
+        case PixelFormat::RGB24: return PixelFormatTraits<PixelFormat::RGB24>::bitsPerPixel;
+        case PixelFormat::RGBA32: return PixelFormatTraits<PixelFormat::RGBA32>::bitsPerPixel;
+        default: return 0;
+    }
+}
+
+/**********************************
+ * Checks whether a format holds a compressed stream instead of pixel rows.
+ * @param format The pixel format.
+ * @return True for JPEG.
+ **********************************/
+constexpr bool pixelFormatCompressed(PixelFormat format) {
+    return format == PixelFormat::JPEG;
+}
+
+/**********************************
+ * @struct PixelFormatTag
+ * @brief Carries a PixelFormat as a type for generic lambdas.
+ **********************************/
+template <PixelFormat F>
+struct PixelFormatTag {
+    static constexpr PixelFormat format = F;
+    using Traits = PixelFormatTraits<F>;
+};
+
+/**********************************
+ * Calls fn with the PixelFormatTag matching a runtime format.
+ * Only the listed formats are instantiated.
+ * @tparam Formats The formats supported by the caller.
+ * @param format The runtime pixel format.
+ * @param fn Callable taking a PixelFormatTag.
+ * @return True if the format was one of the listed formats.
+ **********************************/
+template <PixelFormat... Formats, typename Fn>
+bool dispatchPixelFormat(PixelFormat format, Fn&& fn) {
+    bool matched = false;
+    ((format == Formats ? (fn(PixelFormatTag<Formats>{}), matched = true) : false), ...);
+    return matched;
+}
+
+#endif // PIXEL_FORMAT_H
@@ -0,0 +1,211 @@
+/**********************************
+ * @file pointlut.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the PointLut class and the PointOperation interface
+ * used to collapse chains of point operations into one lookup pass.
+ *
+ * @details
+ * - A point operation maps every channel byte through a function of
+ *   that byte alone (levels, gamma, posterize, quantization).
+ * - PointLut stores one 256-entry table per channel, composing two
+ *   LUTs is a table of tables and costs 5 * 256 lookups.
+ * - Calculators implementing PointOperation expose their LUT so the
+ *   Scheduler can fuse consecutive ones into a single memory pass.
+ *
+ * Constraints:
+ * - Operations that mix channels (grayscale, color matrices) cannot be
+ *   expressed as a PointLut and act as fusion barriers.
+ * - GRAYSCALE8 images use the GRAY table, RGB24 and RGBA32 images use
+ *   the RED, GREEN, BLUE and ALPHA tables.
+ **********************************/
+
+#ifndef POINT_LUT_H
+#define POINT_LUT_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "image.h"
+#include "calculatorcontext.h"
+
+using namespace std;
+
+/**********************************
+ * @enum LutChannel
+ * @brief Selects one of the tables of a PointLut.
+ **********************************/
+enum class LutChannel {
+    RED = 0,
+    GREEN,
+    BLUE,
+    ALPHA,
+    GRAY,
+    COUNT,
+};
+
+/**********************************
+ * @class PointLut
+ * @brief Per-channel 256-entry lookup table.
+ **********************************/
+class PointLut {
+private:
+    static const size_t kChannels = static_cast<size_t>(LutChannel::COUNT);
+    array<array<uint8_t, 256>, kChannels> tables;   // One table per channel
+
+public:
+    /**********************************
+     * Constructor.
+     * Initializes every table to the identity.
+     **********************************/
+    PointLut() {
+        for (auto& table : tables) {
+            for (size_t value = 0; value < 256; ++value) {
+                table[value] = static_cast<uint8_t>(value);
+            }
+        }
+    }
+
+    /**********************************
+     * Retrieves the table of a channel.
+     * @param channel The channel.
+     * @return A reference to the 256-entry table.
+     **********************************/
+    array<uint8_t, 256>& getTable(LutChannel channel) {
+        return tables[static_cast<size_t>(channel)];
+    }
+
+    const array<uint8_t, 256>& getTable(LutChannel channel) const {
+        return tables[static_cast<size_t>(channel)];
+    }
+
+    /**********************************
+     * Fills the color tables (red, green, blue and gray) with a function.
+     * Alpha is left untouched.
+     * @param fn Callable mapping a byte to a byte.
+     **********************************/
+    template <typename Fn>
+    void setColor(Fn&& fn) {
+        for (LutChannel channel : {LutChannel::RED, LutChannel::GREEN,
+                                   LutChannel::BLUE, LutChannel::GRAY}) {
+            auto& table = getTable(channel);
+            for (size_t value = 0; value < 256; ++value) {
+                table[value] = static_cast<uint8_t>(fn(static_cast<uint8_t>(value)));
+            }
+        }
+    }
+
+    /**********************************
+     * Composes this LUT with the one applied after it.
+     * @param next The LUT applied to the output of this one.
+     * @return A LUT equivalent to applying this one, then next.
+     **********************************/
+    PointLut then(const PointLut& next) const {
+        PointLut composed;
+        for (size_t channel = 0; channel < kChannels; ++channel) {
+            for (size_t value = 0; value < 256; ++value) {
+                composed.tables[channel][value] = next.tables[channel][tables[channel][value]];
+            }
+        }
+        return composed;
+    }
+
+    /**********************************
+     * Checks if the LUT leaves every value unchanged.
+     * @return True if every table is the identity.
+     **********************************/
+    bool isIdentity() const {
+        for (const auto& table : tables) {
+            for (size_t value = 0; value < 256; ++value) {
+                if (table[value] != value) return false;
+            }
+        }
+        return true;
+    }
+
+    /**********************************
+     * Applies the LUT to an image in place.
+     * @param image A GRAYSCALE8, RGB24 or RGBA32 image.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    void apply(Image& image) const {
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24,
+                                           PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                applyFormat<decltype(tag)::format>(image);
+            });
+        if (!matched) {
+            throw ImageException("Error PointLut: Unsupported pixel format.");
+        }
+    }
+
+private:
+    /**********************************
+     * Applies the LUT to an image of a known format, one pass per row.
+     * @tparam F The pixel format of the image.
+     * @param image The image to process in place.
+     **********************************/
+    template <PixelFormat F>
+    void applyFormat(Image& image) const {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* pixelData = image.getData().data();
+        const size_t width = image.getWidth();
+
+        for (int32_t row = 0; row < image.getHeight(); ++row) {
+            uint8_t* pixel = pixelData + static_cast<size_t>(row) * image.getStride();
+            if constexpr (Traits::channels == 1) {
+                const auto& gray = getTable(LutChannel::GRAY);
+                for (size_t col = 0; col < width; ++col) {
+                    pixel[col] = gray[pixel[col]];
+                }
+            } else {
+                const auto& red = getTable(LutChannel::RED);
+                const auto& green = getTable(LutChannel::GREEN);
+                const auto& blue = getTable(LutChannel::BLUE);
+                for (size_t col = 0; col < width; ++col, pixel += Traits::bytesPerPixel) {
+                    pixel[Traits::redOffset] = red[pixel[Traits::redOffset]];
+                    pixel[Traits::greenOffset] = green[pixel[Traits::greenOffset]];
+                    pixel[Traits::blueOffset] = blue[pixel[Traits::blueOffset]];
+                    if constexpr (Traits::hasAlpha) {
+                        pixel[Traits::alphaOffset] =
+                            getTable(LutChannel::ALPHA)[pixel[Traits::alphaOffset]];
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**********************************
+ * @class PointOperation
+ * @brief Interface for calculators whose processing is a PointLut.
+ *
+ * A calculator implementing it reads one Image from the input port
+ * named by getPointInputTag() and writes the mapped Image to the
+ * output port named by getPointOutputTag().
+ **********************************/
+class PointOperation {
+public:
+    virtual ~PointOperation() = default;
+
+    /**********************************
+     * Retrieves the LUT equivalent to the calculator's processing.
+     * @param cc The calculator context holding the configuration.
+     * @param lut Receives the LUT.
+     * @return False if the current configuration is not a point operation.
+     **********************************/
+    virtual bool getPointLut(CalculatorContext* cc, PointLut& lut) = 0;
+
+    /**********************************
+     * Retrieves the tag of the input port read by the calculator.
+     * @return The input port tag.
+     **********************************/
+    virtual string getPointInputTag() const = 0;
+
+    /**********************************
+     * Retrieves the tag of the output port written by the calculator.
+     * @return The output port tag.
+     **********************************/
+    virtual string getPointOutputTag() const = 0;
+};
+
+#endif // POINT_LUT_H
@@ -95,6 +95,30 @@ public:
         return packet;
     }
 
+    /**********************************
+     * Retrieves the Packet at the front of the queue without removing it.
+     * @return A constant reference to the oldest Packet, valid until it is read.
+     * @throws PortException if the queue is empty.
+     **********************************/
+    const Packet& peek() const {
+        if (dataQueue.empty()) {
+            throw PortException("peek: Port is empty");
+        }
+        return dataQueue.front();
+    }
+
+    /**********************************
+     * Retrieves the Packet at the back of the queue, the latest written.
+     * @return A constant reference to the newest Packet, valid until it is read.
+     * @throws PortException if the queue is empty.
+     **********************************/
+    const Packet& peekBack() const {
+        if (dataQueue.empty()) {
+            throw PortException("peekBack: Port is empty");
+        }
+        return dataQueue.back();
+    }
+
     /**********************************
      * Compares two Ports for equality based on their data queues direction.
      * @param other The Port to compare with.
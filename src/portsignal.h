@@ -0,0 +1,88 @@
+/**********************************
+ * @file portsignal.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the PortSignal class used to wake an idle Scheduler.
+ *
+ * @details
+ * - Keeps a generation counter that is bumped every time new data is
+ *   written to a watched port.
+ * - Waiters spin for a short time and then park on a condition
+ *   variable until the generation changes or a timeout expires.
+ * - Notifiers only take the lock when a waiter is parked, so the
+ *   common busy path costs a single atomic increment.
+ *
+ * Constraints:
+ * - The signal only reports that something changed, readers must
+ *   check their ports again after waking up.
+ **********************************/
+
+#ifndef PORT_SIGNAL_H
+#define PORT_SIGNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+/**********************************
+ * @class PortSignal
+ * @brief Generation counter with an adaptive spin-then-park wait.
+ **********************************/
+class PortSignal {
+private:
+    mutex lock;                                 // Protects the parked waiters
+    condition_variable cv;                      // Parked waiters wait here
+    atomic<unsigned long long> generation{0};   // Bumped on every notify
+    atomic<int> waiters{0};                     // Number of parked waiters
+
+public:
+    static const int kDefaultSpinCount = 64;    // Spins before parking
+
+    /**********************************
+     * Signals that new data is available.
+     **********************************/
+    void notify() {
+        generation.fetch_add(1);
+        if (waiters.load() > 0) {
+            lock_guard<mutex> guard(lock);
+            cv.notify_all();
+        }
+    }
+
+    /**********************************
+     * Retrieves the current generation.
+     * @return The number of notifications so far.
+     **********************************/
+    unsigned long long getGeneration() const {
+        return generation.load();
+    }
+
+    /**********************************
+     * Waits until the generation differs from the one seen by the caller.
+     * Spins first, then parks on the condition variable.
+     * @param seen The generation observed by the caller.
+     * @param timeoutUs Maximum time to wait in microseconds.
+     * @param spinCount Number of spins before parking.
+     * @return True if a notification arrived, false on timeout.
+     **********************************/
+    bool wait(unsigned long long seen, unsigned long long timeoutUs,
+              int spinCount = kDefaultSpinCount) {
+        for (int i = 0; i < spinCount; ++i) {
+            if (generation.load() != seen) return true;
+            this_thread::yield();
+        }
+
+        unique_lock<mutex> guard(lock);
+        waiters.fetch_add(1);
+        bool notified = cv.wait_for(guard, chrono::microseconds(timeoutUs), [&] {
+            return generation.load() != seen;
+        });
+        waiters.fetch_sub(1);
+        return notified;
+    }
+};
+
+#endif // PORT_SIGNAL_H
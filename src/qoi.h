@@ -0,0 +1,354 @@
+/**********************************
+ * @file qoi.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the QoiCodec class, a lossless encoder and decoder for
+ * the QOI image format.
+ *
+ * @details
+ * - QOI encodes every pixel in one pass as a run, a reference into a 64
+ *   entry table of recently seen colors, a small difference to the
+ *   previous pixel or a literal.
+ *   https://qoiformat.org/qoi-specification.pdf
+ * - Large frames are encoded in parallel, in bands of whole rows whose
+ *   chunks are simply concatenated. A band starts from the last pixel of
+ *   the band above, which the decoder also holds, and only references
+ *   table entries it wrote itself, so the result is a standard QOI stream
+ *   any decoder reads. Band boundaries depend only on the frame size,
+ *   the output is the same for any number of threads.
+ * - Bands are kept as separate buffers so a writer can send them with a
+ *   single gathered write, without concatenating them first.
+ *
+ * Constraints:
+ * - Encodes RGB24 and RGBA32 images as 3 and 4 channel files, GRAYSCALE8
+ *   is stored as RGB. Decoding yields RGB24 or RGBA32.
+ **********************************/
+
+#ifndef QOI_H
+#define QOI_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "image.h"
+#include "parallel.h"
+
+using namespace std;
+
+class QoiCodec {
+public:
+    static const size_t kHeaderSize = 14;           // Magic, width, height, channels, colorspace
+    static const size_t kEndMarkerSize = 8;         // Seven 0x00 bytes and a 0x01
+    static const int32_t kBandPixels = 1 << 18;     // Pixels per encoded band, about 1 MB of RGBA
+    static const int64_t kMaxPixels = 400000000;    // Largest frame accepted by the decoder
+
+private:
+    static const uint8_t kOpIndex = 0x00;   // 00xxxxxx: table entry
+    static const uint8_t kOpDiff = 0x40;    // 01drdgdb: small difference
+    static const uint8_t kOpLuma = 0x80;    // 10dg dr-dg db-dg: luma difference
+    static const uint8_t kOpRun = 0xC0;     // 11rrrrrr: run of 1 to 62 pixels
+    static const uint8_t kOpRgb = 0xFE;     // Literal red, green and blue
+    static const uint8_t kOpRgba = 0xFF;    // Literal red, green, blue and alpha
+    static const uint8_t kMask = 0xC0;      // Two bit tag mask
+    static const uint32_t kOpaqueBlack = 0xFF000000;    // Pixel before the first one, packed
+
+public:
+    /**********************************
+     * Builds the file header of an image.
+     * @param image The image to encode.
+     * @return The 14 header bytes.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static array<uint8_t, kHeaderSize> header(const Image& image) {
+        const int32_t channels = fileChannels(image.getFormat());
+        array<uint8_t, kHeaderSize> bytes{};
+        memcpy(bytes.data(), "qoif", 4);
+        writeBigEndian(bytes.data() + 4, static_cast<uint32_t>(image.getWidth()));
+        writeBigEndian(bytes.data() + 8, static_cast<uint32_t>(image.getHeight()));
+        bytes[12] = static_cast<uint8_t>(channels);
+        bytes[13] = 0;  // sRGB with linear alpha
+        return bytes;
+    }
+
+    /**********************************
+     * Retrieves the end of stream marker.
+     * @return The 8 marker bytes.
+     **********************************/
+    static const array<uint8_t, kEndMarkerSize>& endMarker() {
+        static const array<uint8_t, kEndMarkerSize> marker = {0, 0, 0, 0, 0, 0, 0, 1};
+        return marker;
+    }
+
+    /**********************************
+     * Encodes the pixels of an image, one buffer per band of rows.
+     * Concatenating the header, the bands and the end marker gives the file.
+     * @param image A GRAYSCALE8, RGB24 or RGBA32 image.
+     * @return The encoded chunks of every band, top to bottom.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static vector<vector<uint8_t>> encodeBands(const Image& image) {
+        fileChannels(image.getFormat());
+        const int32_t width = image.getWidth();
+        const int32_t rowsPerBand = max(1, kBandPixels / width);
+        const int32_t bandCount = (image.getHeight() + rowsPerBand - 1) / rowsPerBand;
+        vector<vector<uint8_t>> bands(bandCount);
+
+        dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                Parallel::forRows(bandCount, [&](int32_t begin, int32_t end) {
+                    for (int32_t band = begin; band < end; ++band) {
+                        const int32_t y0 = band * rowsPerBand;
+                        const int32_t y1 = min(image.getHeight(), y0 + rowsPerBand);
+                        bands[band] = encodeRows<decltype(tag)::format>(image, y0, y1);
+                    }
+                }, 1);
+            });
+        return bands;
+    }
+
+    /**********************************
+     * Encodes an image into a complete QOI file.
+     * @param image A GRAYSCALE8, RGB24 or RGBA32 image.
+     * @return The file bytes.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static vector<uint8_t> encode(const Image& image) {
+        const array<uint8_t, kHeaderSize> head = header(image);
+        const vector<vector<uint8_t>> bands = encodeBands(image);
+        size_t size = kHeaderSize + kEndMarkerSize;
+        for (const vector<uint8_t>& band : bands) size += band.size();
+
+        vector<uint8_t> file;
+        file.reserve(size);
+        file.insert(file.end(), head.begin(), head.end());
+        for (const vector<uint8_t>& band : bands) file.insert(file.end(), band.begin(), band.end());
+        file.insert(file.end(), endMarker().begin(), endMarker().end());
+        return file;
+    }
+
+    /**********************************
+     * Decodes a QOI file.
+     * @param data The file bytes.
+     * @param size Number of bytes.
+     * @return An RGB24 image for 3 channel files, RGBA32 otherwise.
+     * @throws runtime_error if the data is not a valid QOI file.
+     **********************************/
+    static Image decode(const uint8_t* data, size_t size) {
+        if (size < kHeaderSize + kEndMarkerSize || memcmp(data, "qoif", 4) != 0) {
+            throw runtime_error("Error decodeQOI: Not a QOI file.");
+        }
+        const uint32_t width = readBigEndian(data + 4);
+        const uint32_t height = readBigEndian(data + 8);
+        const int32_t channels = data[12];
+        if (width == 0 || height == 0 || (channels != 3 && channels != 4) ||
+            static_cast<int64_t>(width) * height > kMaxPixels) {
+            throw runtime_error("Error decodeQOI: Invalid header.");
+        }
+
+        Image image(static_cast<int32_t>(width), static_cast<int32_t>(height),
+                    channels == 4 ? PixelFormat::RGBA32 : PixelFormat::RGB24);
+        if (channels == 4) {
+            decodePixels<4>(data + kHeaderSize, size - kHeaderSize, image.getData().data(),
+                            static_cast<size_t>(width) * height);
+        } else {
+            decodePixels<3>(data + kHeaderSize, size - kHeaderSize, image.getData().data(),
+                            static_cast<size_t>(width) * height);
+        }
+        return image;
+    }
+
+private:
+    /**********************************
+     * Retrieves the channel count stored for a pixel format.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    static int32_t fileChannels(PixelFormat format) {
+        switch (format) {
+            case PixelFormat::RGBA32: return 4;
+            case PixelFormat::RGB24:
+            case PixelFormat::GRAYSCALE8: return 3;
+            default: throw ImageException("Error QoiCodec: Unsupported pixel format.");
+        }
+    }
+
+    /**********************************
+     * Packs a pixel as red | green << 8 | blue << 16 | alpha << 24.
+     * @tparam F The pixel format.
+     **********************************/
+    template <PixelFormat F>
+    static uint32_t loadPixel(const uint8_t* pixel) {
+        if constexpr (F == PixelFormat::RGBA32) {
+            return static_cast<uint32_t>(pixel[0]) | static_cast<uint32_t>(pixel[1]) << 8 |
+                   static_cast<uint32_t>(pixel[2]) << 16 | static_cast<uint32_t>(pixel[3]) << 24;
+        } else if constexpr (F == PixelFormat::RGB24) {
+            return static_cast<uint32_t>(pixel[0]) | static_cast<uint32_t>(pixel[1]) << 8 |
+                   static_cast<uint32_t>(pixel[2]) << 16 | kOpaqueBlack;
+        } else {
+            return pixel[0] * 0x010101u | kOpaqueBlack;
+        }
+    }
+
+    /**********************************
+     * Hashes a packed pixel into the 64 entry color table.
+     **********************************/
+    static uint32_t hash(uint32_t pixel) {
+        return ((pixel & 0xFF) * 3 + (pixel >> 8 & 0xFF) * 5 + (pixel >> 16 & 0xFF) * 7 +
+                (pixel >> 24) * 11) & 63;
+    }
+
+    /**********************************
+     * Encodes rows [y0, y1) of an image of a known format.
+     * @tparam F The pixel format of the image.
+     * @param image The image.
+     * @param y0 First row.
+     * @param y1 One past the last row.
+     * @return The encoded chunks.
+     **********************************/
+    template <PixelFormat F>
+    static vector<uint8_t> encodeRows(const Image& image, int32_t y0, int32_t y1) {
+        constexpr int32_t bytesPerPixel = PixelFormatTraits<F>::bytesPerPixel;
+        const int32_t width = image.getWidth();
+        const uint8_t* pixelData = image.getData().data();
+        const size_t stride = image.getStride();
+
+        // Worst case is a literal RGBA per pixel
+        vector<uint8_t> out(static_cast<size_t>(y1 - y0) * width * 5);
+        uint8_t* p = out.data();
+
+        uint32_t table[64];
+        uint64_t written = 0;   // Table entries written by this band, the only ones referenced
+        uint32_t previous = kOpaqueBlack;
+        if (y0 > 0) {
+            previous = loadPixel<F>(pixelData + (y0 - 1) * stride + (width - 1) * bytesPerPixel);
+        }
+        int32_t run = 0;
+
+        for (int32_t y = y0; y < y1; ++y) {
+            const uint8_t* pixel = pixelData + y * stride;
+            for (int32_t x = 0; x < width; ++x, pixel += bytesPerPixel) {
+                const uint32_t current = loadPixel<F>(pixel);
+                if (current == previous) {
+                    if (++run == 62) {
+                        *p++ = static_cast<uint8_t>(kOpRun | (run - 1));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0) {
+                    *p++ = static_cast<uint8_t>(kOpRun | (run - 1));
+                    run = 0;
+                }
+
+                const uint32_t slot = hash(current);
+                if ((written >> slot & 1) && table[slot] == current) {
+                    *p++ = static_cast<uint8_t>(kOpIndex | slot);
+                } else {
+                    table[slot] = current;
+                    written |= 1ULL << slot;
+                    if ((current ^ previous) >> 24 == 0) {
+                        const int8_t dr = static_cast<int8_t>((current & 0xFF) - (previous & 0xFF));
+                        const int8_t dg = static_cast<int8_t>((current >> 8 & 0xFF) - (previous >> 8 & 0xFF));
+                        const int8_t db = static_cast<int8_t>((current >> 16 & 0xFF) - (previous >> 16 & 0xFF));
+                        const int8_t drdg = static_cast<int8_t>(dr - dg);
+                        const int8_t dbdg = static_cast<int8_t>(db - dg);
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                            *p++ = static_cast<uint8_t>(kOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                        } else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7) {
+                            *p++ = static_cast<uint8_t>(kOpLuma | (dg + 32));
+                            *p++ = static_cast<uint8_t>((drdg + 8) << 4 | (dbdg + 8));
+                        } else {
+                            *p++ = kOpRgb;
+                            *p++ = static_cast<uint8_t>(current);
+                            *p++ = static_cast<uint8_t>(current >> 8);
+                            *p++ = static_cast<uint8_t>(current >> 16);
+                        }
+                    } else {
+                        *p++ = kOpRgba;
+                        memcpy(p, &current, 4);     // Little endian: red, green, blue, alpha
+                        p += 4;
+                    }
+                }
+                previous = current;
+            }
+        }
+        if (run > 0) {
+            *p++ = static_cast<uint8_t>(kOpRun | (run - 1));
+        }
+        out.resize(p - out.data());
+        return out;
+    }
+
+    /**********************************
+     * Decodes the chunks of a file into tightly packed pixels.
+     * @tparam C Channels per pixel, 3 or 4.
+     * @param data First chunk byte.
+     * @param size Bytes from the first chunk to the end of the file.
+     * @param out Receives pixelCount pixels.
+     * @param pixelCount Number of pixels.
+     * @throws runtime_error if the chunks end before the last pixel.
+     **********************************/
+    template <int32_t C>
+    static void decodePixels(const uint8_t* data, size_t size, uint8_t* out, size_t pixelCount) {
+        uint8_t table[64][4] = {};
+        uint8_t pixel[4] = {0, 0, 0, 255};
+        const uint8_t* p = data;
+        const uint8_t* end = data + size - kEndMarkerSize;
+        uint8_t* target = out;
+        uint8_t* const last = out + pixelCount * C;
+
+        while (target < last) {
+            if (p >= end) {
+                throw runtime_error("Error decodeQOI: Truncated data.");
+            }
+            const uint8_t op = *p++;
+            if (op == kOpRgb || op == kOpRgba) {
+                const int32_t count = op == kOpRgb ? 3 : 4;
+                if (end - p < count) throw runtime_error("Error decodeQOI: Truncated data.");
+                memcpy(pixel, p, count);
+                p += count;
+            } else if ((op & kMask) == kOpIndex) {
+                memcpy(pixel, table[op], 4);
+            } else if ((op & kMask) == kOpDiff) {
+                pixel[0] = static_cast<uint8_t>(pixel[0] + ((op >> 4) & 3) - 2);
+                pixel[1] = static_cast<uint8_t>(pixel[1] + ((op >> 2) & 3) - 2);
+                pixel[2] = static_cast<uint8_t>(pixel[2] + (op & 3) - 2);
+            } else if ((op & kMask) == kOpLuma) {
+                if (p >= end) throw runtime_error("Error decodeQOI: Truncated data.");
+                const uint8_t second = *p++;
+                const int32_t dg = (op & 0x3F) - 32;
+                pixel[0] = static_cast<uint8_t>(pixel[0] + dg - 8 + (second >> 4));
+                pixel[1] = static_cast<uint8_t>(pixel[1] + dg);
+                pixel[2] = static_cast<uint8_t>(pixel[2] + dg - 8 + (second & 0x0F));
+            } else {
+                // Run: repeat the previous pixel
+                const size_t run = min<size_t>((op & 0x3F) + 1, (last - target) / C);
+                for (size_t i = 0; i < run; ++i, target += C) {
+                    memcpy(target, pixel, C);
+                }
+            }
+            if (op < kOpRun || op >= kOpRgb) {
+                memcpy(target, pixel, C);
+                target += C;
+            }
+            // Every chunk stores its pixel, as the reference decoder does
+            const uint32_t slot = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) & 63;
+            memcpy(table[slot], pixel, 4);
+        }
+    }
+
+    static void writeBigEndian(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    static uint32_t readBigEndian(const uint8_t* in) {
+        return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 |
+               static_cast<uint32_t>(in[2]) << 8 | in[3];
+    }
+};
+
+#endif // QOI_H
@@ -0,0 +1,296 @@
+/**********************************
+ * @file scenechange.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the SceneChangeDetector class, which flags frames whose
+ * content differs from the last scene change.
+ *
+ * @details
+ * - Each frame is reduced to a coarse grid of mean luma values, by
+ *   default 32x18 cells. A few evenly spaced rows per cell are sampled,
+ *   so a 1080p frame reads about an eighth of its rows. With an
+ *   IntegralImage of the frame the cell means are exact and cost four
+ *   lookups per cell.
+ * - The score is the mean absolute difference between the grid and the
+ *   grid of the key frame, the last frame flagged as changed, 0 to 255.
+ *   A frame is changed when the score reaches the threshold, or when it
+ *   is the first frame or its size or format differs from the previous
+ *   one. Comparing with the key frame instead of the previous frame
+ *   lets slow pans and fades add up until they flag.
+ * - With SSE2, sampled GRAYSCALE8 and RGBA32 rows and the grid difference
+ *   are summed 16 bytes at a time with _mm_sad_epu8.
+ * - The grid is kept as a GRAYSCALE8 image and doubles as a thumbnail.
+ *
+ * Constraints:
+ * - Supports GRAYSCALE8, RGB24 and RGBA32 images, alpha is ignored.
+ **********************************/
+
+#ifndef SCENE_CHANGE_H
+#define SCENE_CHANGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "image.h"
+#include "integralimage.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+class SceneChangeDetector {
+private:
+    static constexpr int32_t kSampledRowsPerCell = 8;   // Rows read per cell without an IntegralImage
+
+    int32_t gridWidth;          // Cells per grid row
+    int32_t gridHeight;         // Cells per grid column
+    int32_t threshold;          // Score at which a frame is changed
+    Image grid;                 // Mean luma per cell of the last frame
+    Image keyframe;             // Grid of the last frame flagged as changed
+    bool hasPrevious;           // False until the first frame
+    int32_t lastWidth;          // Width of the last frame
+    int32_t lastHeight;         // Height of the last frame
+    PixelFormat lastFormat;     // Format of the last frame
+    int32_t score;              // Score of the last frame
+    vector<uint32_t> sums;      // Red, green and blue sums of one row of cells
+
+public:
+    /**********************************
+     * Constructor.
+     * @param newGridWidth Cells per grid row.
+     * @param newGridHeight Cells per grid column.
+     * @param newThreshold Mean absolute luma difference at which a frame is changed.
+     * @throws ImageException if the grid is smaller than 1x1.
+     **********************************/
+    explicit SceneChangeDetector(int32_t newGridWidth = 32, int32_t newGridHeight = 18,
+                                 int32_t newThreshold = 10)
+        : gridWidth(newGridWidth), gridHeight(newGridHeight), threshold(newThreshold),
+          grid(std::max(newGridWidth, 1), std::max(newGridHeight, 1), PixelFormat::GRAYSCALE8),
+          keyframe(std::max(newGridWidth, 1), std::max(newGridHeight, 1), PixelFormat::GRAYSCALE8),
+          hasPrevious(false), lastWidth(0), lastHeight(0), lastFormat(PixelFormat::UNKNOWN),
+          score(0), sums(static_cast<size_t>(std::max(newGridWidth, 1)) * 3) {
+        if (gridWidth < 1 || gridHeight < 1) {
+            throw ImageException("Error SceneChangeDetector: Grid must be at least 1x1.");
+        }
+    }
+
+    /**********************************
+     * Compares a frame with the key frame. A changed frame becomes the
+     * new key frame.
+     * @param image A GRAYSCALE8, RGB24 or RGBA32 frame.
+     * @param integral Optional IntegralImage of the frame, for exact cell means.
+     * @return True if the frame is a scene change.
+     * @throws ImageException if the format is not supported.
+     **********************************/
+    bool update(const Image& image, const IntegralImage* integral = nullptr) {
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32>(
+            image.getFormat(), [&](auto tag) {
+                if (integral && integral->getWidth() == image.getWidth() &&
+                    integral->getHeight() == image.getHeight() &&
+                    integral->getChannels() == PixelFormatTraits<decltype(tag)::format>::channels) {
+                    integralGrid<decltype(tag)::format>(*integral);
+                } else {
+                    sampleGrid<decltype(tag)::format>(image);
+                }
+            });
+        if (!matched) {
+            throw ImageException("Error SceneChangeDetector: Unsupported pixel format.");
+        }
+
+        const bool sameSource = hasPrevious && image.getWidth() == lastWidth &&
+                                image.getHeight() == lastHeight && image.getFormat() == lastFormat;
+        score = sameSource ? meanDifference(grid.getData().data(), keyframe.getData().data()) : 255;
+        hasPrevious = true;
+        lastWidth = image.getWidth();
+        lastHeight = image.getHeight();
+        lastFormat = image.getFormat();
+        if (sameSource && score < threshold) return false;
+        keyframe.getData() = grid.getData();
+        return true;
+    }
+
+    /**********************************
+     * Retrieves the score of the last frame.
+     * @return Mean absolute luma difference per cell to the key frame,
+     *         255 for a first frame.
+     **********************************/
+    int32_t getScore() const { return score; }
+
+    /**********************************
+     * Retrieves the luma grid of the last frame.
+     * @return A gridWidth x gridHeight GRAYSCALE8 image.
+     **********************************/
+    const Image& getThumbnail() const { return grid; }
+
+    int32_t getThreshold() const { return threshold; }
+    int32_t getGridWidth() const { return gridWidth; }
+    int32_t getGridHeight() const { return gridHeight; }
+
+private:
+    /**********************************
+     * Fills the grid from sampled rows of a frame of a known format.
+     * @tparam F The pixel format of the frame.
+     * @param image The frame.
+     **********************************/
+    template <PixelFormat F>
+    void sampleGrid(const Image& image) {
+        using Traits = PixelFormatTraits<F>;
+        const int32_t width = image.getWidth();
+        const int32_t height = image.getHeight();
+        const uint8_t* pixelData = image.getData().data();
+        uint8_t* gridData = grid.getData().data();
+
+        for (int32_t gy = 0; gy < gridHeight; ++gy) {
+            int32_t y0, y1;
+            cellBounds(gy, gridHeight, height, y0, y1);
+            const int32_t rows = std::min(kSampledRowsPerCell, y1 - y0);
+            fill(sums.begin(), sums.end(), 0);
+
+            for (int32_t k = 0; k < rows; ++k) {
+                const int32_t y = y0 + static_cast<int32_t>((2LL * k + 1) * (y1 - y0) / (2LL * rows));
+                const uint8_t* row = pixelData + static_cast<size_t>(y) * image.getStride();
+                for (int32_t gx = 0; gx < gridWidth; ++gx) {
+                    int32_t x0, x1;
+                    cellBounds(gx, gridWidth, width, x0, x1);
+                    sumSpan<F>(row + x0 * Traits::bytesPerPixel, x1 - x0, &sums[gx * 3]);
+                }
+            }
+
+            for (int32_t gx = 0; gx < gridWidth; ++gx) {
+                int32_t x0, x1;
+                cellBounds(gx, gridWidth, width, x0, x1);
+                const uint32_t count = static_cast<uint32_t>(rows * (x1 - x0));
+                uint8_t mean[3];
+                for (int32_t channel = 0; channel < 3; ++channel) {
+                    mean[channel] = static_cast<uint8_t>((sums[gx * 3 + channel] + count / 2) / count);
+                }
+                gridData[gy * gridWidth + gx] = luma(mean[0], mean[1], mean[2]);
+            }
+        }
+    }
+
+    /**********************************
+     * Fills the grid with exact cell means read from an IntegralImage.
+     * @tparam F The pixel format of the frame the table was built from.
+     * @param integral The IntegralImage.
+     **********************************/
+    template <PixelFormat F>
+    void integralGrid(const IntegralImage& integral) {
+        using Traits = PixelFormatTraits<F>;
+        uint8_t* gridData = grid.getData().data();
+        for (int32_t gy = 0; gy < gridHeight; ++gy) {
+            int32_t y0, y1;
+            cellBounds(gy, gridHeight, integral.getHeight(), y0, y1);
+            for (int32_t gx = 0; gx < gridWidth; ++gx) {
+                int32_t x0, x1;
+                cellBounds(gx, gridWidth, integral.getWidth(), x0, x1);
+                uint8_t mean[4];
+                integral.means(x0, y0, x1, y1, mean);
+                gridData[gy * gridWidth + gx] = luma(mean[Traits::redOffset], mean[Traits::greenOffset],
+                                                     mean[Traits::blueOffset]);
+            }
+        }
+    }
+
+    /**********************************
+     * Adds the red, green and blue values of a run of pixels.
+     * @tparam F The pixel format of the pixels.
+     * @param pixel First pixel of the run.
+     * @param count Number of pixels.
+     * @param out Red, green and blue sums to add to.
+     **********************************/
+    template <PixelFormat F>
+    static void sumSpan(const uint8_t* pixel, int32_t count, uint32_t* out) {
+        using Traits = PixelFormatTraits<F>;
+        uint32_t red = 0, green = 0, blue = 0;
+        int32_t i = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr (F == PixelFormat::GRAYSCALE8) {
+            __m128i total = zero;
+            for (; i + 16 <= count; i += 16) {
+                total = _mm_add_epi64(total, _mm_sad_epu8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + i)), zero));
+            }
+            red = static_cast<uint32_t>(_mm_cvtsi128_si32(total) +
+                                        _mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+        } else if constexpr (F == PixelFormat::RGBA32) {
+            // One channel per 32-bit lane after a shift and mask, the SAD adds the lanes
+            const __m128i mask = _mm_set1_epi32(0xFF);
+            __m128i redTotal = zero, greenTotal = zero, blueTotal = zero;
+            for (; i + 4 <= count; i += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel + i * 4));
+                redTotal = _mm_add_epi64(redTotal, _mm_sad_epu8(_mm_and_si128(pixels, mask), zero));
+                greenTotal = _mm_add_epi64(greenTotal, _mm_sad_epu8(
+                    _mm_and_si128(_mm_srli_epi32(pixels, 8), mask), zero));
+                blueTotal = _mm_add_epi64(blueTotal, _mm_sad_epu8(
+                    _mm_and_si128(_mm_srli_epi32(pixels, 16), mask), zero));
+            }
+            red = static_cast<uint32_t>(_mm_cvtsi128_si32(redTotal) + _mm_cvtsi128_si32(_mm_srli_si128(redTotal, 8)));
+            green = static_cast<uint32_t>(_mm_cvtsi128_si32(greenTotal) + _mm_cvtsi128_si32(_mm_srli_si128(greenTotal, 8)));
+            blue = static_cast<uint32_t>(_mm_cvtsi128_si32(blueTotal) + _mm_cvtsi128_si32(_mm_srli_si128(blueTotal, 8)));
+        }
+#endif
+        for (; i < count; ++i) {
+            const uint8_t* p = pixel + i * Traits::bytesPerPixel;
+            red += p[Traits::redOffset];
+            green += p[Traits::greenOffset];
+            blue += p[Traits::blueOffset];
+        }
+        if constexpr (F == PixelFormat::GRAYSCALE8) {
+            // Gray pixels were summed once, the SIMD path only fills red
+            green = blue = red;
+        }
+        out[0] += red;
+        out[1] += green;
+        out[2] += blue;
+    }
+
+    /**********************************
+     * Computes the mean absolute difference of two grids.
+     * @param current The current grid.
+     * @param last The key frame grid.
+     * @return The rounded mean, 0 to 255.
+     **********************************/
+    int32_t meanDifference(const uint8_t* current, const uint8_t* last) const {
+        const int32_t cells = gridWidth * gridHeight;
+        uint64_t total = 0;
+        int32_t i = 0;
+#ifdef __SSE2__
+        __m128i sad = _mm_setzero_si128();
+        for (; i + 16 <= cells; i += 16) {
+            sad = _mm_add_epi64(sad, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(current + i)),
+                                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(last + i))));
+        }
+        total = static_cast<uint64_t>(_mm_cvtsi128_si32(sad)) +
+                static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+#endif
+        for (; i < cells; ++i) {
+            total += current[i] > last[i] ? current[i] - last[i] : last[i] - current[i];
+        }
+        return static_cast<int32_t>((total + cells / 2) / cells);
+    }
+
+    /**********************************
+     * Computes the pixel range of a cell, at least one pixel wide.
+     * @param cell The cell index.
+     * @param cells Number of cells.
+     * @param size Image size along the axis.
+     * @param begin Receives the first pixel.
+     * @param end Receives one past the last pixel.
+     **********************************/
+    static void cellBounds(int32_t cell, int32_t cells, int32_t size, int32_t& begin, int32_t& end) {
+        begin = static_cast<int32_t>(static_cast<int64_t>(cell) * size / cells);
+        end = std::max(begin + 1, static_cast<int32_t>(static_cast<int64_t>(cell + 1) * size / cells));
+    }
+
+    /**********************************
+     * BT.709 luma in 8-bit fixed point.
+     **********************************/
+    static uint8_t luma(uint8_t red, uint8_t green, uint8_t blue) {
+        return static_cast<uint8_t>((54 * red + 183 * green + 19 * blue) >> 8);
+    }
+};
+
+#endif // SCENE_CHANGE_H
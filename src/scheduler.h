@@ -13,11 +13,26 @@
  * Key Features:
  * - Register and connect multiple calculators dynamically.
  * - Input and output ports for external data handling.
- * - Callback mechanisms for input and output processing.
+ * - Callback mechanisms for input and output processing, both can carry
+ *   a context pointer (e.g. a transport such as UnixFrameServer).
  * - High-resolution frame timing using `clock_gettime`.
+ * - Two execution modes: round-robin (one calculator per iteration) and
+ *   depth-first (one input packet driven through the whole chain per tick).
+ * - Readiness-driven execution: a calculator is only invoked when one of
+ *   its input ports holds data, an idle graph parks on a PortSignal
+ *   instead of busy-spinning.
+ * - Point-operation fusion: compilePointOperations() collapses runs of
+ *   consecutive PointOperation calculators into a single PointLut pass.
+ * - Explicit edges: connect() binds any output port to any input port,
+ *   so graphs with fan-in (e.g. N feeds into one compositor) can be built
+ *   where connectCalculators() only chains calculators linearly.
+ * - Gating: gateCalculator() skips a calculator for packets flagged as
+ *   unchanged (e.g. by SceneChangeCalculator), re-emitting its last result.
  *
  * Constraints:
  * - Calculators must be registered before running the scheduler.
+ * - Calculators run in registration order, producers must be registered
+ *   before the calculators reading their outputs.
  * - Proper connections must be established between calculators and ports.
  * - Frame rate and delta time calculations depend on the system clock accuracy.
  **********************************/
@@ -30,18 +45,56 @@
 #include <map>
 #include <memory>
 #include <ctime>
+#include <deque>
+#include <mutex>
 #include "calculatorbase.h"
 #include "calculatorcontext.h"
+#include "portsignal.h"
+#include "pointlut.h"
 #include "image.h"
 
 using namespace std;
 
+/**********************************
+ * @enum ExecutionMode
+ * @brief Selects how the Scheduler advances calculators on each run.
+ * - ROUND_ROBIN: each loop iteration runs a single calculator, a frame
+ *   needs one iteration per calculator to reach the output port.
+ * - DEPTH_FIRST: each tick reads one input packet and drives it through
+ *   every calculator in registration order before the next one is read.
+ **********************************/
+enum class ExecutionMode {
+    ROUND_ROBIN = 0,
+    DEPTH_FIRST,
+};
+
 class Scheduler {
 private:
+    /**
+     * A run of consecutive point operations executed as one LUT pass.
+     */
+    struct FusedPointGroup {
+        size_t last;        // Index of the last calculator of the run
+        PointLut lut;       // Composition of every LUT of the run
+        Port* input;        // Input port of the first calculator
+        Port* output;       // Output port of the last calculator
+    };
+
+    /**
+     * A calculator bypassed for packets whose flag attachment is false.
+     */
+    struct CalculatorGate {
+        string inputTag;    // Input port whose front packet is checked
+        string outputTag;   // Output port receiving bypassed packets
+        string flagKey;     // Bool attachment, false skips the calculator
+        Packet lastOutput;  // Last packet the calculator wrote, re-emitted when skipped
+    };
+
     vector<unique_ptr<CalculatorBase>> calculators; // List of calculators
     map<string, unique_ptr<CalculatorContext>> contexts; // Calculator contexts
     bool running; // Scheduler running state
     int current_index; // Current calculator index
+    ExecutionMode mode; // Execution mode used by run()
     const int FRAME_RATE; // Target frame rate
     const float FRAME_DURATION; // Frame duration in seconds
     const unsigned long long FRAME_RATE_MS; // Frame duration in microseconds
@@ -54,7 +107,18 @@ private:
     Port inputPort; // Input port for external data
     Port outputPort; // Output port for external data
 
+    vector<CalculatorContext*> orderedContexts; // Contexts in calculator order
+    vector<vector<Port*>> readinessPorts; // Input ports watched per calculator
+    mutex pendingLock; // Protects pendingInput
+    deque<pair<Port*, Packet>> pendingInput; // Packets written from other threads and their target port
+    PortSignal inputSignal; // Wakes the scheduler when input arrives
+    map<size_t, FusedPointGroup> fusedGroups; // Fused runs keyed by their first calculator
+    map<size_t, CalculatorGate> gates; // Gated calculators keyed by their index
+    unsigned long long gatedSkips = 0; // Calculator runs skipped by gates
+
     unique_ptr<void (*)(const Packet&)> callbackWrite; // Output callback
+    unique_ptr<void (*)(const Packet&, void*)> callbackWriteWithContext; // Output callback taking a context
+    void* writeContext = nullptr; // Context for the output callback
     unique_ptr<Packet (*)(void*)> callbackRead; // Input callback
     unique_ptr<void*> context; // Context for input callback
 
@@ -65,6 +129,7 @@ public:
     Scheduler() 
         : running(false), 
           current_index(0), 
+          mode(ExecutionMode::ROUND_ROBIN),
           FRAME_RATE(60), 
           FRAME_DURATION(1.0f / FRAME_RATE), 
           FRAME_RATE_MS(static_cast<unsigned long long>(FRAME_DURATION * 1000000.0f)),
@@ -78,6 +143,7 @@ public:
     Scheduler(int frameRate)
         : running(false),
           current_index(0),
+          mode(ExecutionMode::ROUND_ROBIN),
           FRAME_RATE(frameRate),
           FRAME_DURATION(1.0f / FRAME_RATE),
           FRAME_RATE_MS(static_cast<unsigned long long>(FRAME_DURATION * 1000000.0f)),
@@ -106,7 +172,10 @@ public:
     void registerCalculator(CalculatorBase* calculator,const shared_ptr<map<string,Packet>>& newSidePacket = make_shared<map<string,Packet>>()) {
         calculators.push_back(unique_ptr<CalculatorBase>(calculator));
         unique_ptr<CalculatorContext> context = calculator->registerContext(newSidePacket);
+        orderedContexts.push_back(context.get());
         contexts[calculator->getName()] = std::move(context);
+        readinessPorts.clear();
+        fusedGroups.clear();
     }
 
     /**
@@ -115,6 +184,19 @@ public:
      */
     void registerOutputCallback(void (*cb)(const Packet&)){
         callbackWrite = make_unique<void (*)(const Packet&)>(cb);
+        callbackWriteWithContext.reset();
+    }
+
+    /**
+     * Registers an output callback function and its context, e.g. a
+     * transport sink such as UnixFrameServer::writePacket.
+     * @param cb Function pointer for the output callback.
+     * @param ctx Context pointer passed to the callback.
+     */
+    void registerOutputCallback(void (*cb)(const Packet&, void*), void* ctx){
+        callbackWriteWithContext = make_unique<void (*)(const Packet&, void*)>(cb);
+        writeContext = ctx;
+        callbackWrite.reset();
     }
 
     /**
@@ -127,6 +209,23 @@ public:
         context = make_unique<void *>(ctx);
     }
 
+    /**
+     * Sets the execution mode used by run().
+     * @param newMode The execution mode.
+     */
+    void setExecutionMode(ExecutionMode newMode) {
+        mode = newMode;
+        current_index = 0;
+    }
+
+    /**
+     * Retrieves the execution mode used by run().
+     * @return The current execution mode.
+     */
+    ExecutionMode getExecutionMode() const {
+        return mode;
+    }
+
     /**
      * Connects the calculators and manages internal input and output ports.
      */
@@ -157,14 +256,159 @@ public:
         CalculatorContext* lastContext = 
             getCCByCalculatorName(calculators[calculators.size() - 1]->getName());
         lastContext->bindOutputPort(kTagOutput, outputPort);
+
+        cacheReadinessPorts();
+    }
+
+    /**
+     * Connects an output port of a calculator to an input port of another.
+     * The consumer reads the producer's port directly, no packet is copied.
+     * Several producers may feed distinct input ports of one calculator.
+     * @param fromCalc Name of the producing calculator.
+     * @param fromTag Tag of its output port.
+     * @param toCalc Name of the consuming calculator.
+     * @param toTag Tag of its input port, created if missing.
+     * @throws CalculatorException if a calculator or the output port does not exist.
+     */
+    void connect(const string& fromCalc, const string& fromTag,
+                 const string& toCalc, const string& toTag) {
+        Port& sharedPort = getCCByCalculatorName(fromCalc)->getOutputPort(fromTag);
+        getCCByCalculatorName(toCalc)->bindInputPort(toTag, sharedPort);
+        cacheReadinessPorts();
+    }
+
+    /**
+     * Routes an output port of a calculator to the scheduler's output port,
+     * read by readFromOutputPort() and the output callback.
+     * @param calcName Name of the calculator.
+     * @param tag Tag of its output port.
+     * @throws CalculatorException if the calculator or the port does not exist.
+     */
+    void connectOutput(const string& calcName, const string& tag) {
+        CalculatorContext* cc = getCCByCalculatorName(calcName);
+        cc->getOutputPort(tag);
+        cc->bindOutputPort(tag, outputPort);
+        cacheReadinessPorts();
+    }
+
+    /**
+     * Gates a calculator on a per-packet flag. When the packet at the front
+     * of its input port carries the bool attachment flagKey set to false,
+     * the calculator is not invoked: the packet is consumed and the last
+     * packet the calculator wrote to its output port is written again,
+     * sharing its payload (see Packet::share()), flagged unchanged for
+     * gates further down. Until the
+     * calculator has produced a packet, flagged packets still run it.
+     * Results the calculator publishes elsewhere, e.g. on side output
+     * ports, keep their last values.
+     * Packets without the attachment always run the calculator.
+     * Gated calculators are never fused into point-operation runs, call
+     * this before compilePointOperations().
+     * @param calcName The name of the calculator.
+     * @param inputTag Tag of the input port to check.
+     * @param outputTag Tag of the output port whose last packet is re-emitted.
+     * @param flagKey Name of the bool attachment.
+     * @throws CalculatorException if the calculator does not exist.
+     */
+    void gateCalculator(const string& calcName, const string& inputTag, const string& outputTag,
+                        const string& flagKey = "sceneChanged") {
+        for (size_t i = 0; i < calculators.size(); ++i) {
+            if (calculators[i]->getName() == calcName) {
+                gates[i] = CalculatorGate{inputTag, outputTag, flagKey, Packet()};
+                fusedGroups.clear();
+                return;
+            }
+        }
+        throw CalculatorException("No calculator to gate: " + calcName);
+    }
+
+    /**
+     * Retrieves the number of calculator runs skipped by gates.
+     * @return The skip count since the scheduler was created.
+     */
+    unsigned long long getGatedSkipCount() const {
+        return gatedSkips;
+    }
+
+    /**
+     * Fuses runs of consecutive point operations into single LUT passes.
+     * The first calculator of a run reads its input port, applies the
+     * composed LUT and writes to the output port of the last one, the
+     * calculators in between are never invoked.
+     * Must be called after connectCalculators(), LUTs are built from the
+     * side packets at the time of the call.
+     * @return Number of calculators removed from the execution.
+     */
+    int compilePointOperations() {
+        if (readinessPorts.size() != calculators.size()) {
+            throw CalculatorException("Error: Calculators must be connected before compiling.");
+        }
+        fusedGroups.clear();
+
+        int fused = 0;
+        size_t index = 0;
+        while (index < calculators.size()) {
+            PointLut lut;
+            size_t last = index;
+            while (last < calculators.size()) {
+                PointLut stageLut;
+                if (gates.count(last) > 0) break;
+                if (last > index && !feedsNext(last - 1)) break;
+                if (!getPointLut(last, stageLut)) break;
+                lut = lut.then(stageLut);
+                last++;
+            }
+            if (last - index < 2) {
+                index = max(last, index + 1);
+                continue;
+            }
+
+            PointOperation* firstOperation = dynamic_cast<PointOperation*>(calculators[index].get());
+            PointOperation* lastOperation = dynamic_cast<PointOperation*>(calculators[last - 1].get());
+            fusedGroups[index] = FusedPointGroup{
+                last - 1,
+                lut,
+                &orderedContexts[index]->getInputPort(firstOperation->getPointInputTag()),
+                &orderedContexts[last - 1]->getOutputPort(lastOperation->getPointOutputTag())
+            };
+            fused += static_cast<int>(last - index - 1);
+            index = last;
+        }
+        return fused;
     }
 
     /**
      * Writes a packet to the input port.
+     * Safe to call from another thread, the packet is staged and moved
+     * into the input port by run(), waking the scheduler if it is idle.
      * @param packet The packet to write.
      */
     void writeToInputPort(Packet&& packet) {
-        inputPort.write(std::move(packet));
+        stageInput(&inputPort, std::move(packet));
+    }
+
+    /**
+     * Writes a packet to an input port of a calculator, e.g. one feed
+     * of a calculator with several inputs.
+     * Safe to call from another thread, like writeToInputPort(Packet&&).
+     * @param calcName The name of the calculator.
+     * @param tag The tag of its input port.
+     * @param packet The packet to write.
+     * @throws CalculatorException if the calculator or the port does not exist.
+     */
+    void writeToInputPort(const string& calcName, const string& tag, Packet&& packet) {
+        stageInput(&getCCByCalculatorName(calcName)->getInputPort(tag), std::move(packet));
+    }
+
+    /**
+     * Retrieves a side output port of a calculator.
+     * @param calcName The name of the calculator.
+     * @param tag The tag of the side output port.
+     * @return Reference to the side output port.
+     * @throws CalculatorException if the calculator or the port does not exist.
+     */
+    Port& getSideOutputPort(const string& calcName, const string& tag) {
+        return getCCByCalculatorName(calcName)->getSideOutputPort(tag);
     }
 
     /**
@@ -183,6 +427,7 @@ public:
 
     /**
      * Starts the main loop to run all calculators.
+     * In DEPTH_FIRST mode a single call processes one frame end to end.
      */
     void run() {
 
@@ -198,29 +443,36 @@ public:
         float delta = calculateDeltaTime(startTimeFrame);
         startTimeFrame = getCurrentTime(); 
 
+        if (mode == ExecutionMode::DEPTH_FIRST) {
+            runDepthFirst(delta);
+            return;
+        }
+
         while (running) {
+            unsigned long long seen = inputSignal.getGeneration();
+            pullInput();
 
-            if (callbackRead && *callbackRead) {
-                Packet newPacket = (*callbackRead)(*context);
-                inputPort.write(std::move(newPacket));
+            // Find the next calculator with data on its inputs
+            size_t checked = 0;
+            while (checked < calculators.size() && !isReady(current_index)) {
+                current_index = (current_index + 1) % calculators.size();
+                checked++;
+            }
+            if (checked == calculators.size()) {
+                if (waitForInput(seen)) continue;
+                return;
             }
-
-            // Get the current calculator and context
-            CalculatorBase* currentCalc = calculators[current_index].get();
-            CalculatorContext* currentCC = getCCByCalculatorName(currentCalc->getName());
 
             // Enter, process, and close the calculator
-            currentCalc->enter(currentCC, delta);
-            currentCalc->process(currentCC, delta);
-            currentCalc->close(currentCC, delta);
+            runCalculator(current_index, delta);
 
             // Frame duration enforcement
             unsigned long long endTimeFrame = getCurrentTime();
             unsigned long long elapsedTimeFrame = endTimeFrame - startTimeFrame;
             numOfFrames++;
 
-            if (callbackWrite && *callbackWrite) {
-                (*callbackWrite)(readFromOutputPort());
+            if (hasOutputCallback()) {
+                emitOutput(readFromOutputPort());
             }
 
             if (elapsedTimeFrame >= FRAME_RATE_MS) {
@@ -259,6 +511,243 @@ public:
     }
 
 private:
+    /**
+     * Drives one input packet through every calculator in order.
+     * The output callback fires once for each packet that reached
+     * the output port during this tick.
+     * @param delta Delta time passed to the calculators.
+     */
+    void runDepthFirst(float delta) {
+        unsigned long long seen = inputSignal.getGeneration();
+        pullInput();
+        if (!anyReady()) {
+            if (!waitForInput(seen)) return;
+            pullInput();
+        }
+
+        for (size_t i = 0; i < calculators.size(); ++i) {
+            if (!isReady(i)) continue;
+            runCalculator(i, delta);
+        }
+        numOfFrames++;
+
+        if (hasOutputCallback()) {
+            while (outputPort.size() > 0) {
+                emitOutput(outputPort.read());
+            }
+        }
+    }
+
+    /**
+     * Runs the lifecycle of a calculator, or the LUT pass of the fused
+     * run starting at it.
+     * @param index Index of the calculator.
+     * @param delta Delta time passed to the calculator.
+     */
+    void runCalculator(size_t index, float delta) {
+        auto gate = gates.find(index);
+        if (gate != gates.end()) {
+            if (bypassGate(index, gate->second)) return;
+            runGated(index, gate->second, delta);
+            return;
+        }
+
+        auto group = fusedGroups.find(index);
+        if (group != fusedGroups.end()) {
+            FusedPointGroup& fused = group->second;
+            if (fused.input->size() == 0) return;
+            Packet inputPacket = fused.input->read();
+            Image image = std::move(inputPacket.get<Image>());
+            fused.lut.apply(image);
+            fused.output->write(Packet(std::move(image)));
+            return;
+        }
+
+        CalculatorBase* currentCalc = calculators[index].get();
+        CalculatorContext* currentCC = orderedContexts[index];
+        currentCalc->enter(currentCC, delta);
+        currentCalc->process(currentCC, delta);
+        currentCalc->close(currentCC, delta);
+    }
+
+    /**
+     * Replaces the front packet of a gated calculator by its last output
+     * if the packet is flagged unchanged.
+     * @param index Index of the calculator.
+     * @param gate The gate of the calculator.
+     * @return True if the last output was re-emitted and the calculator must not run.
+     */
+    bool bypassGate(size_t index, CalculatorGate& gate) {
+        CalculatorContext* cc = orderedContexts[index];
+        if (!gate.lastOutput.isValid() || !cc->hasInput(gate.inputTag)) return false;
+        Port& input = cc->getInputPort(gate.inputTag);
+        if (input.size() == 0) return false;
+        const Packet& front = input.peek();
+        if (!front.hasAttachment(gate.flagKey) || front.getAttachment<bool>(gate.flagKey)) {
+            return false;
+        }
+        input.read();
+        Packet result = gate.lastOutput.share();
+        result.attach(gate.flagKey, false);
+        cc->getOutputPort(gate.outputTag).write(std::move(result));
+        gatedSkips++;
+        return true;
+    }
+
+    /**
+     * Runs a gated calculator and keeps a share of the packet it wrote.
+     * @param index Index of the calculator.
+     * @param gate The gate of the calculator.
+     * @param delta Delta time passed to the calculator.
+     */
+    void runGated(size_t index, CalculatorGate& gate, float delta) {
+        CalculatorBase* currentCalc = calculators[index].get();
+        CalculatorContext* currentCC = orderedContexts[index];
+        Port& output = currentCC->getOutputPort(gate.outputTag);
+        const long long previous = output.size() > 0 ? output.peekBack().getTimestamp() : Packet::kInvalidTimestamp;
+        currentCalc->enter(currentCC, delta);
+        currentCalc->process(currentCC, delta);
+        currentCalc->close(currentCC, delta);
+        if (output.size() > 0 && output.peekBack().getTimestamp() != previous) {
+            gate.lastOutput = output.peekBack().share();
+        }
+    }
+
+    /**
+     * Retrieves the LUT of a calculator if it is a point operation.
+     * @param index Index of the calculator.
+     * @param lut Receives the LUT.
+     * @return True if the calculator is a point operation in its current configuration.
+     */
+    bool getPointLut(size_t index, PointLut& lut) {
+        PointOperation* operation = dynamic_cast<PointOperation*>(calculators[index].get());
+        return operation && operation->getPointLut(orderedContexts[index], lut);
+    }
+
+    /**
+     * Checks if an output callback is registered.
+     * @return True if emitOutput() reaches a callback.
+     */
+    bool hasOutputCallback() const {
+        return (callbackWrite && *callbackWrite) || (callbackWriteWithContext && *callbackWriteWithContext);
+    }
+
+    /**
+     * Hands a packet to the registered output callback.
+     * @param packet The packet read from the output port.
+     */
+    void emitOutput(const Packet& packet) {
+        if (callbackWrite && *callbackWrite) {
+            (*callbackWrite)(packet);
+        } else if (callbackWriteWithContext && *callbackWriteWithContext) {
+            (*callbackWriteWithContext)(packet, writeContext);
+        }
+    }
+
+    /**
+     * Moves packets from the input callback and from other threads
+     * into the scheduler input port.
+     */
+    void pullInput() {
+        if (callbackRead && *callbackRead) {
+            Packet newPacket = (*callbackRead)(*context);
+            inputPort.write(std::move(newPacket));
+        }
+
+        lock_guard<mutex> guard(pendingLock);
+        while (!pendingInput.empty()) {
+            pendingInput.front().first->write(std::move(pendingInput.front().second));
+            pendingInput.pop_front();
+        }
+    }
+
+    /**
+     * Stages a packet for a port and wakes the scheduler.
+     * @param port The port the packet is moved into by pullInput().
+     * @param packet The packet to write.
+     */
+    void stageInput(Port* port, Packet&& packet) {
+        {
+            lock_guard<mutex> guard(pendingLock);
+            pendingInput.emplace_back(port, std::move(packet));
+        }
+        inputSignal.notify();
+    }
+
+    /**
+     * Caches the input ports used to decide if a calculator is ready.
+     */
+    void cacheReadinessPorts() {
+        readinessPorts.clear();
+        for (size_t i = 0; i < orderedContexts.size(); ++i) {
+            vector<Port*> ports;
+            for (const string& tag : orderedContexts[i]->getInputPortTags()) {
+                ports.push_back(&orderedContexts[i]->getInputPort(tag));
+            }
+            readinessPorts.push_back(ports);
+        }
+    }
+
+    /**
+     * Checks if a point operation writes to the port read by the next one,
+     * runs of point operations are only fused along such edges.
+     * @param index Index of the first calculator.
+     * @return True if calculator index + 1 reads the point output of index.
+     */
+    bool feedsNext(size_t index) const {
+        PointOperation* current = dynamic_cast<PointOperation*>(calculators[index].get());
+        PointOperation* next = dynamic_cast<PointOperation*>(calculators[index + 1].get());
+        if (!current || !next) return false;
+        CalculatorContext* currentCC = orderedContexts[index];
+        CalculatorContext* nextCC = orderedContexts[index + 1];
+        if (!currentCC->hasOutput(current->getPointOutputTag()) ||
+            !nextCC->hasInput(next->getPointInputTag())) {
+            return false;
+        }
+        return &currentCC->getOutputPort(current->getPointOutputTag()) ==
+               &nextCC->getInputPort(next->getPointInputTag());
+    }
+
+    /**
+     * Checks if a calculator has data to process.
+     * Calculators without input ports, or before connectCalculators()
+     * cached the ports, are always ready.
+     * @param index Index of the calculator.
+     * @return True if any of its input ports holds a packet.
+     */
+    bool isReady(size_t index) const {
+        if (index >= readinessPorts.size() || readinessPorts[index].empty()) {
+            return true;
+        }
+        for (const Port* port : readinessPorts[index]) {
+            if (port->size() > 0) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Checks if any calculator has data to process.
+     * @return True if at least one calculator is ready.
+     */
+    bool anyReady() const {
+        for (size_t i = 0; i < calculators.size(); ++i) {
+            if (isReady(i)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Parks the scheduler until new input arrives or the frame budget
+     * is spent.
+     * @param seen Input generation observed before checking readiness.
+     * @return True if new input arrived, false on timeout.
+     */
+    bool waitForInput(unsigned long long seen) {
+        unsigned long long elapsed = getCurrentTime() - startTimeFrame;
+        if (elapsed >= FRAME_RATE_MS) return false;
+        return inputSignal.wait(seen, FRAME_RATE_MS - elapsed);
+    }
+
     /**
      * Retrieves the current system time in microseconds.
      * @return Current time in microseconds.
@@ -0,0 +1,570 @@
+/**********************************
+ * @file sharedframering.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the SharedFrameRing class, a ring of frame slots in
+ * shared memory connecting a producer and a consumer process.
+ *
+ * @details
+ * - The ring is one mapping of a memfd, or of a POSIX shared memory
+ *   object when it is given a name: a header page with the counters,
+ *   then `slotCount` page aligned slots of `slotBytes` pixel bytes.
+ * - The producer renders into a slot through an ImageView (or copies an
+ *   Image into it) and publishes it, the consumer maps the slot as a
+ *   SharedFrame without copying. A frame crosses processes as a counter
+ *   increment instead of two full copies through a pipe.
+ * - `head` counts published frames and `tail` released ones, 64-bit so
+ *   they never wrap and any slot count maps them to slots. Each side
+ *   has a doorbell futex word, bumped on every change the other side
+ *   waits for: an empty ring parks the consumer on `readBell`, a full
+ *   one parks the producer on `writeBell`. Wakes are only issued when
+ *   the other side is parked, the busy path costs no system call.
+ * - A SharedFrame keeps its slot until its last copy is destroyed, so a
+ *   frame can travel through a pipeline in a Packet. Slots are returned
+ *   to the producer in order.
+ * - readPacket() and readImagePacket() are input callbacks for
+ *   Scheduler::registerInputCallback().
+ *
+ * Constraints:
+ * - One producer and one consumer. Either side may be on any thread,
+ *   SharedFrame copies may be destroyed on any thread.
+ * - Linux only (memfd_create, futex).
+ **********************************/
+
+#ifndef SHARED_FRAME_RING_H
+#define SHARED_FRAME_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "image.h"
+#include "imageview.h"
+#include "packet.h"
+#include "portexception.h"
+
+using namespace std;
+
+static_assert(atomic<uint32_t>::is_always_lock_free && sizeof(atomic<uint32_t>) == 4,
+              "Futex words must be plain 32-bit atomics");
+static_assert(atomic<uint64_t>::is_always_lock_free,
+              "Counters in shared memory must be lock free atomics");
+
+class SharedFrameRing;
+
+/**********************************
+ * Shared state of one mapping of a ring, kept alive by the ring and by
+ * every frame read from it.
+ **********************************/
+struct SharedFrameMapping {
+    /**********************************
+     * Layout of the header page. Counters sit on their own cache lines.
+     **********************************/
+    struct Header {
+        uint32_t magic;                     // kMagic once initialized
+        uint32_t slotCount;                 // Number of slots
+        uint64_t slotBytes;                 // Pixel bytes per slot
+        uint64_t slotStride;                // Bytes from one slot to the next
+        alignas(64) atomic<uint64_t> head;  // Frames published
+        atomic<uint32_t> readBell;          // Bumped on publish and close
+        atomic<uint32_t> readWaiters;       // Consumers parked on readBell
+        alignas(64) atomic<uint64_t> tail;  // Frames released
+        atomic<uint32_t> writeBell;         // Bumped on release and close
+        atomic<uint32_t> writeWaiters;      // Producers parked on writeBell
+        alignas(64) atomic<uint32_t> closed;// Set by close()
+    };
+
+    /**********************************
+     * Description of the frame in a slot, followed by its pixels.
+     **********************************/
+    struct Slot {
+        int32_t width;
+        int32_t height;
+        int32_t format;         // PixelFormat
+        uint32_t reserved;
+        int64_t timestamp;      // Producer timestamp in microseconds
+        uint64_t size;          // Bytes of pixel data
+    };
+
+    static const uint32_t kMagic = 0x46524E47;      // "FRNG"
+    static const size_t kSlotHeaderBytes = 64;      // Pixels start this far into a slot
+
+    uint8_t* base = nullptr;        // Start of the mapping
+    size_t size = 0;                // Bytes mapped
+    int fd = -1;                    // Descriptor of the shared memory
+    mutex releaseLock;              // Protects released
+    vector<bool> released;          // Slots read and released out of order
+
+    ~SharedFrameMapping() {
+        if (base) munmap(base, size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    Header* header() const { return reinterpret_cast<Header*>(base); }
+
+    Slot* slot(uint64_t sequence) const {
+        const Header* h = header();
+        return reinterpret_cast<Slot*>(base + pageSize() + (sequence % h->slotCount) * h->slotStride);
+    }
+
+    uint8_t* pixels(uint64_t sequence) const {
+        return reinterpret_cast<uint8_t*>(slot(sequence)) + kSlotHeaderBytes;
+    }
+
+    /**********************************
+     * Releases a slot read by the consumer. The tail only moves over a
+     * contiguous run of released slots, so slots are reused in order.
+     **********************************/
+    void release(uint64_t sequence) {
+        Header* h = header();
+        lock_guard<mutex> guard(releaseLock);
+        released[sequence % h->slotCount] = true;
+        uint64_t tail = h->tail.load();
+        const uint64_t start = tail;
+        while (tail != h->head.load() && released[tail % h->slotCount]) {
+            released[tail % h->slotCount] = false;
+            ++tail;
+        }
+        if (tail == start) return;
+        h->tail.store(tail);
+        ring(h->writeBell, h->writeWaiters);
+    }
+
+    static size_t pageSize() {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    // Bumps a doorbell, waking its waiters if any is parked
+    static void ring(atomic<uint32_t>& bell, atomic<uint32_t>& waiters) {
+        bell.fetch_add(1);
+        if (waiters.load() > 0) futexWake(&bell);
+    }
+
+    static void futexWake(atomic<uint32_t>* word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    static void futexWait(atomic<uint32_t>* word, uint32_t expected, unsigned long long timeoutUs) {
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(timeoutUs / 1000000);
+        timeout.tv_nsec = static_cast<long>(timeoutUs % 1000000) * 1000;
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+    }
+};
+
+/**********************************
+ * @class SharedFrame
+ * @brief A frame read from a SharedFrameRing, viewed in place.
+ * Copies share the slot, it is released when the last one is destroyed.
+ **********************************/
+class SharedFrame {
+private:
+    /**********************************
+     * Holds a slot while frames refer to it.
+     **********************************/
+    struct Lease {
+        shared_ptr<SharedFrameMapping> mapping;
+        uint64_t sequence;
+
+        Lease(shared_ptr<SharedFrameMapping> newMapping, uint64_t newSequence)
+            : mapping(std::move(newMapping)), sequence(newSequence) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { mapping->release(sequence); }
+    };
+
+    shared_ptr<const Lease> lease;          // Empty for an invalid frame
+    const SharedFrameMapping::Slot* slot = nullptr;
+
+    friend class SharedFrameRing;
+
+    SharedFrame(shared_ptr<SharedFrameMapping> mapping, uint64_t sequence)
+        : lease(make_shared<const Lease>(mapping, sequence)), slot(mapping->slot(sequence)) {}
+
+public:
+    /**********************************
+     * Creates an invalid frame, filled by SharedFrameRing::read().
+     **********************************/
+    SharedFrame() = default;
+
+    bool isValid() const { return lease != nullptr; }
+    int32_t getWidth() const { return slot->width; }
+    int32_t getHeight() const { return slot->height; }
+    PixelFormat getFormat() const { return static_cast<PixelFormat>(slot->format); }
+    long long getTimestamp() const { return slot->timestamp; }
+    size_t getSize() const { return slot->size; }
+
+    /**********************************
+     * Retrieves the pixel data in shared memory.
+     * @return Pointer to getSize() bytes, valid while the frame lives.
+     **********************************/
+    const uint8_t* getData() const {
+        return reinterpret_cast<const uint8_t*>(slot) + SharedFrameMapping::kSlotHeaderBytes;
+    }
+
+    /**********************************
+     * Creates a view over the pixels in shared memory, without copying.
+     * @return The view, valid while the frame lives.
+     **********************************/
+    ConstImageView view() const {
+        const ptrdiff_t stride = (static_cast<ptrdiff_t>(slot->width) * Image::bitsPerPixel(getFormat()) + 7) / 8;
+        return ConstImageView(getData(), slot->width, slot->height, getFormat(), stride);
+    }
+
+    /**********************************
+     * Copies the frame into an Image.
+     * @return The image.
+     * @throws ImageException if the slot holds an invalid frame.
+     **********************************/
+    Image toImage() const {
+        return Image(slot->width, slot->height, getFormat(), vector<uint8_t>(getData(), getData() + slot->size));
+    }
+};
+
+/**********************************
+ * @class SharedFrameRing
+ * @brief Single producer, single consumer ring of frames in shared memory.
+ **********************************/
+class SharedFrameRing {
+private:
+    shared_ptr<SharedFrameMapping> mapping;     // Shared with the frames read
+    uint64_t readCursor = 0;                    // Next frame the consumer reads
+    bool slotAcquired = false;                  // acquire() called, publish() pending
+    int32_t acquiredWidth = 0;                  // Frame described by acquire()
+    int32_t acquiredHeight = 0;
+    PixelFormat acquiredFormat = PixelFormat::UNKNOWN;
+
+public:
+    static const int kDefaultSpinCount = 64;        // Polls before parking on a futex
+    static const uint32_t kMaxSlotCount = 1 << 16;  // Largest ring accepted
+
+    /**********************************
+     * Creates a ring.
+     * @param slotCount Number of frames the ring holds.
+     * @param slotBytes Capacity of each slot in bytes, the largest frame.
+     * @param name Name of a POSIX shared memory object (e.g. "/frames") to
+     *             be opened by another process with open(), or empty for
+     *             an anonymous memfd shared by descriptor.
+     * @return The ring, its reader and writer positions at zero.
+     * @throws PortException if the memory cannot be created or mapped.
+     **********************************/
+    static SharedFrameRing create(uint32_t slotCount, size_t slotBytes, const string& name = "") {
+        if (slotCount == 0 || slotCount > kMaxSlotCount || slotBytes == 0) {
+            throw PortException("Error SharedFrameRing: Invalid slot count or size.");
+        }
+        const size_t page = SharedFrameMapping::pageSize();
+        const size_t slotStride = (SharedFrameMapping::kSlotHeaderBytes + slotBytes + page - 1) / page * page;
+        const size_t size = page + slotStride * slotCount;
+
+        int fd = name.empty() ? memfd_create("SharedFrameRing", MFD_CLOEXEC)
+                              : shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            throw PortException("Error SharedFrameRing: Unable to create shared memory " + name);
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            if (!name.empty()) shm_unlink(name.c_str());
+            throw PortException("Error SharedFrameRing: Unable to size shared memory " + name);
+        }
+        SharedFrameRing ring(map(fd, size));
+        SharedFrameMapping::Header* header = ring.mapping->header();
+        header->slotCount = slotCount;
+        header->slotBytes = slotBytes;
+        header->slotStride = slotStride;
+        atomic_thread_fence(memory_order_release);
+        header->magic = SharedFrameMapping::kMagic;
+        ring.mapping->released.assign(slotCount, false);
+        return ring;
+    }
+
+    /**********************************
+     * Opens a ring created with a name by another process.
+     * @param name Name given to create().
+     * @return The ring.
+     * @throws PortException if the object does not exist or is not a ring.
+     **********************************/
+    static SharedFrameRing open(const string& name) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0) {
+            throw PortException("Error SharedFrameRing: Unable to open shared memory " + name);
+        }
+        return attachOwned(fd);
+    }
+
+    /**********************************
+     * Attaches to a ring from its descriptor, e.g. a memfd inherited
+     * across fork() or received over a Unix socket. The descriptor is
+     * duplicated, the caller keeps its own.
+     * @param fd Descriptor returned by getFd() in another process.
+     * @return The ring.
+     * @throws PortException if the descriptor is not a ring.
+     **********************************/
+    static SharedFrameRing attach(int fd) {
+        int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (copy < 0) {
+            throw PortException("Error SharedFrameRing: Invalid descriptor.");
+        }
+        return attachOwned(copy);
+    }
+
+    /**********************************
+     * Removes the name of a ring created with a name. Mapped rings stay
+     * usable, the memory is freed when the last one is unmapped.
+     * @param name Name given to create().
+     **********************************/
+    static void unlink(const string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    SharedFrameRing(SharedFrameRing&&) = default;
+    SharedFrameRing& operator=(SharedFrameRing&&) = default;
+
+    /**********************************
+     * Retrieves the descriptor of the shared memory, for attach().
+     * @return The descriptor, owned by the ring.
+     **********************************/
+    int getFd() const { return mapping->fd; }
+    uint32_t getSlotCount() const { return mapping->header()->slotCount; }
+    size_t getSlotBytes() const { return mapping->header()->slotBytes; }
+
+    /**********************************
+     * Retrieves the number of frames published and not yet released.
+     * @return The number of slots in use.
+     **********************************/
+    uint32_t size() const {
+        const SharedFrameMapping::Header* header = mapping->header();
+        return static_cast<uint32_t>(header->head.load() - header->tail.load());
+    }
+
+    /**********************************
+     * Marks the ring closed and wakes both sides. The consumer still
+     * reads the frames already published.
+     **********************************/
+    void close() {
+        SharedFrameMapping::Header* header = mapping->header();
+        header->closed.store(1);
+        SharedFrameMapping::ring(header->readBell, header->readWaiters);
+        SharedFrameMapping::ring(header->writeBell, header->writeWaiters);
+    }
+
+    /**********************************
+     * Checks if either side closed the ring.
+     * @return True once close() was called.
+     **********************************/
+    bool isClosed() const {
+        return mapping->header()->closed.load() != 0;
+    }
+
+    /**********************************
+     * Producer: reserves the next slot for a frame and returns a view to
+     * render it in place. Waits while the ring is full.
+     * @param width Width of the frame.
+     * @param height Height of the frame.
+     * @param format Pixel format of the frame, byte addressable.
+     * @param view Receives the view over the slot.
+     * @param timeoutUs Maximum time to wait in microseconds, 0 to poll.
+     * @return False if the ring stayed full or was closed.
+     * @throws PortException if the frame does not fit in a slot.
+     **********************************/
+    bool acquire(int32_t width, int32_t height, PixelFormat format, ImageView& view,
+                 unsigned long long timeoutUs = 0) {
+        const int32_t bits = Image::bitsPerPixel(format);
+        if (width <= 0 || height <= 0 || bits == 0) {
+            throw PortException("Error SharedFrameRing: Invalid frame.");
+        }
+        const size_t stride = (static_cast<size_t>(width) * bits + 7) / 8;
+        if (stride * height > getSlotBytes()) {
+            throw PortException("Error SharedFrameRing: Frame larger than a slot.");
+        }
+        if (!waitWritable(timeoutUs)) return false;
+        view = ImageView(mapping->pixels(mapping->header()->head.load()), width, height, format,
+                         static_cast<ptrdiff_t>(stride));
+        slotAcquired = true;
+        acquiredWidth = width;
+        acquiredHeight = height;
+        acquiredFormat = format;
+        return true;
+    }
+
+    /**********************************
+     * Producer: publishes the frame rendered into the slot of acquire().
+     * @param timestamp Timestamp of the frame, passed to the consumer.
+     * @throws PortException if no slot was acquired.
+     **********************************/
+    void publish(long long timestamp) {
+        if (!slotAcquired) {
+            throw PortException("Error SharedFrameRing: publish without acquire.");
+        }
+        const size_t stride = (static_cast<size_t>(acquiredWidth) * Image::bitsPerPixel(acquiredFormat) + 7) / 8;
+        publishSlot(acquiredWidth, acquiredHeight, acquiredFormat, stride * acquiredHeight, timestamp);
+    }
+
+    /**********************************
+     * Producer: copies an image into the next slot and publishes it.
+     * Compressed images (e.g. PixelFormat::JPEG) are copied as they are.
+     * @param image The frame.
+     * @param timestamp Timestamp of the frame, passed to the consumer.
+     * @param timeoutUs Maximum time to wait for a free slot, 0 to poll.
+     * @return False if the ring stayed full or was closed, the frame is dropped.
+     * @throws PortException if the frame does not fit in a slot.
+     **********************************/
+    bool write(const Image& image, long long timestamp, unsigned long long timeoutUs = 0) {
+        const vector<uint8_t>& data = image.getData();
+        if (data.size() > getSlotBytes()) {
+            throw PortException("Error SharedFrameRing: Frame larger than a slot.");
+        }
+        if (!waitWritable(timeoutUs)) return false;
+        memcpy(mapping->pixels(mapping->header()->head.load()), data.data(), data.size());
+        publishSlot(image.getWidth(), image.getHeight(), image.getFormat(), data.size(), timestamp);
+        return true;
+    }
+
+    /**********************************
+     * Consumer: reads the next frame, waiting while the ring is empty.
+     * The slot is held until the frame and its copies are destroyed.
+     * @param frame Receives the frame.
+     * @param timeoutUs Maximum time to wait in microseconds, 0 to poll.
+     * @return False if no frame arrived, or the ring is closed and drained.
+     **********************************/
+    bool read(SharedFrame& frame, unsigned long long timeoutUs = 0) {
+        SharedFrameMapping::Header* header = mapping->header();
+        const bool ready = waitFor(header->readBell, header->readWaiters, timeoutUs, [&] {
+            return header->head.load() != readCursor;
+        });
+        if (!ready) return false;
+        atomic_thread_fence(memory_order_acquire);
+        frame = SharedFrame(mapping, readCursor++);
+        return true;
+    }
+
+    /**********************************
+     * Input callback reading a frame without copying.
+     * Usage: scheduler.registerInputCallback(SharedFrameRing::readPacket, &ring)
+     * @param ring Pointer to the consumer's SharedFrameRing.
+     * @return A Packet holding a SharedFrame, or an empty Packet when the ring is empty.
+     **********************************/
+    static Packet readPacket(void* ring) {
+        SharedFrame frame;
+        if (!static_cast<SharedFrameRing*>(ring)->read(frame)) return Packet();
+        return Packet(std::move(frame));
+    }
+
+    /**********************************
+     * Input callback copying a frame into an Image, for calculators that
+     * read Image packets. The slot is released at once.
+     * @param ring Pointer to the consumer's SharedFrameRing.
+     * @return A Packet holding an Image, or an empty Packet when the ring is empty.
+     **********************************/
+    static Packet readImagePacket(void* ring) {
+        SharedFrame frame;
+        if (!static_cast<SharedFrameRing*>(ring)->read(frame)) return Packet();
+        return Packet(frame.toImage());
+    }
+
+private:
+    explicit SharedFrameRing(shared_ptr<SharedFrameMapping> newMapping) : mapping(std::move(newMapping)) {}
+
+    static shared_ptr<SharedFrameMapping> map(int fd, size_t size) {
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            ::close(fd);
+            throw PortException("Error SharedFrameRing: Unable to map shared memory.");
+        }
+        auto result = make_shared<SharedFrameMapping>();
+        result->base = static_cast<uint8_t*>(base);
+        result->size = size;
+        result->fd = fd;
+        return result;
+    }
+
+    static SharedFrameRing attachOwned(int fd) {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < SharedFrameMapping::pageSize()) {
+            ::close(fd);
+            throw PortException("Error SharedFrameRing: Not a frame ring.");
+        }
+        SharedFrameRing ring(map(fd, static_cast<size_t>(info.st_size)));
+        const SharedFrameMapping::Header* header = ring.mapping->header();
+        const size_t expected = SharedFrameMapping::pageSize() + header->slotStride * header->slotCount;
+        if (header->magic != SharedFrameMapping::kMagic || header->slotCount == 0 ||
+            header->slotCount > kMaxSlotCount || expected != ring.mapping->size) {
+            throw PortException("Error SharedFrameRing: Not a frame ring.");
+        }
+        atomic_thread_fence(memory_order_acquire);
+        ring.mapping->released.assign(header->slotCount, false);
+        ring.readCursor = header->tail.load();
+        return ring;
+    }
+
+    bool waitWritable(unsigned long long timeoutUs) {
+        SharedFrameMapping::Header* header = mapping->header();
+        const uint32_t slotCount = header->slotCount;
+        return waitFor(header->writeBell, header->writeWaiters, timeoutUs, [&] {
+            return header->head.load() - header->tail.load() < slotCount;
+        }) && !isClosed();
+    }
+
+    void publishSlot(int32_t width, int32_t height, PixelFormat format, size_t size, long long timestamp) {
+        SharedFrameMapping::Header* header = mapping->header();
+        const uint64_t head = header->head.load();
+        SharedFrameMapping::Slot* slot = mapping->slot(head);
+        slot->width = width;
+        slot->height = height;
+        slot->format = static_cast<int32_t>(format);
+        slot->timestamp = timestamp;
+        slot->size = size;
+        header->head.store(head + 1);
+        SharedFrameMapping::ring(header->readBell, header->readWaiters);
+        slotAcquired = false;
+    }
+
+    /**********************************
+     * Polls a condition, then parks on a doorbell until it holds, the
+     * ring is closed or the timeout expires. The bell is read and the
+     * waiter count raised before the last check, so a change made after
+     * it either fails the futex wait or sees the waiter and wakes it.
+     **********************************/
+    template <typename Condition>
+    bool waitFor(atomic<uint32_t>& bell, atomic<uint32_t>& waiters, unsigned long long timeoutUs,
+                 Condition condition) {
+        if (condition()) return true;
+        if (timeoutUs == 0) return false;
+        for (int i = 0; i < kDefaultSpinCount; ++i) {
+            if (condition()) return true;
+            if (isClosed()) return false;
+            this_thread::yield();
+        }
+
+        const auto deadline = chrono::steady_clock::now() + chrono::microseconds(timeoutUs);
+        while (true) {
+            const uint32_t seen = bell.load();
+            waiters.fetch_add(1);
+            if (condition() || isClosed()) {
+                waiters.fetch_sub(1);
+                return condition();
+            }
+            const auto now = chrono::steady_clock::now();
+            if (now >= deadline) {
+                waiters.fetch_sub(1);
+                return false;
+            }
+            SharedFrameMapping::futexWait(&bell, seen,
+                chrono::duration_cast<chrono::microseconds>(deadline - now).count() + 1);
+            waiters.fetch_sub(1);
+        }
+    }
+};
+
+#endif // SHARED_FRAME_RING_H
@@ -0,0 +1,132 @@
+/**********************************
+ * @file staticpipeline.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the StaticPipeline class template, a compile-time
+ * alternative to the Scheduler for fixed graphs.
+ *
+ * @details
+ * - Stages are composed as template parameters and stored by value.
+ * - The Image is passed between stages by reference, no Port or
+ *   Packet is created between stages.
+ * - Calls are resolved at compile time so the compiler can inline and
+ *   fuse the stage loops.
+ * - Lifecycle hooks (`enter`, `close`) are optional, a stage that does
+ *   not define them costs nothing.
+ *
+ * Stage requirements:
+ * - `void process(Image& image)` is mandatory.
+ * - `void enter(Image& image)` and `void close(Image& image)` are optional.
+ *
+ * Constraints:
+ * - The graph is a fixed linear chain, use the Scheduler for
+ *   configurable graphs.
+ **********************************/
+
+#ifndef STATIC_PIPELINE_H
+#define STATIC_PIPELINE_H
+
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "image.h"
+
+using namespace std;
+
+/**********************************
+ * Detects if a stage defines `enter(Image&)`.
+ **********************************/
+template <typename Stage, typename = void>
+struct HasEnterHook : false_type {};
+
+template <typename Stage>
+struct HasEnterHook<Stage,
+    void_t<decltype(declval<Stage&>().enter(declval<Image&>()))>> : true_type {};
+
+/**********************************
+ * Detects if a stage defines `close(Image&)`.
+ **********************************/
+template <typename Stage, typename = void>
+struct HasCloseHook : false_type {};
+
+template <typename Stage>
+struct HasCloseHook<Stage,
+    void_t<decltype(declval<Stage&>().close(declval<Image&>()))>> : true_type {};
+
+/**********************************
+ * @class StaticPipeline
+ * @brief Runs a fixed chain of stages on an Image in place.
+ * @tparam Stages The stage types, in execution order.
+ **********************************/
+template <typename... Stages>
+class StaticPipeline {
+private:
+    tuple<Stages...> stages;    // Stage instances in execution order
+
+public:
+    /**********************************
+     * Default constructor.
+     * Default constructs every stage.
+     **********************************/
+    StaticPipeline() = default;
+
+    /**********************************
+     * Constructs the pipeline from configured stages.
+     * @param newStages The stage instances, in execution order.
+     **********************************/
+    explicit StaticPipeline(Stages... newStages)
+        : stages(std::move(newStages)...) {}
+
+    /**********************************
+     * Runs every stage on the image.
+     * @param image The image to process in place.
+     **********************************/
+    void process(Image& image) {
+        processStages(image, index_sequence_for<Stages...>{});
+    }
+
+    /**********************************
+     * Retrieves a stage by position.
+     * @tparam I Index of the stage.
+     * @return A reference to the stage.
+     **********************************/
+    template <size_t I>
+    auto& getStage() {
+        return get<I>(stages);
+    }
+
+    /**********************************
+     * Retrieves the number of stages.
+     * @return Number of stages in the pipeline.
+     **********************************/
+    static constexpr size_t size() {
+        return sizeof...(Stages);
+    }
+
+private:
+    /**********************************
+     * Expands the stage tuple in order.
+     * @param image The image to process in place.
+     **********************************/
+    template <size_t... I>
+    void processStages(Image& image, index_sequence<I...>) {
+        (processStage(get<I>(stages), image), ...);
+    }
+
+    /**********************************
+     * Runs the lifecycle of a single stage.
+     * @param stage The stage to run.
+     * @param image The image to process in place.
+     **********************************/
+    template <typename Stage>
+    static void processStage(Stage& stage, Image& image) {
+        if constexpr (HasEnterHook<Stage>::value) {
+            stage.enter(image);
+        }
+        stage.process(image);
+        if constexpr (HasCloseHook<Stage>::value) {
+            stage.close(image);
+        }
+    }
+};
+
+#endif // STATIC_PIPELINE_H
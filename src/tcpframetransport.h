@@ -0,0 +1,536 @@
+/**********************************
+ * @file tcpframetransport.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines TcpFrameSender and TcpFrameReceiver, a frame transport
+ * over TCP connecting graph segments on different hosts.
+ *
+ * @details
+ * - Each frame travels as a 28 byte header (format, size, timestamp)
+ *   followed by its pixel data. Compressed images are sent as they are.
+ * - Small frames (thumbnails, JPEG frames) are batched into one buffer
+ *   and sent with a single system call once the batch is full, old, or
+ *   flushed. Large frames are sent with one gathered write of the
+ *   pending batch, the header and the pixels, which are never copied in
+ *   user space.
+ * - Credit-based flow control: the receiver grants a window of frames
+ *   and returns credits as the application consumes them. A sender out
+ *   of credits waits for the receiver instead of buffering, so a slow
+ *   remote segment slows down its producer.
+ * - writePacket() is an output callback and readPacket() an input
+ *   callback for the Scheduler.
+ *
+ * - The receiver listens on loopback unless given another address, and
+ *   checks each header against the frame size it implies before
+ *   allocating the pixel data.
+ *
+ * Constraints:
+ * - One sender per receiver, each used from one thread at a time.
+ * - Integers are little endian on the wire.
+ **********************************/
+
+#ifndef TCP_FRAME_TRANSPORT_H
+#define TCP_FRAME_TRANSPORT_H
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+#include "image.h"
+#include "packet.h"
+#include "portexception.h"
+
+using namespace std;
+
+/**********************************
+ * Wire format shared by TcpFrameSender and TcpFrameReceiver.
+ * - Frame: kind, format, 2 reserved bytes, width, height (32 bits),
+ *   timestamp, size (64 bits), then size bytes of pixel data.
+ * - Credit: kind, 3 reserved bytes, frames granted (32 bits).
+ **********************************/
+struct TcpFrameProtocol {
+    enum Kind : uint8_t {
+        FRAME = 1,
+        CREDIT = 2,
+    };
+
+    static constexpr size_t kFrameHeaderBytes = 28;
+    static constexpr size_t kCreditBytes = 8;
+
+    static void putU32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    static void putU64(uint8_t* out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    static uint32_t getU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = value << 8 | in[i];
+        return value;
+    }
+
+    static uint64_t getU64(const uint8_t* in) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = value << 8 | in[i];
+        return value;
+    }
+
+    // Waits for a descriptor to become readable, 0 polls
+    static bool waitReadable(int fd, unsigned long long timeoutUs) {
+        pollfd ready = {fd, POLLIN, 0};
+        const int timeoutMs = static_cast<int>(min<unsigned long long>((timeoutUs + 999) / 1000, INT32_MAX));
+        int polled;
+        do {
+            polled = poll(&ready, 1, timeoutMs);
+        } while (polled < 0 && errno == EINTR);
+        return polled > 0;
+    }
+};
+
+/**********************************
+ * @class TcpFrameSender
+ * @brief Sends frames to a TcpFrameReceiver within the credits it grants.
+ **********************************/
+class TcpFrameSender {
+private:
+    int fd = -1;                        // Connected socket
+    uint32_t credits = 0;               // Frames the receiver can take
+    bool closed = false;                // The receiver went away
+    vector<uint8_t> batch;              // Small frames not sent yet
+    chrono::steady_clock::time_point batchStart;    // When the first of them was queued
+    uint8_t creditBuffer[TcpFrameProtocol::kCreditBytes];   // Partial credit message
+    size_t creditBytes = 0;             // Bytes in creditBuffer
+    unsigned long long writes = 0;      // System calls that sent data
+    unsigned long long stalls = 0;      // Sends that waited for credits
+
+public:
+    static constexpr size_t kSmallFrameBytes = 16 * 1024;   // Frames batched up to this size
+    static constexpr size_t kBatchBytes = 64 * 1024;        // Batches sent at this size
+    static constexpr unsigned long long kMaxBatchDelayUs = 2000;    // Batches sent at this age
+    static constexpr unsigned long long kDefaultTimeoutUs = 1000000;
+
+    /**********************************
+     * Connects to a receiver.
+     * @param host Name or address of the receiver.
+     * @param port Port of the receiver.
+     * @throws PortException if the receiver cannot be reached.
+     **********************************/
+    TcpFrameSender(const string& host, uint16_t port) {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses) != 0) {
+            throw PortException("Error TcpFrameSender: Unknown host " + host);
+        }
+        for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+            fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+            if (fd >= 0 && ::connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) {
+            throw PortException("Error TcpFrameSender: Unable to connect to " + host + ":" + to_string(port));
+        }
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    TcpFrameSender(const TcpFrameSender&) = delete;
+    TcpFrameSender& operator=(const TcpFrameSender&) = delete;
+
+    /**********************************
+     * Sends the pending batch and closes the connection.
+     **********************************/
+    ~TcpFrameSender() {
+        try {
+            flush();
+        } catch (const PortException&) {
+        }
+        ::close(fd);
+    }
+
+    bool isClosed() const { return closed; }
+    uint32_t getCredits() const { return credits; }
+    unsigned long long getWriteCount() const { return writes; }
+    unsigned long long getStallCount() const { return stalls; }
+
+    /**********************************
+     * Sends a frame, waiting for a credit if the receiver is behind.
+     * @param image The frame.
+     * @param timestamp Timestamp of the frame, passed to the receiver.
+     * @param timeoutUs Maximum time to wait for a credit, 0 to poll.
+     * @return False if no credit arrived in time or the receiver is gone,
+     *         the frame is not sent.
+     * @throws PortException if the connection fails.
+     **********************************/
+    bool send(const Image& image, long long timestamp, unsigned long long timeoutUs = kDefaultTimeoutUs) {
+        if (!acquireCredit(timeoutUs)) return false;
+        const vector<uint8_t>& data = image.getData();
+        uint8_t header[TcpFrameProtocol::kFrameHeaderBytes] = {};
+        header[0] = TcpFrameProtocol::FRAME;
+        header[1] = static_cast<uint8_t>(image.getFormat());
+        TcpFrameProtocol::putU32(header + 4, static_cast<uint32_t>(image.getWidth()));
+        TcpFrameProtocol::putU32(header + 8, static_cast<uint32_t>(image.getHeight()));
+        TcpFrameProtocol::putU64(header + 12, static_cast<uint64_t>(timestamp));
+        TcpFrameProtocol::putU64(header + 20, data.size());
+        credits--;
+
+        if (sizeof(header) + data.size() <= kSmallFrameBytes) {
+            if (batch.empty()) batchStart = chrono::steady_clock::now();
+            batch.insert(batch.end(), header, header + sizeof(header));
+            batch.insert(batch.end(), data.begin(), data.end());
+            if (batch.size() >= kBatchBytes) flush();
+            else flushIfDue();
+            return true;
+        }
+
+        iovec pieces[3];
+        int count = 0;
+        if (!batch.empty()) pieces[count++] = {batch.data(), batch.size()};
+        pieces[count++] = {header, sizeof(header)};
+        pieces[count++] = {const_cast<uint8_t*>(data.data()), data.size()};
+        sendAll(pieces, count);
+        batch.clear();
+        return true;
+    }
+
+    /**********************************
+     * Sends the batched frames now.
+     * @throws PortException if the connection fails.
+     **********************************/
+    void flush() {
+        if (batch.empty() || closed) return;
+        iovec piece = {batch.data(), batch.size()};
+        sendAll(&piece, 1);
+        batch.clear();
+    }
+
+    /**********************************
+     * Sends the batched frames if the oldest waited kMaxBatchDelayUs.
+     * @throws PortException if the connection fails.
+     **********************************/
+    void flushIfDue() {
+        if (!batch.empty() && chrono::steady_clock::now() - batchStart >= chrono::microseconds(kMaxBatchDelayUs)) {
+            flush();
+        }
+    }
+
+    /**********************************
+     * Output callback sending Image packets. Other packets, including the
+     * empty ones of idle ticks, only send a batch that is due.
+     * Usage: scheduler.registerOutputCallback(TcpFrameSender::writePacket, &sender)
+     * @param packet The packet from the scheduler's output port.
+     * @param sender Pointer to the TcpFrameSender.
+     **********************************/
+    static void writePacket(const Packet& packet, void* sender) {
+        TcpFrameSender* target = static_cast<TcpFrameSender*>(sender);
+        if (packet.isValid()) {
+            try {
+                target->send(packet.get<Image>(), packet.getTimestamp());
+                return;
+            } catch (const PacketException&) {
+            }
+        }
+        target->flushIfDue();
+    }
+
+private:
+    /**********************************
+     * Takes the credits already received, then waits for one. The batch
+     * is flushed first, the receiver grants nothing for frames it has
+     * not seen.
+     **********************************/
+    bool acquireCredit(unsigned long long timeoutUs) {
+        readCredits();
+        if (credits > 0) return true;
+        if (closed) return false;
+        flush();
+        stalls++;
+        const auto deadline = chrono::steady_clock::now() + chrono::microseconds(timeoutUs);
+        while (credits == 0 && !closed) {
+            const auto now = chrono::steady_clock::now();
+            if (now >= deadline && timeoutUs > 0) return false;
+            const unsigned long long remaining = now >= deadline ? 0 :
+                chrono::duration_cast<chrono::microseconds>(deadline - now).count();
+            if (!TcpFrameProtocol::waitReadable(fd, remaining)) return false;
+            readCredits();
+        }
+        return credits > 0;
+    }
+
+    // Reads the credit messages available without blocking
+    void readCredits() {
+        uint8_t buffer[512];
+        while (!closed) {
+            const ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received == 0) {
+                closed = true;
+                return;
+            }
+            if (received < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) closed = true;
+                return;
+            }
+            for (ssize_t i = 0; i < received; ++i) {
+                creditBuffer[creditBytes++] = buffer[i];
+                if (creditBytes < TcpFrameProtocol::kCreditBytes) continue;
+                creditBytes = 0;
+                if (creditBuffer[0] != TcpFrameProtocol::CREDIT) {
+                    throw PortException("Error TcpFrameSender: Invalid message from receiver.");
+                }
+                credits += TcpFrameProtocol::getU32(creditBuffer + 4);
+            }
+        }
+    }
+
+    void sendAll(iovec* pieces, int count) {
+        msghdr message = {};
+        message.msg_iov = pieces;
+        message.msg_iovlen = count;
+        while (message.msg_iovlen > 0) {
+            ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                closed = true;
+                throw PortException("Error TcpFrameSender: Connection lost.");
+            }
+            writes++;
+            // Skip what was sent, the last piece may be partial
+            while (message.msg_iovlen > 0 && static_cast<size_t>(sent) >= message.msg_iov->iov_len) {
+                sent -= message.msg_iov->iov_len;
+                message.msg_iov++;
+                message.msg_iovlen--;
+            }
+            if (sent > 0) {
+                message.msg_iov->iov_base = static_cast<uint8_t*>(message.msg_iov->iov_base) + sent;
+                message.msg_iov->iov_len -= sent;
+            }
+        }
+    }
+};
+
+/**********************************
+ * @class TcpFrameReceiver
+ * @brief Accepts one TcpFrameSender and receives its frames.
+ **********************************/
+class TcpFrameReceiver {
+private:
+    int listenFd = -1;                  // Listening socket
+    int fd = -1;                        // Connection of the sender
+    uint16_t port = 0;                  // Listening port
+    uint32_t window;                    // Frames granted at once
+    uint64_t maxFrameBytes;             // Largest frame accepted
+    uint32_t pendingCredits = 0;        // Frames consumed, not yet granted again
+    bool closed = false;                // The sender went away
+    vector<uint8_t> buffer;             // Bytes received, not yet parsed
+    size_t begin = 0;                   // First unparsed byte
+    size_t end = 0;                     // End of the received bytes
+
+public:
+    static constexpr uint32_t kDefaultWindow = 8;       // Frames in flight
+    static constexpr size_t kBufferBytes = 256 * 1024;  // Receive buffer
+    static constexpr int kStallTimeoutMs = 5000;        // Longest pause inside a frame
+    static constexpr uint64_t kDefaultMaxFrameBytes = 256ull << 20;   // Fits an 8K RGBA frame
+
+    /**********************************
+     * Listens for a sender.
+     * @param listenPort Port to listen on, 0 picks a free one (see getPort()).
+     * @param newWindow Frames the sender may have in flight.
+     * @param bindAddress Local address to listen on, "0.0.0.0" for every interface.
+     * @param newMaxFrameBytes Largest frame accepted, raw or compressed.
+     * @throws PortException if the socket cannot be created.
+     **********************************/
+    explicit TcpFrameReceiver(uint16_t listenPort = 0, uint32_t newWindow = kDefaultWindow,
+                              const string& bindAddress = "127.0.0.1",
+                              uint64_t newMaxFrameBytes = kDefaultMaxFrameBytes)
+        : window(max<uint32_t>(1, newWindow)), maxFrameBytes(newMaxFrameBytes), buffer(kBufferBytes) {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(listenPort);
+        int enable = 1;
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0 || inet_pton(AF_INET, bindAddress.c_str(), &address.sin_addr) != 1 ||
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0 ||
+            ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, 1) != 0) {
+            if (listenFd >= 0) ::close(listenFd);
+            throw PortException("Error TcpFrameReceiver: Unable to listen on port " + to_string(listenPort));
+        }
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+    }
+
+    TcpFrameReceiver(const TcpFrameReceiver&) = delete;
+    TcpFrameReceiver& operator=(const TcpFrameReceiver&) = delete;
+
+    ~TcpFrameReceiver() {
+        if (fd >= 0) ::close(fd);
+        ::close(listenFd);
+    }
+
+    uint16_t getPort() const { return port; }
+    bool isConnected() const { return fd >= 0; }
+    bool isClosed() const { return closed; }
+
+    /**********************************
+     * Accepts the sender and grants it the first window of credits.
+     * Called by receive() when no sender is connected.
+     * @param timeoutUs Maximum time to wait in microseconds, 0 to poll.
+     * @return True if a sender is connected.
+     **********************************/
+    bool accept(unsigned long long timeoutUs = 0) {
+        if (fd >= 0) return true;
+        if (!TcpFrameProtocol::waitReadable(listenFd, timeoutUs)) return false;
+        fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) return false;
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        timeval stall = {kStallTimeoutMs / 1000, (kStallTimeoutMs % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &stall, sizeof(stall));
+        grant(window);
+        return true;
+    }
+
+    /**********************************
+     * Checks a frame header before its pixel data is allocated.
+     * Raw frames must hold exactly their rows, every frame must fit maxFrameBytes.
+     * @param header The frame header.
+     * @param size Size of the pixel data announced by the header.
+     * @return True if the header describes a valid frame.
+     **********************************/
+    bool headerMatches(const uint8_t* header, uint64_t size) const {
+        if (header[0] != TcpFrameProtocol::FRAME || size == 0 || size > maxFrameBytes) return false;
+        const int32_t width = static_cast<int32_t>(TcpFrameProtocol::getU32(header + 4));
+        const int32_t height = static_cast<int32_t>(TcpFrameProtocol::getU32(header + 8));
+        const PixelFormat format = static_cast<PixelFormat>(header[1]);
+        if (width <= 0 || height <= 0) return false;
+        if (Image::isCompressed(format)) return true;
+        if (Image::bitsPerPixel(format) == 0) return false;
+        const uint64_t stride = (static_cast<uint64_t>(width) * Image::bitsPerPixel(format) + 7) / 8;
+        return size == stride * static_cast<uint64_t>(height);
+    }
+
+    /**********************************
+     * Receives the next frame and returns its credit to the sender.
+     * @param packet Receives a Packet holding the frame as an Image.
+     * @param timestamp Receives the timestamp given by the sender.
+     * @param timeoutUs Maximum time to wait for a frame to start, 0 to poll.
+     * @return False if no frame arrived or the sender is gone.
+     * @throws PortException if the sender stalls inside a frame or sends
+     *         invalid data.
+     **********************************/
+    bool receive(Packet& packet, long long& timestamp, unsigned long long timeoutUs = 0) {
+        if (closed || !accept(timeoutUs)) return false;
+        if (begin == end && (!TcpFrameProtocol::waitReadable(fd, timeoutUs) || !fill())) return false;
+
+        uint8_t header[TcpFrameProtocol::kFrameHeaderBytes];
+        readExact(header, sizeof(header));
+        const uint64_t size = TcpFrameProtocol::getU64(header + 20);
+        if (!headerMatches(header, size)) {
+            throw PortException("Error TcpFrameReceiver: Invalid frame header.");
+        }
+        vector<uint8_t> data(size);
+        readExact(data.data(), size);
+        try {
+            packet = Packet(Image(static_cast<int32_t>(TcpFrameProtocol::getU32(header + 4)),
+                                  static_cast<int32_t>(TcpFrameProtocol::getU32(header + 8)),
+                                  static_cast<PixelFormat>(header[1]), std::move(data)));
+        } catch (const ImageException&) {
+            throw PortException("Error TcpFrameReceiver: Invalid frame.");
+        }
+        timestamp = static_cast<long long>(TcpFrameProtocol::getU64(header + 12));
+
+        if (++pendingCredits >= max<uint32_t>(1, window / 2)) {
+            grant(pendingCredits);
+            pendingCredits = 0;
+        }
+        return true;
+    }
+
+    /**********************************
+     * Input callback reading the next frame, without waiting.
+     * Usage: scheduler.registerInputCallback(TcpFrameReceiver::readPacket, &receiver)
+     * @param receiver Pointer to the TcpFrameReceiver.
+     * @return A Packet holding an Image, or an empty Packet when none is pending.
+     **********************************/
+    static Packet readPacket(void* receiver) {
+        Packet packet;
+        long long timestamp = 0;
+        static_cast<TcpFrameReceiver*>(receiver)->receive(packet, timestamp);
+        return packet;
+    }
+
+private:
+    void grant(uint32_t count) {
+        uint8_t message[TcpFrameProtocol::kCreditBytes] = {TcpFrameProtocol::CREDIT};
+        TcpFrameProtocol::putU32(message + 4, count);
+        // A sender that is gone shows up as the end of the stream on the next read
+        while (::send(fd, message, sizeof(message), MSG_NOSIGNAL) < 0 && errno == EINTR) {
+        }
+    }
+
+    // Reads more bytes into the buffer, false at the end of the stream
+    bool fill() {
+        if (begin == end) begin = end = 0;
+        while (true) {
+            const ssize_t received = recv(fd, buffer.data() + end, buffer.size() - end, 0);
+            if (received > 0) {
+                end += static_cast<size_t>(received);
+                return true;
+            }
+            if (received < 0 && errno == EINTR) continue;
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                throw PortException("Error TcpFrameReceiver: Sender stalled.");
+            }
+            closed = true;
+            return false;
+        }
+    }
+
+    // Reads bytes from the buffer, large remainders straight from the socket
+    void readExact(uint8_t* out, size_t size) {
+        while (size > 0) {
+            if (begin == end) {
+                if (size >= buffer.size() / 2) {
+                    const ssize_t received = recv(fd, out, size, MSG_WAITALL);
+                    if (received > 0) {
+                        out += received;
+                        size -= static_cast<size_t>(received);
+                        continue;
+                    }
+                    if (received < 0 && errno == EINTR) continue;
+                    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        throw PortException("Error TcpFrameReceiver: Sender stalled.");
+                    }
+                    closed = true;
+                    throw PortException("Error TcpFrameReceiver: Truncated frame.");
+                }
+                if (!fill()) throw PortException("Error TcpFrameReceiver: Truncated frame.");
+            }
+            const size_t count = min(size, end - begin);
+            memcpy(out, buffer.data() + begin, count);
+            begin += count;
+            out += count;
+            size -= count;
+        }
+    }
+};
+
+#endif // TCP_FRAME_TRANSPORT_H
@@ -0,0 +1,296 @@
+/**********************************
+ * @file thresholdmap.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines the ThresholdMap class used by ordered dithering.
+ *
+ * @details
+ * - Bayer matrices of any power-of-two size are generated at compile
+ *   time with makeBayerMatrix<Size>().
+ * - Tileable blue-noise maps can be loaded from an image or generated
+ *   with the void-and-cluster method.
+ * - Thresholds are stored as ranks in [0, levels) and expanded one row
+ *   at a time into 16.16 fixed point, so the dither inner loop is an
+ *   integer add, a shift and a table lookup.
+ *   https://en.wikipedia.org/wiki/Ordered_dithering
+ *
+ * Constraints:
+ * - Width, height and the number of levels must be powers of two,
+ *   tiling uses masks instead of a modulo per pixel.
+ * - The number of levels is limited to 65536.
+ **********************************/
+
+#ifndef THRESHOLD_MAP_H
+#define THRESHOLD_MAP_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include "image.h"
+
+using namespace std;
+
+/**********************************
+ * Generates a Bayer matrix at compile time.
+ * Each doubling step is M(2n) = 4 * M(n) + {0, 2; 3, 1}, so the top
+ * coordinate bits select the lowest bits of the rank.
+ * @tparam Size Side of the matrix, a power of two.
+ * @return The ranks in row-major order, in [0, Size * Size).
+ **********************************/
+template <int32_t Size>
+constexpr array<uint16_t, Size * Size> makeBayerMatrix() {
+    static_assert(Size >= 2 && Size <= 256 && (Size & (Size - 1)) == 0,
+                  "Bayer matrix size must be a power of two up to 256");
+    constexpr int32_t quadrant[4] = {0, 2, 3, 1};
+    array<uint16_t, Size * Size> matrix{};
+    for (int32_t y = 0; y < Size; ++y) {
+        for (int32_t x = 0; x < Size; ++x) {
+            int32_t rank = 0;
+            int32_t weight = 1;
+            for (int32_t bit = Size / 2; bit > 0; bit /= 2) {
+                int32_t index = ((x & bit) ? 1 : 0) + ((y & bit) ? 2 : 0);
+                rank += quadrant[index] * weight;
+                weight *= 4;
+            }
+            matrix[y * Size + x] = static_cast<uint16_t>(rank);
+        }
+    }
+    return matrix;
+}
+
+/**********************************
+ * @class ThresholdMap
+ * @brief Tileable threshold map for ordered dithering.
+ **********************************/
+class ThresholdMap {
+private:
+    int32_t width;              // Width of the tile, a power of two
+    int32_t height;             // Height of the tile, a power of two
+    int32_t levels;             // Number of distinct thresholds, a power of two
+    vector<uint16_t> ranks;     // Threshold ranks in row-major order
+
+public:
+    static const int32_t kFixedShift = 16;              // Fractional bits of expanded thresholds
+    static const int32_t kFixedOne = 1 << kFixedShift;  // 1.0 in fixed point
+    static const int32_t kMaxBayerLevel = 5;            // Largest runtime Bayer level, 64x64
+
+    /**********************************
+     * Constructor.
+     * @param newWidth Width of the tile.
+     * @param newHeight Height of the tile.
+     * @param newLevels Number of distinct thresholds.
+     * @param newRanks Ranks in [0, newLevels) in row-major order.
+     * @throws ImageException if a size is not a power of two or the ranks do not fit.
+     **********************************/
+    ThresholdMap(int32_t newWidth, int32_t newHeight, int32_t newLevels, vector<uint16_t> newRanks)
+        : width(newWidth), height(newHeight), levels(newLevels), ranks(std::move(newRanks)) {
+        if (!isPowerOfTwo(width) || !isPowerOfTwo(height) ||
+            !isPowerOfTwo(levels) || levels > kFixedOne) {
+            throw ImageException("Invalid threshold map: sizes and levels must be powers of two.");
+        }
+        if (ranks.size() != static_cast<size_t>(width) * height) {
+            throw ImageException("Invalid threshold map: rank count does not match the size.");
+        }
+    }
+
+    /**********************************
+     * Builds a Bayer threshold map from a compile-time matrix.
+     * @tparam Size Side of the matrix, a power of two.
+     * @return The threshold map.
+     **********************************/
+    template <int32_t Size>
+    static ThresholdMap bayer() {
+        static constexpr array<uint16_t, Size * Size> matrix = makeBayerMatrix<Size>();
+        return ThresholdMap(Size, Size, Size * Size, vector<uint16_t>(matrix.begin(), matrix.end()));
+    }
+
+    /**********************************
+     * Retrieves the shared Bayer map for a dither level.
+     * @param level Bayer level, the matrix side is 2 << level.
+     * Levels are clamped to [0, kMaxBayerLevel].
+     * @return A reference to the cached threshold map.
+     **********************************/
+    static const ThresholdMap& bayerForLevel(int level) {
+        static const ThresholdMap maps[kMaxBayerLevel + 1] = {
+            bayer<2>(), bayer<4>(), bayer<8>(), bayer<16>(), bayer<32>(), bayer<64>()
+        };
+        return maps[std::clamp(level, 0, static_cast<int>(kMaxBayerLevel))];
+    }
+
+    /**********************************
+     * Builds a threshold map from a tileable noise texture.
+     * The red channel (or the gray value) is used as the threshold.
+     * @param texture A GRAYSCALE8, RGB24 or RGBA32 image with power-of-two sides.
+     * @return The threshold map, with 256 levels.
+     * @throws ImageException if the format or size is not supported.
+     **********************************/
+    static ThresholdMap fromImage(const Image& texture) {
+        vector<uint16_t> values(static_cast<size_t>(texture.getWidth()) * texture.getHeight());
+        bool matched = dispatchPixelFormat<PixelFormat::GRAYSCALE8, PixelFormat::RGB24,
+                                           PixelFormat::RGBA32>(
+            texture.getFormat(), [&](auto tag) {
+                using Traits = typename decltype(tag)::Traits;
+                const uint8_t* data = texture.getData().data();
+                for (int32_t y = 0; y < texture.getHeight(); ++y) {
+                    const uint8_t* row = data + static_cast<size_t>(y) * texture.getStride();
+                    for (int32_t x = 0; x < texture.getWidth(); ++x) {
+                        values[static_cast<size_t>(y) * texture.getWidth() + x] =
+                            row[x * Traits::bytesPerPixel + Traits::redOffset];
+                    }
+                }
+            });
+        if (!matched) {
+            throw ImageException("Invalid threshold map: unsupported texture format.");
+        }
+        return ThresholdMap(texture.getWidth(), texture.getHeight(), 256, std::move(values));
+    }
+
+    /**********************************
+     * Generates a tileable blue-noise map with the void-and-cluster method.
+     * Generation costs O(size^4), it is meant to run once per pipeline.
+     * @param size Side of the map, a power of two up to 256.
+     * @param sigma Standard deviation of the energy filter.
+     * @param seed Seed of the initial random pattern.
+     * @return The threshold map, with size * size levels.
+     **********************************/
+    static ThresholdMap blueNoise(int32_t size, float sigma = 1.5f, uint32_t seed = 1) {
+        if (!isPowerOfTwo(size) || size > 256) {
+            throw ImageException("Invalid threshold map: blue noise size must be a power of two up to 256.");
+        }
+        const size_t count = static_cast<size_t>(size) * size;
+
+        // Gaussian energy for every toroidal offset
+        vector<float> kernel(count);
+        for (int32_t dy = 0; dy < size; ++dy) {
+            for (int32_t dx = 0; dx < size; ++dx) {
+                float wx = static_cast<float>(std::min(dx, size - dx));
+                float wy = static_cast<float>(std::min(dy, size - dy));
+                kernel[dy * size + dx] = exp(-(wx * wx + wy * wy) / (2.0f * sigma * sigma));
+            }
+        }
+
+        vector<uint8_t> pattern(count, 0);
+        vector<float> energy(count, 0.0f);
+        auto splat = [&](size_t index, float sign) {
+            int32_t px = static_cast<int32_t>(index) & (size - 1);
+            int32_t py = static_cast<int32_t>(index) / size;
+            for (int32_t y = 0; y < size; ++y) {
+                const float* kernelRow = kernel.data() + ((y - py) & (size - 1)) * size;
+                float* energyRow = energy.data() + y * size;
+                for (int32_t x = 0; x < size; ++x) {
+                    energyRow[x] += sign * kernelRow[(x - px) & (size - 1)];
+                }
+            }
+        };
+        // Tightest cluster: the set pixel with the highest energy
+        auto tightestCluster = [&]() {
+            size_t best = 0;
+            float bestEnergy = -1.0f;
+            for (size_t i = 0; i < count; ++i) {
+                if (pattern[i] && energy[i] > bestEnergy) { bestEnergy = energy[i]; best = i; }
+            }
+            return best;
+        };
+        // Largest void: the empty pixel with the lowest energy
+        auto largestVoid = [&]() {
+            size_t best = 0;
+            float bestEnergy = numeric_limits<float>::max();
+            for (size_t i = 0; i < count; ++i) {
+                if (!pattern[i] && energy[i] < bestEnergy) { bestEnergy = energy[i]; best = i; }
+            }
+            return best;
+        };
+
+        // Initial random pattern with about a tenth of the pixels set
+        mt19937 random(seed);
+        size_t ones = std::max<size_t>(1, count / 10);
+        for (size_t placed = 0; placed < ones;) {
+            size_t index = random() % count;
+            if (!pattern[index]) {
+                pattern[index] = 1;
+                splat(index, 1.0f);
+                placed++;
+            }
+        }
+
+        // Relax the pattern until moving the tightest cluster does not help
+        for (size_t iteration = 0; iteration < count; ++iteration) {
+            size_t cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            size_t gap = largestVoid();
+            pattern[gap] = 1;
+            splat(gap, 1.0f);
+            if (gap == cluster) break;
+        }
+
+        vector<uint16_t> values(count);
+        vector<uint8_t> prototype = pattern;
+        vector<float> prototypeEnergy = energy;
+
+        // Phase 1: remove the tightest clusters, ranking downwards
+        for (size_t rank = ones; rank > 0; --rank) {
+            size_t cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            values[cluster] = static_cast<uint16_t>(rank - 1);
+        }
+
+        // Phase 2: fill the largest voids, ranking upwards
+        pattern = std::move(prototype);
+        energy = std::move(prototypeEnergy);
+        for (size_t rank = ones; rank < count; ++rank) {
+            size_t gap = largestVoid();
+            pattern[gap] = 1;
+            splat(gap, 1.0f);
+            values[gap] = static_cast<uint16_t>(rank);
+        }
+
+        return ThresholdMap(size, size, static_cast<int32_t>(count), std::move(values));
+    }
+
+    /**********************************
+     * Expands the thresholds of an image row into 16.16 fixed point.
+     * The value for column x is spread * rank(x, y) / levels.
+     * @param y The image row.
+     * @param count Number of columns to expand.
+     * @param spread Multiplier applied to every threshold.
+     * @param out Destination, at least count values.
+     **********************************/
+    void expandRow(int32_t y, size_t count, int32_t spread, uint32_t* out) const {
+        const uint16_t* row = ranks.data() + static_cast<size_t>(y & (height - 1)) * width;
+        const uint32_t scale = static_cast<uint32_t>(kFixedOne / levels) * static_cast<uint32_t>(spread);
+        size_t first = std::min(count, static_cast<size_t>(width));
+        for (size_t x = 0; x < first; ++x) {
+            out[x] = row[x] * scale;
+        }
+        // Tile the expanded period across the rest of the row
+        for (size_t x = first; x < count; x += width) {
+            copy(out, out + std::min(static_cast<size_t>(width), count - x), out + x);
+        }
+    }
+
+    /**********************************
+     * Retrieves the rank at a position, tiling the map.
+     * @param x The column.
+     * @param y The row.
+     * @return The rank in [0, levels).
+     **********************************/
+    uint16_t getRank(int32_t x, int32_t y) const {
+        return ranks[static_cast<size_t>(y & (height - 1)) * width + (x & (width - 1))];
+    }
+
+    int32_t getWidth() const { return width; }
+    int32_t getHeight() const { return height; }
+    int32_t getLevels() const { return levels; }
+
+private:
+    static bool isPowerOfTwo(int32_t value) {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+};
+
+#endif // THRESHOLD_MAP_H
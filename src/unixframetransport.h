@@ -0,0 +1,467 @@
+/**********************************
+ * @file unixframetransport.h
+ * @author Erich Gutierrez Chavez
+ * @brief Defines UnixFrameServer and UnixFrameClient, a local frame
+ * transport passing frame buffers as sealed memfds over a Unix socket.
+ *
+ * @details
+ * - The server listens on a Unix domain socket (SOCK_SEQPACKET, one
+ *   message per frame) and accepts any number of clients.
+ * - send() copies a frame once into a fresh memfd, seals it against
+ *   writes and resizing, and sends a small header with the descriptor
+ *   (SCM_RIGHTS) to every client. All clients map the same pages.
+ * - A client maps each received memfd read-only as a SealedFrame. The
+ *   seals are checked first, so the producer cannot change or truncate
+ *   a frame under its readers.
+ * - A SealedFrame sent back through a server is forwarded without any
+ *   copy, so a relay process costs one message per frame.
+ * - A client that falls behind loses frames instead of stalling the
+ *   server: a full socket buffer drops the frame for that client only.
+ *   Disconnected clients are removed.
+ * - writePacket() is an output callback and readPacket() /
+ *   readImagePacket() are input callbacks for the Scheduler, in place
+ *   of the stdin/stdout callbacks.
+ *
+ * Constraints:
+ * - Linux only (memfd_create, file seals).
+ * - A server and a client are each used from one thread at a time.
+ **********************************/
+
+#ifndef UNIX_FRAME_TRANSPORT_H
+#define UNIX_FRAME_TRANSPORT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include "image.h"
+#include "imageview.h"
+#include "packet.h"
+#include "portexception.h"
+
+using namespace std;
+
+/**********************************
+ * @class SealedFrame
+ * @brief A frame received as a sealed memfd, mapped read-only.
+ * Copies share the mapping, it is unmapped when the last one is destroyed.
+ **********************************/
+class SealedFrame {
+public:
+    /**********************************
+     * Message sent with each descriptor.
+     **********************************/
+    struct Header {
+        uint32_t magic;         // kMagic
+        int32_t width;
+        int32_t height;
+        int32_t format;         // PixelFormat
+        int64_t timestamp;      // Producer timestamp in microseconds
+        uint64_t size;          // Bytes of pixel data
+    };
+
+    static const uint32_t kMagic = 0x46524D53;      // "FRMS"
+    static const int kRequiredSeals = F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+private:
+    /**********************************
+     * The mapping and the descriptor, kept for forwarding.
+     **********************************/
+    struct Mapping {
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        int fd = -1;
+
+        Mapping() = default;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        ~Mapping() {
+            if (data) munmap(const_cast<uint8_t*>(data), length);
+            if (fd >= 0) ::close(fd);
+        }
+    };
+
+    shared_ptr<const Mapping> mapping;      // Empty for an invalid frame
+    Header header{};
+
+public:
+    /**********************************
+     * Creates an invalid frame, filled by UnixFrameClient::receive().
+     **********************************/
+    SealedFrame() = default;
+
+    /**********************************
+     * Maps a received descriptor, taking ownership of it.
+     * @param fd The memfd, closed on failure.
+     * @param newHeader The header received with it.
+     * @throws PortException if the descriptor is not sealed or too small.
+     **********************************/
+    SealedFrame(int fd, const Header& newHeader) : header(newHeader) {
+        auto newMapping = make_shared<Mapping>();
+        newMapping->fd = fd;
+        struct stat info;
+        const int seals = fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) {
+            throw PortException("Error SealedFrame: Frame buffer is not sealed.");
+        }
+        if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < header.size || header.size == 0) {
+            throw PortException("Error SealedFrame: Frame buffer too small.");
+        }
+        void* data = mmap(nullptr, header.size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            throw PortException("Error SealedFrame: Unable to map frame buffer.");
+        }
+        newMapping->data = static_cast<const uint8_t*>(data);
+        newMapping->length = header.size;
+        mapping = std::move(newMapping);
+    }
+
+    bool isValid() const { return mapping != nullptr; }
+    int32_t getWidth() const { return header.width; }
+    int32_t getHeight() const { return header.height; }
+    PixelFormat getFormat() const { return static_cast<PixelFormat>(header.format); }
+    long long getTimestamp() const { return header.timestamp; }
+    size_t getSize() const { return header.size; }
+    const Header& getHeader() const { return header; }
+
+    /**********************************
+     * Retrieves the descriptor of the frame buffer, to forward it.
+     * @return The descriptor, owned by the frame.
+     **********************************/
+    int getFd() const { return mapping->fd; }
+
+    /**********************************
+     * Retrieves the mapped pixel data.
+     * @return Pointer to getSize() bytes, valid while the frame lives.
+     **********************************/
+    const uint8_t* getData() const { return mapping->data; }
+
+    /**********************************
+     * Creates a view over the mapped pixels, without copying.
+     * @return The view, valid while the frame lives.
+     **********************************/
+    ConstImageView view() const {
+        const ptrdiff_t stride = (static_cast<ptrdiff_t>(header.width) * Image::bitsPerPixel(getFormat()) + 7) / 8;
+        return ConstImageView(getData(), header.width, header.height, getFormat(), stride);
+    }
+
+    /**********************************
+     * Copies the frame into an Image.
+     * @return The image.
+     * @throws ImageException if the header describes an invalid frame.
+     **********************************/
+    Image toImage() const {
+        return Image(header.width, header.height, getFormat(), vector<uint8_t>(getData(), getData() + header.size));
+    }
+};
+
+/**********************************
+ * @class UnixFrameServer
+ * @brief Sends frames to every client connected to a Unix socket.
+ **********************************/
+class UnixFrameServer {
+private:
+    string path;                // Socket path, removed by the destructor
+    int listenFd = -1;          // Listening socket
+    vector<int> clients;        // Connected clients
+    unsigned long long sent = 0;        // Frames sent, counted once per client
+    unsigned long long dropped = 0;     // Frames dropped for slow clients
+
+public:
+    /**********************************
+     * Creates the server socket, replacing a stale socket file.
+     * @param socketPath Path of the socket.
+     * @param backlog Pending connections allowed.
+     * @throws PortException if the socket cannot be created.
+     **********************************/
+    explicit UnixFrameServer(const string& socketPath, int backlog = 16) : path(socketPath) {
+        sockaddr_un address = makeAddress(path);
+        listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw PortException("Error UnixFrameServer: Unable to create socket.");
+        }
+        ::unlink(path.c_str());
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, backlog) != 0) {
+            ::close(listenFd);
+            throw PortException("Error UnixFrameServer: Unable to listen on " + path);
+        }
+    }
+
+    UnixFrameServer(const UnixFrameServer&) = delete;
+    UnixFrameServer& operator=(const UnixFrameServer&) = delete;
+
+    ~UnixFrameServer() {
+        for (int client : clients) ::close(client);
+        ::close(listenFd);
+        ::unlink(path.c_str());
+    }
+
+    /**********************************
+     * Accepts the clients waiting to connect. Called by every send.
+     * @return The number of connected clients.
+     **********************************/
+    size_t acceptClients() {
+        while (true) {
+            int client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0) break;
+            clients.push_back(client);
+        }
+        return clients.size();
+    }
+
+    size_t getClientCount() const { return clients.size(); }
+    unsigned long long getSentCount() const { return sent; }
+    unsigned long long getDroppedCount() const { return dropped; }
+
+    /**********************************
+     * Builds the address of a socket path.
+     * @param socketPath The path.
+     * @return The address.
+     * @throws PortException if the path is too long.
+     **********************************/
+    static sockaddr_un makeAddress(const string& socketPath) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+            throw PortException("Error UnixFrameTransport: Invalid socket path " + socketPath);
+        }
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+        return address;
+    }
+
+    /**********************************
+     * Sends a frame to every client. The pixels are copied once into a
+     * sealed memfd shared by all of them. Compressed images are sent as
+     * they are.
+     * @param image The frame.
+     * @param timestamp Timestamp of the frame, passed to the clients.
+     * @return The number of clients the frame reached.
+     * @throws PortException if the frame buffer cannot be created.
+     **********************************/
+    size_t send(const Image& image, long long timestamp) {
+        if (acceptClients() == 0) return 0;
+        const vector<uint8_t>& data = image.getData();
+        int fd = memfd_create("UnixFrame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0) {
+            throw PortException("Error UnixFrameServer: Unable to create frame buffer.");
+        }
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+            if (count <= 0) {
+                if (count < 0 && errno == EINTR) continue;
+                ::close(fd);
+                throw PortException("Error UnixFrameServer: Unable to fill frame buffer.");
+            }
+            written += static_cast<size_t>(count);
+        }
+        if (fcntl(fd, F_ADD_SEALS, SealedFrame::kRequiredSeals) != 0) {
+            ::close(fd);
+            throw PortException("Error UnixFrameServer: Unable to seal frame buffer.");
+        }
+        SealedFrame::Header header{SealedFrame::kMagic, image.getWidth(), image.getHeight(),
+                                   static_cast<int32_t>(image.getFormat()), timestamp, data.size()};
+        const size_t reached = broadcast(header, fd);
+        ::close(fd);
+        return reached;
+    }
+
+    /**********************************
+     * Forwards a received frame to every client, without copying it.
+     * @param frame The frame.
+     * @return The number of clients the frame reached.
+     **********************************/
+    size_t send(const SealedFrame& frame) {
+        if (acceptClients() == 0 || !frame.isValid()) return 0;
+        return broadcast(frame.getHeader(), frame.getFd());
+    }
+
+    /**********************************
+     * Output callback sending Image and SealedFrame packets, others are
+     * ignored.
+     * Usage: scheduler.registerOutputCallback(UnixFrameServer::writePacket, &server)
+     * @param packet The packet from the scheduler's output port.
+     * @param server Pointer to the UnixFrameServer.
+     **********************************/
+    static void writePacket(const Packet& packet, void* server) {
+        if (!packet.isValid()) return;
+        UnixFrameServer* target = static_cast<UnixFrameServer*>(server);
+        try {
+            target->send(packet.get<Image>(), packet.getTimestamp());
+        } catch (const PacketException&) {
+            try {
+                target->send(packet.get<SealedFrame>());
+            } catch (const PacketException&) {
+            }
+        }
+    }
+
+private:
+    size_t broadcast(const SealedFrame::Header& header, int fd) {
+        size_t reached = 0;
+        for (size_t i = 0; i < clients.size();) {
+            const ssize_t result = sendFrame(clients[i], header, fd);
+            if (result > 0) {
+                reached++;
+                sent++;
+            } else if (result == 0) {
+                dropped++;
+            } else {
+                ::close(clients[i]);
+                clients.erase(clients.begin() + i);
+                continue;
+            }
+            ++i;
+        }
+        return reached;
+    }
+
+    // 1 if sent, 0 if the client's buffer is full, -1 if it is gone
+    static ssize_t sendFrame(int client, const SealedFrame::Header& header, int fd) {
+        iovec part = {const_cast<SealedFrame::Header*>(&header), sizeof(header)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(rights), &fd, sizeof(int));
+        while (true) {
+            if (sendmsg(client, &message, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) return 1;
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+    }
+
+};
+
+/**********************************
+ * @class UnixFrameClient
+ * @brief Receives frames from a UnixFrameServer.
+ **********************************/
+class UnixFrameClient {
+private:
+    int fd = -1;                // Connected socket
+    bool closed = false;        // The server went away
+
+public:
+    /**********************************
+     * Connects to a server.
+     * @param socketPath Path of the server socket.
+     * @throws PortException if the server cannot be reached.
+     **********************************/
+    explicit UnixFrameClient(const string& socketPath) {
+        sockaddr_un address = UnixFrameServer::makeAddress(socketPath);
+        fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw PortException("Error UnixFrameClient: Unable to create socket.");
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            throw PortException("Error UnixFrameClient: Unable to connect to " + socketPath);
+        }
+    }
+
+    UnixFrameClient(const UnixFrameClient&) = delete;
+    UnixFrameClient& operator=(const UnixFrameClient&) = delete;
+
+    ~UnixFrameClient() {
+        ::close(fd);
+    }
+
+    /**********************************
+     * Checks if the server closed the connection.
+     * @return True once receive() saw the end of the stream.
+     **********************************/
+    bool isClosed() const { return closed; }
+
+    /**********************************
+     * Receives the next frame, waiting for it.
+     * @param frame Receives the frame, mapped read-only.
+     * @param timeoutUs Maximum time to wait in microseconds, 0 to poll.
+     * @return False if no frame arrived or the server is gone.
+     * @throws PortException if the server sent an invalid frame.
+     **********************************/
+    bool receive(SealedFrame& frame, unsigned long long timeoutUs = 0) {
+        if (closed) return false;
+        pollfd ready = {fd, POLLIN, 0};
+        const int timeoutMs = static_cast<int>(min<unsigned long long>((timeoutUs + 999) / 1000, INT32_MAX));
+        int polled;
+        do {
+            polled = poll(&ready, 1, timeoutMs);
+        } while (polled < 0 && errno == EINTR);
+        if (polled <= 0) return false;
+
+        SealedFrame::Header header;
+        iovec part = {&header, sizeof(header)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        ssize_t received;
+        do {
+            received = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        } while (received < 0 && errno == EINTR);
+        if (received <= 0) {
+            closed = true;
+            return false;
+        }
+
+        int frameFd = -1;
+        for (cmsghdr* rights = CMSG_FIRSTHDR(&message); rights; rights = CMSG_NXTHDR(&message, rights)) {
+            if (rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS) {
+                memcpy(&frameFd, CMSG_DATA(rights), sizeof(int));
+            }
+        }
+        if (frameFd < 0 || received != sizeof(header) || header.magic != SealedFrame::kMagic ||
+            (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0) {
+            if (frameFd >= 0) ::close(frameFd);
+            throw PortException("Error UnixFrameClient: Invalid frame message.");
+        }
+        frame = SealedFrame(frameFd, header);
+        return true;
+    }
+
+    /**********************************
+     * Input callback reading a frame without copying.
+     * Usage: scheduler.registerInputCallback(UnixFrameClient::readPacket, &client)
+     * @param client Pointer to the UnixFrameClient.
+     * @return A Packet holding a SealedFrame, or an empty Packet when none is pending.
+     **********************************/
+    static Packet readPacket(void* client) {
+        SealedFrame frame;
+        if (!static_cast<UnixFrameClient*>(client)->receive(frame)) return Packet();
+        return Packet(std::move(frame));
+    }
+
+    /**********************************
+     * Input callback copying a frame into an Image, for calculators that
+     * read Image packets.
+     * @param client Pointer to the UnixFrameClient.
+     * @return A Packet holding an Image, or an empty Packet when none is pending.
+     **********************************/
+    static Packet readImagePacket(void* client) {
+        SealedFrame frame;
+        if (!static_cast<UnixFrameClient*>(client)->receive(frame)) return Packet();
+        return Packet(frame.toImage());
+    }
+};
+
+#endif // UNIX_FRAME_TRANSPORT_H
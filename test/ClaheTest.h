@@ -0,0 +1,101 @@
+#ifndef CLAHE_TEST_H
+#define CLAHE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include "../examples/calculators/clahecalculator.h"
+
+using namespace std;
+
+class ClaheTest {
+public:
+    static void run() {
+        cout << "Starting Clahe Tests...\n";
+
+        testFlat();
+        testIdentity();
+        testInterpolation();
+        testAlpha();
+
+        cout << "All Clahe Tests Completed.\n";
+    }
+
+private:
+    static Image noise(int32_t width, int32_t height, PixelFormat format, uint8_t low, uint8_t high) {
+        Image image(width, height, format);
+        uint32_t seed = 7;
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(low + (seed >> 16) % (high - low + 1));
+        }
+        image.setData(image.getData());
+        return image;
+    }
+
+    static void testFlat() {
+        // Every tile gets the same LUT, the result is flat and close to the input
+        Image image(64, 64, PixelFormat::GRAYSCALE8, vector<uint8_t>(64 * 64, 100));
+        ClaheKernel(4, 4, 2.0f).process(image);
+        const uint8_t value = image.getData()[0];
+        for (uint8_t pixel : image.getData()) assert(pixel == value);
+        assert(abs(value - 100) <= 2);
+        cout << "Flat image test PASSED" << endl;
+    }
+
+    static void testIdentity() {
+        // Each 16x16 tile holds every value once, a flat histogram maps to itself
+        vector<uint8_t> ramp(64 * 64);
+        for (int32_t y = 0; y < 64; ++y) {
+            for (int32_t x = 0; x < 64; ++x) ramp[y * 64 + x] = static_cast<uint8_t>(x % 16 + 16 * (y % 16));
+        }
+        Image image(64, 64, PixelFormat::GRAYSCALE8, ramp);
+        ClaheKernel(4, 4, 1.05f).process(image);
+        assert(image.getData() == ramp);
+
+        // A limit of 1 leaves any image as is
+        const Image original = noise(37, 23, PixelFormat::RGB24, 0, 255);
+        Image copy = original;
+        ClaheKernel(4, 4, 1.0f).process(copy);
+        assert(copy.getData() == original.getData());
+        cout << "Identity test PASSED" << endl;
+    }
+
+    static void testInterpolation() {
+        // Dark noise on the left tile, bright noise on the right, row 0 is 128 across
+        const int32_t width = 64, height = 32;
+        Image image = noise(width, height, PixelFormat::GRAYSCALE8, 0, 100);
+        const Image bright = noise(width, height, PixelFormat::GRAYSCALE8, 150, 255);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = width / 2; x < width; ++x) image.getData()[y * width + x] = bright.getData()[y * width + x];
+        }
+        for (int32_t x = 0; x < width; ++x) image.getData()[x] = 128;
+        ClaheKernel(2, 1, 4.0f).process(image);
+
+        // Flat before the first tile center and after the last one
+        const uint8_t* row = image.getData().data();
+        const int32_t left = row[0], right = row[width - 1];
+        assert(left > right + 100 && "128 is bright on the left, dark on the right");
+        for (int32_t x = 0; x < 16; ++x) assert(row[x] == left);
+        for (int32_t x = 48; x < width; ++x) assert(row[x] == right);
+
+        // Linear in between, without a step at the tile border
+        for (int32_t x = 16; x < 48; ++x) {
+            const int32_t weight = (2 * x + 1 - 32) * 256 / 64;
+            assert(row[x] == (left * (256 - weight) + right * weight + 128) >> 8);
+            assert(row[x - 1] - row[x] <= (left - right) / 32 + 1);
+        }
+        cout << "Interpolation test PASSED" << endl;
+    }
+
+    static void testAlpha() {
+        Image image = noise(40, 30, PixelFormat::RGBA32, 20, 120);
+        const Image original = image;
+        ClaheKernel(4, 3, 3.0f).process(image);
+        assert(image.getData() != original.getData());
+        for (size_t i = 3; i < image.getData().size(); i += 4) assert(image.getData()[i] == original.getData()[i]);
+        cout << "Alpha test PASSED" << endl;
+    }
+};
+
+#endif // CLAHE_TEST_H
@@ -0,0 +1,88 @@
+#ifndef DITHER_TEST_H
+#define DITHER_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include "../examples/calculators/dithercalculator.h"
+
+using namespace std;
+
+class DitherTest {
+public:
+    static void run() {
+        cout << "Starting Dither Tests...\n";
+
+        testPacked1();
+        testPacked2And4();
+        testPackedBMP();
+
+        cout << "All Dither Tests Completed.\n";
+    }
+
+private:
+    // Without spread the packed level of a value is (2^bits - 1) * v / 255
+    static DitherKernel packedKernel(int bits) {
+        return DitherKernel(2, 2, 2, 0, 1, 0, bits);
+    }
+
+    static void testPacked1() {
+        // 13 pixels: two bytes per row, the leftmost pixel in the high bit
+        vector<uint8_t> levels(13 * 2, 0);
+        const int on[] = {0, 2, 7, 8, 12};
+        for (int x : on) levels[x] = 255;
+        for (int x = 0; x < 13; ++x) levels[13 + x] = 255;
+        Image image(13, 2, PixelFormat::GRAYSCALE8, levels);
+        packedKernel(1).process(image);
+
+        assert(image.getFormat() == PixelFormat::GRAYSCALE1 && image.getStride() == 2);
+        assert((image.getData() == vector<uint8_t>{0xA1, 0x88, 0xFF, 0xF8}) && "padding bits are 0");
+
+        // RGB is reduced to luma, white must stay on
+        Image rgb(9, 1, PixelFormat::RGB24, vector<uint8_t>(27, 255));
+        rgb.getData()[3] = rgb.getData()[4] = rgb.getData()[5] = 0;
+        packedKernel(1).process(rgb);
+        assert((rgb.getData() == vector<uint8_t>{0xBF, 0x80}));
+        cout << "Packed 1-bit test PASSED" << endl;
+    }
+
+    static void testPacked2And4() {
+        // 5 pixels of 2 bits: levels 0, 1, 2, 3, 3 -> 00 01 10 11 | 11 000000
+        Image two(5, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 85, 170, 255, 255});
+        packedKernel(2).process(two);
+        assert(two.getFormat() == PixelFormat::GRAYSCALE2 && two.getStride() == 2);
+        assert((two.getData() == vector<uint8_t>{0x1B, 0xC0}));
+
+        // 3 pixels of 4 bits per row: levels 1, 10, 15 -> 0x1A, 0xF0
+        Image four(3, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{17, 170, 255, 0, 34, 51});
+        packedKernel(4).process(four);
+        assert(four.getFormat() == PixelFormat::GRAYSCALE4 && four.getStride() == 2);
+        assert((four.getData() == vector<uint8_t>{0x1A, 0xF0, 0x02, 0x30}));
+
+        // Unpacking gives the levels back
+        vector<uint8_t> row(3);
+        BitPacking::unpackRow(four.getData().data() + 2, 3, 4, row.data());
+        assert((row == vector<uint8_t>{0, 2, 3}));
+        cout << "Packed 2 and 4-bit test PASSED" << endl;
+    }
+
+    static void testPackedBMP() {
+        // Dithered gradients with spread, written and read back as palette BMPs
+        const string path = "dither_packed_test.bmp";
+        vector<uint8_t> ramp(37 * 11);
+        for (size_t i = 0; i < ramp.size(); ++i) ramp[i] = static_cast<uint8_t>((i % 37) * 7);
+
+        for (int bits : {1, 4}) {
+            Image image(37, 11, PixelFormat::GRAYSCALE8, ramp);
+            DitherKernel(2, 2, 2, 1, 2, 0, bits).process(image);
+            ImageUtils::writeBMP(path, image);
+            const Image read = ImageUtils::readBMP(path);
+            assert(read.getFormat() == PixelFormat::GRAYSCALE8 && read.getWidth() == 37 && read.getHeight() == 11);
+            assert(read.getData() == ImageUtils::unpackGrayscale(image).getData());
+        }
+        remove(path.c_str());
+        cout << "Packed BMP test PASSED" << endl;
+    }
+};
+
+#endif // DITHER_TEST_H
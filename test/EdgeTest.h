@@ -0,0 +1,141 @@
+#ifndef EDGE_TEST_H
+#define EDGE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include "../examples/calculators/edgecalculator.h"
+
+using namespace std;
+
+class EdgeTest {
+public:
+    static void run() {
+        cout << "Starting Edge Tests...\n";
+
+        testStep();
+        testFlat();
+        testReference();
+        testScharrRange();
+        testThreshold();
+
+        cout << "All Edge Tests Completed.\n";
+    }
+
+private:
+    static Image noise(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        uint32_t seed = 99;
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+        image.setData(image.getData());
+        return image;
+    }
+
+    // Plain 3x3 gradient on GRAYSCALE8 with replicated borders
+    static vector<uint8_t> reference(const Image& image, EdgeOperator edgeOperator, int threshold) {
+        const int32_t width = image.getWidth(), height = image.getHeight();
+        const int32_t outer = edgeOperator == EdgeOperator::SCHARR ? 3 : 1;
+        const int32_t center = edgeOperator == EdgeOperator::SCHARR ? 10 : 2;
+        const int32_t weights[3] = {outer, center, outer};
+        auto at = [&](int32_t x, int32_t y) {
+            return static_cast<int32_t>(image.getData()[clamp(y, 0, height - 1) * width + clamp(x, 0, width - 1)]);
+        };
+
+        vector<uint8_t> edges(static_cast<size_t>(width) * height);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                int32_t gx = 0, gy = 0;
+                for (int32_t i = 0; i < 3; ++i) {
+                    gx += weights[i] * (at(x + 1, y + i - 1) - at(x - 1, y + i - 1));
+                    gy += weights[i] * (at(x + i - 1, y + 1) - at(x + i - 1, y - 1));
+                }
+                const int32_t magnitude = (abs(gx) + abs(gy)) / (outer * 2 + center);
+                edges[y * width + x] = threshold > 0 ? (magnitude >= threshold ? 255 : 0)
+                                                     : static_cast<uint8_t>(min(magnitude, 255));
+            }
+        }
+        return edges;
+    }
+
+    static void testStep() {
+        // Full contrast vertical step between columns 6 and 7
+        vector<uint8_t> step(13 * 9);
+        for (size_t i = 0; i < step.size(); ++i) step[i] = (i % 13) >= 7 ? 255 : 0;
+        for (EdgeOperator edgeOperator : {EdgeOperator::SOBEL, EdgeOperator::SCHARR}) {
+            Image image(13, 9, PixelFormat::GRAYSCALE8, step);
+            EdgeKernel(edgeOperator).process(image);
+            for (size_t i = 0; i < step.size(); ++i) {
+                const size_t col = i % 13;
+                assert(image.getData()[i] == (col == 6 || col == 7 ? 255 : 0));
+            }
+        }
+
+        // Color images are reduced to luma first
+        Image rgb(13, 9, PixelFormat::RGB24);
+        for (size_t i = 0; i < step.size(); ++i) rgb.getData()[i * 3] = rgb.getData()[i * 3 + 1] = rgb.getData()[i * 3 + 2] = step[i];
+        rgb.setData(rgb.getData());
+        EdgeKernel().process(rgb);
+        assert(rgb.getFormat() == PixelFormat::GRAYSCALE8 && rgb.getData()[6] == 255 && rgb.getData()[5] == 0);
+        cout << "Step test PASSED" << endl;
+    }
+
+    static void testFlat() {
+        Image image(37, 20, PixelFormat::RGBA32, vector<uint8_t>(37 * 20 * 4, 173));
+        EdgeKernel(EdgeOperator::SCHARR).process(image);
+        assert(image.getData() == vector<uint8_t>(37 * 20, 0));
+        cout << "Flat image test PASSED" << endl;
+    }
+
+    static void testReference() {
+        // Widths that leave a scalar tail after the eight pixel SSE2 steps
+        for (int32_t width : {13, 37}) {
+            const Image source = noise(width, 41, PixelFormat::GRAYSCALE8);
+            for (EdgeOperator edgeOperator : {EdgeOperator::SOBEL, EdgeOperator::SCHARR}) {
+                Image image = source;
+                EdgeKernel(edgeOperator).process(image);
+                assert(image.getData() == reference(source, edgeOperator, 0));
+            }
+        }
+        cout << "Reference test PASSED" << endl;
+    }
+
+    static void testScharrRange() {
+        // A diagonal step drives |gx| + |gy| up to 414, the map saturates instead of wrapping
+        vector<uint8_t> diagonal(16 * 16);
+        for (size_t i = 0; i < diagonal.size(); ++i) diagonal[i] = (i % 16) + (i / 16) >= 8 ? 255 : 0;
+        const Image source(16, 16, PixelFormat::GRAYSCALE8, diagonal);
+        Image image = source;
+        EdgeKernel(EdgeOperator::SCHARR).process(image);
+        assert(image.getData() == reference(source, EdgeOperator::SCHARR, 0));
+        assert(image.getData()[4 * 16 + 4] == 255 && image.getData()[3 * 16 + 4] == 255);
+        assert(image.getData()[0] == 0 && image.getData()[15 * 16 + 15] == 0);
+
+        // A single bright pixel stays in proportion, 10 * 255 / 16 beside it
+        Image dot(16, 16, PixelFormat::GRAYSCALE8, vector<uint8_t>(16 * 16, 0));
+        dot.getData()[5 * 16 + 5] = 255;
+        const Image dotSource = dot;
+        EdgeKernel(EdgeOperator::SCHARR).process(dot);
+        assert(dot.getData() == reference(dotSource, EdgeOperator::SCHARR, 0));
+        assert(dot.getData()[5 * 16 + 4] == 159 && dot.getData()[5 * 16 + 5] == 0);
+        cout << "Scharr range test PASSED" << endl;
+    }
+
+    static void testThreshold() {
+        const Image source = noise(37, 19, PixelFormat::GRAYSCALE8);
+        Image image = source;
+        EdgeKernel(EdgeOperator::SOBEL, 100).process(image);
+        size_t edges = 0;
+        for (uint8_t value : image.getData()) {
+            assert(value == 0 || value == 255);
+            edges += value == 255;
+        }
+        assert(edges > 0 && edges < image.getData().size());
+        assert(image.getData() == reference(source, EdgeOperator::SOBEL, 100));
+        cout << "Threshold test PASSED" << endl;
+    }
+};
+
+#endif // EDGE_TEST_H
@@ -0,0 +1,85 @@
+#ifndef FRAME_POOL_TEST_H
+#define FRAME_POOL_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include "../src/framepool.h"
+
+using namespace std;
+
+class FramePoolTest {
+public:
+    static void run() {
+        cout << "Starting FramePool Tests...\n";
+
+        testReuse();
+        testCapacity();
+        testThreads();
+
+        cout << "All FramePool Tests Completed.\n";
+    }
+
+private:
+    static void testReuse() {
+        FramePool pool;
+        Image first = pool.acquire(8, 4, PixelFormat::RGBA32);
+        assert(first.getData().size() == 8 * 4 * 4);
+        const uint8_t* buffer = first.getData().data();
+        pool.release(std::move(first));
+        assert(pool.size() == 1);
+
+        // A smaller frame reuses the released buffer
+        Image second = pool.acquire(5, 3, PixelFormat::RGB24);
+        assert(second.getData().data() == buffer);
+        assert(second.getWidth() == 5 && second.getStride() == 15 && second.getData().size() == 45);
+        assert(pool.size() == 0 && pool.getAllocationCount() == 1);
+
+        // A larger one allocates
+        pool.release(std::move(second));
+        Image third = pool.acquire(16, 16, PixelFormat::RGBA32);
+        assert(pool.getAllocationCount() == 2 && pool.size() == 1);
+
+        bool thrown = false;
+        try {
+            pool.acquire(0, 4, PixelFormat::RGBA32);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Reuse test PASSED" << endl;
+    }
+
+    static void testCapacity() {
+        FramePool pool(2);
+        for (int i = 0; i < 4; ++i) {
+            pool.release(Image(4, 4, PixelFormat::GRAYSCALE8));
+        }
+        assert(pool.size() == 2 && pool.getCapacity() == 2);
+
+        // Releasing an image without pixels keeps nothing
+        Image empty = pool.acquire(4, 4, PixelFormat::GRAYSCALE8);
+        pool.release(std::move(empty));
+        pool.release(std::move(empty));
+        assert(pool.size() == 2);
+        cout << "Capacity test PASSED" << endl;
+    }
+
+    static void testThreads() {
+        FramePool pool(8);
+        auto cycle = [&pool] {
+            for (int i = 0; i < 1000; ++i) {
+                Image image = pool.acquire(32, 8, PixelFormat::RGBA32);
+                image.getData()[0] = static_cast<uint8_t>(i);
+                pool.release(std::move(image));
+            }
+        };
+        thread worker(cycle);
+        cycle();
+        worker.join();
+        assert(pool.getAllocationCount() <= 2 && "two threads never need more than two buffers");
+        cout << "Threads test PASSED" << endl;
+    }
+};
+
+#endif // FRAME_POOL_TEST_H
@@ -0,0 +1,89 @@
+#ifndef GEOMETRY_TEST_H
+#define GEOMETRY_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include "../examples/calculators/geometrycalculator.h"
+
+using namespace std;
+
+class GeometryTest {
+public:
+    static void run() {
+        cout << "Starting Geometry Tests...\n";
+
+        testPixelPositions();
+        testUnsupportedFormat();
+
+        cout << "All Geometry Tests Completed.\n";
+    }
+
+private:
+    static Image makeImage(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        for (size_t i = 0; i < image.getData().size(); ++i) {
+            image.getData()[i] = static_cast<uint8_t>(i * 7 + i / 5);
+        }
+        return image;
+    }
+
+    static const uint8_t* pixelAt(const Image& image, int32_t x, int32_t y) {
+        return image.getData().data() + y * image.getStride() + x * Image::bitsPerPixel(image.getFormat()) / 8;
+    }
+
+    // Source column and row of a target pixel, rotations are clockwise
+    static pair<int32_t, int32_t> sourceOf(GeometryTransform transform, int32_t x, int32_t y,
+                                           int32_t width, int32_t height) {
+        switch (transform) {
+            case GeometryTransform::ROTATE_90: return {y, height - 1 - x};
+            case GeometryTransform::ROTATE_180: return {width - 1 - x, height - 1 - y};
+            case GeometryTransform::ROTATE_270: return {width - 1 - y, x};
+            case GeometryTransform::FLIP_HORIZONTAL: return {width - 1 - x, y};
+            case GeometryTransform::FLIP_VERTICAL: return {x, height - 1 - y};
+            case GeometryTransform::TRANSPOSE: return {y, x};
+            default: return {x, y};
+        }
+    }
+
+    static void testPixelPositions() {
+        // Non-square sizes, the larger ones span several tiles and bands
+        const int32_t sizes[][2] = {{5, 3}, {70, 33}, {37, 101}};
+        const GeometryTransform transforms[] = {
+            GeometryTransform::NONE, GeometryTransform::ROTATE_90, GeometryTransform::ROTATE_180,
+            GeometryTransform::ROTATE_270, GeometryTransform::FLIP_HORIZONTAL,
+            GeometryTransform::FLIP_VERTICAL, GeometryTransform::TRANSPOSE};
+        for (PixelFormat format : {PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32}) {
+            const int32_t bytesPerPixel = Image::bitsPerPixel(format) / 8;
+            for (const auto& size : sizes) {
+                const Image source = makeImage(size[0], size[1], format);
+                for (GeometryTransform transform : transforms) {
+                    Image target = source;
+                    GeometryKernel(transform).process(target);
+                    const bool swapped = transform == GeometryTransform::ROTATE_90 ||
+                        transform == GeometryTransform::ROTATE_270 || transform == GeometryTransform::TRANSPOSE;
+                    assert(target.getWidth() == (swapped ? size[1] : size[0]));
+                    assert(target.getHeight() == (swapped ? size[0] : size[1]));
+                    for (int32_t y = 0; y < target.getHeight(); ++y) {
+                        for (int32_t x = 0; x < target.getWidth(); ++x) {
+                            const pair<int32_t, int32_t> from = sourceOf(transform, x, y, size[0], size[1]);
+                            assert(memcmp(pixelAt(target, x, y), pixelAt(source, from.first, from.second),
+                                          bytesPerPixel) == 0);
+                        }
+                    }
+                }
+            }
+        }
+        cout << "Pixel positions test PASSED" << endl;
+    }
+
+    static void testUnsupportedFormat() {
+        Image image = makeImage(6, 2, PixelFormat::GRAYSCALE4);
+        const vector<uint8_t> before = image.getData();
+        GeometryKernel(GeometryTransform::ROTATE_90).process(image);
+        assert(image.getWidth() == 6 && image.getData() == before && "left untouched");
+        cout << "Unsupported format test PASSED" << endl;
+    }
+};
+
+#endif // GEOMETRY_TEST_H
@@ -0,0 +1,284 @@
+#ifndef GIF_TEST_H
+#define GIF_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include "../src/gif.h"
+#include "../src/scheduler.h"
+#include "../examples/calculators/gifcalculator.h"
+
+using namespace std;
+
+class GifTest {
+public:
+    static void run() {
+        cout << "Starting GIF Tests...\n";
+
+        testPalette();
+        testLzw();
+        testWriter();
+        testCalculator();
+
+        cout << "All GIF Tests Completed.\n";
+    }
+
+private:
+    // Reference LZW decoder, returns the indexes of one image
+    static vector<uint8_t> decodeLzw(const vector<uint8_t>& blocks, size_t& offset) {
+        const int32_t minCodeSize = blocks[offset++];
+        vector<uint8_t> data;
+        while (blocks[offset] != 0) {
+            data.insert(data.end(), blocks.begin() + offset + 1, blocks.begin() + offset + 1 + blocks[offset]);
+            offset += blocks[offset] + 1;
+        }
+        ++offset;
+
+        const int32_t clearCode = 1 << minCodeSize;
+        vector<vector<uint8_t>> table;
+        int32_t codeSize = minCodeSize + 1;
+        vector<uint8_t> out, previous;
+        size_t bit = 0;
+        while (bit + codeSize <= data.size() * 8) {
+            int32_t code = 0;
+            for (int32_t i = 0; i < codeSize; ++i, ++bit) code |= ((data[bit >> 3] >> (bit & 7)) & 1) << i;
+            if (code == clearCode) {
+                table.clear();
+                for (int32_t i = 0; i < clearCode + 2; ++i) table.push_back({static_cast<uint8_t>(i)});
+                codeSize = minCodeSize + 1;
+                previous.clear();
+                continue;
+            }
+            if (code == clearCode + 1) break;
+            vector<uint8_t> entry;
+            if (code < static_cast<int32_t>(table.size())) {
+                entry = table[code];
+            } else {
+                assert(code == static_cast<int32_t>(table.size()) && !previous.empty());
+                entry = previous;
+                entry.push_back(previous[0]);
+            }
+            out.insert(out.end(), entry.begin(), entry.end());
+            if (!previous.empty() && table.size() < 4096) {
+                previous.push_back(entry[0]);
+                table.push_back(previous);
+                if (table.size() == (1u << codeSize) && codeSize < 12) ++codeSize;
+            }
+            previous = entry;
+        }
+        return out;
+    }
+
+    // Decodes every image of a file onto the canvas, returns the gray level of each pixel per frame
+    static vector<vector<uint8_t>> decodeFrames(const vector<uint8_t>& bytes) {
+        assert(string(bytes.begin(), bytes.begin() + 6) == "GIF89a" && bytes.back() == 0x3B);
+        const int32_t width = bytes[6] | bytes[7] << 8, height = bytes[8] | bytes[9] << 8;
+        const size_t tableSize = 3u << ((bytes[10] & 7) + 1);
+        const uint8_t* colors = bytes.data() + 13;
+        vector<uint8_t> canvas(static_cast<size_t>(width) * height, 0);
+        vector<vector<uint8_t>> frames;
+        int32_t transparent = -1;
+
+        size_t offset = 13 + tableSize;
+        while (bytes[offset] != 0x3B) {
+            if (bytes[offset] == 0x21) {
+                if (bytes[offset + 1] == 0xF9) transparent = bytes[offset + 3] & 1 ? bytes[offset + 6] : -1;
+                offset += 2;
+                while (bytes[offset] != 0) offset += bytes[offset] + 1;
+                ++offset;
+                continue;
+            }
+            assert(bytes[offset] == 0x2C);
+            const int32_t left = bytes[offset + 1] | bytes[offset + 2] << 8, top = bytes[offset + 3] | bytes[offset + 4] << 8;
+            const int32_t w = bytes[offset + 5] | bytes[offset + 6] << 8, h = bytes[offset + 7] | bytes[offset + 8] << 8;
+            offset += 10;
+            const vector<uint8_t> indexes = decodeLzw(bytes, offset);
+            assert(indexes.size() == static_cast<size_t>(w) * h);
+            for (int32_t y = 0; y < h; ++y) {
+                for (int32_t x = 0; x < w; ++x) {
+                    const uint8_t index = indexes[y * w + x];
+                    if (index != transparent) canvas[(top + y) * width + left + x] = colors[3 * index];
+                }
+            }
+            frames.push_back(canvas);
+        }
+        return frames;
+    }
+
+    static void testPalette() {
+        // Dithered values map back to their lattice entry
+        GifPalette palette(6, 7, 6);
+        assert(palette.getIndexBits() == 8 && palette.getTransparentIndex() == 252);
+        assert(palette.getColors().size() == 3 * 256);
+        Image frame(3, 1, PixelFormat::RGB24, vector<uint8_t>{0, 0, 0, 255, 255, 255, 51, 42, 204});
+        vector<uint8_t> indexes;
+        palette.map(frame, indexes);
+        assert(indexes[0] == 0 && indexes[1] == 251);
+        // 51 is red level 1, 42 green level 1, 204 blue level 4
+        assert(indexes[2] == (1 * 7 + 1) * 6 + 4);
+        const uint8_t* color = palette.getColors().data() + 3 * indexes[2];
+        assert(color[0] == 51 && color[1] == 42 && color[2] == 204);
+
+        // Packed gray levels are indexes
+        GifPalette gray = GifPalette::gray(4);
+        Image packed(5, 1, PixelFormat::GRAYSCALE2, vector<uint8_t>{0x1B, 0xC0});
+        gray.map(packed, indexes);
+        assert((indexes == vector<uint8_t>{0, 1, 2, 3, 3}));
+        assert(gray.getIndexBits() == 3 && gray.getColors()[3 * 3] == 255);
+
+        // GRAYSCALE8 levels map to the nearest gray
+        Image levels(4, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 100, 200, 255});
+        gray.map(levels, indexes);
+        assert((indexes == vector<uint8_t>{0, 1, 2, 3}));
+
+        bool thrown = false;
+        try {
+            GifPalette(8, 8, 8);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Palette test PASSED" << endl;
+    }
+
+    static void testLzw() {
+        // Noise fills the dictionary several times, flat areas make long strings
+        const int32_t width = 300, height = 200;
+        vector<uint8_t> indexes(width * height);
+        srand(13);
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            indexes[i] = i < indexes.size() / 2 ? static_cast<uint8_t>(rand() % 200) : static_cast<uint8_t>(i / 5000);
+        }
+        vector<uint8_t> blocks;
+        GifLzw::encode(indexes.data(), width, 0, 0, width, height, 8, blocks);
+        size_t offset = 0;
+        assert(decodeLzw(blocks, offset) == indexes);
+        assert(offset == blocks.size());
+
+        // A rectangle with 2-bit indexes
+        for (uint8_t& index : indexes) index &= 3;
+        blocks.clear();
+        GifLzw::encode(indexes.data(), width, 17, 150, 41, 9, 2, blocks);
+        offset = 0;
+        vector<uint8_t> decoded = decodeLzw(blocks, offset);
+        assert(decoded.size() == 41 * 9);
+        for (int32_t y = 0; y < 9; ++y) {
+            for (int32_t x = 0; x < 41; ++x) assert(decoded[y * 41 + x] == indexes[(150 + y) * width + 17 + x]);
+        }
+        cout << "LZW test PASSED" << endl;
+    }
+
+    static void testWriter() {
+        const string path = "gif_test.gif";
+        GifPalette palette = GifPalette::gray(16);
+        vector<uint8_t> first(64 * 32, 3), second = first;
+        for (int32_t y = 10; y < 14; ++y) second[y * 64 + 20] = 9;
+        second[12 * 64 + 30] = 1;
+        {
+            GifWriter writer(path, 64, 32, palette, 0, 1);
+            writer.addFrame(vector<uint8_t>(first), 0);
+            writer.addFrame(vector<uint8_t>(first), 40000);     // Unchanged, merged
+            writer.addFrame(vector<uint8_t>(second), 80000);
+            bool thrown = false;
+            try {
+                writer.addFrame(vector<uint8_t>(10), 120000);
+            } catch (const ImageException&) {
+                thrown = true;
+            }
+            assert(thrown);
+            writer.close();
+            assert(writer.getStoredFrameCount() == 2 && writer.getMergedFrameCount() == 1);
+        }
+
+        ifstream file(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        assert(string(bytes.begin(), bytes.begin() + 6) == "GIF89a" && bytes.back() == 0x3B);
+        // Header, 32 color table, looping extension, then the first control block
+        size_t offset = 13 + 3 * 32 + 19;
+        assert(bytes[offset] == 0x21 && bytes[offset + 1] == 0xF9);
+        assert(bytes[offset + 4] == 8 && "the merged frame doubles the delay");
+        offset += 8 + 10;
+        assert(decodeLzw(bytes, offset) == first);
+
+        // The second image only covers the changed rectangle, the rest is transparent
+        assert(bytes[offset + 3] == 5 && bytes[offset + 4] == 4 && bytes[offset + 6] == 16);
+        offset += 8;
+        assert(bytes[offset] == 0x2C);
+        assert(bytes[offset + 1] == 20 && bytes[offset + 3] == 10 && bytes[offset + 5] == 11 && bytes[offset + 7] == 4);
+        offset += 10;
+        vector<uint8_t> rectangle = decodeLzw(bytes, offset);
+        assert(rectangle.size() == 44 && rectangle[0] == 9 && rectangle[1] == 16 && rectangle[2 * 11 + 10] == 1);
+        remove(path.c_str());
+        cout << "Writer test PASSED" << endl;
+    }
+
+    static Image square(int32_t x0, int32_t y0) {
+        Image frame(24, 16, PixelFormat::GRAYSCALE8, vector<uint8_t>(24 * 16, 0));
+        for (int32_t y = y0; y < y0 + 4; ++y) {
+            for (int32_t x = x0; x < x0 + 5; ++x) frame.getData()[y * 24 + x] = 255;
+        }
+        return frame;
+    }
+
+    static Scheduler* gifScheduler(GifCalculator* calculator, const string& path, int frames) {
+        auto sidePackets = make_shared<map<string, Packet>>();
+        (*sidePackets)["gifPath"] = Packet(path);
+        (*sidePackets)["grayCount"] = Packet(2);
+        (*sidePackets)["gifFrames"] = Packet(frames);
+        Scheduler* scheduler = new Scheduler();
+        scheduler->setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler->registerCalculator(calculator, sidePackets);
+        scheduler->connectCalculators();
+        scheduler->connectOutput("GifCalculator", "ImageGif");
+        return scheduler;
+    }
+
+    static void testCalculator() {
+        // Three frames are recorded, close() writes the trailer while the graph still runs
+        const string path = "gif_calculator_test.gif";
+        const Image frames[4] = {square(0, 0), square(3, 2), square(3, 2), square(18, 11)};
+        unique_ptr<Scheduler> scheduler(gifScheduler(new GifCalculator(), path, 3));
+        for (const Image& frame : frames) {
+            scheduler->writeToInputPort(Packet(frame));
+            scheduler->run();
+            assert(scheduler->readFromOutputPort().get<Image>().getData() == frame.getData());
+        }
+
+        ifstream file(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        const vector<vector<uint8_t>> decoded = decodeFrames(bytes);
+        assert(decoded.size() == 2 && "the repeated frame extends the delay, the fourth is not recorded");
+        assert(decoded[0] == frames[0].getData() && decoded[1] == frames[1].getData());
+        remove(path.c_str());
+
+        // Writing past the end of the device fails when the file is finished
+        scheduler.reset(gifScheduler(new GifCalculator(), "/dev/full", 2));
+        scheduler->writeToInputPort(Packet(frames[0]));
+        scheduler->run();
+        scheduler->writeToInputPort(Packet(frames[1]));
+        bool thrown = false;
+        try {
+            scheduler->run();
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // Open ended recordings are finished explicitly
+        GifCalculator* calculator = new GifCalculator();
+        scheduler.reset(gifScheduler(calculator, "/dev/full", 0));
+        scheduler->writeToInputPort(Packet(frames[0]));
+        scheduler->run();
+        thrown = false;
+        try {
+            calculator->finish();
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Calculator test PASSED" << endl;
+    }
+};
+
+#endif // GIF_TEST_H
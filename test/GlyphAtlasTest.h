@@ -0,0 +1,65 @@
+#ifndef GLYPH_ATLAS_TEST_H
+#define GLYPH_ATLAS_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../src/glyphatlas.h"
+
+using namespace std;
+
+class GlyphAtlasTest {
+public:
+    static void run() {
+        cout << "Starting GlyphAtlas Tests...\n";
+
+        testCells();
+        testCharacterMapping();
+
+        cout << "All GlyphAtlas Tests Completed.\n";
+    }
+
+private:
+    static void testCells() {
+        GlyphAtlas atlas(3, 200);
+        assert(atlas.getCellWidth() == 18 && atlas.getCellHeight() == 27);
+
+        // '-' is a full width bar on font row 3, scaled by 3 below one blank row
+        const int32_t dash = atlas.cellOf('-');
+        for (int32_t y = 0; y < atlas.getCellHeight(); ++y) {
+            const bool bar = y >= 3 + 3 * 3 && y < 3 + 4 * 3;
+            for (int32_t x = 0; x < atlas.getCellWidth(); ++x) {
+                const bool set = bar && x < 15;
+                assert(atlas.cellRow(dash, y)[x] == (set ? 200 : 0));
+            }
+        }
+
+        bool thrown = false;
+        try {
+            GlyphAtlas invalid(0);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Cells test PASSED" << endl;
+    }
+
+    static void testCharacterMapping() {
+        GlyphAtlas atlas(1);
+        assert(atlas.cellOf('a') == atlas.cellOf('A'));
+        assert(atlas.cellOf('z') == atlas.cellOf('Z'));
+        assert(atlas.cellOf('0') != atlas.cellOf('O'));
+        assert(atlas.cellOf('~') == atlas.cellOf('?'));
+        assert(atlas.cellOf(static_cast<char>(0xE9)) == atlas.cellOf('?'));
+
+        // The space glyph is empty
+        const int32_t space = atlas.cellOf(' ');
+        for (int32_t y = 0; y < atlas.getCellHeight(); ++y) {
+            for (int32_t x = 0; x < atlas.getCellWidth(); ++x) {
+                assert(atlas.cellRow(space, y)[x] == 0);
+            }
+        }
+        cout << "Character mapping test PASSED" << endl;
+    }
+};
+
+#endif // GLYPH_ATLAS_TEST_H
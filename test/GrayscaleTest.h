@@ -0,0 +1,114 @@
+#ifndef GRAYSCALE_TEST_H
+#define GRAYSCALE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include "../examples/calculators/graycalculator.h"
+#include "../examples/calculators/dithercalculator.h"
+#include "../examples/calculators/bannercalculator.h"
+
+using namespace std;
+
+class GrayscaleTest {
+public:
+    static void run() {
+        cout << "Starting Grayscale Tests...\n";
+
+        testLuma();
+        testGrayscaleKernels();
+        testToRGBA32();
+        testPaletteBMP();
+
+        cout << "All Grayscale Tests Completed.\n";
+    }
+
+private:
+    static void testLuma() {
+        // BT.709 weights, rounded: white stays white
+        const vector<uint8_t> rgb = {255, 255, 255,  255, 0, 0,  0, 255, 0,  0, 0, 255,
+                                     100, 150, 200,  128, 128, 128};
+        const vector<uint8_t> expected = {255, 54, 182, 18, 143, 128};
+        const Image image(6, 1, PixelFormat::RGB24, rgb);
+
+        const Image gray = GrayscaleKernel().toGrayscale8<PixelFormat::RGB24>(image);
+        assert(gray.getFormat() == PixelFormat::GRAYSCALE8 && gray.getStride() == 6);
+        assert(gray.getData() == expected);
+
+        // RGBA32 drops alpha
+        Image rgba = ImageUtils::toRGBA32(image);
+        for (size_t i = 0; i < 6; ++i) rgba.getData()[i * 4 + 3] = 7;
+        Image singleChannel = rgba;
+        GrayscaleKernel(true).process(singleChannel);
+        assert(singleChannel.getFormat() == PixelFormat::GRAYSCALE8 && singleChannel.getData() == expected);
+
+        // In place conversion keeps the format and alpha
+        GrayscaleKernel().process(rgba);
+        assert(rgba.getFormat() == PixelFormat::RGBA32);
+        for (size_t i = 0; i < 6; ++i) {
+            const uint8_t* pixel = rgba.getData().data() + i * 4;
+            assert(pixel[0] == expected[i] && pixel[1] == expected[i] && pixel[2] == expected[i] && pixel[3] == 7);
+        }
+        cout << "Luma test PASSED" << endl;
+    }
+
+    static void testGrayscaleKernels() {
+        // Dithering GRAYSCALE8 without spread quantizes to the gray levels
+        Image gray(4, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 100, 200, 255});
+        DitherKernel(2, 2, 2, 0, 1, 3).process(gray);
+        assert(gray.getFormat() == PixelFormat::GRAYSCALE8);
+        assert((gray.getData() == vector<uint8_t>{0, 0, 127, 255}));
+
+        // A banner over GRAYSCALE8 is written as luma, transparent pixels are skipped
+        Image frame(3, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>(6, 9));
+        const Image banner(2, 1, PixelFormat::RGBA32, vector<uint8_t>{0, 255, 0, 255,  255, 255, 255, 0});
+        BannerKernel(banner, 1, 1).process(frame);
+        assert((frame.getData() == vector<uint8_t>{9, 9, 9, 9, 182, 9}));
+
+        // Banner pixels past the image are clipped
+        BannerKernel(banner, 2, 0).process(frame);
+        assert(frame.getData()[2] == 182);
+        cout << "Gray kernels test PASSED" << endl;
+    }
+
+    static void testToRGBA32() {
+        const Image gray(3, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 1, 2, 250, 251, 252});
+        const Image rgba = ImageUtils::toRGBA32(gray);
+        assert(rgba.getFormat() == PixelFormat::RGBA32 && rgba.getWidth() == 3 && rgba.getHeight() == 2);
+        for (size_t i = 0; i < 6; ++i) {
+            const uint8_t* pixel = rgba.getData().data() + i * 4;
+            const uint8_t luma = gray.getData()[i];
+            assert(pixel[0] == luma && pixel[1] == luma && pixel[2] == luma && pixel[3] == 255);
+        }
+
+        // RGB24 gets an opaque alpha
+        const Image rgb(3, 1, PixelFormat::RGB24, vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8, 9});
+        const Image expanded = ImageUtils::toRGBA32(rgb);
+        assert((expanded.getData() == vector<uint8_t>{1, 2, 3, 255, 4, 5, 6, 255, 7, 8, 9, 255}));
+        cout << "To RGBA32 test PASSED" << endl;
+    }
+
+    static void testPaletteBMP() {
+        // Odd width: rows are padded to 4 bytes in the file
+        const string path = "grayscale_palette_test.bmp";
+        vector<uint8_t> levels(7 * 5);
+        for (size_t i = 0; i < levels.size(); ++i) levels[i] = static_cast<uint8_t>(i * 37);
+        const Image gray(7, 5, PixelFormat::GRAYSCALE8, levels);
+        ImageUtils::writeBMP(path, gray);
+
+        FILE* file = fopen(path.c_str(), "rb");
+        assert(file);
+        fseek(file, 0, SEEK_END);
+        const long size = ftell(file);
+        fclose(file);
+        assert(size == 14 + 40 + 256 * 4 + 8 * 5 && "8-bit indexes with a 256 entry palette");
+
+        const Image read = ImageUtils::readBMP(path);
+        assert(read.getFormat() == PixelFormat::GRAYSCALE8 && read.getWidth() == 7 && read.getHeight() == 5);
+        assert(read.getData() == gray.getData());
+        remove(path.c_str());
+        cout << "Palette BMP test PASSED" << endl;
+    }
+};
+
+#endif // GRAYSCALE_TEST_H
@@ -2,6 +2,7 @@
 #define IMAGE_TEST_H
 
 #include "../src/image.h"
+#include "../src/bitpacking.h"
 #include <iostream>
 #include <cassert>
 
@@ -14,6 +15,8 @@ public:
         testSetDataAndGetData();
         testClone();
         testInvalidImage();
+        testPixelFormatTraits();
+        testBitPacking();
 
         cout << "All tests passed!\n";
     }
@@ -116,6 +119,61 @@ private:
         cout << "Invalid image test PASSED!" << endl;
     }
 
+    static void testPixelFormatTraits() {
+        cout << "Testing pixel format traits..." << endl;
+
+        static_assert(PixelFormatTraits<PixelFormat::RGB24>::bytesPerPixel == 3, "RGB24 is 3 bytes");
+        static_assert(!PixelFormatTraits<PixelFormat::RGB24>::hasAlpha, "RGB24 has no alpha");
+        static_assert(PixelFormatTraits<PixelFormat::RGBA32>::alphaOffset == 3, "RGBA32 alpha offset");
+        static_assert(Image::bitsPerPixel(PixelFormat::GRAYSCALE8) == 8, "GRAYSCALE8 is 8 bits");
+        static_assert(Image::bitsPerPixel(PixelFormat::JPEG) == 0, "JPEG has no fixed depth");
+
+        // Rows are tightly packed for every format
+        assert(Image(5, 2, PixelFormat::RGB24).getStride() == 15);
+        assert(Image(5, 2, PixelFormat::GRAYSCALE8).getStride() == 5);
+        assert(Image(9, 2, PixelFormat::GRAYSCALE1).getStride() == 2);
+        assert(Image(5, 2, PixelFormat::RGB24).getData().size() == 30);
+
+        // Only the listed formats are dispatched
+        int bytes = 0;
+        bool matched = dispatchPixelFormat<PixelFormat::RGB24, PixelFormat::RGBA32>(
+            PixelFormat::RGB24, [&](auto tag) {
+                bytes = decltype(tag)::Traits::bytesPerPixel;
+            });
+        assert(matched && bytes == 3);
+        matched = dispatchPixelFormat<PixelFormat::RGB24, PixelFormat::RGBA32>(
+            PixelFormat::GRAYSCALE8, [&](auto tag) {});
+        assert(!matched);
+
+        cout << "Pixel format traits test PASSED!" << endl;
+    }
+
+    static void testBitPacking() {
+        cout << "Testing bit packing..." << endl;
+
+        // 37 pixels cover the SIMD path and a partial last byte
+        for (int bits : {1, 2, 4}) {
+            const size_t count = 37;
+            vector<uint8_t> levels(count);
+            for (size_t i = 0; i < count; ++i) {
+                levels[i] = static_cast<uint8_t>((i * 7 + 3) % (1 << bits));
+            }
+            vector<uint8_t> packed((count * bits + 7) / 8);
+            vector<uint8_t> unpacked(count);
+            BitPacking::packRow(levels.data(), count, bits, packed.data());
+            BitPacking::unpackRow(packed.data(), count, bits, unpacked.data());
+            assert(unpacked == levels && "pack and unpack should round trip");
+        }
+
+        // The leftmost pixel is stored in the most significant bit
+        uint8_t levels[8] = {1, 0, 0, 0, 0, 0, 0, 1};
+        uint8_t packed = 0;
+        BitPacking::packRow(levels, 8, 1, &packed);
+        assert(packed == 0x81);
+
+        cout << "Bit packing test PASSED!" << endl;
+    }
+
 };
 
 #endif // IMAGE_TEST_H
@@ -0,0 +1,144 @@
+#ifndef IMAGE_VIEW_TEST_H
+#define IMAGE_VIEW_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include "../src/imageview.h"
+
+using namespace std;
+
+class ImageViewTest {
+public:
+    static void run() {
+        cout << "Starting ImageView Tests...\n";
+
+        testFlippedView();
+        testTranspose();
+        testFlips();
+        testSubView();
+
+        cout << "All ImageView Tests Completed.\n";
+    }
+
+private:
+    static Image makeImage(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        for (size_t i = 0; i < image.getData().size(); ++i) {
+            image.getData()[i] = static_cast<uint8_t>(i * 7 + i / 5);
+        }
+        return image;
+    }
+
+    static const uint8_t* pixelAt(const Image& image, int32_t x, int32_t y) {
+        return image.getData().data() + y * image.getStride() + x * Image::bitsPerPixel(image.getFormat()) / 8;
+    }
+
+    static void testFlippedView() {
+        Image image = makeImage(5, 4, PixelFormat::RGB24);
+        ConstImageView flipped = ConstImageView(image).flippedVertical();
+        assert(flipped.getStride() == -image.getStride());
+        assert(flipped.row(0) == pixelAt(image, 0, 3));
+
+        // Flipping twice gives back the original view
+        assert(flipped.flippedVertical().row(0) == image.getData().data());
+
+        Image copy = flipped.toImage();
+        for (int32_t y = 0; y < 4; ++y) {
+            assert(memcmp(pixelAt(copy, 0, y), pixelAt(image, 0, 3 - y), 15) == 0);
+        }
+        cout << "Flipped view test PASSED" << endl;
+    }
+
+    static void testTranspose() {
+        // Sizes around the tile and SIMD block boundaries
+        const int32_t sizes[][2] = {{1, 1}, {3, 7}, {4, 4}, {33, 70}, {67, 5}};
+        for (PixelFormat format : {PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32}) {
+            const int32_t bytesPerPixel = Image::bitsPerPixel(format) / 8;
+            for (const auto& size : sizes) {
+                Image source = makeImage(size[0], size[1], format);
+                Image target(size[1], size[0], format);
+                ImageTransform::transpose(ConstImageView(source), ImageView(target));
+                for (int32_t y = 0; y < size[1]; ++y) {
+                    for (int32_t x = 0; x < size[0]; ++x) {
+                        assert(memcmp(pixelAt(target, y, x), pixelAt(source, x, y), bytesPerPixel) == 0);
+                    }
+                }
+
+                // A flipped source rotates by 90 degrees
+                Image rotated(size[1], size[0], format);
+                ImageTransform::transpose(ConstImageView(source).flippedVertical(), ImageView(rotated));
+                for (int32_t y = 0; y < size[1]; ++y) {
+                    for (int32_t x = 0; x < size[0]; ++x) {
+                        assert(memcmp(pixelAt(rotated, size[1] - 1 - y, x), pixelAt(source, x, y),
+                                      bytesPerPixel) == 0);
+                    }
+                }
+            }
+        }
+
+        bool thrown = false;
+        try {
+            Image source(4, 3, PixelFormat::RGB24);
+            Image target(4, 3, PixelFormat::RGB24);
+            ImageTransform::transpose(ConstImageView(source), ImageView(target));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Transpose test PASSED" << endl;
+    }
+
+    static void testFlips() {
+        for (PixelFormat format : {PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32}) {
+            const int32_t bytesPerPixel = Image::bitsPerPixel(format) / 8;
+            Image original = makeImage(7, 5, format);
+
+            Image mirrored = original;
+            ImageTransform::flipHorizontal(ImageView(mirrored));
+            Image flipped = original;
+            ImageTransform::flipVertical(ImageView(flipped));
+            for (int32_t y = 0; y < 5; ++y) {
+                for (int32_t x = 0; x < 7; ++x) {
+                    assert(memcmp(pixelAt(mirrored, 6 - x, y), pixelAt(original, x, y), bytesPerPixel) == 0);
+                    assert(memcmp(pixelAt(flipped, x, 4 - y), pixelAt(original, x, y), bytesPerPixel) == 0);
+                }
+            }
+
+            // The in place flip matches a copy through the flipped view
+            assert(flipped.getData() == ConstImageView(original).flippedVertical().toImage().getData());
+        }
+        cout << "Flip test PASSED" << endl;
+    }
+
+    static void testSubView() {
+        Image image = makeImage(6, 5, PixelFormat::RGB24);
+        ImageView cell = ImageView(image).subView(2, 1, 3, 2);
+        assert(cell.getWidth() == 3 && cell.getHeight() == 2);
+        assert(cell.getStride() == image.getStride());
+        assert(cell.row(0) == pixelAt(image, 2, 1) && cell.row(1) == pixelAt(image, 2, 2));
+
+        // Writes through the view land in the image, nothing else changes
+        Image before = image;
+        memset(cell.row(1), 0xAB, cell.getRowBytes());
+        for (int32_t y = 0; y < 5; ++y) {
+            for (int32_t x = 0; x < 6; ++x) {
+                const bool inside = y == 2 && x >= 2 && x < 5;
+                const uint8_t* pixel = pixelAt(image, x, y);
+                assert(inside ? pixel[0] == 0xAB && pixel[2] == 0xAB
+                              : memcmp(pixel, pixelAt(before, x, y), 3) == 0);
+            }
+        }
+
+        bool thrown = false;
+        try {
+            ImageView(image).subView(4, 0, 3, 1);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Sub view test PASSED" << endl;
+    }
+};
+
+#endif // IMAGE_VIEW_TEST_H
@@ -0,0 +1,126 @@
+#ifndef INTEGRAL_IMAGE_TEST_H
+#define INTEGRAL_IMAGE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include "../src/integralimage.h"
+#include "../src/packet.h"
+
+using namespace std;
+
+class IntegralImageTest {
+public:
+    static void run() {
+        cout << "Starting IntegralImage Tests...\n";
+
+        testRectangleSums();
+        testMeans();
+        testPacketAttachment();
+
+        cout << "All IntegralImage Tests Completed.\n";
+    }
+
+private:
+    static Image makeImage(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        srand(7);
+        for (uint8_t& value : image.getData()) {
+            value = static_cast<uint8_t>(rand() % 256);
+        }
+        return image;
+    }
+
+    static uint32_t naiveSum(const Image& image, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                             int32_t channel) {
+        const int32_t bytesPerPixel = Image::bitsPerPixel(image.getFormat()) / 8;
+        uint32_t total = 0;
+        for (int32_t y = y0; y < y1; ++y) {
+            for (int32_t x = x0; x < x1; ++x) {
+                total += image.getData()[y * image.getStride() + x * bytesPerPixel + channel];
+            }
+        }
+        return total;
+    }
+
+    static void testRectangleSums() {
+        for (PixelFormat format : {PixelFormat::GRAYSCALE8, PixelFormat::RGB24, PixelFormat::RGBA32}) {
+            Image image = makeImage(131, 77, format);
+            IntegralImage integral(image);
+            assert(integral.getChannels() == Image::bitsPerPixel(format) / 8);
+
+            const int32_t rectangles[][4] = {{0, 0, 131, 77}, {5, 3, 6, 4}, {17, 40, 100, 76}, {130, 0, 131, 77}};
+            for (const auto& r : rectangles) {
+                uint32_t all[4];
+                integral.sums(r[0], r[1], r[2], r[3], all);
+                for (int32_t channel = 0; channel < integral.getChannels(); ++channel) {
+                    uint32_t expected = naiveSum(image, r[0], r[1], r[2], r[3], channel);
+                    assert(integral.sum(r[0], r[1], r[2], r[3], channel) == expected);
+                    assert(all[channel] == expected);
+                }
+            }
+
+            // Rectangles are clipped to the image, empty ones sum to zero
+            assert(integral.sum(-10, -10, 1000, 1000) == naiveSum(image, 0, 0, 131, 77, 0));
+            assert(integral.sum(50, 50, 40, 60) == 0);
+        }
+
+        bool thrown = false;
+        try {
+            IntegralImage integral(Image(8, 8, PixelFormat::GRAYSCALE1));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Rectangle sums test PASSED" << endl;
+    }
+
+    static void testMeans() {
+        Image image(4, 2, PixelFormat::RGB24);
+        for (int32_t i = 0; i < 8; ++i) {
+            image.getData()[i * 3] = static_cast<uint8_t>(i * 10);     // 0..70
+            image.getData()[i * 3 + 1] = 255;
+            image.getData()[i * 3 + 2] = static_cast<uint8_t>(i % 2);  // Half zeros, half ones
+        }
+        IntegralImage integral(image);
+        uint8_t mean[3];
+        integral.means(0, 0, 4, 2, mean);
+        assert(mean[0] == 35 && mean[1] == 255 && mean[2] == 1);   // 0.5 rounds up
+        integral.means(0, 1, 2, 2, mean);
+        assert(mean[0] == 45);
+        cout << "Means test PASSED" << endl;
+    }
+
+    static void testPacketAttachment() {
+        Image image = makeImage(16, 16, PixelFormat::GRAYSCALE8);
+        Packet packet(image);
+        assert(!packet.hasAttachment("integralImage"));
+        packet.attach("integralImage", IntegralImage(packet.get<Image>()));
+
+        // Attachments follow the packet when it is moved
+        Packet moved(std::move(packet));
+        assert(!packet.hasAttachment("integralImage"));
+        assert(moved.hasAttachment("integralImage"));
+        assert(moved.getAttachment<IntegralImage>("integralImage").sum(0, 0, 16, 16) ==
+               naiveSum(image, 0, 0, 16, 16, 0));
+
+        bool thrown = false;
+        try {
+            moved.getAttachment<int>("integralImage");
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        try {
+            moved.getAttachment<IntegralImage>("missing");
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Packet attachment test PASSED" << endl;
+    }
+};
+
+#endif // INTEGRAL_IMAGE_TEST_H
@@ -0,0 +1,270 @@
+#ifndef JPEG_TEST_H
+#define JPEG_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include "../src/imageutils.h"
+
+using namespace std;
+
+class JpegTest {
+public:
+    static void run() {
+        cout << "Starting JPEG Tests...\n";
+
+        testTransforms();
+        testRoundTrip();
+        testRestartMarkers();
+        testCompressedImages();
+        testInvalid();
+        testFiles();
+
+        cout << "All JPEG Tests Completed.\n";
+    }
+
+private:
+    // Peak signal to noise ratio between two images of the same layout
+    static double psnr(const Image& a, const Image& b) {
+        assert(a.getData().size() == b.getData().size());
+        double error = 0;
+        for (size_t i = 0; i < a.getData().size(); ++i) {
+            const double difference = static_cast<double>(a.getData()[i]) - b.getData()[i];
+            error += difference * difference;
+        }
+        error /= a.getData().size();
+        return error == 0 ? 99.0 : 10.0 * log10(255.0 * 255.0 / error);
+    }
+
+    // Smooth gradients with some texture, like a camera frame
+    static Image makeImage(int32_t width, int32_t height, PixelFormat format) {
+        const int32_t channels = Image::bitsPerPixel(format) / 8;
+        vector<uint8_t> data(static_cast<size_t>(width) * height * channels);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                uint8_t* pixel = data.data() + (static_cast<size_t>(y) * width + x) * channels;
+                for (int32_t c = 0; c < channels; ++c) {
+                    const double value = 128 + 60 * sin((x + 3 * c) * 0.07) + 50 * cos((y - 5 * c) * 0.05) + (x * y % 7);
+                    pixel[c] = static_cast<uint8_t>(max(0.0, min(255.0, value)));
+                }
+            }
+        }
+        return Image(width, height, format, std::move(data));
+    }
+
+    static size_t countMarkers(const vector<uint8_t>& file, uint8_t low, uint8_t high) {
+        size_t count = 0;
+        for (size_t i = 0; i + 1 < file.size(); ++i) {
+            if (file[i] == 0xFF && file[i + 1] >= low && file[i + 1] <= high) ++count;
+        }
+        return count;
+    }
+
+    static void testTransforms() {
+        uint8_t block[64];
+        srand(3);
+        for (uint8_t& sample : block) sample = static_cast<uint8_t>(rand());
+
+        // Forward DCT against the definition, F(u, v) scaled by 16 * s(u) * s(v).
+        // The fast transform rounds its products, a few units off at most
+        int16_t coefficients[64];
+        JpegCodec::forwardDct(block, 8, coefficients);
+        double reference[64];
+        for (int32_t v = 0; v < 8; ++v) {
+            for (int32_t u = 0; u < 8; ++u) {
+                double sum = 0;
+                for (int32_t y = 0; y < 8; ++y) {
+                    for (int32_t x = 0; x < 8; ++x) {
+                        sum += (block[y * 8 + x] - 128) * cos((2 * x + 1) * u * M_PI / 16) * cos((2 * y + 1) * v * M_PI / 16);
+                    }
+                }
+                reference[v * 8 + u] = sum * (u == 0 ? M_SQRT1_2 : 1) * (v == 0 ? M_SQRT1_2 : 1) / 4;
+                const double scaled = coefficients[v * 8 + u] / (16 * JpegCodec::aanScale(u) * JpegCodec::aanScale(v));
+                assert(fabs(scaled - reference[v * 8 + u]) < 4);
+            }
+        }
+
+        // Unit quantizers bring the samples back
+        const uint16_t unit[64] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+        int32_t multipliers[64];
+        JpegCodec::dequantTable(unit, multipliers);
+        int16_t dequantized[64];
+        for (int32_t i = 0; i < 64; ++i) {
+            dequantized[i] = JpegCodec::dequantize(static_cast<int32_t>(lround(reference[i])), multipliers[i]);
+        }
+        uint8_t samples[64];
+        JpegCodec::inverseDct(dequantized, samples, 8);
+        for (int32_t i = 0; i < 64; ++i) assert(abs(samples[i] - block[i]) <= 2);
+
+        // Saturated input clamps instead of wrapping
+        assert(JpegCodec::dequantize(2047, 255 << 10) == 32767);
+        assert(JpegCodec::dequantize(-2047, 255 << 10) == -32768);
+        cout << "Transforms test PASSED" << endl;
+    }
+
+    static void testRoundTrip() {
+        // Odd sizes cover partial MCUs and edge replication
+        const Image gray = makeImage(77, 45, PixelFormat::GRAYSCALE8);
+        const vector<uint8_t> grayFile = JpegCodec::encode(gray, 90);
+        Image decodedGray = JpegCodec::decode(grayFile.data(), grayFile.size());
+        assert(decodedGray.getFormat() == PixelFormat::GRAYSCALE8);
+        assert(decodedGray.getWidth() == 77 && decodedGray.getHeight() == 45);
+        assert(psnr(gray, decodedGray) > 38);
+
+        const Image rgb = makeImage(131, 67, PixelFormat::RGB24);
+        const vector<uint8_t> rgbFile = JpegCodec::encode(rgb, 90);
+        Image decodedRgb = JpegCodec::decode(rgbFile.data(), rgbFile.size());
+        assert(decodedRgb.getFormat() == PixelFormat::RGB24);
+        assert(psnr(rgb, decodedRgb) > 32);
+        assert(rgbFile.size() < rgb.getData().size() / 4);
+
+        // Alpha is dropped, the color channels give the same file
+        const Image rgba = makeImage(131, 67, PixelFormat::RGBA32);
+        vector<uint8_t> colors;
+        for (size_t i = 0; i < rgba.getData().size(); i += 4) {
+            colors.insert(colors.end(), rgba.getData().begin() + i, rgba.getData().begin() + i + 3);
+        }
+        assert(JpegCodec::encode(rgba) == JpegCodec::encode(Image(131, 67, PixelFormat::RGB24, std::move(colors))));
+
+        // Higher quality is larger and closer
+        const vector<uint8_t> low = JpegCodec::encode(rgb, 20);
+        Image decodedLow = JpegCodec::decode(low.data(), low.size());
+        assert(low.size() < rgbFile.size() && psnr(rgb, decodedLow) < psnr(rgb, decodedRgb));
+
+        // A single pixel
+        const Image dot(1, 1, PixelFormat::RGB24, vector<uint8_t>{200, 30, 90});
+        const vector<uint8_t> dotFile = JpegCodec::encode(dot, 100);
+        Image decodedDot = JpegCodec::decode(dotFile.data(), dotFile.size());
+        for (int32_t c = 0; c < 3; ++c) assert(abs(decodedDot.getData()[c] - dot.getData()[c]) <= 3);
+        cout << "Round trip test PASSED" << endl;
+    }
+
+    static void testRestartMarkers() {
+        // One restart marker between rows of MCUs, the interval is a row
+        const Image rgb = makeImage(100, 70, PixelFormat::RGB24);
+        const vector<vector<uint8_t>> segments = JpegCodec::encodeSegments(rgb);
+        assert(segments.size() == 5 + 2);
+        for (size_t row = 1; row + 2 < segments.size(); ++row) {
+            const vector<uint8_t>& segment = segments[row];
+            assert(segment[segment.size() - 2] == 0xFF && segment.back() == 0xD0 + ((row - 1) & 7));
+        }
+        assert(segments.back() == (vector<uint8_t>{0xFF, 0xD9}));
+
+        const vector<uint8_t> file = JpegCodec::encode(rgb);
+        assert(countMarkers(file, 0xD0, 0xD7) == 4);
+        size_t dri = 0;
+        while (!(file[dri] == 0xFF && file[dri + 1] == 0xDD)) ++dri;
+        assert(file[dri + 4] == 0 && file[dri + 5] == 7);
+
+        // 38 rows wrap the marker numbers
+        const Image gray = makeImage(40, 300, PixelFormat::GRAYSCALE8);
+        const vector<uint8_t> grayFile = JpegCodec::encode(gray);
+        assert(countMarkers(grayFile, 0xD0, 0xD7) == 37);
+        assert(psnr(gray, JpegCodec::decode(grayFile.data(), grayFile.size())) > 35);
+        cout << "Restart markers test PASSED" << endl;
+    }
+
+    static void testCompressedImages() {
+        const Image rgb = makeImage(64, 48, PixelFormat::RGB24);
+        Image compressed = JpegCodec::compress(rgb);
+        assert(compressed.getFormat() == PixelFormat::JPEG && Image::isCompressed(compressed.getFormat()));
+        assert(compressed.getWidth() == 64 && compressed.getHeight() == 48);
+        assert(compressed.getStride() == 0 && compressed.getData().size() == JpegCodec::encode(rgb).size());
+        assert(psnr(rgb, JpegCodec::decompress(compressed)) > 30);
+
+        bool thrown = false;
+        try {
+            JpegCodec::decompress(rgb);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // A compressed image needs its stream
+        thrown = false;
+        try {
+            Image empty(64, 48, PixelFormat::JPEG, vector<uint8_t>());
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Compressed images test PASSED" << endl;
+    }
+
+    static void expectDecodeError(const vector<uint8_t>& file) {
+        bool thrown = false;
+        try {
+            JpegCodec::decode(file.data(), file.size());
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    static void testInvalid() {
+        const vector<uint8_t> file = JpegCodec::encode(makeImage(48, 48, PixelFormat::RGB24));
+        expectDecodeError(vector<uint8_t>{0x89, 'P', 'N', 'G', 0, 0});
+        expectDecodeError(vector<uint8_t>(file.begin(), file.begin() + 100));
+
+        // Progressive frames are rejected
+        vector<uint8_t> progressive = file;
+        size_t sof = 0;
+        while (!(progressive[sof] == 0xFF && progressive[sof + 1] == 0xC0)) ++sof;
+        progressive[sof + 1] = 0xC2;
+        expectDecodeError(progressive);
+
+        // Garbage in the entropy coded data is reported, not crashed on
+        vector<uint8_t> corrupt = file;
+        for (size_t i = corrupt.size() - 200; i < corrupt.size() - 2; ++i) corrupt[i] = 0xFE;
+        try {
+            JpegCodec::decode(corrupt.data(), corrupt.size());
+        } catch (const runtime_error&) {
+        }
+
+        bool thrown = false;
+        try {
+            JpegCodec::encode(Image(8, 8, PixelFormat::GRAYSCALE4, vector<uint8_t>(32)));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Invalid input test PASSED" << endl;
+    }
+
+    static void testFiles() {
+        const string path = "jpeg_test.jpg";
+        const Image rgb = makeImage(90, 50, PixelFormat::RGB24);
+        ImageUtils::writeJPEG(path, rgb, 95);
+        Image decoded = ImageUtils::readJPEG(path);
+        assert(decoded.getWidth() == 90 && decoded.getFormat() == PixelFormat::RGB24);
+        assert(psnr(rgb, decoded) > 34);
+
+        // Compressed images are written as is
+        Image compressed = JpegCodec::compress(rgb, 50);
+        ImageUtils::writeJPEG(path, compressed);
+        ifstream file(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        assert(bytes == compressed.getData());
+
+        // Packed gray is expanded first
+        ImageUtils::writeJPEG(path, Image(16, 2, PixelFormat::GRAYSCALE1, vector<uint8_t>{0xFF, 0x00, 0xFF, 0x00}));
+        Image gray = ImageUtils::readJPEG(path);
+        assert(gray.getFormat() == PixelFormat::GRAYSCALE8 && gray.getData()[0] > 240 && gray.getData()[15] < 15);
+        remove(path.c_str());
+
+        bool thrown = false;
+        try {
+            ImageUtils::readJPEG("missing_file.jpg");
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Files test PASSED" << endl;
+    }
+};
+
+#endif // JPEG_TEST_H
@@ -0,0 +1,85 @@
+#ifndef LUT3D_TEST_H
+#define LUT3D_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <sstream>
+#include "../src/lut3d.h"
+
+using namespace std;
+
+class Lut3DTest {
+public:
+    static void run() {
+        cout << "Starting Lut3D Tests...\n";
+
+        testIdentity();
+        testParseCube();
+        testApply();
+
+        cout << "All Lut3D Tests Completed.\n";
+    }
+
+private:
+    static void testIdentity() {
+        for (int32_t size : {2, 17, 33}) {
+            Lut3D lut = Lut3D::identity(size);
+            for (int value = 0; value < 256; value += 3) {
+                uint8_t out[3];
+                lut.lookup(value, 255 - value, value / 2, out);
+                assert(abs(out[0] - value) <= 1);
+                assert(abs(out[1] - (255 - value)) <= 1);
+                assert(abs(out[2] - value / 2) <= 1);
+            }
+        }
+        cout << "Identity test PASSED" << endl;
+    }
+
+    static void testParseCube() {
+        // 2-point cube that swaps red and blue
+        istringstream cube(
+            "# comment\n"
+            "TITLE \"swap\"\n"
+            "LUT_3D_SIZE 2\n"
+            "0 0 0\n0 0 1\n0 1 0\n0 1 1\n"
+            "1 0 0\n1 0 1\n1 1 0\n1 1 1\n");
+        Lut3D lut = Lut3D::fromCube(cube);
+        assert(lut.getSize() == 2);
+
+        uint8_t out[3];
+        lut.lookup(200, 10, 50, out);
+        assert(abs(out[0] - 50) <= 1 && abs(out[1] - 10) <= 1 && abs(out[2] - 200) <= 1);
+
+        bool thrown = false;
+        try {
+            istringstream truncated("LUT_3D_SIZE 2\n0 0 0\n");
+            Lut3D::fromCube(truncated);
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && "truncated cube should be rejected");
+        cout << "Parse cube test PASSED" << endl;
+    }
+
+    static void testApply() {
+        Lut3D lut = Lut3D::identity(17);
+        Image image(67, 131, PixelFormat::RGBA32);
+        vector<uint8_t>& data = image.getData();
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<uint8_t>(i * 7);
+        }
+        vector<uint8_t> original = data;
+        lut.apply(image);
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (i % 4 == 3) {
+                assert(data[i] == original[i] && "alpha is untouched");
+            } else {
+                assert(abs(data[i] - original[i]) <= 1);
+            }
+        }
+        cout << "Apply test PASSED" << endl;
+    }
+};
+
+#endif // LUT3D_TEST_H
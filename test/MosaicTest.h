@@ -0,0 +1,186 @@
+#ifndef MOSAIC_TEST_H
+#define MOSAIC_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include "../src/scheduler.h"
+#include "../examples/calculators/mosaiccalculator.h"
+
+using namespace std;
+
+class MosaicTest {
+public:
+    static void run() {
+        cout << "Starting Mosaic Tests...\n";
+
+        testScaling();
+        testAreaMeans();
+        testEmptyCells();
+        testSync();
+
+        cout << "All Mosaic Tests Completed.\n";
+    }
+
+private:
+    static Image noise(int32_t width, int32_t height, PixelFormat format, uint32_t seed) {
+        Image image(width, height, format);
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+        image.setData(image.getData());
+        return image;
+    }
+
+    static Image composeOne(const Image& source, int32_t cellWidth, int32_t cellHeight, MosaicScaling scaling) {
+        const MosaicKernel kernel(1, cellWidth, cellHeight, scaling);
+        Image output(kernel.getOutputWidth(), kernel.getOutputHeight(1), PixelFormat::RGBA32);
+        kernel.compose({&source}, output);
+        return output;
+    }
+
+    // Rounded mean of the source pixels covered by every cell pixel, RGB24 source
+    static vector<uint8_t> areaReference(const Image& source, int32_t cellWidth, int32_t cellHeight) {
+        const int32_t sourceWidth = source.getWidth(), sourceHeight = source.getHeight();
+        vector<uint8_t> expected;
+        for (int32_t y = 0; y < cellHeight; ++y) {
+            const int32_t y0 = y * sourceHeight / cellHeight, y1 = max(y0 + 1, (y + 1) * sourceHeight / cellHeight);
+            for (int32_t x = 0; x < cellWidth; ++x) {
+                const int32_t x0 = x * sourceWidth / cellWidth, x1 = max(x0 + 1, (x + 1) * sourceWidth / cellWidth);
+                const uint32_t area = (x1 - x0) * (y1 - y0);
+                for (int32_t channel = 0; channel < 3; ++channel) {
+                    uint32_t sum = 0;
+                    for (int32_t sy = y0; sy < y1; ++sy) {
+                        for (int32_t sx = x0; sx < x1; ++sx) sum += source.getData()[sy * source.getStride() + sx * 3 + channel];
+                    }
+                    expected.push_back(static_cast<uint8_t>((sum + area / 2) / area));
+                }
+                expected.push_back(255);
+            }
+        }
+        return expected;
+    }
+
+    static void testScaling() {
+        // 4x2 into 2x1: nearest takes the pixel under each cell center, area averages 2x2 blocks
+        const Image source(4, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 100, 200, 50,  20, 60, 60, 80});
+        const Image nearest = composeOne(source, 2, 1, MosaicScaling::NEAREST);
+        assert((nearest.getData() == vector<uint8_t>{60, 60, 60, 255,  80, 80, 80, 255}));
+        const Image area = composeOne(source, 2, 1, MosaicScaling::AREA);
+        assert((area.getData() == vector<uint8_t>{45, 45, 45, 255,  98, 98, 98, 255}));
+
+        // Upscaling repeats pixels with both filters, alpha is kept
+        const Image rgba(2, 1, PixelFormat::RGBA32, vector<uint8_t>{1, 2, 3, 4,  5, 6, 7, 8});
+        for (MosaicScaling scaling : {MosaicScaling::NEAREST, MosaicScaling::AREA}) {
+            const Image output = composeOne(rgba, 4, 2, scaling);
+            for (int32_t y = 0; y < 2; ++y) {
+                for (int32_t x = 0; x < 4; ++x) {
+                    const uint8_t* pixel = output.getData().data() + y * output.getStride() + x * 4;
+                    const uint8_t* expected = rgba.getData().data() + (x / 2) * 4;
+                    assert(equal(pixel, pixel + 4, expected));
+                }
+            }
+        }
+        cout << "Scaling test PASSED" << endl;
+    }
+
+    static void testAreaMeans() {
+        // Footprints of 50x45 use the reciprocal, 100x130 divide
+        const Image small = noise(150, 90, PixelFormat::RGB24, 3);
+        assert(composeOne(small, 3, 2, MosaicScaling::AREA).getData() == areaReference(small, 3, 2));
+        const Image large = noise(200, 130, PixelFormat::RGB24, 5);
+        assert(composeOne(large, 2, 1, MosaicScaling::AREA).getData() == areaReference(large, 2, 1));
+
+        // Uneven footprints of 2 and 3 columns
+        const Image uneven = noise(37, 11, PixelFormat::RGB24, 7);
+        assert(composeOne(uneven, 15, 4, MosaicScaling::AREA).getData() == areaReference(uneven, 15, 4));
+        cout << "Area means test PASSED" << endl;
+    }
+
+    static void testEmptyCells() {
+        // 2 columns, 3 sources: a missing source, an unsupported format and an unused cell are black
+        const MosaicKernel kernel(2, 3, 2);
+        const Image white(3, 2, PixelFormat::RGB24, vector<uint8_t>(18, 255));
+        const Image packed(8, 2, PixelFormat::GRAYSCALE1, vector<uint8_t>{0xFF, 0xFF});
+        Image output(kernel.getOutputWidth(), kernel.getOutputHeight(3), PixelFormat::RGBA32,
+                     vector<uint8_t>(6 * 4 * 4, 77));
+        kernel.compose({&white, nullptr, &packed}, output);
+
+        for (int32_t y = 0; y < 4; ++y) {
+            for (int32_t x = 0; x < 6; ++x) {
+                const uint8_t* pixel = output.getData().data() + y * output.getStride() + x * 4;
+                const uint8_t level = (y < 2 && x < 3) ? 255 : 0;
+                assert(pixel[0] == level && pixel[1] == level && pixel[2] == level && pixel[3] == 255);
+            }
+        }
+
+        bool thrown = false;
+        try {
+            Image wrong(6, 2, PixelFormat::RGBA32);
+            kernel.compose({&white, nullptr, &packed}, wrong);
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Empty cells test PASSED" << endl;
+    }
+
+    static Image gray(uint8_t level) {
+        return Image(2, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>(4, level));
+    }
+
+    // Composites received by the output callback
+    static vector<Image>& collected() {
+        static vector<Image> images;
+        return images;
+    }
+
+    // Runs input 0 frames at levels 10 and 20 with 50 ms between them, then an input 1 frame
+    static vector<Image> runSync(MosaicSync sync) {
+        auto sidePackets = make_shared<map<string, Packet>>();
+        (*sidePackets)["mosaicSync"] = Packet(sync);
+        (*sidePackets)["mosaicSyncWindow"] = Packet(20000);
+        (*sidePackets)["mosaicColumns"] = Packet(2);
+        (*sidePackets)["mosaicCellWidth"] = Packet(2);
+        (*sidePackets)["mosaicCellHeight"] = Packet(2);
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new MosaicCalculator("MosaicCalculator", 2), sidePackets);
+        scheduler.connectCalculators();
+        scheduler.connectOutput("MosaicCalculator", "ImageMosaic");
+        vector<Image>& outputs = collected();
+        outputs.clear();
+        scheduler.registerOutputCallback([](const Packet& packet) {
+            collected().push_back(packet.get<Image>());
+        });
+
+        Packet early(gray(10));
+        this_thread::sleep_for(chrono::milliseconds(50));
+        Packet late(gray(20));
+        Packet other(gray(30));
+        scheduler.writeToInputPort("MosaicCalculator", MosaicCalculator::getInputTag(0), std::move(early));
+        scheduler.run();
+        scheduler.writeToInputPort("MosaicCalculator", MosaicCalculator::getInputTag(0), std::move(late));
+        scheduler.writeToInputPort("MosaicCalculator", MosaicCalculator::getInputTag(1), std::move(other));
+        scheduler.run();
+        return outputs;
+    }
+
+    static void testSync() {
+        // Latest: a composite per delivery, the newest frame of every input
+        const vector<Image> latest = runSync(MosaicSync::LATEST);
+        assert(latest.size() == 2);
+        assert(latest[0].getData()[0] == 10 && latest[0].getData()[8] == 0 && "input 1 is still black");
+        assert(latest[1].getData()[0] == 20 && latest[1].getData()[8] == 30);
+
+        // Aligned: the early frame is 50 ms before the input 1 frame and is dropped
+        const vector<Image> aligned = runSync(MosaicSync::ALIGNED);
+        assert(aligned.size() == 1);
+        assert(aligned[0].getData()[0] == 20 && aligned[0].getData()[8] == 30);
+        cout << "Sync test PASSED" << endl;
+    }
+};
+
+#endif // MOSAIC_TEST_H
@@ -0,0 +1,288 @@
+#ifndef PACKET_RECORDING_TEST_H
+#define PACKET_RECORDING_TEST_H
+
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include "../src/scheduler.h"
+#include "../src/packetrecording.h"
+#include "TestFrames.h"
+
+using namespace std;
+
+// A user payload type for the registry
+struct Detection {
+    int32_t label;
+    float score;
+};
+
+// Adds one to integer packets
+class IncrementCalculator : public CalculatorBase {
+public:
+    IncrementCalculator() : CalculatorBase("IncrementCalculator") {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        return make_unique<CalculatorContext>(newSidePacket);
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        Port& input = cc->getInputPort("kTagInput");
+        while (input.size() > 0) cc->getOutputPort("kTagOutput").write(Packet(input.read().get<int>() + 1));
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+class PacketRecordingTest {
+public:
+    static void run() {
+        cout << "Starting PacketRecording Tests...\n";
+
+        testSerializer();
+        testRecordReplay();
+        testUnclosed();
+        testTiming();
+        testScheduler();
+
+        cout << "All PacketRecording Tests Completed.\n";
+    }
+
+private:
+    static Packet roundTrip(const Packet& packet) {
+        vector<uint8_t> bytes;
+        PacketSerializer::serialize(packet, bytes);
+        return PacketSerializer::deserialize(PacketSerializer::getTypeName(packet), bytes.data(), bytes.size());
+    }
+
+    static void registerDetection() {
+        PacketSerializer::registerType<Detection>("Detection",
+            [](const Detection& value, vector<uint8_t>& out) {
+                PacketSerializer::serialize(Packet(value.label), out);
+                PacketSerializer::serialize(Packet(value.score), out);
+            },
+            [](const uint8_t* data, size_t size) {
+                PacketSerializer::expectSize(size, 8, "Detection");
+                return Detection{PacketSerializer::deserialize("int32", data, 4).get<int>(),
+                                 PacketSerializer::deserialize("float32", data + 4, 4).get<float>()};
+            });
+    }
+
+    static void testSerializer() {
+        assert(roundTrip(Packet(-42)).get<int>() == -42);
+        assert(roundTrip(Packet(1LL << 40)).get<long long>() == 1LL << 40);
+        assert(roundTrip(Packet(2.5f)).get<float>() == 2.5f);
+        assert(roundTrip(Packet(-0.125)).get<double>() == -0.125);
+        assert(roundTrip(Packet(true)).get<bool>());
+        assert(roundTrip(Packet(string("frame\0meta", 10))).get<string>() == string("frame\0meta", 10));
+        assert(roundTrip(Packet(vector<uint8_t>{1, 2, 3})).get<vector<uint8_t>>().size() == 3);
+
+        const Image image = makeTestFrame(7, 3, PixelFormat::RGB24, 1);
+        const Image copy = roundTrip(Packet(image)).get<Image>();
+        assert(copy.getWidth() == 7 && copy.getFormat() == PixelFormat::RGB24 && copy.getData() == image.getData());
+        Image compressed(64, 48, PixelFormat::JPEG, vector<uint8_t>{0xFF, 0xD8, 0xFF, 0xD9});
+        assert(roundTrip(Packet(compressed)).get<Image>().getData().size() == 4);
+
+        // User types
+        assert(!PacketSerializer::isRegistered(Packet(Detection{3, 0.75f})));
+        registerDetection();
+        const Detection detection = roundTrip(Packet(Detection{3, 0.75f})).get<Detection>();
+        assert(detection.label == 3 && detection.score == 0.75f);
+        assert(PacketSerializer::getTypeName(Packet(Detection{})) == "Detection");
+
+        bool thrown = false;
+        try {
+            PacketSerializer::registerType<short>("int32",
+                [](const short&, vector<uint8_t>&) {},
+                [](const uint8_t*, size_t) { return short(0); });
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown && "a name belongs to one type");
+
+        thrown = false;
+        try {
+            const uint8_t bytes[3] = {};
+            PacketSerializer::deserialize("int32", bytes, 3);
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        try {
+            const uint8_t header[12] = {2, 0, 0, 0, 2, 0, 0, 0, static_cast<uint8_t>(PixelFormat::RGB24), 0, 0, 0};
+            PacketSerializer::deserialize("Image", header, sizeof(header));
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown && "an image without its pixels");
+
+        thrown = false;
+        try {
+            vector<uint8_t> bytes;
+            PacketSerializer::serialize(Packet(static_cast<short>(1)), bytes);
+        } catch (const PacketException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Serializer test PASSED" << endl;
+    }
+
+    static void testRecordReplay() {
+        const string path = "packet_recording_test.rec";
+        {
+            PacketRecorder recorder(path);
+            assert(recorder.record(Packet(makeTestFrame(16, 8, PixelFormat::RGB24, 0)), 1000));
+            assert(recorder.record(Packet(5), 1500));
+            assert(recorder.record(Packet(Detection{9, 0.5f}), 1600));
+            assert(!recorder.record(Packet(static_cast<short>(1)), 1700) && "not registered");
+            assert(!recorder.record(Packet(), 1800));
+            assert(recorder.record(Packet(makeTestFrame(16, 8, PixelFormat::RGB24, 1)), 2000));
+            assert(recorder.getRecordedCount() == 4 && recorder.getSkippedCount() == 2);
+            recorder.close();
+
+            bool thrown = false;
+            try {
+                recorder.record(Packet(1), 3000);
+            } catch (const runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+
+        PacketReplay replay(path, ReplayMode::MAX_SPEED);
+        assert(replay.size() == 4 && replay.getDuration() == 1000);
+        assert(replay.getTypeName(0) == "Image" && replay.getTypeName(1) == "int32" && replay.getTypeName(2) == "Detection");
+        assert(replay.getTimestamp(2) == 1600);
+
+        Packet packet;
+        long long timestamp = 0;
+        assert(replay.next(packet, timestamp) && timestamp == 1000);
+        assert(packet.get<Image>().getData() == makeTestFrame(16, 8, PixelFormat::RGB24, 0).getData());
+        assert(replay.next(packet, timestamp) && packet.get<int>() == 5);
+        assert(replay.next(packet, timestamp) && packet.get<Detection>().label == 9);
+        assert(replay.next(packet, timestamp) && timestamp == 2000 && replay.isFinished());
+        assert(!replay.next(packet, timestamp));
+
+        // Random access
+        assert(replay.get(3).get<Image>().getData() == makeTestFrame(16, 8, PixelFormat::RGB24, 1).getData());
+        replay.seek(1);
+        assert(replay.next(packet, timestamp) && timestamp == 1500);
+
+        bool thrown = false;
+        try {
+            PacketReplay missing("missing_recording.rec");
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+        remove(path.c_str());
+        cout << "Record replay test PASSED" << endl;
+    }
+
+    static void testUnclosed() {
+        // Without an index the records are scanned, a truncated record is dropped
+        const string path = "packet_recording_unclosed.rec";
+        const Image frame = makeTestFrame(32, 32, PixelFormat::RGB24, 4);
+        {
+            PacketRecorder recorder(path);
+            for (int32_t i = 0; i < 5; ++i) assert(recorder.record(Packet(frame), 100 * i));
+            recorder.close();
+        }
+        vector<char> bytes;
+        {
+            ifstream in(path, ios::binary);
+            bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        const size_t record = PacketRecordingFormat::kRecordBytes + 12 + frame.getData().size();
+        const size_t firstPacket = PacketRecordingFormat::kHeaderBytes + PacketRecordingFormat::kRecordBytes + 5;
+        bytes.resize(firstPacket + 4 * record + 10);
+        fill(bytes.begin() + 8, bytes.begin() + 16, 0);
+        {
+            ofstream out(path, ios::binary | ios::trunc);
+            out.write(bytes.data(), bytes.size());
+        }
+
+        PacketReplay replay(path, ReplayMode::MAX_SPEED);
+        assert(replay.size() == 4 && replay.getTimestamp(3) == 300);
+        assert(replay.get(3).get<Image>().getData() == frame.getData());
+        remove(path.c_str());
+        cout << "Unclosed recording test PASSED" << endl;
+    }
+
+    static void testTiming() {
+        const string path = "packet_recording_timing.rec";
+        {
+            PacketRecorder recorder(path);
+            for (int32_t i = 0; i < 5; ++i) recorder.record(Packet(i), 1000000 + i * 10000);
+        }
+
+        // Original timing spaces the packets as recorded, 40 ms
+        PacketReplay replay(path);
+        Packet packet;
+        long long timestamp = 0;
+        auto start = chrono::steady_clock::now();
+        while (replay.next(packet, timestamp)) {}
+        long long elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        assert(elapsed >= 40 && elapsed < 1000);
+
+        replay.seek(0);
+        assert(replay.poll(packet, timestamp) && packet.get<int>() == 0);
+        assert(!replay.poll(packet, timestamp) && "the next packet is not due yet");
+
+        // Maximum speed does not wait
+        replay.setMode(ReplayMode::MAX_SPEED);
+        replay.seek(0);
+        start = chrono::steady_clock::now();
+        while (replay.next(packet, timestamp)) {}
+        elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        assert(elapsed < 20);
+        remove(path.c_str());
+        cout << "Timing test PASSED" << endl;
+    }
+
+    static void testScheduler() {
+        // Capture a graph output, then replay it into another graph
+        const string path = "packet_recording_scheduler.rec";
+        {
+            PacketRecorder recorder(path);
+            Scheduler scheduler;
+            scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+            scheduler.registerCalculator(new IncrementCalculator());
+            scheduler.connectCalculators();
+            scheduler.registerOutputCallback(PacketRecorder::writePacket, &recorder);
+            for (int i = 0; i < 10; ++i) {
+                scheduler.writeToInputPort(Packet(i * 10));
+                scheduler.run();
+            }
+            assert(recorder.getRecordedCount() == 10);
+        }
+
+        PacketReplay replay(path, ReplayMode::MAX_SPEED);
+        PacketRecorder recorder("packet_recording_replayed.rec");
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new IncrementCalculator());
+        scheduler.connectCalculators();
+        scheduler.registerInputCallback(PacketReplay::readPacket, &replay);
+        scheduler.registerOutputCallback(PacketRecorder::writePacket, &recorder);
+        for (int32_t tick = 0; tick < 100 && !replay.isFinished(); ++tick) scheduler.run();
+        scheduler.run();
+        recorder.close();
+
+        PacketReplay result("packet_recording_replayed.rec", ReplayMode::MAX_SPEED);
+        assert(result.size() == 10);
+        for (size_t i = 0; i < result.size(); ++i) {
+            assert(result.get(i).get<int>() == static_cast<int>(i) * 10 + 2);
+        }
+        remove(path.c_str());
+        remove("packet_recording_replayed.rec");
+        cout << "Scheduler test PASSED" << endl;
+    }
+};
+
+#endif // PACKET_RECORDING_TEST_H
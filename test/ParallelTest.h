@@ -0,0 +1,73 @@
+#ifndef PARALLEL_TEST_H
+#define PARALLEL_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <vector>
+#include "../src/parallel.h"
+
+using namespace std;
+
+class ParallelTest {
+public:
+    static void run() {
+        cout << "Starting Parallel Tests...\n";
+
+        testRowCoverage();
+        testNestedCall();
+        testBackToBack();
+
+        cout << "All Parallel Tests Completed.\n";
+    }
+
+private:
+    static void testRowCoverage() {
+        // Every row is visited exactly once, for several sizes and repeated calls
+        for (int32_t rows : {0, 1, 15, 16, 100, 1081}) {
+            for (int repeat = 0; repeat < 3; ++repeat) {
+                vector<atomic<int>> visits(rows);
+                Parallel::forRows(rows, [&](int32_t begin, int32_t end) {
+                    for (int32_t row = begin; row < end; ++row) {
+                        visits[row]++;
+                    }
+                });
+                for (int32_t row = 0; row < rows; ++row) {
+                    assert(visits[row] == 1 && "each row belongs to one band");
+                }
+            }
+        }
+        cout << "Row coverage test PASSED (" << Parallel::getThreadCount() << " threads)" << endl;
+    }
+
+    static void testNestedCall() {
+        atomic<int> innerRows{0};
+        Parallel::forRows(64, [&](int32_t begin, int32_t end) {
+            Parallel::forRows(32, [&](int32_t innerBegin, int32_t innerEnd) {
+                innerRows += innerEnd - innerBegin;
+            });
+        });
+        assert(innerRows == 32 * min(Parallel::getThreadCount(), 64 / Parallel::kMinRowsPerBand));
+        cout << "Nested call test PASSED" << endl;
+    }
+
+    static void testBackToBack() {
+        // Workers woken late for one call never claim bands of the next
+        const int32_t rows = Parallel::getThreadCount() * 4;
+        vector<atomic<int>> visits(rows);
+        const int calls = 2000;
+        for (int call = 0; call < calls; ++call) {
+            Parallel::forRows(rows, [&](int32_t begin, int32_t end) {
+                for (int32_t row = begin; row < end; ++row) {
+                    visits[row]++;
+                }
+            }, 1);
+        }
+        for (int32_t row = 0; row < rows; ++row) {
+            assert(visits[row] == calls && "each band runs once per call");
+        }
+        cout << "Back to back test PASSED" << endl;
+    }
+};
+
+#endif // PARALLEL_TEST_H
@@ -0,0 +1,121 @@
+#ifndef PIXEL_SHAPE_TEST_H
+#define PIXEL_SHAPE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../examples/calculators/pixelcalculator.h"
+
+using namespace std;
+
+class PixelShapeTest {
+public:
+    static void run() {
+        cout << "Starting PixelShape Tests...\n";
+
+        testBlockMeans();
+        testIntegralAttachment();
+
+        cout << "All PixelShape Tests Completed.\n";
+    }
+
+private:
+    static Image noise(int32_t width, int32_t height, PixelFormat format, uint32_t seed) {
+        Image image(width, height, format);
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+        image.setData(image.getData());
+        return image;
+    }
+
+    // Rounded mean of every channel over each block, read pixel by pixel
+    static vector<uint8_t> blockMeans(const Image& image, int32_t block, int32_t channels) {
+        const int32_t width = image.getWidth(), height = image.getHeight();
+        const size_t stride = image.getStride();
+        vector<uint8_t> expected(image.getData().size());
+        for (int32_t y0 = 0; y0 < height; y0 += block) {
+            for (int32_t x0 = 0; x0 < width; x0 += block) {
+                const int32_t x1 = min(x0 + block, width), y1 = min(y0 + block, height);
+                const uint32_t area = (x1 - x0) * (y1 - y0);
+                for (int32_t channel = 0; channel < channels; ++channel) {
+                    uint32_t sum = 0;
+                    for (int32_t y = y0; y < y1; ++y) {
+                        for (int32_t x = x0; x < x1; ++x) sum += image.getData()[y * stride + x * channels + channel];
+                    }
+                    const uint8_t mean = static_cast<uint8_t>((sum + area / 2) / area);
+                    for (int32_t y = y0; y < y1; ++y) {
+                        for (int32_t x = x0; x < x1; ++x) expected[y * stride + x * channels + channel] = mean;
+                    }
+                }
+            }
+        }
+        return expected;
+    }
+
+    static void testBlockMeans() {
+        // 11x7 in blocks of 4 leaves a 3 wide column and a 3 tall row of partial blocks
+        const struct { PixelFormat format; int32_t channels; } formats[] = {
+            {PixelFormat::GRAYSCALE8, 1}, {PixelFormat::RGB24, 3}, {PixelFormat::RGBA32, 4}};
+        for (const auto& entry : formats) {
+            const Image source = noise(11, 7, entry.format, 3);
+            Image image = source;
+            PixelShapeKernel(4, 0).process(image);
+            assert(image.getData() == blockMeans(source, 4, entry.channels));
+        }
+
+        // The 1x1 corner block keeps its pixel
+        const Image source = noise(9, 9, PixelFormat::RGB24, 5);
+        Image image = source;
+        PixelShapeKernel(4, 0).process(image);
+        const size_t corner = 8 * source.getStride() + 8 * 3;
+        for (size_t i = corner; i < corner + 3; ++i) assert(image.getData()[i] == source.getData()[i]);
+
+        // A block larger than the image averages the whole image
+        Image whole = noise(5, 3, PixelFormat::GRAYSCALE8, 11);
+        const vector<uint8_t> expected = blockMeans(whole, 16, 1);
+        PixelShapeKernel(16, 0).process(whole);
+        assert(whole.getData() == expected);
+        cout << "Block means test PASSED" << endl;
+    }
+
+    static Image pixelate(const Image& frame, bool attachIntegral) {
+        auto sidePackets = make_shared<map<string, Packet>>();
+        (*sidePackets)["pixelSize"] = Packet(5);
+        (*sidePackets)["pixeShape"] = Packet(0);
+        PixelShapeCalculator calculator;
+        unique_ptr<CalculatorContext> cc = calculator.registerContext(sidePackets);
+        Port input;
+        cc->bindInputPort(cc->kTagInput, input);
+
+        Packet packet(frame);
+        if (attachIntegral) packet.attach("integralImage", IntegralImage(frame));
+        input.write(std::move(packet));
+        calculator.process(cc.get(), 0);
+        return cc->getOutputPort("ImagePixel").read().get<Image>();
+    }
+
+    static void testIntegralAttachment() {
+        const Image frame = noise(23, 17, PixelFormat::RGBA32, 17);
+        const Image built = pixelate(frame, false);
+        const Image attached = pixelate(frame, true);
+        assert(attached.getData() == built.getData());
+        assert(built.getData() == blockMeans(frame, 5, 4));
+
+        // A matching table is read as is, the kernel does not rebuild it
+        const Image lookalike = noise(23, 17, PixelFormat::RGBA32, 23);
+        const IntegralImage lookalikeIntegral(lookalike);
+        Image fromTable = frame;
+        PixelShapeKernel(5, 0).process(fromTable, &lookalikeIntegral);
+        assert(fromTable.getData() == blockMeans(lookalike, 5, 4));
+
+        // A table of another size is not used
+        Image kernelOutput = frame;
+        const IntegralImage other(noise(23, 16, PixelFormat::RGBA32, 19));
+        PixelShapeKernel(5, 0).process(kernelOutput, &other);
+        assert(kernelOutput.getData() == built.getData());
+        cout << "Integral attachment test PASSED" << endl;
+    }
+};
+
+#endif // PIXEL_SHAPE_TEST_H
@@ -0,0 +1,378 @@
+#ifndef PNG_TEST_H
+#define PNG_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "../src/imageutils.h"
+
+using namespace std;
+
+class PngTest {
+public:
+    static void run() {
+        cout << "Starting PNG Tests...\n";
+
+        testChecksums();
+        testCodeLengths();
+        testFilters();
+        testStoredFile();
+        testInflate();
+        testFiles();
+
+        cout << "All PNG Tests Completed.\n";
+    }
+
+private:
+    static uint32_t readBigEndian(const uint8_t* in) {
+        return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 |
+               static_cast<uint32_t>(in[2]) << 8 | in[3];
+    }
+
+    // Inverse of the PNG filters, for one row
+    static void unfilterRow(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t rowBytes, int32_t bytesPerPixel) {
+        for (size_t i = 0; i < rowBytes; ++i) {
+            const int32_t a = i >= static_cast<size_t>(bytesPerPixel) ? row[i - bytesPerPixel] : 0;
+            const int32_t b = prior[i];
+            const int32_t c = i >= static_cast<size_t>(bytesPerPixel) ? prior[i - bytesPerPixel] : 0;
+            const int32_t p = a + b - c;
+            const int32_t paeth = abs(p - a) <= abs(p - b) && abs(p - a) <= abs(p - c) ? a : abs(p - b) <= abs(p - c) ? b : c;
+            const int32_t predictions[5] = {0, a, b, (a + b) / 2, paeth};
+            row[i] = static_cast<uint8_t>(row[i] + predictions[filter]);
+        }
+    }
+
+    // Reference inflater, RFC 1951, one bit at a time
+    struct Inflater {
+        const uint8_t* data;
+        size_t size;
+        size_t bitPosition = 0;
+        int32_t blockTypes[3] = {0, 0, 0};
+
+        // Canonical Huffman code, count of codes per length and symbols in code order
+        struct Code {
+            int32_t counts[16] = {};
+            vector<int32_t> symbols;
+        };
+
+        uint32_t bits(int32_t count) {
+            uint32_t value = 0;
+            for (int32_t i = 0; i < count; ++i, ++bitPosition) {
+                assert(bitPosition / 8 < size);
+                value |= ((data[bitPosition / 8] >> (bitPosition % 8)) & 1u) << i;
+            }
+            return value;
+        }
+
+        static Code build(const uint8_t* lengths, int32_t count) {
+            Code code;
+            for (int32_t symbol = 0; symbol < count; ++symbol) code.counts[lengths[symbol]]++;
+            code.counts[0] = 0;
+            int32_t offsets[16] = {};
+            for (int32_t length = 1; length < 16; ++length) offsets[length] = offsets[length - 1] + code.counts[length - 1];
+            code.symbols.resize(count);
+            for (int32_t symbol = 0; symbol < count; ++symbol) {
+                if (lengths[symbol]) code.symbols[offsets[lengths[symbol]]++] = symbol;
+            }
+            return code;
+        }
+
+        int32_t decode(const Code& code) {
+            int32_t value = 0, first = 0, index = 0;
+            for (int32_t length = 1; length < 16; ++length) {
+                value |= static_cast<int32_t>(bits(1));
+                const int32_t count = code.counts[length];
+                if (value - first < count) return code.symbols[index + value - first];
+                index += count;
+                first = (first + count) << 1;
+                value <<= 1;
+            }
+            assert(false && "invalid code");
+            return -1;
+        }
+
+        void codes(vector<uint8_t>& out, const Code& literals, const Code& distances) {
+            static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                      8193, 12289, 16385, 24577};
+            static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                      7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+            while (true) {
+                const int32_t symbol = decode(literals);
+                if (symbol < 256) {
+                    out.push_back(static_cast<uint8_t>(symbol));
+                } else if (symbol == 256) {
+                    return;
+                } else {
+                    assert(symbol < 286);
+                    const size_t length = lengthBase[symbol - 257] + bits(lengthExtra[symbol - 257]);
+                    const int32_t distanceSymbol = decode(distances);
+                    assert(distanceSymbol < 30);
+                    const size_t distance = distanceBase[distanceSymbol] + bits(distanceExtra[distanceSymbol]);
+                    assert(distance <= out.size());
+                    for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+                }
+            }
+        }
+
+        vector<uint8_t> inflate() {
+            vector<uint8_t> out;
+            bool final = false;
+            while (!final) {
+                final = bits(1);
+                const uint32_t type = bits(2);
+                assert(type < 3);
+                blockTypes[type]++;
+                if (type == 0) {
+                    bitPosition = (bitPosition + 7) / 8 * 8;
+                    const size_t length = bits(16);
+                    assert((length ^ bits(16)) == 0xFFFF);
+                    for (size_t i = 0; i < length; ++i) out.push_back(static_cast<uint8_t>(bits(8)));
+                } else if (type == 1) {
+                    uint8_t lengths[288 + 30];
+                    for (int32_t symbol = 0; symbol < 288; ++symbol) {
+                        lengths[symbol] = symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+                    }
+                    fill(lengths + 288, lengths + 318, 5);
+                    codes(out, build(lengths, 288), build(lengths + 288, 30));
+                } else {
+                    const int32_t literalCount = bits(5) + 257;
+                    const int32_t distanceCount = bits(5) + 1;
+                    const int32_t lengthCount = bits(4) + 4;
+                    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+                    uint8_t codeLengths[19] = {};
+                    for (int32_t i = 0; i < lengthCount; ++i) codeLengths[order[i]] = static_cast<uint8_t>(bits(3));
+                    const Code lengthCode = build(codeLengths, 19);
+
+                    vector<uint8_t> lengths;
+                    while (static_cast<int32_t>(lengths.size()) < literalCount + distanceCount) {
+                        const int32_t symbol = decode(lengthCode);
+                        if (symbol < 16) {
+                            lengths.push_back(static_cast<uint8_t>(symbol));
+                        } else if (symbol == 16) {
+                            assert(!lengths.empty());
+                            lengths.insert(lengths.end(), 3 + bits(2), lengths.back());
+                        } else {
+                            lengths.insert(lengths.end(), symbol == 17 ? 3 + bits(3) : 11 + bits(7), 0);
+                        }
+                    }
+                    assert(static_cast<int32_t>(lengths.size()) == literalCount + distanceCount);
+                    assert(lengths[256] > 0 && "end of block code");
+                    codes(out, build(lengths.data(), literalCount), build(lengths.data() + literalCount, distanceCount));
+                }
+            }
+            bitPosition = (bitPosition + 7) / 8 * 8;
+            return out;
+        }
+    };
+
+    static void testChecksums() {
+        const uint8_t* digits = reinterpret_cast<const uint8_t*>("123456789");
+        assert(PngEncoder::crc32(digits, 9) == 0xCBF43926);
+        assert(PngEncoder::crc32(digits + 4, 5, PngEncoder::crc32(digits, 4)) == 0xCBF43926);
+        assert(Deflate::adler32(reinterpret_cast<const uint8_t*>("Wikipedia"), 9) == 0x11E60398);
+
+        vector<uint8_t> data(100000);
+        srand(5);
+        for (uint8_t& value : data) value = static_cast<uint8_t>(rand());
+        const uint32_t whole = Deflate::adler32(data.data(), data.size());
+        const uint32_t first = Deflate::adler32(data.data(), 12345);
+        const uint32_t second = Deflate::adler32(data.data() + 12345, data.size() - 12345);
+        assert(Deflate::combineAdler32(first, second, data.size() - 12345) == whole);
+        assert(Deflate::adler32(data.data() + 12345, data.size() - 12345, first) == whole);
+        cout << "Checksums test PASSED" << endl;
+    }
+
+    static void testCodeLengths() {
+        // Fibonacci frequencies give the deepest possible tree
+        uint32_t freq[30];
+        freq[0] = freq[1] = 1;
+        for (int32_t i = 2; i < 30; ++i) freq[i] = freq[i - 1] + freq[i - 2];
+        uint8_t lengths[30];
+        Deflate::buildLengths(freq, 30, 7, lengths);
+        uint64_t kraft = 0;
+        for (int32_t i = 0; i < 30; ++i) {
+            assert(lengths[i] >= 1 && lengths[i] <= 7);
+            kraft += 1ULL << (7 - lengths[i]);
+        }
+        assert(kraft == 128 && "complete prefix code");
+        assert(lengths[29] <= lengths[0]);
+
+        // A single symbol still gets a complete code
+        uint32_t single[4] = {0, 0, 9, 0};
+        Deflate::buildLengths(single, 4, 15, lengths);
+        assert(lengths[2] == 1 && lengths[0] == 1 && lengths[1] == 0 && lengths[3] == 0);
+        cout << "Code lengths test PASSED" << endl;
+    }
+
+    static void testFilters() {
+        // Rows long enough for the SSE2 loop and its scalar tail
+        const size_t rowBytes = 3 * 37;
+        vector<uint8_t> prior(rowBytes), row(rowBytes), scratch(rowBytes * 4), out(rowBytes + 1);
+        srand(9);
+        bool used[5] = {false, false, false, false, false};
+        for (int32_t trial = 0; trial < 200; ++trial) {
+            for (size_t i = 0; i < rowBytes; ++i) {
+                prior[i] = static_cast<uint8_t>(rand());
+                // Mix of noise, gradients and copies of the row above
+                switch (trial % 4) {
+                    case 0: row[i] = static_cast<uint8_t>(rand()); break;
+                    case 1: row[i] = static_cast<uint8_t>(i * 3 + trial); break;
+                    case 2: row[i] = static_cast<uint8_t>(prior[i] + 1); break;
+                    default: row[i] = static_cast<uint8_t>((prior[i] + (i ? row[i - 1] : 0)) / 2); break;
+                }
+            }
+            PngFilter filter = PngEncoder::filterRow(row.data(), prior.data(), rowBytes, 3, scratch.data(), out.data());
+            used[static_cast<int32_t>(filter)] = true;
+            assert(out[0] == static_cast<uint8_t>(filter));
+            for (int32_t f = 0; f < 5; ++f) {
+                // Every candidate must invert, not only the chosen one
+                vector<uint8_t> candidate(rowBytes);
+                const uint8_t* sources[5] = {row.data(), scratch.data(), scratch.data() + rowBytes,
+                                             scratch.data() + 2 * rowBytes, scratch.data() + 3 * rowBytes};
+                memcpy(candidate.data(), sources[f], rowBytes);
+                unfilterRow(static_cast<uint8_t>(f), candidate.data(), prior.data(), rowBytes, 3);
+                assert(candidate == row);
+            }
+        }
+        assert(used[1] && used[2]);
+        cout << "Filters test PASSED" << endl;
+    }
+
+    static void testStoredFile() {
+        // Noise does not compress, the image data is written as stored blocks
+        Image image(300, 250, PixelFormat::RGB24);
+        srand(11);
+        for (uint8_t& value : image.getData()) value = static_cast<uint8_t>(rand());
+        vector<uint8_t> file = PngEncoder::encode(image);
+        const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        assert(memcmp(file.data(), signature, 8) == 0);
+
+        vector<uint8_t> zlib;
+        size_t p = 8;
+        int32_t idatCount = 0;
+        bool ended = false;
+        while (p < file.size()) {
+            const uint32_t length = readBigEndian(file.data() + p);
+            const string type(reinterpret_cast<const char*>(file.data() + p + 4), 4);
+            assert(readBigEndian(file.data() + p + 8 + length) == PngEncoder::crc32(file.data() + p + 4, length + 4));
+            if (type == "IHDR") {
+                assert(readBigEndian(file.data() + p + 8) == 300 && readBigEndian(file.data() + p + 12) == 250);
+                assert(file[p + 16] == 8 && file[p + 17] == 2);
+            } else if (type == "IDAT") {
+                zlib.insert(zlib.end(), file.begin() + p + 8, file.begin() + p + 8 + length);
+                ++idatCount;
+            } else if (type == "IEND") {
+                ended = true;
+            }
+            p += 12 + length;
+        }
+        assert(ended && idatCount == 1 && p == file.size());
+        assert((zlib[0] * 256 + zlib[1]) % 31 == 0 && (zlib[0] & 0x0F) == 8);
+
+        // Stored blocks: 3 header bits, byte aligned LEN and NLEN, then the bytes
+        vector<uint8_t> filtered;
+        size_t q = 2;
+        bool final = false;
+        while (!final) {
+            final = zlib[q] & 1;
+            assert(((zlib[q] >> 1) & 3) == 0);
+            const size_t length = zlib[q + 1] | zlib[q + 2] << 8;
+            assert((length ^ (zlib[q + 3] | zlib[q + 4] << 8)) == 0xFFFF);
+            filtered.insert(filtered.end(), zlib.begin() + q + 5, zlib.begin() + q + 5 + length);
+            q += 5 + length;
+        }
+        assert(q + 4 == zlib.size());
+        assert(readBigEndian(zlib.data() + q) == Deflate::adler32(filtered.data(), filtered.size()));
+
+        const size_t rowBytes = 900;
+        vector<uint8_t> prior(rowBytes, 0);
+        for (int32_t y = 0; y < 250; ++y) {
+            uint8_t* row = filtered.data() + y * (rowBytes + 1);
+            unfilterRow(row[0], row + 1, prior.data(), rowBytes, 3);
+            assert(memcmp(row + 1, image.getData().data() + y * rowBytes, rowBytes) == 0);
+            memcpy(prior.data(), row + 1, rowBytes);
+        }
+        cout << "Stored file test PASSED" << endl;
+    }
+
+    static void testInflate() {
+        // Noise over gradients compresses a little: dynamic blocks, several chunks of rows
+        Image image(700, 400, PixelFormat::RGB24);
+        srand(13);
+        for (int32_t y = 0; y < 400; ++y) {
+            for (int32_t x = 0; x < 700 * 3; ++x) {
+                const int32_t flat = (y / 50) % 2 && x < 600;
+                image.getData()[y * 2100 + x] = static_cast<uint8_t>(flat ? 90 : x / 9 + y / 3 + rand() % 16);
+            }
+        }
+
+        for (DeflateMode mode : {DeflateMode::HUFFMAN_ONLY, DeflateMode::RLE}) {
+            const vector<uint8_t> file = PngEncoder::encode(image, mode);
+            vector<uint8_t> zlib;
+            int32_t idatCount = 0;
+            for (size_t p = 8; p < file.size();) {
+                const uint32_t length = readBigEndian(file.data() + p);
+                assert(readBigEndian(file.data() + p + 8 + length) == PngEncoder::crc32(file.data() + p + 4, length + 4));
+                if (memcmp(file.data() + p + 4, "IDAT", 4) == 0) {
+                    zlib.insert(zlib.end(), file.begin() + p + 8, file.begin() + p + 8 + length);
+                    ++idatCount;
+                }
+                p += 12 + length;
+            }
+            const size_t rowBytes = 2100;
+            assert(idatCount == static_cast<int32_t>((400 + 123) / 124) && "256 KiB of filtered rows per chunk");
+            assert(zlib.size() < 400 * (rowBytes + 1));
+
+            Inflater inflater{zlib.data() + 2, zlib.size() - 6};
+            vector<uint8_t> filtered = inflater.inflate();
+            assert(inflater.blockTypes[2] == idatCount && "one dynamic block per chunk");
+            assert(inflater.bitPosition / 8 == zlib.size() - 6);
+            assert(filtered.size() == 400 * (rowBytes + 1));
+            assert(readBigEndian(zlib.data() + zlib.size() - 4) == Deflate::adler32(filtered.data(), filtered.size()));
+
+            vector<uint8_t> prior(rowBytes, 0);
+            for (int32_t y = 0; y < 400; ++y) {
+                uint8_t* row = filtered.data() + y * (rowBytes + 1);
+                assert(row[0] < 5);
+                unfilterRow(row[0], row + 1, prior.data(), rowBytes, 3);
+                assert(memcmp(row + 1, image.getData().data() + y * rowBytes, rowBytes) == 0);
+                memcpy(prior.data(), row + 1, rowBytes);
+            }
+        }
+        cout << "Inflate test PASSED" << endl;
+    }
+
+    static void testFiles() {
+        // Flat content compresses, in several chunks, the same through a path or a descriptor
+        Image image(1000, 600, PixelFormat::RGBA32);
+        for (size_t i = 0; i < image.getData().size(); ++i) {
+            image.getData()[i] = static_cast<uint8_t>((i / 4000) / 50 * 40 + i % 4);
+        }
+        const string path = "png_test.png";
+        ImageUtils::writePNG(path, image);
+        ifstream file(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        assert(bytes == PngEncoder::encode(image));
+        assert(bytes.size() < image.getData().size() / 100);
+        assert(PngEncoder::encodeChunks(image).size() == 2 + (600 + 64) / 65);
+        remove(path.c_str());
+
+        bool thrown = false;
+        try {
+            PngEncoder::encode(Image(4, 4, PixelFormat::JPEG));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Files test PASSED" << endl;
+    }
+};
+
+#endif // PNG_TEST_H
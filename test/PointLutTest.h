@@ -0,0 +1,57 @@
+#ifndef POINT_LUT_TEST_H
+#define POINT_LUT_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../src/pointlut.h"
+
+using namespace std;
+
+class PointLutTest {
+public:
+    static void run() {
+        cout << "Starting PointLut Tests...\n";
+
+        testCompose();
+        testApply();
+
+        cout << "All PointLut Tests Completed.\n";
+    }
+
+private:
+    static void testCompose() {
+        PointLut invert;
+        invert.setColor([](uint8_t value) { return 255 - value; });
+        PointLut half;
+        half.setColor([](uint8_t value) { return value / 2; });
+
+        assert(PointLut().isIdentity());
+        assert(invert.then(invert).isIdentity() && "inverting twice is the identity");
+
+        PointLut composed = invert.then(half);
+        for (int value = 0; value < 256; ++value) {
+            assert(composed.getTable(LutChannel::RED)[value] == (255 - value) / 2);
+            assert(composed.getTable(LutChannel::ALPHA)[value] == value);
+        }
+        cout << "Compose test PASSED" << endl;
+    }
+
+    static void testApply() {
+        PointLut lut;
+        lut.getTable(LutChannel::RED)[10] = 1;
+        lut.getTable(LutChannel::GREEN)[10] = 2;
+        lut.getTable(LutChannel::BLUE)[10] = 3;
+        lut.getTable(LutChannel::GRAY)[10] = 4;
+
+        Image color(2, 2, PixelFormat::RGB24, vector<uint8_t>(2 * 2 * 3, 10));
+        lut.apply(color);
+        assert(color.getData()[0] == 1 && color.getData()[1] == 2 && color.getData()[2] == 3);
+
+        Image gray(2, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>(2 * 2, 10));
+        lut.apply(gray);
+        assert(gray.getData()[3] == 4 && "gray images use the gray table");
+        cout << "Apply test PASSED" << endl;
+    }
+};
+
+#endif // POINT_LUT_TEST_H
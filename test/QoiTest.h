@@ -0,0 +1,110 @@
+#ifndef QOI_TEST_H
+#define QOI_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include "../src/imageutils.h"
+
+using namespace std;
+
+class QoiTest {
+public:
+    static void run() {
+        cout << "Starting QOI Tests...\n";
+
+        testKnownStream();
+        testRoundTrip();
+        testFiles();
+        testInvalid();
+
+        cout << "All QOI Tests Completed.\n";
+    }
+
+private:
+    static Image makeFrame(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        const int32_t bytesPerPixel = Image::bitsPerPixel(format) / 8;
+        srand(7);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                uint8_t* pixel = image.getData().data() + y * image.getStride() + x * bytesPerPixel;
+                for (int32_t channel = 0; channel < bytesPerPixel; ++channel) {
+                    // Flat blocks, gradients and noise exercise every chunk type
+                    if (channel == 3 && (x / 64 + y / 64) % 3 != 2) pixel[channel] = 255;
+                    else if ((x / 64 + y / 64) % 3 == 0) pixel[channel] = static_cast<uint8_t>(40 * channel);
+                    else if ((x / 64 + y / 64) % 3 == 1) pixel[channel] = static_cast<uint8_t>(x + y * channel);
+                    else pixel[channel] = static_cast<uint8_t>(rand());
+                }
+            }
+        }
+        return image;
+    }
+
+    static void testKnownStream() {
+        // Opaque black repeats the initial pixel, then a small difference
+        Image image(2, 1, PixelFormat::RGB24, vector<uint8_t>{0, 0, 0, 1, 1, 1});
+        const vector<uint8_t> expected = {'q', 'o', 'i', 'f', 0, 0, 0, 2, 0, 0, 0, 1, 3, 0,
+                                          0xC0, 0x7F, 0, 0, 0, 0, 0, 0, 0, 1};
+        assert(QoiCodec::encode(image) == expected);
+        cout << "Known stream test PASSED" << endl;
+    }
+
+    static void testRoundTrip() {
+        // Large enough for several bands
+        for (PixelFormat format : {PixelFormat::RGB24, PixelFormat::RGBA32}) {
+            Image frame = makeFrame(701, 800, format);
+            assert(QoiCodec::encodeBands(frame).size() == 3);
+            vector<uint8_t> file = QoiCodec::encode(frame);
+            Image decoded = QoiCodec::decode(file.data(), file.size());
+            assert(decoded.getFormat() == format);
+            assert(decoded.getData() == frame.getData());
+            assert(file.size() < frame.getData().size() * 3 / 4);
+        }
+
+        // Gray is stored as RGB
+        Image gray = makeFrame(50, 30, PixelFormat::GRAYSCALE8);
+        vector<uint8_t> file = QoiCodec::encode(gray);
+        Image decoded = QoiCodec::decode(file.data(), file.size());
+        assert(decoded.getFormat() == PixelFormat::RGB24);
+        assert(decoded.getData()[3 * 17] == gray.getData()[17] && decoded.getData()[3 * 17 + 2] == gray.getData()[17]);
+        cout << "Round trip test PASSED" << endl;
+    }
+
+    static void testFiles() {
+        const string path = "qoi_test.qoi";
+        Image frame = makeFrame(300, 200, PixelFormat::RGBA32);
+        ImageUtils::writeQOI(path, frame);
+
+        ifstream file(path, ios::binary);
+        vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        assert(bytes == QoiCodec::encode(frame));
+        assert(ImageUtils::readQOI(path).getData() == frame.getData());
+        remove(path.c_str());
+        cout << "Files test PASSED" << endl;
+    }
+
+    static void testInvalid() {
+        vector<uint8_t> file = QoiCodec::encode(makeFrame(40, 40, PixelFormat::RGB24));
+        file.resize(file.size() / 2);
+        bool thrown = false;
+        try {
+            QoiCodec::decode(file.data(), file.size());
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && "truncated data");
+
+        thrown = false;
+        try {
+            QoiCodec::encode(Image(4, 4, PixelFormat::GRAYSCALE1));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Invalid test PASSED" << endl;
+    }
+};
+
+#endif // QOI_TEST_H
@@ -0,0 +1,138 @@
+#ifndef SCENE_CHANGE_TEST_H
+#define SCENE_CHANGE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include "../src/scenechange.h"
+
+using namespace std;
+
+class SceneChangeTest {
+public:
+    static void run() {
+        cout << "Starting SceneChange Tests...\n";
+
+        testChanges();
+        testDrift();
+        testFormats();
+        testIntegralGrid();
+
+        cout << "All SceneChange Tests Completed.\n";
+    }
+
+private:
+    static Image makeScene(int32_t width, int32_t height, PixelFormat format, int seed) {
+        Image image(width, height, format);
+        const int32_t bytesPerPixel = Image::bitsPerPixel(format) / 8;
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                // Smooth gradients, a different layout per seed
+                const uint8_t value = static_cast<uint8_t>((x * (seed + 1) + y * (3 - seed)) & 0xFF);
+                uint8_t* pixel = image.getData().data() + y * image.getStride() + x * bytesPerPixel;
+                for (int32_t channel = 0; channel < bytesPerPixel; ++channel) pixel[channel] = value;
+            }
+        }
+        return image;
+    }
+
+    static void testChanges() {
+        SceneChangeDetector detector(16, 9, 10);
+        Image scene = makeScene(320, 180, PixelFormat::RGBA32, 0);
+        assert(detector.update(scene) && detector.getScore() == 255 && "first frame is a change");
+        assert(!detector.update(scene) && detector.getScore() == 0);
+
+        // Sensor noise stays below the threshold
+        Image noisy = scene;
+        srand(3);
+        for (uint8_t& value : noisy.getData()) {
+            value = static_cast<uint8_t>(std::clamp(value + rand() % 7 - 3, 0, 255));
+        }
+        assert(!detector.update(noisy) && detector.getScore() < 3);
+
+        // A cut to another scene is a change
+        assert(detector.update(makeScene(320, 180, PixelFormat::RGBA32, 2)));
+        assert(detector.getScore() >= 10);
+
+        // So is a new frame size
+        assert(detector.update(makeScene(160, 90, PixelFormat::RGBA32, 2)));
+        assert(detector.getThumbnail().getWidth() == 16 && detector.getThumbnail().getHeight() == 9);
+
+        bool thrown = false;
+        try {
+            detector.update(Image(8, 8, PixelFormat::GRAYSCALE1));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Changes test PASSED" << endl;
+    }
+
+    static void testDrift() {
+        // A fade of 2 levels per frame never reaches the threshold between
+        // neighbours, it adds up against the key frame instead
+        SceneChangeDetector detector(8, 4, 10);
+        assert(detector.update(Image(64, 36, PixelFormat::GRAYSCALE8, vector<uint8_t>(64 * 36, 100))));
+        vector<int32_t> flagged;
+        for (int32_t frame = 1; frame <= 12; ++frame) {
+            const uint8_t level = static_cast<uint8_t>(100 + 2 * frame);
+            if (detector.update(Image(64, 36, PixelFormat::GRAYSCALE8, vector<uint8_t>(64 * 36, level)))) {
+                assert(detector.getScore() == 10);
+                flagged.push_back(frame);
+            } else {
+                assert(detector.getScore() == 2 * (frame - (flagged.empty() ? 0 : flagged.back())));
+            }
+        }
+        assert((flagged == vector<int32_t>{5, 10}));
+
+        // A slow pan over a ramp moves each cell by under one level per frame
+        auto ramp = [](int32_t shift) {
+            Image image(320, 180, PixelFormat::GRAYSCALE8);
+            for (int32_t y = 0; y < 180; ++y) {
+                for (int32_t x = 0; x < 320; ++x) {
+                    image.getData()[y * image.getStride() + x] = static_cast<uint8_t>((x + shift) * 255 / 400);
+                }
+            }
+            return image;
+        };
+        SceneChangeDetector pan(16, 9, 10);
+        pan.update(ramp(0));
+        int32_t shift = 1;
+        while (shift <= 40 && !pan.update(ramp(shift))) {
+            assert(pan.getScore() < 10);
+            ++shift;
+        }
+        assert(shift > 10 && shift <= 40 && "the pan flags once it adds up");
+        cout << "Drift test PASSED" << endl;
+    }
+
+    static void testFormats() {
+        // The same gray content gives the same grid in every format
+        SceneChangeDetector gray, rgb, rgba;
+        gray.update(makeScene(333, 201, PixelFormat::GRAYSCALE8, 1));
+        rgb.update(makeScene(333, 201, PixelFormat::RGB24, 1));
+        rgba.update(makeScene(333, 201, PixelFormat::RGBA32, 1));
+        assert(gray.getThumbnail().getData() == rgb.getThumbnail().getData());
+        assert(gray.getThumbnail().getData() == rgba.getThumbnail().getData());
+        cout << "Formats test PASSED" << endl;
+    }
+
+    static void testIntegralGrid() {
+        Image scene = makeScene(64, 36, PixelFormat::RGB24, 1);
+        IntegralImage integral(scene);
+        SceneChangeDetector sampled(8, 4), exact(8, 4);
+        sampled.update(scene);
+        exact.update(scene, &integral);
+
+        // Cells are 8x9 pixels, sampled means read 8 of the 9 rows
+        const vector<uint8_t>& a = sampled.getThumbnail().getData();
+        const vector<uint8_t>& b = exact.getThumbnail().getData();
+        for (size_t i = 0; i < a.size(); ++i) {
+            assert(abs(a[i] - b[i]) <= 2);
+        }
+        assert(b[0] == static_cast<uint8_t>((integral.sum(0, 0, 8, 9) + 36) / 72));
+        cout << "Integral grid test PASSED" << endl;
+    }
+};
+
+#endif // SCENE_CHANGE_TEST_H
@@ -4,6 +4,8 @@
 #include <sstream>
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <ctime>
 #include "../src/scheduler.h"
 #include "../src/calculatorbase.h"
 #include "../src/calculatorcontext.h"
@@ -118,7 +120,123 @@ public:
 
     void close(CalculatorContext* cc, float delta) override {}
 };
-    
+
+class CountingCalculator : public CalculatorBase {
+public:
+    static int processCount;
+
+    CountingCalculator() : CalculatorBase("CountingCalculator") {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string,Packet>>& newSidePacket = make_shared<map<string,Packet>>()) override {
+        return make_unique<CalculatorContext>(newSidePacket);
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        processCount++;
+        Packet p = cc->getInputPort(kTagInput).read();
+        cc->getOutputPort(kTagOutput).write(std::move(p));
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+int CountingCalculator::processCount = 0;
+
+class OffsetPointCalculator : public CalculatorBase, public PointOperation {
+private:
+    string inputTag;
+    string outputTag;
+    int offset;
+
+public:
+    static int processCount;
+
+    OffsetPointCalculator(const string& calcName, const string& newInputTag,
+                          const string& newOutputTag, int newOffset)
+        : CalculatorBase(calcName), inputTag(newInputTag), outputTag(newOutputTag),
+          offset(newOffset) {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string,Packet>>& newSidePacket = make_shared<map<string,Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addInputPort(inputTag, Port());
+        context->addOutputPort(outputTag, Port());
+        return context;
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        processCount++;
+        Packet p = cc->getInputPort(inputTag).read();
+        Image image = std::move(p.get<Image>());
+        PointLut lut;
+        getPointLut(cc, lut);
+        lut.apply(image);
+        cc->getOutputPort(outputTag).write(Packet(std::move(image)));
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+
+    bool getPointLut(CalculatorContext* cc, PointLut& lut) override {
+        lut.setColor([this](uint8_t value) { return value + offset; });
+        return true;
+    }
+
+    string getPointInputTag() const override { return inputTag; }
+    string getPointOutputTag() const override { return outputTag; }
+};
+
+int OffsetPointCalculator::processCount = 0;
+
+class SideOutputCalculator : public CalculatorBase {
+public:
+    SideOutputCalculator() : CalculatorBase("SideOutputCalculator") {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string,Packet>>& newSidePacket = make_shared<map<string,Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addOutputPort("SideFrame", Port());
+        context->addSideOutputPort("SideCount", Port());
+        return context;
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        Packet p = cc->getInputPort(kTagInput).read();
+        int width = p.get<Image>().getWidth();
+        cc->getOutputPort("SideFrame").write(std::move(p));
+        cc->getSideOutputPort("SideCount").write(Packet(width * 10));
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+class SumCalculator : public CalculatorBase {
+public:
+    SumCalculator() : CalculatorBase("SumCalculator") {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string,Packet>>& newSidePacket = make_shared<map<string,Packet>>()) override {
+        auto context = make_unique<CalculatorContext>(newSidePacket);
+        context->addInputPort("SumA", Port());
+        context->addInputPort("SumB", Port());
+        context->addOutputPort("Sum", Port());
+        return context;
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        Port& a = cc->getInputPort("SumA");
+        Port& b = cc->getInputPort("SumB");
+        if (a.size() == 0 || b.size() == 0) return;
+        int sum = a.read().get<int>() + b.read().get<int>();
+        cc->getOutputPort("Sum").write(Packet(sum));
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+};
 
 class SchedulerTest {
 public:
@@ -130,6 +248,12 @@ public:
 
         testBasicScheduler();
         testMultipleCalculators();
+        testDepthFirstScheduler();
+        testReadinessScheduler();
+        testPointOperationFusion();
+        testSideOutputPorts();
+        testFanIn();
+        testGatedCalculator();
 
         cout << "All Scheduler Tests Completed.\n";
     }
@@ -201,10 +325,254 @@ private:
 
     }
 
+    static int outputCallbackCount;
 
-};
+    static void testDepthFirstScheduler(){
+        cout << "\n--- Test: Depth First Scheduler ---\n";
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new Calculator1());
+        scheduler.registerCalculator(new Calculator2());
+        scheduler.connectCalculators();
+
+        // Every tick must deliver the frame to the output port
+        for (int i = 0; i < kNumberOfPacketsToPush; i++) {
+            scheduler.writeToInputPort(Packet(i));
+            scheduler.run();
+            Packet outputPacket = scheduler.readFromOutputPort();
+            assert(outputPacket.isValid() && "frame should reach the output in one tick");
+            assert(outputPacket.get<int>() == i + 1);
+        }
+        cout << "Depth first latency of one tick PASSED" << endl;
+
+        // The output callback fires once per completed frame only
+        Scheduler callbackScheduler;
+        callbackScheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        callbackScheduler.registerCalculator(new Calculator1());
+        callbackScheduler.registerCalculator(new Calculator2());
+        callbackScheduler.connectCalculators();
+        callbackScheduler.registerOutputCallback([](const Packet& packet) {
+            assert(packet.isValid() && "callback should only receive frames");
+            outputCallbackCount++;
+        });
+
+        outputCallbackCount = 0;
+        const int kFrames = 10;
+        for (int i = 0; i < kFrames; i++) {
+            callbackScheduler.writeToInputPort(Packet(i));
+            callbackScheduler.run();
+        }
+        callbackScheduler.run();
+        assert(outputCallbackCount == kFrames && "one callback per frame");
+        cout << "Depth first output callback PASSED" << endl;
+    }
+
+    static void testReadinessScheduler(){
+        cout << "\n--- Test: Readiness Scheduler ---\n";
+
+        Scheduler scheduler;
+        scheduler.registerCalculator(new CountingCalculator());
+        scheduler.connectCalculators();
+
+        // An idle graph must not invoke calculators nor burn the CPU
+        CountingCalculator::processCount = 0;
+        clock_t cpuStart = clock();
+        const int kIdleRuns = 10;
+        for (int i = 0; i < kIdleRuns; i++) {
+            scheduler.run();
+        }
+        double cpuSeconds = double(clock() - cpuStart) / CLOCKS_PER_SEC;
+        assert(CountingCalculator::processCount == 0 && "idle calculator should not run");
+        assert(cpuSeconds < 0.05 && "idle scheduler should park");
+        cout << "Idle scheduler parks PASSED (cpu " << cpuSeconds << "s)" << endl;
+
+        // A packet written from another thread wakes the scheduler
+        thread producer([&scheduler] {
+            this_thread::sleep_for(chrono::milliseconds(2));
+            scheduler.writeToInputPort(Packet(7));
+        });
+        scheduler.run();
+        producer.join();
+        Packet outputPacket = scheduler.readFromOutputPort();
+        assert(outputPacket.isValid() && "woken scheduler should process the packet");
+        assert(outputPacket.get<int>() == 7);
+        assert(CountingCalculator::processCount == 1);
+        cout << "Scheduler wakes on input PASSED" << endl;
+    }
+
+    static void testPointOperationFusion(){
+        cout << "\n--- Test: Point Operation Fusion ---\n";
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new OffsetPointCalculator("Offset1", kTagInput, "O1", 1));
+        scheduler.registerCalculator(new OffsetPointCalculator("Offset2", "O1", "O2", 2));
+        scheduler.registerCalculator(new OffsetPointCalculator("Offset3", "O2", kTagOutput, 4));
+        scheduler.connectCalculators();
+        assert(scheduler.compilePointOperations() == 2 && "three point stages fuse into one");
+
+        OffsetPointCalculator::processCount = 0;
+        Image image(3, 2, PixelFormat::RGBA32, vector<uint8_t>(3 * 2 * 4, 10));
+        scheduler.writeToInputPort(Packet(std::move(image)));
+        scheduler.run();
+
+        Packet outputPacket = scheduler.readFromOutputPort();
+        assert(outputPacket.isValid() && "fused run should reach the output port");
+        const vector<uint8_t>& data = outputPacket.get<Image>().getData();
+        for (size_t i = 0; i < data.size(); i += 4) {
+            assert(data[i] == 17 && data[i + 1] == 17 && data[i + 2] == 17);
+            assert(data[i + 3] == 10 && "alpha is not a color channel");
+        }
+        assert(OffsetPointCalculator::processCount == 0 && "fused calculators are not invoked");
+        cout << "Point operation fusion PASSED" << endl;
+    }
+
+    static void testSideOutputPorts(){
+        cout << "\n--- Test: Side Output Ports ---\n";
 
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new SideOutputCalculator());
+        scheduler.registerCalculator(new OffsetPointCalculator("Next", "SideFrame", kTagOutput, 0));
+        scheduler.connectCalculators();
+
+        // Side outputs are not forwarded to the next calculator
+        CalculatorContext* nextContext = scheduler.getCCByCalculatorName("Next");
+        assert(nextContext->hasInput("SideFrame") && !nextContext->hasInput("SideCount"));
+
+        OffsetPointCalculator::processCount = 0;
+        scheduler.writeToInputPort(Packet(Image(4, 2, PixelFormat::RGBA32)));
+        scheduler.run();
+        assert(OffsetPointCalculator::processCount == 1);
+        assert(scheduler.readFromOutputPort().isValid());
+
+        Port& sideOutput = scheduler.getSideOutputPort("SideOutputCalculator", "SideCount");
+        assert(sideOutput.size() == 1 && sideOutput.read().get<int>() == 40);
+        cout << "Side output ports PASSED" << endl;
+    }
+
+    static void testFanIn(){
+        cout << "\n--- Test: Fan In ---\n";
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new OffsetPointCalculator("FeedA", "In", "Out", 1));
+        scheduler.registerCalculator(new OffsetPointCalculator("FeedB", "In", "Out", 2));
+        scheduler.registerCalculator(new SumCalculator());
+        scheduler.connect("FeedA", "Out", "SumCalculator", "SumA");
+        scheduler.connect("FeedB", "Out", "SumCalculator", "SumB");
+        scheduler.connectOutput("SumCalculator", "Sum");
+
+        // Adjacent point operations that do not feed each other are not fused
+        assert(scheduler.compilePointOperations() == 0);
+
+        bool thrown = false;
+        try {
+            scheduler.connect("FeedA", "Missing", "SumCalculator", "SumA");
+        } catch (const CalculatorException&) {
+            thrown = true;
+        }
+        assert(thrown && "connecting a missing output port must throw");
+
+        // One feed alone does not complete a sum
+        OffsetPointCalculator::processCount = 0;
+        scheduler.writeToInputPort("FeedA", "In", Packet(Image(2, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{10, 20})));
+        scheduler.run();
+        assert(OffsetPointCalculator::processCount == 1);
+        assert(!scheduler.readFromOutputPort().isValid());
+
+        CalculatorContext* sumContext = scheduler.getCCByCalculatorName("SumCalculator");
+        assert(&sumContext->getInputPort("SumA") == &scheduler.getCCByCalculatorName("FeedA")->getOutputPort("Out"));
+        assert(sumContext->getInputPort("SumA").size() == 1);
+        Packet fromA = sumContext->getInputPort("SumA").read();
+        assert(fromA.get<Image>().getData()[1] == 21);
+
+        sumContext->getInputPort("SumA").write(Packet(3));
+        scheduler.writeToInputPort("SumCalculator", "SumB", Packet(4));
+        scheduler.run();
+        Packet outputPacket = scheduler.readFromOutputPort();
+        assert(outputPacket.isValid() && outputPacket.get<int>() == 7);
+        cout << "Fan in PASSED" << endl;
+    }
+
+    static void testGatedCalculator(){
+        cout << "\n--- Test: Gated Calculator ---\n";
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new OffsetPointCalculator("Flagged", kTagInput, "Frame", 0));
+        scheduler.registerCalculator(new OffsetPointCalculator("Expensive", "Frame", kTagOutput, 5));
+        scheduler.connectCalculators();
+        scheduler.gateCalculator("Expensive", "Frame", kTagOutput);
+        assert(scheduler.compilePointOperations() == 0 && "gated calculators are not fused");
+
+        // Only packets flagged unchanged skip the calculator, its last result is re-emitted
+        OffsetPointCalculator::processCount = 0;
+        const uint8_t* kept = nullptr;
+        for (int frame = 0; frame < 4; ++frame) {
+            Packet packet(Image(1, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{static_cast<uint8_t>(10 + frame)}));
+            if (frame > 0) packet.attach("sceneChanged", frame == 2);
+            scheduler.getCCByCalculatorName("Expensive")->getInputPort("Frame").write(std::move(packet));
+
+            const Packet& front = scheduler.getCCByCalculatorName("Expensive")->getInputPort("Frame").peek();
+            assert(front.hasAttachment("sceneChanged") == (frame > 0));
+
+            scheduler.run();
+            Packet outputPacket = scheduler.readFromOutputPort();
+            assert(outputPacket.isValid());
+            const bool skipped = frame == 1 || frame == 3;
+            const Packet& readOnly = outputPacket;
+            const Image& result = readOnly.get<Image>();
+            assert(result.getData()[0] == (skipped ? 10 + frame + 4 : 10 + frame + 5));
+            assert(OffsetPointCalculator::processCount == (frame < 2 ? 1 : 2));
+            if (skipped) {
+                assert(!outputPacket.getAttachment<bool>("sceneChanged"));
+                assert(result.getData().data() == kept && "the re-emitted result is shared, not copied");
+            }
+            kept = result.getData().data();
+
+            // Writing to the frame copies it, the result kept by the gate is untouched
+            outputPacket.get<Image>().getData()[0] = 0;
+            assert(readOnly.get<Image>().getData().data() != kept);
+        }
+        assert(OffsetPointCalculator::processCount == 2);
+        assert(scheduler.getGatedSkipCount() == 2);
+
+        // Without a previous result a flagged packet still runs the calculator
+        Scheduler fresh;
+        fresh.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        fresh.registerCalculator(new OffsetPointCalculator("Expensive", kTagInput, kTagOutput, 5));
+        fresh.connectCalculators();
+        fresh.gateCalculator("Expensive", kTagInput, kTagOutput);
+        OffsetPointCalculator::processCount = 0;
+        Packet unchanged(Image(1, 1, PixelFormat::GRAYSCALE8, vector<uint8_t>{20}));
+        unchanged.attach("sceneChanged", false);
+        fresh.writeToInputPort(std::move(unchanged));
+        fresh.run();
+        assert(fresh.readFromOutputPort().get<Image>().getData()[0] == 25);
+        assert(OffsetPointCalculator::processCount == 1 && fresh.getGatedSkipCount() == 0);
+
+        bool thrown = false;
+        try {
+            scheduler.gateCalculator("Missing", "Frame", kTagOutput);
+        } catch (const CalculatorException&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        try {
+            Port().peek();
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown && "peeking an empty port must throw");
+        cout << "Gated calculator PASSED" << endl;
+    }
+};
 
+int SchedulerTest::outputCallbackCount = 0;
 
 #endif // SCHEDULER_TEST_H
 
@@ -0,0 +1,196 @@
+#ifndef SHARED_FRAME_RING_TEST_H
+#define SHARED_FRAME_RING_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/sharedframering.h"
+#include "TestFrames.h"
+
+using namespace std;
+
+class SharedFrameRingTest {
+public:
+    static void run() {
+        cout << "Starting SharedFrameRing Tests...\n";
+
+        testReadWrite();
+        testRelease();
+        testCounterWrap();
+        testNamed();
+        testTwoProcesses();
+
+        cout << "All SharedFrameRing Tests Completed.\n";
+    }
+
+private:
+    static void testReadWrite() {
+        SharedFrameRing ring = SharedFrameRing::create(3, 32 * 16 * 3);
+        assert(ring.getSlotCount() == 3 && ring.getSlotBytes() == 32 * 16 * 3);
+
+        const Image first = makeTestFrame(32, 16, PixelFormat::RGB24, 1);
+        assert(ring.write(first, 100));
+
+        // Render in place, nothing is copied
+        ImageView view(nullptr, 0, 0, PixelFormat::UNKNOWN, 0);
+        assert(ring.acquire(8, 4, PixelFormat::GRAYSCALE8, view));
+        for (int32_t y = 0; y < 4; ++y) {
+            for (int32_t x = 0; x < 8; ++x) view.row(y)[x] = static_cast<uint8_t>(y * 8 + x);
+        }
+        ring.publish(200);
+        assert(ring.size() == 2);
+
+        SharedFrame frame;
+        assert(ring.read(frame) && frame.isValid());
+        assert(frame.getWidth() == 32 && frame.getFormat() == PixelFormat::RGB24 && frame.getTimestamp() == 100);
+        assert(frame.toImage().getData() == first.getData());
+
+        // Input callbacks wrap the frames in packets
+        Packet packet = SharedFrameRing::readPacket(&ring);
+        const SharedFrame& second = packet.get<SharedFrame>();
+        assert(second.getTimestamp() == 200 && second.getSize() == 32);
+        assert(second.view().row(3)[7] == 31);
+        assert(!SharedFrameRing::readPacket(&ring).isValid());
+
+        bool thrown = false;
+        try {
+            ring.write(makeTestFrame(64, 16, PixelFormat::RGB24, 0), 300);
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Read write test PASSED" << endl;
+    }
+
+    static void testRelease() {
+        SharedFrameRing ring = SharedFrameRing::create(2, 64);
+        const Image frame(4, 4, PixelFormat::GRAYSCALE8);
+        assert(ring.write(frame, 1) && ring.write(frame, 2));
+        assert(!ring.write(frame, 3) && "the ring is full");
+
+        SharedFrame first, second;
+        assert(ring.read(first) && ring.read(second));
+        // Slots are returned in order, the second one waits for the first
+        second = SharedFrame();
+        assert(ring.size() == 2);
+        SharedFrame copy = first;
+        first = SharedFrame();
+        assert(ring.size() == 2);
+        copy = SharedFrame();
+        assert(ring.size() == 0);
+        assert(ring.write(frame, 3));
+
+        // Closing still lets the consumer drain
+        ring.close();
+        assert(!ring.write(frame, 4));
+        SharedFrame last;
+        assert(ring.read(last, 1000) && last.getTimestamp() == 3);
+        assert(!ring.read(last, 1000));
+        cout << "Release test PASSED" << endl;
+    }
+
+    static void testCounterWrap() {
+        // 3 slots do not divide 2^32: start the counters just below it
+        SharedFrameRing producer = SharedFrameRing::create(3, 16);
+        const size_t page = SharedFrameMapping::pageSize();
+        void* base = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_SHARED, producer.getFd(), 0);
+        assert(base != MAP_FAILED);
+        SharedFrameMapping::Header* header = static_cast<SharedFrameMapping::Header*>(base);
+        header->head.store(0xFFFFFFFEull);
+        header->tail.store(0xFFFFFFFEull);
+        SharedFrameRing consumer = SharedFrameRing::attach(producer.getFd());
+
+        // Full rings held across the boundary keep every frame in its own slot
+        for (uint8_t round = 0; round < 4; ++round) {
+            for (uint8_t i = 0; i < 3; ++i) {
+                const uint8_t level = static_cast<uint8_t>(round * 3 + i);
+                assert(producer.write(Image(4, 4, PixelFormat::GRAYSCALE8, vector<uint8_t>(16, level)), level));
+            }
+            assert(producer.size() == 3 && !producer.write(Image(4, 4, PixelFormat::GRAYSCALE8), 0));
+            SharedFrame frames[3];
+            for (uint8_t i = 0; i < 3; ++i) {
+                assert(consumer.read(frames[i]));
+                const uint8_t level = static_cast<uint8_t>(round * 3 + i);
+                assert(frames[i].getTimestamp() == level && frames[i].getData()[15] == level);
+            }
+        }
+        assert(producer.size() == 0 && header->head.load() == 0xFFFFFFFEull + 12);
+        munmap(base, page);
+        cout << "Counter wrap test PASSED" << endl;
+    }
+
+    static void testNamed() {
+        const string name = "/shared_frame_ring_test_" + to_string(getpid());
+        SharedFrameRing producer = SharedFrameRing::create(4, 1024, name);
+        SharedFrameRing consumer = SharedFrameRing::open(name);
+        SharedFrameRing::unlink(name);
+
+        assert(producer.write(makeTestFrame(10, 10, PixelFormat::RGB24, 9), 42));
+        SharedFrame frame;
+        assert(consumer.read(frame) && frame.getTimestamp() == 42);
+        assert(frame.toImage().getData() == makeTestFrame(10, 10, PixelFormat::RGB24, 9).getData());
+        frame = SharedFrame();
+        assert(producer.size() == 0);
+
+        bool thrown = false;
+        try {
+            SharedFrameRing::open(name);
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // A descriptor that is not a ring
+        int fd = memfd_create("not_a_ring", MFD_CLOEXEC);
+        assert(ftruncate(fd, 8192) == 0);
+        thrown = false;
+        try {
+            SharedFrameRing::attach(fd);
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        close(fd);
+        cout << "Named ring test PASSED" << endl;
+    }
+
+    static void testTwoProcesses() {
+        // More frames than slots, the producer waits for the consumer
+        const int32_t frames = 40, width = 64, height = 48;
+        SharedFrameRing ring = SharedFrameRing::create(2, width * height);
+        pid_t child = fork();
+        assert(child >= 0);
+        if (child == 0) {
+            SharedFrameRing producer = SharedFrameRing::attach(ring.getFd());
+            for (int32_t i = 0; i < frames; ++i) {
+                ImageView view(nullptr, 0, 0, PixelFormat::UNKNOWN, 0);
+                if (!producer.acquire(width, height, PixelFormat::GRAYSCALE8, view, 5000000)) _exit(1);
+                for (int32_t y = 0; y < height; ++y) {
+                    for (int32_t x = 0; x < width; ++x) view.row(y)[x] = static_cast<uint8_t>(i + x + y);
+                }
+                producer.publish(1000 + i);
+            }
+            producer.close();
+            _exit(0);
+        }
+
+        int32_t received = 0;
+        SharedFrame frame;
+        while (ring.read(frame, 5000000)) {
+            assert(frame.getTimestamp() == 1000 + received);
+            const ConstImageView view = frame.view();
+            assert(view.row(0)[0] == static_cast<uint8_t>(received));
+            assert(view.row(height - 1)[width - 1] == static_cast<uint8_t>(received + width + height - 2));
+            frame = SharedFrame();
+            ++received;
+        }
+        assert(received == frames && ring.isClosed());
+        int status = 0;
+        assert(waitpid(child, &status, 0) == child);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        cout << "Two processes test PASSED" << endl;
+    }
+};
+
+#endif // SHARED_FRAME_RING_TEST_H
@@ -0,0 +1,130 @@
+#ifndef STATIC_PIPELINE_TEST_H
+#define STATIC_PIPELINE_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../src/staticpipeline.h"
+#include "../src/image.h"
+#include "../src/scheduler.h"
+#include "../examples/calculators/pixelcalculator.h"
+#include "../examples/calculators/dithercalculator.h"
+#include "../examples/calculators/graycalculator.h"
+
+using namespace std;
+
+/**
+ * Stage that adds a constant to every byte of the image.
+ */
+struct AddStage {
+    int amount;
+    void process(Image& image) {
+        for (uint8_t& value : image.getData()) {
+            value = static_cast<uint8_t>(value + amount);
+        }
+    }
+};
+
+/**
+ * Stage that doubles every byte and counts its lifecycle hooks.
+ */
+struct DoubleStage {
+    int enterCount = 0;
+    int closeCount = 0;
+    void enter(Image& image) { enterCount++; }
+    void process(Image& image) {
+        for (uint8_t& value : image.getData()) {
+            value = static_cast<uint8_t>(value * 2);
+        }
+    }
+    void close(Image& image) { closeCount++; }
+};
+
+class StaticPipelineTest {
+public:
+    static void run() {
+        cout << "Starting StaticPipeline Tests...\n";
+
+        testStageOrder();
+        testLifecycleHooks();
+        testMatchesScheduler();
+
+        cout << "All StaticPipeline Tests Completed.\n";
+    }
+
+private:
+    static void testStageOrder() {
+        StaticPipeline<AddStage, DoubleStage, AddStage> pipeline(
+            AddStage{1}, DoubleStage(), AddStage{3});
+        static_assert(StaticPipeline<AddStage, DoubleStage, AddStage>::size() == 3,
+                      "pipeline should have three stages");
+
+        Image image(4, 4, PixelFormat::RGBA32, vector<uint8_t>(4 * 4 * 4, 10));
+        pipeline.process(image);
+
+        for (uint8_t value : image.getData()) {
+            assert(value == (10 + 1) * 2 + 3 && "stages should run in order");
+        }
+        cout << "Stage order test PASSED" << endl;
+    }
+
+    static void testLifecycleHooks() {
+        static_assert(!HasEnterHook<AddStage>::value, "AddStage has no enter hook");
+        static_assert(HasEnterHook<DoubleStage>::value, "DoubleStage has an enter hook");
+        static_assert(HasCloseHook<DoubleStage>::value, "DoubleStage has a close hook");
+
+        StaticPipeline<AddStage, DoubleStage> pipeline(AddStage{0}, DoubleStage());
+        Image image(2, 2, PixelFormat::RGBA32, vector<uint8_t>(2 * 2 * 4, 1));
+        const int kFrames = 3;
+        for (int i = 0; i < kFrames; i++) {
+            pipeline.process(image);
+        }
+
+        assert(pipeline.getStage<1>().enterCount == kFrames);
+        assert(pipeline.getStage<1>().closeCount == kFrames);
+        assert(image.getData()[0] == 8);
+        cout << "Lifecycle hooks test PASSED" << endl;
+    }
+
+    static void testMatchesScheduler() {
+        // The kernels of the calculators compose into the same chain as the graph
+        Image frame(64, 48, PixelFormat::RGBA32);
+        uint32_t seed = 7;
+        for (uint8_t& value : frame.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+
+        shared_ptr<map<string, Packet>> sidePackets = make_shared<map<string, Packet>>();
+        (*sidePackets)["pixelSize"] = Packet(4);
+        (*sidePackets)["pixeShape"] = Packet(1);
+        (*sidePackets)["redCount"] = Packet(3);
+        (*sidePackets)["greenCount"] = Packet(6);
+        (*sidePackets)["blueCount"] = Packet(3);
+        (*sidePackets)["spread"] = Packet(3);
+        (*sidePackets)["bayerLevel"] = Packet(2);
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new PixelShapeCalculator(), sidePackets);
+        scheduler.registerCalculator(new DitherCalculator(), sidePackets);
+        scheduler.registerCalculator(new GrayscaleCalculator(), sidePackets);
+        scheduler.connectCalculators();
+        scheduler.connectOutput("GrayscaleCalculator", "ImageGrayscale");
+        scheduler.writeToInputPort(Packet(frame));
+        scheduler.run();
+        Packet graphOutput = scheduler.readFromOutputPort();
+        assert(graphOutput.isValid() && "the graph should emit the frame in one tick");
+
+        StaticPipeline<PixelShapeKernel, DitherKernel, GrayscaleKernel> pipeline(
+            PixelShapeKernel(4, 1), DitherKernel(3, 6, 3, 3, 2), GrayscaleKernel());
+        Image image = frame;
+        pipeline.process(image);
+
+        const Image& expected = graphOutput.get<Image>();
+        assert(image.getFormat() == expected.getFormat() && image.getWidth() == expected.getWidth());
+        assert(image.getData() == expected.getData() && "same output as the scheduler graph");
+        cout << "Matches scheduler test PASSED" << endl;
+    }
+};
+
+#endif // STATIC_PIPELINE_TEST_H
@@ -0,0 +1,114 @@
+#ifndef STATISTICS_TEST_H
+#define STATISTICS_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../src/scheduler.h"
+#include "../examples/calculators/statisticscalculator.h"
+
+using namespace std;
+
+class StatisticsTest {
+public:
+    static void run() {
+        cout << "Starting Statistics Tests...\n";
+
+        testKnownImages();
+        testBands();
+        testSideOutput();
+
+        cout << "All Statistics Tests Completed.\n";
+    }
+
+private:
+    static void testKnownImages() {
+        const Image gray(4, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{10, 20, 30, 40, 50, 60, 70, 80});
+        ImageStatistics statistics = StatisticsKernel().measure(gray);
+        assert(statistics.pixelCount == 8 && statistics.minLuma == 10 && statistics.maxLuma == 80);
+        assert(statistics.meanLuma == 45.0);
+        assert(statistics.lumaHistogram[10] == 1 && statistics.lumaHistogram[80] == 1 && statistics.lumaHistogram[15] == 0);
+        assert(statistics.clippedLow == 0 && statistics.clippedHigh == 0);
+
+        // Lumas 0, 255 and (54 * 255 + 19 * 128) >> 8 = 63
+        const Image rgb(3, 1, PixelFormat::RGB24, vector<uint8_t>{0, 0, 0,  255, 255, 255,  255, 0, 128});
+        statistics = StatisticsKernel().measure(rgb);
+        assert(statistics.pixelCount == 3 && statistics.minLuma == 0 && statistics.maxLuma == 255);
+        assert(statistics.lumaHistogram[0] == 1 && statistics.lumaHistogram[255] == 1 && statistics.lumaHistogram[63] == 1);
+        assert(statistics.meanLuma == 106.0);
+        assert(statistics.clippedLow == 2 && statistics.clippedHigh == 2);
+
+        // Packed formats are not measured
+        statistics = StatisticsKernel().measure(Image(8, 1, PixelFormat::GRAYSCALE1, vector<uint8_t>{0xFF}));
+        assert(statistics.pixelCount == 0);
+        cout << "Known images test PASSED" << endl;
+    }
+
+    static void testBands() {
+        // Tall enough for several row bands, compared with a direct count
+        const int32_t width = 97, height = 301;
+        Image image(width, height, PixelFormat::RGBA32);
+        uint32_t seed = 12345;
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+        image.setData(image.getData());
+
+        array<uint32_t, 256> histogram{};
+        uint64_t low = 0, high = 0, sum = 0;
+        const uint8_t* pixel = image.getData().data();
+        for (int32_t i = 0; i < width * height; ++i, pixel += 4) {
+            const uint32_t luma = (54 * pixel[0] + 183 * pixel[1] + 19 * pixel[2]) >> 8;
+            histogram[luma]++;
+            sum += luma;
+            low += min(pixel[0], min(pixel[1], pixel[2])) == 0;
+            high += max(pixel[0], max(pixel[1], pixel[2])) == 255;
+        }
+
+        const ImageStatistics statistics = StatisticsKernel().measure(image);
+        assert(statistics.lumaHistogram == histogram);
+        assert(statistics.pixelCount == static_cast<uint64_t>(width) * height);
+        assert(statistics.clippedLow == low && statistics.clippedHigh == high);
+        assert(statistics.meanLuma == static_cast<double>(sum) / (width * height));
+        cout << "Bands test PASSED" << endl;
+    }
+
+    static void testSideOutput() {
+        const Image dark(2, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{0, 0, 10, 10});
+        const Image bright(2, 2, PixelFormat::GRAYSCALE8, vector<uint8_t>{200, 255, 255, 255});
+
+        // The frames move on untouched, one statistics packet per frame
+        StatisticsCalculator calculator;
+        unique_ptr<CalculatorContext> cc = calculator.registerContext();
+        Port input;
+        cc->bindInputPort("kTagInput", input);
+        input.write(Packet(dark));
+        calculator.process(cc.get(), 0);
+        input.write(Packet(bright));
+        calculator.process(cc.get(), 0);
+        Port& frames = cc->getOutputPort("ImageMeasured");
+        assert(frames.size() == 2);
+        assert(frames.read().get<Image>().getData() == dark.getData());
+        assert(frames.read().get<Image>().getData() == bright.getData());
+        assert(cc->getSideOutputPort("ImageStatistics").size() == 2);
+
+        // Applications read the side output through the scheduler
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new StatisticsCalculator());
+        scheduler.connectCalculators();
+        scheduler.writeToInputPort(Packet(dark));
+        scheduler.run();
+        scheduler.writeToInputPort(Packet(bright));
+        scheduler.run();
+        Port& side = scheduler.getSideOutputPort("StatisticsCalculator", "ImageStatistics");
+        assert(side.size() == 2);
+        const ImageStatistics first = side.read().get<ImageStatistics>();
+        assert(first.meanLuma == 5.0 && first.clippedLow == 2 && first.maxLuma == 10);
+        const ImageStatistics second = side.read().get<ImageStatistics>();
+        assert(second.minLuma == 200 && second.clippedHigh == 3 && second.lumaHistogram[255] == 3);
+        cout << "Side output test PASSED" << endl;
+    }
+};
+
+#endif // STATISTICS_TEST_H
@@ -0,0 +1,173 @@
+#ifndef TCP_FRAME_TRANSPORT_TEST_H
+#define TCP_FRAME_TRANSPORT_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include "../src/tcpframetransport.h"
+#include "TestFrames.h"
+
+using namespace std;
+
+class TcpFrameTransportTest {
+public:
+    static void run() {
+        cout << "Starting TcpFrameTransport Tests...\n";
+
+        testBatching();
+        testLargeFrames();
+        testCredits();
+        testSlowReceiver();
+        testForgedHeaders();
+
+        cout << "All TcpFrameTransport Tests Completed.\n";
+    }
+
+private:
+    static void testBatching() {
+        TcpFrameReceiver receiver(0, 16, "127.0.0.1");
+        TcpFrameSender sender("127.0.0.1", receiver.getPort());
+        assert(receiver.accept(1000000) && receiver.isConnected());
+
+        // Small frames share one write
+        for (int32_t i = 0; i < 10; ++i) {
+            assert(sender.send(makeTestFrame(20, 10, PixelFormat::GRAYSCALE8, static_cast<uint8_t>(i)), 100 + i));
+        }
+        assert(sender.getWriteCount() == 0 && sender.getCredits() == 6);
+        sender.flush();
+        assert(sender.getWriteCount() == 1);
+
+        for (int32_t i = 0; i < 10; ++i) {
+            Packet packet;
+            long long timestamp = 0;
+            assert(receiver.receive(packet, timestamp, 1000000));
+            assert(timestamp == 100 + i);
+            assert(packet.get<Image>().getData() == makeTestFrame(20, 10, PixelFormat::GRAYSCALE8, static_cast<uint8_t>(i)).getData());
+        }
+        Packet none = TcpFrameReceiver::readPacket(&receiver);
+        assert(!none.isValid());
+
+        // Compressed images travel as they are, packets without an image are skipped
+        TcpFrameSender::writePacket(Packet(Image(320, 200, PixelFormat::JPEG, vector<uint8_t>{0xFF, 0xD8, 0xFF, 0xD9})), &sender);
+        TcpFrameSender::writePacket(Packet(3), &sender);
+        sender.flush();
+        Packet packet;
+        for (int32_t i = 0; i < 100 && !packet.isValid(); ++i) {
+            usleep(1000);
+            packet = TcpFrameReceiver::readPacket(&receiver);
+        }
+        assert(packet.get<Image>().getFormat() == PixelFormat::JPEG && packet.get<Image>().getWidth() == 320);
+        cout << "Batching test PASSED" << endl;
+    }
+
+    static void testLargeFrames() {
+        TcpFrameReceiver receiver(0, 4, "127.0.0.1");
+        TcpFrameSender sender("127.0.0.1", receiver.getPort());
+        assert(receiver.accept(1000000));
+
+        // A pending small frame goes out with the large one
+        const Image small = makeTestFrame(8, 8, PixelFormat::RGB24, 1);
+        const Image large = makeTestFrame(640, 360, PixelFormat::RGBA32, 2);
+        assert(sender.send(small, 1) && sender.getWriteCount() == 0);
+        thread reader([&] {
+            for (int32_t i = 0; i < 2; ++i) {
+                Packet packet;
+                long long timestamp = 0;
+                assert(receiver.receive(packet, timestamp, 2000000));
+                assert(packet.get<Image>().getData() == (i == 0 ? small : large).getData());
+                assert(timestamp == i + 1);
+            }
+        });
+        assert(sender.send(large, 2));
+        reader.join();
+        cout << "Large frames test PASSED" << endl;
+    }
+
+    static void testCredits() {
+        TcpFrameReceiver receiver(0, 2, "127.0.0.1");
+        TcpFrameSender sender("127.0.0.1", receiver.getPort());
+        const Image frame = makeTestFrame(16, 16, PixelFormat::GRAYSCALE8, 0);
+        assert(!sender.send(frame, 1, 0) && "no credit before the receiver accepts");
+        assert(receiver.accept(1000000));
+
+        // The window is full until the receiver consumes a frame
+        assert(sender.send(frame, 1, 1000000) && sender.send(frame, 2, 0));
+        assert(!sender.send(frame, 3, 0) && sender.getStallCount() > 0);
+        Packet packet;
+        long long timestamp = 0;
+        assert(receiver.receive(packet, timestamp, 1000000) && timestamp == 1);
+        assert(sender.send(frame, 3, 1000000));
+        sender.flush();
+        assert(receiver.receive(packet, timestamp, 1000000) && timestamp == 2);
+        assert(receiver.receive(packet, timestamp, 1000000) && timestamp == 3);
+        cout << "Credits test PASSED" << endl;
+    }
+
+    static void testSlowReceiver() {
+        // A slow consumer throttles the producer, never more than the window in flight
+        const uint32_t window = 3;
+        const int32_t frames = 30;
+        TcpFrameReceiver receiver(0, window, "127.0.0.1");
+        int32_t received = 0;
+        thread consumer([&] {
+            Packet packet;
+            long long timestamp = 0;
+            while (receiver.receive(packet, timestamp, 2000000)) {
+                assert(timestamp == received && packet.get<Image>().getWidth() == 256);
+                ++received;
+                usleep(500);
+            }
+        });
+        {
+            TcpFrameSender sender("127.0.0.1", receiver.getPort());
+            const Image frame = makeTestFrame(256, 256, PixelFormat::RGBA32, 7);
+            for (int32_t i = 0; i < frames; ++i) {
+                assert(sender.send(frame, i, 2000000));
+                assert(sender.getCredits() < window);
+            }
+            assert(sender.getStallCount() > 0);
+        }
+        consumer.join();
+        assert(received == frames && receiver.isClosed());
+        cout << "Slow receiver test PASSED" << endl;
+    }
+
+    static void testForgedHeaders() {
+        // Headers are rejected before the announced size is allocated
+        auto rejects = [](uint8_t format, uint32_t width, uint32_t height, uint64_t size) {
+            TcpFrameReceiver receiver(0, 4, "127.0.0.1", 1 << 20);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(receiver.getPort());
+            inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+            const int fd = socket(AF_INET, SOCK_STREAM, 0);
+            assert(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+            uint8_t header[TcpFrameProtocol::kFrameHeaderBytes] = {TcpFrameProtocol::FRAME, format};
+            TcpFrameProtocol::putU32(header + 4, width);
+            TcpFrameProtocol::putU32(header + 8, height);
+            TcpFrameProtocol::putU64(header + 20, size);
+            assert(::write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)));
+            bool thrown = false;
+            try {
+                Packet packet;
+                long long timestamp = 0;
+                receiver.receive(packet, timestamp, 1000000);
+            } catch (const PortException&) {
+                thrown = true;
+            }
+            ::close(fd);
+            return thrown;
+        };
+        const uint8_t rgba = static_cast<uint8_t>(PixelFormat::RGBA32);
+        const uint8_t jpeg = static_cast<uint8_t>(PixelFormat::JPEG);
+        assert(rejects(rgba, 640, 360, 4ull << 30) && "larger than the cap");
+        assert(rejects(rgba, 640, 360, 640 * 360 * 4 - 1) && "not the size of the rows");
+        assert(rejects(rgba, 1024, 1024, 1024 * 1024 * 4) && "rows larger than the cap");
+        assert(rejects(rgba, 0x80000000u, 1, 4) && "negative width");
+        assert(rejects(0, 16, 16, 256) && "unknown format");
+        assert(rejects(jpeg, 640, 360, (1 << 20) + 1) && "compressed frame larger than the cap");
+        cout << "Forged headers test PASSED" << endl;
+    }
+};
+
+#endif // TCP_FRAME_TRANSPORT_TEST_H
@@ -0,0 +1,26 @@
+#ifndef TEST_FRAMES_H
+#define TEST_FRAMES_H
+
+#include <cstdint>
+#include "../src/image.h"
+
+using namespace std;
+
+/**********************************
+ * Creates a frame filled with a pattern that differs per seed.
+ * The pattern does not repeat within a row, so shifted or swapped bytes show up.
+ * @param width Width of the frame.
+ * @param height Height of the frame.
+ * @param format Pixel format of the frame.
+ * @param seed Seed of the pattern.
+ * @return The frame.
+ **********************************/
+inline Image makeTestFrame(int32_t width, int32_t height, PixelFormat format, uint8_t seed) {
+    Image image(width, height, format);
+    for (size_t i = 0; i < image.getData().size(); ++i) {
+        image.getData()[i] = static_cast<uint8_t>(seed + i * 5 + i / 251);
+    }
+    return image;
+}
+
+#endif // TEST_FRAMES_H
@@ -0,0 +1,123 @@
+#ifndef TEXT_OVERLAY_TEST_H
+#define TEXT_OVERLAY_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include "../examples/calculators/textoverlaycalculator.h"
+
+using namespace std;
+
+class TextOverlayTest {
+public:
+    static void run() {
+        cout << "Starting TextOverlay Tests...\n";
+
+        testSetText();
+        testBlend();
+        testClipping();
+
+        cout << "All TextOverlay Tests Completed.\n";
+    }
+
+private:
+    static Image noise(int32_t width, int32_t height, PixelFormat format) {
+        Image image(width, height, format);
+        uint32_t seed = 41;
+        for (uint8_t& value : image.getData()) {
+            seed = seed * 1103515245 + 12345;
+            value = static_cast<uint8_t>(seed >> 16);
+        }
+        image.setData(image.getData());
+        return image;
+    }
+
+    // Per-pixel blend of the atlas glyphs, p = (p * (256 - a) + c * a + 128) >> 8
+    static vector<uint8_t> reference(const Image& image, const string& text, int32_t scale, int32_t startX,
+                                     int32_t startY, const array<uint8_t, 4>& pixelColor, uint8_t opacity) {
+        const GlyphAtlas atlas(scale, opacity);
+        const int32_t bytesPerPixel = static_cast<int32_t>(image.getStride() / image.getWidth());
+        vector<uint8_t> expected = image.getData();
+        for (int32_t y = 0; y < image.getHeight(); ++y) {
+            for (int32_t x = 0; x < image.getWidth(); ++x) {
+                const int32_t dx = x - startX, dy = y - startY;
+                if (dx < 0 || dy < 0 || dy >= atlas.getCellHeight()) continue;
+                const size_t character = dx / atlas.getCellWidth();
+                if (character >= text.size()) continue;
+                const uint8_t coverage = atlas.cellRow(atlas.cellOf(text[character]), dy)[dx % atlas.getCellWidth()];
+                const int32_t alpha = coverage + (coverage >> 7);
+                uint8_t* pixel = expected.data() + y * image.getStride() + x * bytesPerPixel;
+                for (int32_t channel = 0; channel < bytesPerPixel; ++channel) {
+                    pixel[channel] = static_cast<uint8_t>((pixel[channel] * (256 - alpha) + pixelColor[channel] * alpha + 128) >> 8);
+                }
+            }
+        }
+        return expected;
+    }
+
+    static void testSetText() {
+        TextOverlayKernel kernel;
+        assert(kernel.setText("12:00:00.000") == 12);
+        assert(kernel.setText("12:00:00.000") == 0 && "same text, nothing copied");
+        assert(kernel.setText("12:00:00.040") == 1);
+        assert(kernel.setText("12:00:01.041") == 2);
+        assert(kernel.setText("frame 7") == 7 && "a new length lays out everything");
+
+        // The layer follows the changes, drawn the same as a fresh kernel
+        TextOverlayKernel fresh;
+        fresh.setText("frame 7");
+        Image image = noise(120, 30, PixelFormat::RGB24);
+        Image freshImage = image;
+        kernel.process(image);
+        fresh.process(freshImage);
+        assert(image.getData() == freshImage.getData());
+        cout << "Set text test PASSED" << endl;
+    }
+
+    static void testBlend() {
+        // 3 cells of 12 pixels: two 16 pixel SIMD spans and a 4 pixel tail, partial opacity
+        const string text = "A1:";
+        const array<uint8_t, 4> rgba = {0x20, 0xC0, 0x80, 255};
+        for (PixelFormat format : {PixelFormat::RGBA32, PixelFormat::RGB24, PixelFormat::GRAYSCALE8}) {
+            const Image source = noise(45, 23, format);
+            Image image = source;
+            TextOverlayKernel kernel(2, 3, 2, 0x20C080, 200);
+            kernel.setText(text);
+            kernel.process(image);
+
+            // Luma of the color for gray images
+            const array<uint8_t, 4> color = format == PixelFormat::GRAYSCALE8 ?
+                array<uint8_t, 4>{static_cast<uint8_t>((54 * 0x20 + 183 * 0xC0 + 19 * 0x80) >> 8), 255, 255, 255} : rgba;
+            assert(image.getData() == reference(source, text, 2, 3, 2, color, 200));
+            assert(image.getData() != source.getData());
+        }
+        cout << "Blend test PASSED" << endl;
+    }
+
+    static void testClipping() {
+        // Text hanging past the right and bottom edges, then past the left and top edges
+        const array<uint8_t, 4> white = {255, 255, 255, 255};
+        const int32_t corners[2][2] = {{30, 14}, {-7, -5}};
+        for (const auto& corner : corners) {
+            for (PixelFormat format : {PixelFormat::RGBA32, PixelFormat::GRAYSCALE8}) {
+                const Image source = noise(40, 20, format);
+                Image image = source;
+                TextOverlayKernel kernel(2, corner[0], corner[1]);
+                kernel.setText("W8W8");
+                kernel.process(image);
+                assert(image.getData().size() == source.getData().size());
+                assert(image.getData() == reference(source, "W8W8", 2, corner[0], corner[1], white, 255));
+            }
+        }
+
+        // Entirely outside the image
+        const Image source = noise(40, 20, PixelFormat::RGBA32);
+        Image image = source;
+        TextOverlayKernel kernel(2, 40, 0);
+        kernel.setText("W");
+        kernel.process(image);
+        assert(image.getData() == source.getData());
+        cout << "Clipping test PASSED" << endl;
+    }
+};
+
+#endif // TEXT_OVERLAY_TEST_H
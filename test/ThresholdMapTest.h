@@ -0,0 +1,91 @@
+#ifndef THRESHOLD_MAP_TEST_H
+#define THRESHOLD_MAP_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include "../src/thresholdmap.h"
+
+using namespace std;
+
+class ThresholdMapTest {
+public:
+    static void run() {
+        cout << "Starting ThresholdMap Tests...\n";
+
+        testBayerMatrix();
+        testExpandRow();
+        testBlueNoise();
+
+        cout << "All ThresholdMap Tests Completed.\n";
+    }
+
+private:
+    static void testBayerMatrix() {
+        constexpr auto bayer2 = makeBayerMatrix<2>();
+        static_assert(bayer2[0] == 0 && bayer2[1] == 2 && bayer2[2] == 3 && bayer2[3] == 1,
+                      "2x2 Bayer matrix");
+
+        // Matches the classic 4x4 table
+        const uint16_t bayer4[16] = {0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5};
+        constexpr auto generated = makeBayerMatrix<4>();
+        assert(equal(generated.begin(), generated.end(), bayer4));
+
+        // Every rank appears once
+        auto bayer16 = makeBayerMatrix<16>();
+        sort(bayer16.begin(), bayer16.end());
+        for (size_t i = 0; i < bayer16.size(); ++i) {
+            assert(bayer16[i] == i);
+        }
+        cout << "Bayer matrix test PASSED" << endl;
+    }
+
+    static void testExpandRow() {
+        const ThresholdMap& map = ThresholdMap::bayerForLevel(0);
+        assert(map.getWidth() == 2 && map.getLevels() == 4);
+
+        // Row 1 of the 2x2 matrix is {3, 1}, tiled over 5 columns
+        vector<uint32_t> row(5);
+        map.expandRow(1, row.size(), 2, row.data());
+        const uint32_t quarter = ThresholdMap::kFixedOne / 4;
+        vector<uint32_t> expected = {6 * quarter, 2 * quarter, 6 * quarter, 2 * quarter, 6 * quarter};
+        assert(row == expected);
+
+        bool thrown = false;
+        try {
+            ThresholdMap(3, 2, 4, vector<uint16_t>(6, 0));
+        } catch (const ImageException&) {
+            thrown = true;
+        }
+        assert(thrown && "sizes must be powers of two");
+        cout << "Expand row test PASSED" << endl;
+    }
+
+    static void testBlueNoise() {
+        ThresholdMap map = ThresholdMap::blueNoise(16);
+        assert(map.getLevels() == 256);
+
+        vector<uint16_t> ranks;
+        for (int32_t y = 0; y < 16; ++y) {
+            for (int32_t x = 0; x < 16; ++x) {
+                ranks.push_back(map.getRank(x, y));
+            }
+        }
+        sort(ranks.begin(), ranks.end());
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            assert(ranks[i] == i && "blue noise ranks should be a permutation");
+        }
+
+        // The darkest eighth should not clump: no two neighbours share it
+        for (int32_t y = 0; y < 16; ++y) {
+            for (int32_t x = 0; x < 16; ++x) {
+                if (map.getRank(x, y) >= 32) continue;
+                assert(map.getRank(x + 1, y) >= 32 || map.getRank(x, y + 1) >= 32);
+            }
+        }
+        cout << "Blue noise test PASSED" << endl;
+    }
+};
+
+#endif // THRESHOLD_MAP_TEST_H
@@ -0,0 +1,218 @@
+#ifndef UNIX_FRAME_TRANSPORT_TEST_H
+#define UNIX_FRAME_TRANSPORT_TEST_H
+
+#include <iostream>
+#include <cassert>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/scheduler.h"
+#include "../src/unixframetransport.h"
+#include "TestFrames.h"
+
+using namespace std;
+
+// Forwards its input packets untouched
+class RelayCalculator : public CalculatorBase {
+public:
+    RelayCalculator() : CalculatorBase("RelayCalculator") {}
+
+    unique_ptr<CalculatorContext> registerContext(const shared_ptr<map<string, Packet>>& newSidePacket = make_shared<map<string, Packet>>()) override {
+        return make_unique<CalculatorContext>(newSidePacket);
+    }
+
+    void enter(CalculatorContext* cc, float delta) override {}
+
+    void process(CalculatorContext* cc, float delta) override {
+        Port& input = cc->getInputPort("kTagInput");
+        while (input.size() > 0) cc->getOutputPort("kTagOutput").write(input.read());
+    }
+
+    void close(CalculatorContext* cc, float delta) override {}
+};
+
+class UnixFrameTransportTest {
+public:
+    static void run() {
+        cout << "Starting UnixFrameTransport Tests...\n";
+
+        testBroadcast();
+        testScheduler();
+        testUnsealed();
+        testTwoProcesses();
+
+        cout << "All UnixFrameTransport Tests Completed.\n";
+    }
+
+private:
+    static ino_t inode(int fd) {
+        struct stat info;
+        assert(fstat(fd, &info) == 0);
+        return info.st_ino;
+    }
+
+    static void testBroadcast() {
+        const string path = "unix_frame_test.sock";
+        UnixFrameServer server(path);
+        assert(server.send(makeTestFrame(4, 4, PixelFormat::RGBA32, 0), 1) == 0 && "no client yet");
+
+        UnixFrameClient first(path), second(path);
+        const Image image = makeTestFrame(40, 30, PixelFormat::RGBA32, 5);
+        assert(server.send(image, 77) == 2 && server.getClientCount() == 2);
+
+        // Both clients map the same sealed buffer
+        SealedFrame a, b;
+        assert(first.receive(a, 1000000) && second.receive(b, 1000000));
+        assert(a.getTimestamp() == 77 && a.getWidth() == 40 && a.getFormat() == PixelFormat::RGBA32);
+        assert(a.toImage().getData() == image.getData());
+        assert(b.view().row(29)[159] == image.getData()[29 * 160 + 159]);
+        assert(inode(a.getFd()) == inode(b.getFd()));
+        assert(::write(a.getFd(), "x", 1) < 0 && "the buffer is sealed");
+        assert(!first.receive(a) && "nothing pending");
+
+        // Compressed images travel as they are
+        Image compressed(640, 480, PixelFormat::JPEG, vector<uint8_t>{0xFF, 0xD8, 0xFF, 0xD9});
+        assert(server.send(compressed, 78) == 2);
+        assert(first.receive(a, 1000000) && a.getSize() == 4 && a.getFormat() == PixelFormat::JPEG);
+        assert(second.receive(b, 1000000));
+
+        // A client that went away is dropped on the next send
+        {
+            UnixFrameClient third(path);
+            assert(server.acceptClients() == 3);
+        }
+        assert(server.send(image, 79) == 2 && server.getClientCount() == 2);
+
+        bool thrown = false;
+        try {
+            UnixFrameClient missing("missing_socket.sock");
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        cout << "Broadcast test PASSED" << endl;
+    }
+
+    static void testScheduler() {
+        // A relay graph: frames from upstream are forwarded to downstream without a copy
+        UnixFrameServer upstream("unix_frame_up.sock");
+        UnixFrameClient relayInput("unix_frame_up.sock");
+        UnixFrameServer downstream("unix_frame_down.sock");
+        UnixFrameClient consumer("unix_frame_down.sock");
+        downstream.acceptClients();
+
+        Scheduler scheduler;
+        scheduler.setExecutionMode(ExecutionMode::DEPTH_FIRST);
+        scheduler.registerCalculator(new RelayCalculator());
+        scheduler.connectCalculators();
+        scheduler.registerInputCallback(UnixFrameClient::readPacket, &relayInput);
+        scheduler.registerOutputCallback(UnixFrameServer::writePacket, &downstream);
+
+        const Image image = makeTestFrame(16, 8, PixelFormat::RGBA32, 9);
+        SealedFrame frame;
+        for (int32_t i = 0; i < 3; ++i) {
+            assert(upstream.send(image, 100 + i) == 1);
+            for (int32_t tick = 0; tick < 10 && !consumer.receive(frame); ++tick) scheduler.run();
+            assert(frame.isValid() && frame.getTimestamp() == 100 + i);
+            assert(frame.toImage().getData() == image.getData());
+        }
+        assert(downstream.getSentCount() == 3);
+
+        // Image packets are sealed into a new buffer
+        UnixFrameServer::writePacket(Packet(makeTestFrame(2, 2, PixelFormat::RGBA32, 1)), &downstream);
+        UnixFrameServer::writePacket(Packet(5), &downstream);
+        UnixFrameServer::writePacket(Packet(), &downstream);
+        assert(consumer.receive(frame, 1000000) && frame.getWidth() == 2);
+        assert(!consumer.receive(frame));
+        cout << "Scheduler test PASSED" << endl;
+    }
+
+    static void testUnsealed() {
+        // A writable memfd passed by another producer is refused
+        int raw[2];
+        assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, raw) == 0);
+        int buffer = memfd_create("unsealed", MFD_CLOEXEC);
+        assert(ftruncate(buffer, 64) == 0);
+        SealedFrame::Header header{SealedFrame::kMagic, 4, 4, static_cast<int32_t>(PixelFormat::RGBA32), 1, 64};
+        iovec part = {&header, sizeof(header)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(rights), &buffer, sizeof(int));
+        assert(sendmsg(raw[0], &message, 0) == sizeof(header));
+
+        bool thrown = false;
+        int received = -1;
+        {
+            SealedFrame::Header copy;
+            iovec in = {&copy, sizeof(copy)};
+            alignas(cmsghdr) char inControl[CMSG_SPACE(sizeof(int))];
+            msghdr inMessage = {};
+            inMessage.msg_iov = &in;
+            inMessage.msg_iovlen = 1;
+            inMessage.msg_control = inControl;
+            inMessage.msg_controllen = sizeof(inControl);
+            assert(recvmsg(raw[1], &inMessage, 0) == sizeof(header));
+            memcpy(&received, CMSG_DATA(CMSG_FIRSTHDR(&inMessage)), sizeof(int));
+        }
+        try {
+            SealedFrame frame(received, header);
+        } catch (const PortException&) {
+            thrown = true;
+        }
+        assert(thrown);
+        assert(fcntl(received, F_GETFD) < 0 && "the descriptor is closed on failure");
+        close(buffer);
+        close(raw[0]);
+        close(raw[1]);
+        cout << "Unsealed buffer test PASSED" << endl;
+    }
+
+    static void testTwoProcesses() {
+        const string path = "unix_frame_fork.sock";
+        auto server = make_unique<UnixFrameServer>(path);
+        pid_t child = fork();
+        assert(child >= 0);
+        if (child == 0) {
+            // Exits with the number of valid frames received
+            int count = 0;
+            try {
+                UnixFrameClient client(path);
+                SealedFrame frame;
+                while (client.receive(frame, 5000000)) {
+                    const ConstImageView view = frame.view();
+                    if (view.row(0)[0] != static_cast<uint8_t>(frame.getTimestamp())) _exit(255);
+                    ++count;
+                }
+            } catch (const PortException&) {
+                _exit(254);
+            }
+            _exit(count);
+        }
+
+        for (int32_t tries = 0; tries < 5000 && server->acceptClients() == 0; ++tries) usleep(1000);
+        assert(server->getClientCount() == 1);
+        Image image = makeTestFrame(320, 240, PixelFormat::RGBA32, 0);
+        for (int32_t i = 0; i < 50; ++i) {
+            image.getData()[0] = static_cast<uint8_t>(i);
+            server->send(image, i);
+        }
+        // A slow client may lose frames, never receive a partial one
+        assert(server->getSentCount() + server->getDroppedCount() == 50);
+        const unsigned long long sent = server->getSentCount();
+        server.reset();
+
+        int status = 0;
+        assert(waitpid(child, &status, 0) == child);
+        assert(WIFEXITED(status) && static_cast<unsigned long long>(WEXITSTATUS(status)) == sent);
+        cout << "Two processes test PASSED" << endl;
+    }
+};
+
+#endif // UNIX_FRAME_TRANSPORT_TEST_H
@@ -4,6 +4,33 @@
 #include "CalculatorContextTest.h"
 #include "SchedulerTest.h"
 #include "ImageTest.h"
+#include "StaticPipelineTest.h"
+#include "GrayscaleTest.h"
+#include "DitherTest.h"
+#include "ThresholdMapTest.h"
+#include "PointLutTest.h"
+#include "ParallelTest.h"
+#include "Lut3DTest.h"
+#include "StatisticsTest.h"
+#include "ClaheTest.h"
+#include "ImageViewTest.h"
+#include "GeometryTest.h"
+#include "EdgeTest.h"
+#include "IntegralImageTest.h"
+#include "PixelShapeTest.h"
+#include "GlyphAtlasTest.h"
+#include "TextOverlayTest.h"
+#include "FramePoolTest.h"
+#include "MosaicTest.h"
+#include "SceneChangeTest.h"
+#include "QoiTest.h"
+#include "PngTest.h"
+#include "GifTest.h"
+#include "JpegTest.h"
+#include "SharedFrameRingTest.h"
+#include "UnixFrameTransportTest.h"
+#include "TcpFrameTransportTest.h"
+#include "PacketRecordingTest.h"
 
 long long Packet::lastTimestamp = 0;
 int main() {
@@ -11,7 +38,34 @@ int main() {
     //PortTest::run();
     //CalculatorContextTest::run();
     SchedulerTest::run();
-    //ImageTest::run();
+    StaticPipelineTest::run();
+    ImageTest::run();
+    GrayscaleTest::run();
+    DitherTest::run();
+    ThresholdMapTest::run();
+    PointLutTest::run();
+    ParallelTest::run();
+    Lut3DTest::run();
+    StatisticsTest::run();
+    ClaheTest::run();
+    ImageViewTest::run();
+    GeometryTest::run();
+    EdgeTest::run();
+    IntegralImageTest::run();
+    PixelShapeTest::run();
+    GlyphAtlasTest::run();
+    TextOverlayTest::run();
+    FramePoolTest::run();
+    MosaicTest::run();
+    SceneChangeTest::run();
+    QoiTest::run();
+    PngTest::run();
+    GifTest::run();
+    JpegTest::run();
+    SharedFrameRingTest::run();
+    UnixFrameTransportTest::run();
+    TcpFrameTransportTest::run();
+    PacketRecordingTest::run();
     //TypeIdTest::run();
     return 0;
 }